@@ -108,6 +108,12 @@ extern char *output_files[];
  */
 #define VISIBILITY_MAP_CRASHSAFE_CAT_VER 201107031
 
+/*
+ * The visibility map gained a second, all-frozen, bit per heap page with
+ * this catalog version.
+ */
+#define VISIBILITY_MAP_FROZEN_BIT_CAT_VER 201507021
+
 /*
  * pg_multixact format changed in 9.3 commit 0ac5ad5134f2769ccbaefec73844f85,
  * ("Improve concurrency of foreign key locking") which also updated catalog
@@ -0,0 +1,722 @@
+/*-------------------------------------------------------------------------
+ *
+ * brin.c
+ *	  Implementation of BRIN indexes for Postgres
+ *
+ * A BRIN index keeps, for each range of pagesPerRange consecutive heap
+ * blocks, a small summary of the values in the range.  A bitmap scan returns
+ * every page of each range whose summary is consistent with the scan keys,
+ * and leaves it to the executor to recheck the quals.  See README for
+ * details.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ * IDENTIFICATION
+ *			src/backend/access/brin/brin.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/brin_private.h"
+#include "access/heapam.h"
+#include "access/heapam_xlog.h"
+#include "access/relscan.h"
+#include "access/reloptions.h"
+#include "catalog/index.h"
+#include "executor/executor.h"
+#include "miscadmin.h"
+#include "nodes/tidbitmap.h"
+#include "storage/bufmgr.h"
+#include "storage/freespace.h"
+#include "storage/smgr.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+
+
+/*
+ * Working state for summarizing block ranges, during index build or VACUUM
+ */
+typedef struct BrinBuildState
+{
+	Relation	heap;
+	Relation	index;
+	IndexInfo  *indexInfo;
+	BrinDesc   *bdesc;
+	BrinRevmap *revmap;
+	BlockNumber pagesPerRange;
+	BufferAccessStrategy strategy;
+	EState	   *estate;
+	List	   *predicate;
+	TupleTableSlot *slot;
+	MemoryContext rangeCxt;		/* reset after each range */
+	double		heapTuples;		/* number of heap tuples seen */
+	double		numRanges;		/* number of ranges summarized */
+} BrinBuildState;
+
+/*
+ * Private state of a bitmap scan
+ */
+typedef struct BrinOpaqueData
+{
+	BrinDesc   *bdesc;
+	MemoryContext tempCxt;		/* reset after each range */
+} BrinOpaqueData;
+
+typedef BrinOpaqueData *BrinOpaque;
+
+
+static BrinBuildState *brin_begin_summarize(Relation heap, Relation index,
+					 BufferAccessStrategy strategy);
+static void brin_end_summarize(BrinBuildState *state);
+static BrinMemTuple *brin_scan_range(BrinBuildState *state,
+				BlockNumber heapBlk, BlockNumber nblocks);
+static void brin_summarize_range(BrinBuildState *state,
+					 BlockNumber heapBlk, BlockNumber nblocks);
+
+
+/*
+ * Set up for summarizing ranges of heap.
+ */
+static BrinBuildState *
+brin_begin_summarize(Relation heap, Relation index,
+					 BufferAccessStrategy strategy)
+{
+	BrinBuildState *state;
+	ExprContext *econtext;
+
+	state = (BrinBuildState *) palloc0(sizeof(BrinBuildState));
+	state->heap = heap;
+	state->index = index;
+	state->indexInfo = BuildIndexInfo(index);
+	state->bdesc = brin_build_desc(index);
+	state->revmap = brinRevmapInitialize(index, &state->pagesPerRange);
+	state->strategy = strategy;
+
+	/*
+	 * Need an EState for evaluation of index expressions and partial-index
+	 * predicates, as in IndexBuildHeapScan.
+	 */
+	state->estate = CreateExecutorState();
+	econtext = GetPerTupleExprContext(state->estate);
+	state->slot = MakeSingleTupleTableSlot(RelationGetDescr(heap));
+	econtext->ecxt_scantuple = state->slot;
+	state->predicate = (List *)
+		ExecPrepareExpr((Expr *) state->indexInfo->ii_Predicate,
+						state->estate);
+
+	state->rangeCxt = AllocSetContextCreate(CurrentMemoryContext,
+											"BRIN summarization context",
+											ALLOCSET_DEFAULT_MINSIZE,
+											ALLOCSET_DEFAULT_INITSIZE,
+											ALLOCSET_DEFAULT_MAXSIZE);
+	return state;
+}
+
+static void
+brin_end_summarize(BrinBuildState *state)
+{
+	ExecDropSingleTupleTableSlot(state->slot);
+	FreeExecutorState(state->estate);
+	MemoryContextDelete(state->rangeCxt);
+	brinRevmapTerminate(state->revmap);
+}
+
+/*
+ * Compute the summary of the heap range starting at heapBlk, looking at
+ * blocks below nblocks only.  The result is allocated in rangeCxt.
+ *
+ * Every tuple on the pages is included, live or not: a summary only has to
+ * cover the values that may be present, and reading dead tuples too spares
+ * us visibility checks.  As in heapgetpage, line pointers are collected
+ * under a share lock, and the tuples read afterwards with just the pin,
+ * which prevents them from being moved.
+ */
+static BrinMemTuple *
+brin_scan_range(BrinBuildState *state, BlockNumber heapBlk,
+				BlockNumber nblocks)
+{
+	IndexInfo  *indexInfo = state->indexInfo;
+	ExprContext *econtext = GetPerTupleExprContext(state->estate);
+	BrinMemTuple *dtup;
+	BlockNumber endBlk;
+	BlockNumber blkno;
+	MemoryContext oldcxt;
+
+	oldcxt = MemoryContextSwitchTo(state->rangeCxt);
+	dtup = brin_new_memtuple(state->bdesc, heapBlk);
+
+	endBlk = Min(nblocks, heapBlk + state->pagesPerRange);
+	for (blkno = heapBlk; blkno < endBlk; blkno++)
+	{
+		Buffer		buf;
+		Page		page;
+		OffsetNumber offsets[MaxHeapTuplesPerPage];
+		int			noffsets = 0;
+		OffsetNumber off;
+		OffsetNumber maxoff;
+		int			i;
+
+		CHECK_FOR_INTERRUPTS();
+
+		buf = ReadBufferExtended(state->heap, MAIN_FORKNUM, blkno,
+								 RBM_NORMAL, state->strategy);
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buf);
+		maxoff = PageIsNew(page) ? InvalidOffsetNumber :
+			PageGetMaxOffsetNumber(page);
+		for (off = FirstOffsetNumber; off <= maxoff; off = OffsetNumberNext(off))
+		{
+			if (ItemIdIsNormal(PageGetItemId(page, off)))
+				offsets[noffsets++] = off;
+		}
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+
+		for (i = 0; i < noffsets; i++)
+		{
+			ItemId		lp = PageGetItemId(page, offsets[i]);
+			HeapTupleData tuple;
+			Datum		values[INDEX_MAX_KEYS];
+			bool		isnull[INDEX_MAX_KEYS];
+			int			keyno;
+
+			tuple.t_data = (HeapTupleHeader) PageGetItem(page, lp);
+			tuple.t_len = ItemIdGetLength(lp);
+			tuple.t_tableOid = RelationGetRelid(state->heap);
+			ItemPointerSet(&tuple.t_self, blkno, offsets[i]);
+#ifdef PGXC
+			tuple.t_xc_node_id = 0;
+#endif
+
+			ResetExprContext(econtext);
+			ExecStoreTuple(&tuple, state->slot, InvalidBuffer, false);
+
+			if (state->predicate != NIL &&
+				!ExecQual(state->predicate, econtext, false))
+				continue;
+
+			FormIndexDatum(indexInfo, state->slot, state->estate,
+						   values, isnull);
+
+			for (keyno = 0; keyno < indexInfo->ii_NumIndexAttrs; keyno++)
+				brin_add_value(state->bdesc, dtup, keyno,
+							   values[keyno], isnull[keyno]);
+
+			state->heapTuples += 1;
+		}
+
+		ExecClearTuple(state->slot);
+		ReleaseBuffer(buf);
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+
+	return dtup;
+}
+
+/*
+ * Summarize the range starting at heapBlk, if it isn't summarized already,
+ * while other backends may be inserting into it.
+ *
+ * First a placeholder tuple is inserted for the range.  brininsert widens
+ * a placeholder like any other summary, so once it is in place, values
+ * inserted into the range can't be missed; and values inserted before that
+ * are on the heap pages by the time we read them.  So after scanning the
+ * range, we merge our result into whatever the placeholder has collected
+ * meanwhile.  A placeholder left over by an aborted summarization is simply
+ * redone.
+ */
+static void
+brin_summarize_range(BrinBuildState *state, BlockNumber heapBlk,
+					 BlockNumber nblocks)
+{
+	Relation	index = state->index;
+	BrinDesc   *bdesc = state->bdesc;
+	BlockNumber pagesPerRange = state->pagesPerRange;
+	BrinMemTuple *dtup;
+	BrinMemTuple *curdtup;
+	BrinTuple  *tup;
+	Buffer		rmbuf;
+	Size		size;
+	MemoryContext oldcxt;
+
+	oldcxt = MemoryContextSwitchTo(state->rangeCxt);
+
+	rmbuf = brinLockRevmapPageForUpdate(state->revmap, heapBlk, true);
+	tup = brinGetTupleForUpdate(state->revmap, rmbuf, heapBlk, &size);
+	if (tup != NULL && !BrinTupleIsPlaceholder(tup))
+	{
+		/* already done */
+		LockBuffer(rmbuf, BUFFER_LOCK_UNLOCK);
+		MemoryContextSwitchTo(oldcxt);
+		MemoryContextReset(state->rangeCxt);
+		return;
+	}
+	if (tup == NULL)
+	{
+		dtup = brin_new_memtuple(bdesc, heapBlk);
+		dtup->bt_placeholder = true;
+		tup = brin_form_tuple(bdesc, dtup, &size);
+		brin_doinsert(index, pagesPerRange, rmbuf, heapBlk, tup, size);
+	}
+	LockBuffer(rmbuf, BUFFER_LOCK_UNLOCK);
+
+	dtup = brin_scan_range(state, heapBlk, nblocks);
+
+	rmbuf = brinLockRevmapPageForUpdate(state->revmap, heapBlk, false);
+	tup = brinGetTupleForUpdate(state->revmap, rmbuf, heapBlk, &size);
+	if (tup == NULL)
+		elog(ERROR, "placeholder tuple for heap block %u of BRIN index \"%s\" disappeared",
+			 heapBlk, RelationGetRelationName(index));
+	curdtup = brin_deform_tuple(bdesc, tup);
+	brin_union_tuples(bdesc, dtup, curdtup);
+	dtup->bt_placeholder = false;
+	tup = brin_form_tuple(bdesc, dtup, &size);
+	brin_doupdate(index, pagesPerRange, rmbuf, heapBlk, tup, size);
+	LockBuffer(rmbuf, BUFFER_LOCK_UNLOCK);
+
+	state->numRanges += 1;
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextReset(state->rangeCxt);
+}
+
+/*
+ * Build a BRIN index: create the metapage and summarize every range of the
+ * heap.  No one else can touch the index yet, so no placeholders are needed.
+ */
+Datum
+brinbuild(PG_FUNCTION_ARGS)
+{
+	Relation	heap = (Relation) PG_GETARG_POINTER(0);
+	Relation	index = (Relation) PG_GETARG_POINTER(1);
+	IndexBuildResult *result;
+	BrinBuildState *state;
+	BlockNumber pagesPerRange = BrinGetPagesPerRange(index);
+	BlockNumber nblocks;
+	BlockNumber heapBlk;
+	Buffer		metabuf;
+
+	if (RelationGetNumberOfBlocks(index) != 0)
+		elog(ERROR, "index \"%s\" already contains data",
+			 RelationGetRelationName(index));
+
+	metabuf = ReadBuffer(index, P_NEW);
+	Assert(BufferGetBlockNumber(metabuf) == BRIN_METAPAGE_BLKNO);
+	LockBuffer(metabuf, BUFFER_LOCK_EXCLUSIVE);
+
+	START_CRIT_SECTION();
+
+	brin_metapage_init(BufferGetPage(metabuf), pagesPerRange);
+	MarkBufferDirty(metabuf);
+
+	if (RelationNeedsWAL(index))
+	{
+		XLogRecPtr	recptr;
+		XLogRecData rdata;
+		xl_brin_createidx xlrec;
+
+		xlrec.node = index->rd_node;
+		xlrec.pagesPerRange = pagesPerRange;
+
+		rdata.data = (char *) &xlrec;
+		rdata.len = sizeof(xl_brin_createidx);
+		rdata.buffer = InvalidBuffer;
+		rdata.next = NULL;
+
+		recptr = XLogInsert(RM_BRIN_ID, XLOG_BRIN_CREATE_INDEX, &rdata);
+
+		PageSetLSN(BufferGetPage(metabuf), recptr);
+	}
+
+	END_CRIT_SECTION();
+
+	UnlockReleaseBuffer(metabuf);
+
+	state = brin_begin_summarize(heap, index,
+								 GetAccessStrategy(BAS_BULKREAD));
+
+	nblocks = RelationGetNumberOfBlocks(heap);
+	for (heapBlk = 0; heapBlk < nblocks; heapBlk += pagesPerRange)
+	{
+		BrinMemTuple *dtup;
+		BrinTuple  *tup;
+		Buffer		rmbuf;
+		Size		size;
+		MemoryContext oldcxt;
+
+		dtup = brin_scan_range(state, heapBlk, nblocks);
+
+		oldcxt = MemoryContextSwitchTo(state->rangeCxt);
+		tup = brin_form_tuple(state->bdesc, dtup, &size);
+		rmbuf = brinLockRevmapPageForUpdate(state->revmap, heapBlk, true);
+		brin_doinsert(index, pagesPerRange, rmbuf, heapBlk, tup, size);
+		LockBuffer(rmbuf, BUFFER_LOCK_UNLOCK);
+		MemoryContextSwitchTo(oldcxt);
+
+		MemoryContextReset(state->rangeCxt);
+		state->numRanges += 1;
+	}
+
+	result = (IndexBuildResult *) palloc(sizeof(IndexBuildResult));
+	result->heap_tuples = state->heapTuples;
+	result->index_tuples = state->numRanges;
+
+	brin_end_summarize(state);
+
+	PG_RETURN_POINTER(result);
+}
+
+/*
+ * Build an empty BRIN index in the initialization fork
+ */
+Datum
+brinbuildempty(PG_FUNCTION_ARGS)
+{
+	Relation	index = (Relation) PG_GETARG_POINTER(0);
+	Page		page;
+
+	/* Construct metapage. */
+	page = (Page) palloc(BLCKSZ);
+	brin_metapage_init(page, BrinGetPagesPerRange(index));
+
+	/* Write the page.  If archiving/streaming, XLOG it. */
+	PageSetChecksumInplace(page, BRIN_METAPAGE_BLKNO);
+	smgrwrite(index->rd_smgr, INIT_FORKNUM, BRIN_METAPAGE_BLKNO,
+			  (char *) page, true);
+	if (XLogIsNeeded())
+		log_newpage(&index->rd_smgr->smgr_rnode.node, INIT_FORKNUM,
+					BRIN_METAPAGE_BLKNO, page);
+
+	/*
+	 * An immediate sync is required even if we xlog'd the page, because the
+	 * write did not go through shared buffers and therefore a concurrent
+	 * checkpoint may have moved the redo pointer past our xlog record.
+	 */
+	smgrimmedsync(index->rd_smgr, INIT_FORKNUM);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Widen the summary of the range containing a new heap tuple, if the range
+ * is summarized (or being summarized).  Ranges that aren't are left for
+ * VACUUM.
+ *
+ * In the common case the new values are already covered, and all it costs
+ * is a look at the summary under share locks.
+ */
+Datum
+brininsert(PG_FUNCTION_ARGS)
+{
+	Relation	index = (Relation) PG_GETARG_POINTER(0);
+	Datum	   *values = (Datum *) PG_GETARG_POINTER(1);
+	bool	   *isnull = (bool *) PG_GETARG_POINTER(2);
+	ItemPointer heaptid = (ItemPointer) PG_GETARG_POINTER(3);
+	BrinRevmap *revmap;
+	BrinDesc   *bdesc;
+	BrinTuple  *tup;
+	BrinMemTuple *dtup;
+	BlockNumber pagesPerRange;
+	BlockNumber heapBlk;
+	Buffer		rmbuf;
+	Size		size;
+	bool		changed = false;
+	int			keyno;
+	MemoryContext tupcxt;
+	MemoryContext oldcxt;
+
+	tupcxt = AllocSetContextCreate(CurrentMemoryContext,
+								   "BRIN insert context",
+								   ALLOCSET_SMALL_MINSIZE,
+								   ALLOCSET_SMALL_INITSIZE,
+								   ALLOCSET_SMALL_MAXSIZE);
+	oldcxt = MemoryContextSwitchTo(tupcxt);
+
+	revmap = brinRevmapInitialize(index, &pagesPerRange);
+	heapBlk = ItemPointerGetBlockNumber(heaptid);
+	heapBlk = (heapBlk / pagesPerRange) * pagesPerRange;
+
+	tup = brinGetTupleForHeapBlock(revmap, heapBlk, &size);
+	if (tup != NULL)
+	{
+		bdesc = brin_build_desc(index);
+		dtup = brin_deform_tuple(bdesc, tup);
+		for (keyno = 0; keyno < bdesc->bd_tupdesc->natts; keyno++)
+			changed |= brin_add_value(bdesc, dtup, keyno,
+									  values[keyno], isnull[keyno]);
+
+		if (changed)
+		{
+			/*
+			 * Redo the work with the revmap page locked, since the summary
+			 * may have changed meanwhile.
+			 */
+			rmbuf = brinLockRevmapPageForUpdate(revmap, heapBlk, false);
+			tup = brinGetTupleForUpdate(revmap, rmbuf, heapBlk, &size);
+			Assert(tup != NULL);
+
+			dtup = brin_deform_tuple(bdesc, tup);
+			changed = false;
+			for (keyno = 0; keyno < bdesc->bd_tupdesc->natts; keyno++)
+				changed |= brin_add_value(bdesc, dtup, keyno,
+										  values[keyno], isnull[keyno]);
+			if (changed)
+			{
+				tup = brin_form_tuple(bdesc, dtup, &size);
+				brin_doupdate(index, pagesPerRange, rmbuf, heapBlk, tup, size);
+			}
+			LockBuffer(rmbuf, BUFFER_LOCK_UNLOCK);
+		}
+	}
+
+	brinRevmapTerminate(revmap);
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(tupcxt);
+
+	PG_RETURN_BOOL(false);
+}
+
+Datum
+brinbeginscan(PG_FUNCTION_ARGS)
+{
+	Relation	rel = (Relation) PG_GETARG_POINTER(0);
+	int			nkeys = PG_GETARG_INT32(1);
+	int			norderbys = PG_GETARG_INT32(2);
+	IndexScanDesc scan;
+	BrinOpaque	so;
+
+	scan = RelationGetIndexScan(rel, nkeys, norderbys);
+
+	so = (BrinOpaque) palloc(sizeof(BrinOpaqueData));
+	so->bdesc = brin_build_desc(rel);
+	so->tempCxt = AllocSetContextCreate(CurrentMemoryContext,
+										"BRIN scan temporary context",
+										ALLOCSET_DEFAULT_MINSIZE,
+										ALLOCSET_DEFAULT_INITSIZE,
+										ALLOCSET_DEFAULT_MAXSIZE);
+	scan->opaque = so;
+
+	PG_RETURN_POINTER(scan);
+}
+
+Datum
+brinrescan(PG_FUNCTION_ARGS)
+{
+	IndexScanDesc scan = (IndexScanDesc) PG_GETARG_POINTER(0);
+	ScanKey		scankey = (ScanKey) PG_GETARG_POINTER(1);
+
+	/* copy scankeys into local storage */
+	if (scankey && scan->numberOfKeys > 0)
+		memmove(scan->keyData, scankey,
+				scan->numberOfKeys * sizeof(ScanKeyData));
+
+	PG_RETURN_VOID();
+}
+
+Datum
+brinendscan(PG_FUNCTION_ARGS)
+{
+	IndexScanDesc scan = (IndexScanDesc) PG_GETARG_POINTER(0);
+	BrinOpaque	so = (BrinOpaque) scan->opaque;
+
+	MemoryContextDelete(so->tempCxt);
+	pfree(so->bdesc);
+	pfree(so);
+
+	PG_RETURN_VOID();
+}
+
+Datum
+brinmarkpos(PG_FUNCTION_ARGS)
+{
+	elog(ERROR, "BRIN does not support mark/restore");
+	PG_RETURN_VOID();
+}
+
+Datum
+brinrestrpos(PG_FUNCTION_ARGS)
+{
+	elog(ERROR, "BRIN does not support mark/restore");
+	PG_RETURN_VOID();
+}
+
+/*
+ * Add to the bitmap every page of each range whose summary is consistent
+ * with all the scan keys.  Ranges that have not been summarized are always
+ * returned.  All pages are lossy, so the executor rechecks every tuple.
+ */
+Datum
+bringetbitmap(PG_FUNCTION_ARGS)
+{
+	IndexScanDesc scan = (IndexScanDesc) PG_GETARG_POINTER(0);
+	TIDBitmap  *tbm = (TIDBitmap *) PG_GETARG_POINTER(1);
+	BrinOpaque	so = (BrinOpaque) scan->opaque;
+	Relation	index = scan->indexRelation;
+	Relation	heap;
+	BrinRevmap *revmap;
+	BlockNumber pagesPerRange;
+	BlockNumber nblocks;
+	BlockNumber heapBlk;
+	int64		totalpages = 0;
+
+	/* bitmap scans don't open the heap for us */
+	heap = heap_open(IndexGetRelation(RelationGetRelid(index), false),
+					 AccessShareLock);
+	nblocks = RelationGetNumberOfBlocks(heap);
+	heap_close(heap, AccessShareLock);
+
+	revmap = brinRevmapInitialize(index, &pagesPerRange);
+
+	for (heapBlk = 0; heapBlk < nblocks; heapBlk += pagesPerRange)
+	{
+		BrinTuple  *tup;
+		Size		size;
+		bool		addrange = true;
+		MemoryContext oldcxt;
+
+		CHECK_FOR_INTERRUPTS();
+
+		oldcxt = MemoryContextSwitchTo(so->tempCxt);
+
+		tup = brinGetTupleForHeapBlock(revmap, heapBlk, &size);
+		if (tup != NULL && !BrinTupleIsPlaceholder(tup))
+		{
+			BrinMemTuple *dtup = brin_deform_tuple(so->bdesc, tup);
+			int			keyno;
+
+			for (keyno = 0; keyno < scan->numberOfKeys; keyno++)
+			{
+				if (!brin_consistent(so->bdesc, dtup, &scan->keyData[keyno]))
+				{
+					addrange = false;
+					break;
+				}
+			}
+		}
+
+		MemoryContextSwitchTo(oldcxt);
+		MemoryContextReset(so->tempCxt);
+
+		if (addrange)
+		{
+			BlockNumber pageno;
+
+			for (pageno = heapBlk;
+				 pageno < Min(nblocks, heapBlk + pagesPerRange);
+				 pageno++)
+			{
+				tbm_add_page(tbm, pageno);
+				totalpages++;
+			}
+		}
+	}
+
+	brinRevmapTerminate(revmap);
+
+	/*
+	 * There is no exact count of tuples to return; guess at ten per page so
+	 * that instrumentation shows something meaningful.
+	 */
+	PG_RETURN_INT64(totalpages * 10);
+}
+
+/*
+ * Nothing to do for deleted heap tuples: a summary may cover values that are
+ * no longer present.  Summaries are only tightened by rebuilding the index.
+ */
+Datum
+brinbulkdelete(PG_FUNCTION_ARGS)
+{
+	IndexBulkDeleteResult *stats = (IndexBulkDeleteResult *) PG_GETARG_POINTER(1);
+
+	if (stats == NULL)
+		stats = (IndexBulkDeleteResult *) palloc0(sizeof(IndexBulkDeleteResult));
+
+	PG_RETURN_POINTER(stats);
+}
+
+/*
+ * Summarize the ranges added to the heap since the index was built or last
+ * vacuumed, and any left as placeholders by an interrupted summarization.
+ */
+Datum
+brinvacuumcleanup(PG_FUNCTION_ARGS)
+{
+	IndexVacuumInfo *info = (IndexVacuumInfo *) PG_GETARG_POINTER(0);
+	IndexBulkDeleteResult *stats = (IndexBulkDeleteResult *) PG_GETARG_POINTER(1);
+	Relation	index = info->index;
+	Relation	heap;
+	BrinBuildState *state;
+	BlockNumber nblocks;
+	BlockNumber heapBlk;
+
+	/* No-op in ANALYZE ONLY mode */
+	if (info->analyze_only)
+		PG_RETURN_POINTER(stats);
+
+	if (stats == NULL)
+		stats = (IndexBulkDeleteResult *) palloc0(sizeof(IndexBulkDeleteResult));
+
+	/* VACUUM already holds a lock on the heap that prevents DDL */
+	heap = heap_open(IndexGetRelation(RelationGetRelid(index), false),
+					 AccessShareLock);
+
+	state = brin_begin_summarize(heap, index, info->strategy);
+
+	nblocks = RelationGetNumberOfBlocks(heap);
+	for (heapBlk = 0; heapBlk < nblocks; heapBlk += state->pagesPerRange)
+	{
+		BrinTuple  *tup;
+		Size		size;
+
+		tup = brinGetTupleForHeapBlock(state->revmap, heapBlk, &size);
+		if (tup == NULL || BrinTupleIsPlaceholder(tup))
+			brin_summarize_range(state, heapBlk, nblocks);
+		else
+			stats->num_index_tuples += 1;
+		if (tup != NULL)
+			pfree(tup);
+	}
+	stats->num_index_tuples += state->numRanges;
+
+	brin_end_summarize(state);
+	heap_close(heap, AccessShareLock);
+
+	FreeSpaceMapVacuum(index);
+
+	stats->num_pages = RelationGetNumberOfBlocks(index);
+
+	PG_RETURN_POINTER(stats);
+}
+
+Datum
+brinoptions(PG_FUNCTION_ARGS)
+{
+	Datum		reloptions = PG_GETARG_DATUM(0);
+	bool		validate = PG_GETARG_BOOL(1);
+	relopt_value *options;
+	BrinOptions *rdopts;
+	int			numoptions;
+	static const relopt_parse_elt tab[] = {
+		{"pages_per_range", RELOPT_TYPE_INT, offsetof(BrinOptions, pagesPerRange)}
+	};
+
+	options = parseRelOptions(reloptions, validate, RELOPT_KIND_BRIN,
+							  &numoptions);
+
+	/* if none set, we're done */
+	if (numoptions == 0)
+		PG_RETURN_NULL();
+
+	rdopts = allocateReloptStruct(sizeof(BrinOptions), options, numoptions);
+
+	fillRelOptions((void *) rdopts, sizeof(BrinOptions), options, numoptions,
+				   validate, tab, lengthof(tab));
+
+	pfree(options);
+
+	PG_RETURN_BYTEA_P(rdopts);
+}
@@ -0,0 +1,356 @@
+/*-------------------------------------------------------------------------
+ *
+ * brin_pageops.c
+ *	  Page-handling routines for BRIN indexes
+ *
+ * Summary tuples live on regular pages and are found through the range map.
+ * Whoever changes the summary of a range must hold the revmap page covering
+ * it exclusively locked for the whole operation; regular pages are locked
+ * after that, at most two at a time and then in block number order.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ * IDENTIFICATION
+ *			src/backend/access/brin/brin_pageops.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/brin_private.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+#include "storage/freespace.h"
+#include "storage/lmgr.h"
+#include "storage/smgr.h"
+
+
+/*
+ * Remove the item at offnum from a regular page.  The line pointer is only
+ * marked unused, so that the offsets of the other summaries (which are
+ * recorded in the range map) stay put while the space is reclaimed.
+ */
+static void
+brin_page_remove_item(Page page, OffsetNumber offnum)
+{
+	ItemIdSetUnused(PageGetItemId(page, offnum));
+	PageRepairFragmentation(page);
+}
+
+/*
+ * Return a buffer holding a regular page with room for itemsz bytes,
+ * exclusively locked.  If oldbuf is valid, it is a page the caller has
+ * pinned (but not locked); it is never returned, but is locked exclusively
+ * too, in block number order so as not to deadlock against other backends
+ * doing the same.  *extended is set if the page was added to the relation;
+ * it is then initialized but not WAL-logged yet.
+ */
+static Buffer
+brin_getinsertbuffer(Relation irel, Buffer oldbuf, Size itemsz,
+					 bool *extended)
+{
+	BlockNumber oldblk;
+	BlockNumber newblk;
+
+	oldblk = BufferIsValid(oldbuf) ? BufferGetBlockNumber(oldbuf) :
+		InvalidBlockNumber;
+	newblk = RelationGetTargetBlock(irel);
+
+	for (;;)
+	{
+		Buffer		buf;
+		Page		page;
+		Size		freespace;
+
+		CHECK_FOR_INTERRUPTS();
+
+		*extended = false;
+		if (newblk == InvalidBlockNumber)
+			newblk = GetPageWithFreeSpace(irel, itemsz + sizeof(ItemIdData));
+		if (newblk == oldblk)
+			newblk = InvalidBlockNumber;
+
+		if (newblk == InvalidBlockNumber)
+		{
+			LockRelationForExtension(irel, ExclusiveLock);
+			buf = ReadBuffer(irel, P_NEW);
+			UnlockRelationForExtension(irel, ExclusiveLock);
+			newblk = BufferGetBlockNumber(buf);
+			*extended = true;
+		}
+		else
+			buf = ReadBuffer(irel, newblk);
+
+		if (BufferIsValid(oldbuf) && oldblk < newblk)
+		{
+			LockBuffer(oldbuf, BUFFER_LOCK_EXCLUSIVE);
+			LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+		}
+		else
+		{
+			LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+			if (BufferIsValid(oldbuf))
+				LockBuffer(oldbuf, BUFFER_LOCK_EXCLUSIVE);
+		}
+
+		page = BufferGetPage(buf);
+		if (*extended)
+			brin_page_init(page, BRIN_PAGETYPE_REGULAR);
+
+		/*
+		 * The free space map and the target block are only hints: the page
+		 * may have filled up, or (for a page that was never initialized) may
+		 * not be a regular page at all.
+		 */
+		if (!PageIsNew(page) && BRIN_IS_REGULAR_PAGE(page))
+		{
+			freespace = PageGetFreeSpace(page);
+			if (freespace >= MAXALIGN(itemsz))
+			{
+				RelationSetTargetBlock(irel, newblk);
+				return buf;
+			}
+			RecordPageWithFreeSpace(irel, newblk, freespace);
+		}
+
+		if (BufferIsValid(oldbuf))
+			LockBuffer(oldbuf, BUFFER_LOCK_UNLOCK);
+		UnlockReleaseBuffer(buf);
+
+		/* an empty page has room for any legal tuple */
+		if (*extended)
+			elog(ERROR, "index row size %lu does not fit on a new BRIN page",
+				 (unsigned long) itemsz);
+		newblk = InvalidBlockNumber;
+	}
+}
+
+/*
+ * Insert the summary tuple of a range that has none yet.  rmbuf is the
+ * revmap page covering heapBlk, exclusively locked by the caller.
+ */
+void
+brin_doinsert(Relation idxrel, BlockNumber pagesPerRange, Buffer rmbuf,
+			  BlockNumber heapBlk, BrinTuple *tup, Size itemsz)
+{
+	Buffer		buf;
+	Page		page;
+	bool		extended;
+	OffsetNumber off;
+	ItemPointerData tid;
+
+	buf = brin_getinsertbuffer(idxrel, InvalidBuffer, itemsz, &extended);
+	page = BufferGetPage(buf);
+
+	START_CRIT_SECTION();
+
+	off = PageAddItem(page, (Item) tup, itemsz, InvalidOffsetNumber,
+					  false, false);
+	if (off == InvalidOffsetNumber)
+		elog(PANIC, "failed to add BRIN tuple to page \"%s\"",
+			 RelationGetRelationName(idxrel));
+	MarkBufferDirty(buf);
+
+	ItemPointerSet(&tid, BufferGetBlockNumber(buf), off);
+	brinSetRevmapEntry(rmbuf, pagesPerRange, heapBlk, &tid);
+	MarkBufferDirty(rmbuf);
+
+	if (RelationNeedsWAL(idxrel))
+	{
+		XLogRecPtr	recptr;
+		XLogRecData rdata[3];
+		xl_brin_insert xlrec;
+		uint8		info = XLOG_BRIN_INSERT;
+
+		xlrec.node = idxrel->rd_node;
+		xlrec.heapBlk = heapBlk;
+		xlrec.pagesPerRange = pagesPerRange;
+		xlrec.revmapBlk = BufferGetBlockNumber(rmbuf);
+		xlrec.tid = tid;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = SizeOfBrinInsert;
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &rdata[1];
+
+		rdata[1].data = NULL;
+		rdata[1].len = 0;
+		rdata[1].buffer = rmbuf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = &rdata[2];
+
+		rdata[2].data = (char *) tup;
+		rdata[2].len = itemsz;
+		rdata[2].buffer = extended ? InvalidBuffer : buf;
+		rdata[2].buffer_std = true;
+		rdata[2].next = NULL;
+
+		if (extended)
+			info |= XLOG_BRIN_INIT_PAGE;
+
+		recptr = XLogInsert(RM_BRIN_ID, info, rdata);
+
+		PageSetLSN(page, recptr);
+		PageSetLSN(BufferGetPage(rmbuf), recptr);
+	}
+
+	END_CRIT_SECTION();
+
+	UnlockReleaseBuffer(buf);
+}
+
+/*
+ * Replace the summary tuple of a range with tup.  rmbuf is the revmap page
+ * covering heapBlk, exclusively locked by the caller.
+ *
+ * If the old tuple's page has room, the new one takes the old one's place;
+ * otherwise it goes to another page and the range map is updated, in a
+ * single WAL record.
+ */
+void
+brin_doupdate(Relation idxrel, BlockNumber pagesPerRange, Buffer rmbuf,
+			  BlockNumber heapBlk, BrinTuple *tup, Size itemsz)
+{
+	ItemPointerData oldtid;
+	OffsetNumber oldoff;
+	Buffer		oldbuf;
+	Page		oldpage;
+	ItemId		oldlp;
+	Buffer		newbuf;
+	Page		newpage;
+	bool		extended;
+	OffsetNumber newoff;
+	ItemPointerData newtid;
+
+	brinGetRevmapEntry(rmbuf, pagesPerRange, heapBlk, &oldtid);
+	Assert(ItemPointerIsValid(&oldtid));
+	oldoff = ItemPointerGetOffsetNumber(&oldtid);
+
+	oldbuf = ReadBuffer(idxrel, ItemPointerGetBlockNumber(&oldtid));
+	LockBuffer(oldbuf, BUFFER_LOCK_EXCLUSIVE);
+	oldpage = BufferGetPage(oldbuf);
+	oldlp = PageGetItemId(oldpage, oldoff);
+
+	if (PageGetExactFreeSpace(oldpage) + MAXALIGN(ItemIdGetLength(oldlp)) >=
+		MAXALIGN(itemsz))
+	{
+		START_CRIT_SECTION();
+
+		brin_page_remove_item(oldpage, oldoff);
+		if (PageAddItem(oldpage, (Item) tup, itemsz, oldoff,
+						true, false) == InvalidOffsetNumber)
+			elog(PANIC, "failed to replace BRIN tuple in index \"%s\"",
+				 RelationGetRelationName(idxrel));
+		MarkBufferDirty(oldbuf);
+
+		if (RelationNeedsWAL(idxrel))
+		{
+			XLogRecPtr	recptr;
+			XLogRecData rdata[2];
+			xl_brin_samepage_update xlrec;
+
+			xlrec.node = idxrel->rd_node;
+			xlrec.tid = oldtid;
+
+			rdata[0].data = (char *) &xlrec;
+			rdata[0].len = SizeOfBrinSamepageUpdate;
+			rdata[0].buffer = InvalidBuffer;
+			rdata[0].next = &rdata[1];
+
+			rdata[1].data = (char *) tup;
+			rdata[1].len = itemsz;
+			rdata[1].buffer = oldbuf;
+			rdata[1].buffer_std = true;
+			rdata[1].next = NULL;
+
+			recptr = XLogInsert(RM_BRIN_ID, XLOG_BRIN_SAMEPAGE_UPDATE, rdata);
+
+			PageSetLSN(oldpage, recptr);
+		}
+
+		END_CRIT_SECTION();
+
+		UnlockReleaseBuffer(oldbuf);
+		return;
+	}
+
+	/*
+	 * Move the tuple to another page.  Nobody else can touch the old tuple
+	 * while we hold the revmap page, so it's fine to unlock its page while
+	 * we look for room elsewhere.
+	 */
+	RecordPageWithFreeSpace(idxrel, BufferGetBlockNumber(oldbuf),
+							PageGetFreeSpace(oldpage));
+	LockBuffer(oldbuf, BUFFER_LOCK_UNLOCK);
+	newbuf = brin_getinsertbuffer(idxrel, oldbuf, itemsz, &extended);
+	newpage = BufferGetPage(newbuf);
+
+	START_CRIT_SECTION();
+
+	brin_page_remove_item(oldpage, oldoff);
+	MarkBufferDirty(oldbuf);
+
+	newoff = PageAddItem(newpage, (Item) tup, itemsz, InvalidOffsetNumber,
+						 false, false);
+	if (newoff == InvalidOffsetNumber)
+		elog(PANIC, "failed to add BRIN tuple to page \"%s\"",
+			 RelationGetRelationName(idxrel));
+	MarkBufferDirty(newbuf);
+
+	ItemPointerSet(&newtid, BufferGetBlockNumber(newbuf), newoff);
+	brinSetRevmapEntry(rmbuf, pagesPerRange, heapBlk, &newtid);
+	MarkBufferDirty(rmbuf);
+
+	if (RelationNeedsWAL(idxrel))
+	{
+		XLogRecPtr	recptr;
+		XLogRecData rdata[4];
+		xl_brin_update xlrec;
+		uint8		info = XLOG_BRIN_UPDATE;
+
+		xlrec.new.node = idxrel->rd_node;
+		xlrec.new.heapBlk = heapBlk;
+		xlrec.new.pagesPerRange = pagesPerRange;
+		xlrec.new.revmapBlk = BufferGetBlockNumber(rmbuf);
+		xlrec.new.tid = newtid;
+		xlrec.oldtid = oldtid;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = SizeOfBrinUpdate;
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &rdata[1];
+
+		rdata[1].data = NULL;
+		rdata[1].len = 0;
+		rdata[1].buffer = rmbuf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = &rdata[2];
+
+		rdata[2].data = NULL;
+		rdata[2].len = 0;
+		rdata[2].buffer = oldbuf;
+		rdata[2].buffer_std = true;
+		rdata[2].next = &rdata[3];
+
+		rdata[3].data = (char *) tup;
+		rdata[3].len = itemsz;
+		rdata[3].buffer = extended ? InvalidBuffer : newbuf;
+		rdata[3].buffer_std = true;
+		rdata[3].next = NULL;
+
+		if (extended)
+			info |= XLOG_BRIN_INIT_PAGE;
+
+		recptr = XLogInsert(RM_BRIN_ID, info, rdata);
+
+		PageSetLSN(oldpage, recptr);
+		PageSetLSN(newpage, recptr);
+		PageSetLSN(BufferGetPage(rmbuf), recptr);
+	}
+
+	END_CRIT_SECTION();
+
+	UnlockReleaseBuffer(newbuf);
+	UnlockReleaseBuffer(oldbuf);
+}
@@ -0,0 +1,467 @@
+/*-------------------------------------------------------------------------
+ *
+ * brin_revmap.c
+ *	  Range map for BRIN indexes
+ *
+ * The range map ("revmap") translates a heap block number into the location
+ * of the summary tuple of the block range containing it.  It is a two-level
+ * array: the metapage holds the block numbers of directory pages, each
+ * directory page holds the block numbers of revmap pages, and each revmap
+ * page holds one ItemPointer per block range.  Directory and revmap pages are
+ * created the first time a range they cover is summarized, wherever the
+ * relation happens to end at that moment, and are never moved or freed; so
+ * a link read once can be used without holding a lock on its parent.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ * IDENTIFICATION
+ *			src/backend/access/brin/brin_revmap.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/brin_private.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+#include "storage/lmgr.h"
+
+
+struct BrinRevmap
+{
+	Relation	rm_irel;
+	BlockNumber rm_pagesPerRange;
+	uint32		rm_ndirectory;	/* directory links copied from metapage */
+	BlockNumber *rm_directory;
+	BlockNumber rm_lastmapno;	/* revmap page looked up last ... */
+	BlockNumber rm_lastmapblk;	/* ... and where it is */
+	Buffer		rm_dirbuf;		/* pinned directory page, if any */
+	Buffer		rm_currbuf;		/* pinned revmap page, if any */
+};
+
+
+/*
+ * Initialize a new page of the given type.
+ *
+ * Apart from regular pages, the content area of each page is a fixed-size
+ * array, so we mark all of it as in use; that way full-page images may treat
+ * every page as having the standard layout.
+ */
+void
+brin_page_init(Page page, uint16 type)
+{
+	PageInit(page, BLCKSZ, sizeof(BrinSpecialSpace));
+	BrinPageType(page) = type;
+
+	if (type != BRIN_PAGETYPE_REGULAR)
+		((PageHeader) page)->pd_lower = ((PageHeader) page)->pd_upper;
+
+	/* zeroed revmap entries are invalid item pointers, but block 0 is valid */
+	if (type == BRIN_PAGETYPE_DIRECTORY)
+	{
+		BlockNumber *dir = BrinPageGetDirectory(page);
+		int			i;
+
+		for (i = 0; i < DIRECTORY_PAGE_MAXITEMS; i++)
+			dir[i] = InvalidBlockNumber;
+	}
+}
+
+/*
+ * Initialize a metapage.
+ */
+void
+brin_metapage_init(Page page, BlockNumber pagesPerRange)
+{
+	BrinMetaPageData *meta;
+	int			i;
+
+	brin_page_init(page, BRIN_PAGETYPE_META);
+
+	meta = BrinPageGetMeta(page);
+	meta->brinMagic = BRIN_META_MAGIC;
+	meta->brinVersion = BRIN_CURRENT_VERSION;
+	meta->pagesPerRange = pagesPerRange;
+	meta->nDirectory = 0;
+	for (i = 0; i < BRIN_MAX_DIRECTORY_PAGES; i++)
+		meta->directory[i] = InvalidBlockNumber;
+}
+
+/*
+ * Store the link to a new directory or revmap page in its parent, which is
+ * the metapage or a directory page respectively.  Also used by WAL replay.
+ */
+void
+brinSetMapLink(Page parent, uint32 slot, BlockNumber newblk)
+{
+	if (BrinPageType(parent) == BRIN_PAGETYPE_META)
+	{
+		BrinMetaPageData *meta = BrinPageGetMeta(parent);
+
+		meta->directory[slot] = newblk;
+		if (slot >= meta->nDirectory)
+			meta->nDirectory = slot + 1;
+	}
+	else
+		BrinPageGetDirectory(parent)[slot] = newblk;
+}
+
+/*
+ * Prepare to access the range map of an index, returning its pages-per-range
+ * setting in *pagesPerRange.
+ *
+ * The directory links are copied from the metapage now.  Links created later
+ * are not seen; to callers that is the same as the ranges they cover not
+ * having been summarized yet.
+ */
+BrinRevmap *
+brinRevmapInitialize(Relation idxrel, BlockNumber *pagesPerRange)
+{
+	BrinRevmap *revmap;
+	Buffer		metabuf;
+	BrinMetaPageData *meta;
+
+	metabuf = ReadBuffer(idxrel, BRIN_METAPAGE_BLKNO);
+	LockBuffer(metabuf, BUFFER_LOCK_SHARE);
+	meta = BrinPageGetMeta(BufferGetPage(metabuf));
+
+	if (BrinPageType(BufferGetPage(metabuf)) != BRIN_PAGETYPE_META ||
+		meta->brinMagic != BRIN_META_MAGIC)
+		ereport(ERROR,
+				(errcode(ERRCODE_INDEX_CORRUPTED),
+				 errmsg("index \"%s\" is not a BRIN index",
+						RelationGetRelationName(idxrel))));
+
+	if (meta->brinVersion != BRIN_CURRENT_VERSION)
+		ereport(ERROR,
+				(errcode(ERRCODE_INDEX_CORRUPTED),
+				 errmsg("version mismatch in index \"%s\": file version %d, code version %d",
+						RelationGetRelationName(idxrel),
+						meta->brinVersion, BRIN_CURRENT_VERSION)));
+
+	revmap = (BrinRevmap *) palloc(sizeof(BrinRevmap));
+	revmap->rm_irel = idxrel;
+	revmap->rm_pagesPerRange = meta->pagesPerRange;
+	revmap->rm_ndirectory = meta->nDirectory;
+	revmap->rm_directory = (BlockNumber *)
+		palloc(sizeof(BlockNumber) * Max(meta->nDirectory, 1));
+	memcpy(revmap->rm_directory, meta->directory,
+		   sizeof(BlockNumber) * meta->nDirectory);
+	revmap->rm_lastmapno = InvalidBlockNumber;
+	revmap->rm_lastmapblk = InvalidBlockNumber;
+	revmap->rm_dirbuf = InvalidBuffer;
+	revmap->rm_currbuf = InvalidBuffer;
+
+	UnlockReleaseBuffer(metabuf);
+
+	*pagesPerRange = revmap->rm_pagesPerRange;
+	return revmap;
+}
+
+/*
+ * Release resources associated with a revmap access object.
+ */
+void
+brinRevmapTerminate(BrinRevmap *revmap)
+{
+	if (BufferIsValid(revmap->rm_dirbuf))
+		ReleaseBuffer(revmap->rm_dirbuf);
+	if (BufferIsValid(revmap->rm_currbuf))
+		ReleaseBuffer(revmap->rm_currbuf);
+	pfree(revmap->rm_directory);
+	pfree(revmap);
+}
+
+/*
+ * Return the block number of the revmap page covering heapBlk, or
+ * InvalidBlockNumber if it has not been created yet.
+ */
+static BlockNumber
+revmap_get_blkno(BrinRevmap *revmap, BlockNumber heapBlk)
+{
+	BlockNumber mapno;
+	uint32		dirno;
+	BlockNumber dirblk;
+	BlockNumber blkno;
+
+	mapno = heapBlk / revmap->rm_pagesPerRange / REVMAP_PAGE_MAXITEMS;
+	if (mapno == revmap->rm_lastmapno)
+		return revmap->rm_lastmapblk;
+
+	dirno = mapno / DIRECTORY_PAGE_MAXITEMS;
+	if (dirno >= revmap->rm_ndirectory)
+		return InvalidBlockNumber;
+	dirblk = revmap->rm_directory[dirno];
+	if (dirblk == InvalidBlockNumber)
+		return InvalidBlockNumber;
+
+	revmap->rm_dirbuf = ReleaseAndReadBuffer(revmap->rm_dirbuf,
+											 revmap->rm_irel, dirblk);
+	LockBuffer(revmap->rm_dirbuf, BUFFER_LOCK_SHARE);
+	blkno = BrinPageGetDirectory(BufferGetPage(revmap->rm_dirbuf))
+		[mapno % DIRECTORY_PAGE_MAXITEMS];
+	LockBuffer(revmap->rm_dirbuf, BUFFER_LOCK_UNLOCK);
+
+	/* only remember pages that exist; they cannot go away */
+	if (blkno != InvalidBlockNumber)
+	{
+		revmap->rm_lastmapno = mapno;
+		revmap->rm_lastmapblk = blkno;
+	}
+	return blkno;
+}
+
+/*
+ * Add a new directory or revmap page to the index and link it from slot
+ * "slot" of parentbuf, which the caller holds exclusively locked.
+ */
+static BlockNumber
+revmap_new_map_page(Relation irel, Buffer parentbuf, uint32 slot,
+					uint16 type)
+{
+	Buffer		newbuf;
+	BlockNumber newblk;
+	Page		parent = BufferGetPage(parentbuf);
+
+	LockRelationForExtension(irel, ExclusiveLock);
+	newbuf = ReadBuffer(irel, P_NEW);
+	UnlockRelationForExtension(irel, ExclusiveLock);
+	LockBuffer(newbuf, BUFFER_LOCK_EXCLUSIVE);
+	newblk = BufferGetBlockNumber(newbuf);
+
+	START_CRIT_SECTION();
+
+	brin_page_init(BufferGetPage(newbuf), type);
+	MarkBufferDirty(newbuf);
+	brinSetMapLink(parent, slot, newblk);
+	MarkBufferDirty(parentbuf);
+
+	if (RelationNeedsWAL(irel))
+	{
+		XLogRecPtr	recptr;
+		XLogRecData rdata[2];
+		xl_brin_new_map_page xlrec;
+
+		xlrec.node = irel->rd_node;
+		xlrec.parentBlk = BufferGetBlockNumber(parentbuf);
+		xlrec.slot = slot;
+		xlrec.newBlk = newblk;
+		xlrec.pageType = type;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = sizeof(xl_brin_new_map_page);
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &rdata[1];
+
+		rdata[1].data = NULL;
+		rdata[1].len = 0;
+		rdata[1].buffer = parentbuf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = NULL;
+
+		recptr = XLogInsert(RM_BRIN_ID, XLOG_BRIN_NEW_MAP_PAGE, rdata);
+
+		PageSetLSN(parent, recptr);
+		PageSetLSN(BufferGetPage(newbuf), recptr);
+	}
+
+	END_CRIT_SECTION();
+
+	UnlockReleaseBuffer(newbuf);
+
+	return newblk;
+}
+
+/*
+ * Make sure the revmap page covering heapBlk exists, creating it (and its
+ * directory page) if necessary, and return its block number.
+ */
+static BlockNumber
+revmap_extend(BrinRevmap *revmap, BlockNumber heapBlk)
+{
+	Relation	irel = revmap->rm_irel;
+	BlockNumber mapno;
+	uint32		dirno;
+	Buffer		metabuf;
+	Buffer		dirbuf;
+	BrinMetaPageData *meta;
+	BlockNumber dirblk;
+	BlockNumber blkno;
+
+	mapno = heapBlk / revmap->rm_pagesPerRange / REVMAP_PAGE_MAXITEMS;
+	dirno = mapno / DIRECTORY_PAGE_MAXITEMS;
+	if (dirno >= BRIN_MAX_DIRECTORY_PAGES)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("heap block %u is out of range for BRIN index \"%s\"",
+						heapBlk, RelationGetRelationName(irel)),
+				 errhint("Recreate the index with a larger pages_per_range.")));
+
+	/* the metapage lock serializes all additions to the range map */
+	metabuf = ReadBuffer(irel, BRIN_METAPAGE_BLKNO);
+	LockBuffer(metabuf, BUFFER_LOCK_EXCLUSIVE);
+	meta = BrinPageGetMeta(BufferGetPage(metabuf));
+
+	dirblk = (dirno < meta->nDirectory) ?
+		meta->directory[dirno] : InvalidBlockNumber;
+	if (dirblk == InvalidBlockNumber)
+		dirblk = revmap_new_map_page(irel, metabuf, dirno,
+									 BRIN_PAGETYPE_DIRECTORY);
+
+	/* refresh our copy of the directory links while we're here */
+	if (meta->nDirectory > revmap->rm_ndirectory)
+		revmap->rm_directory = (BlockNumber *)
+			repalloc(revmap->rm_directory,
+					 sizeof(BlockNumber) * meta->nDirectory);
+	memcpy(revmap->rm_directory, meta->directory,
+		   sizeof(BlockNumber) * meta->nDirectory);
+	revmap->rm_ndirectory = meta->nDirectory;
+
+	dirbuf = ReadBuffer(irel, dirblk);
+	LockBuffer(dirbuf, BUFFER_LOCK_EXCLUSIVE);
+	blkno = BrinPageGetDirectory(BufferGetPage(dirbuf))
+		[mapno % DIRECTORY_PAGE_MAXITEMS];
+	if (blkno == InvalidBlockNumber)
+		blkno = revmap_new_map_page(irel, dirbuf,
+									mapno % DIRECTORY_PAGE_MAXITEMS,
+									BRIN_PAGETYPE_REVMAP);
+	UnlockReleaseBuffer(dirbuf);
+	UnlockReleaseBuffer(metabuf);
+
+	return blkno;
+}
+
+/*
+ * Return the revmap page covering heapBlk, exclusively locked, ready for
+ * updating the range's entry.  If the page doesn't exist yet, it is created
+ * if extend is true, else InvalidBuffer is returned.
+ *
+ * The pin belongs to the revmap object, so the caller must only unlock the
+ * buffer when done, not release it.
+ */
+Buffer
+brinLockRevmapPageForUpdate(BrinRevmap *revmap, BlockNumber heapBlk,
+							bool extend)
+{
+	BlockNumber blkno;
+
+	blkno = revmap_get_blkno(revmap, heapBlk);
+	if (blkno == InvalidBlockNumber)
+	{
+		if (!extend)
+			return InvalidBuffer;
+		blkno = revmap_extend(revmap, heapBlk);
+	}
+
+	revmap->rm_currbuf = ReleaseAndReadBuffer(revmap->rm_currbuf,
+											  revmap->rm_irel, blkno);
+	LockBuffer(revmap->rm_currbuf, BUFFER_LOCK_EXCLUSIVE);
+
+	return revmap->rm_currbuf;
+}
+
+/*
+ * Read or set the entry for the range containing heapBlk in a locked revmap
+ * page.
+ */
+void
+brinGetRevmapEntry(Buffer rmbuf, BlockNumber pagesPerRange,
+				   BlockNumber heapBlk, ItemPointer tid)
+{
+	ItemPointerData *entries = BrinPageGetRevmap(BufferGetPage(rmbuf));
+
+	ItemPointerCopy(&entries[(heapBlk / pagesPerRange) % REVMAP_PAGE_MAXITEMS],
+					tid);
+}
+
+void
+brinSetRevmapEntry(Buffer rmbuf, BlockNumber pagesPerRange,
+				   BlockNumber heapBlk, ItemPointer tid)
+{
+	ItemPointerData *entries = BrinPageGetRevmap(BufferGetPage(rmbuf));
+
+	ItemPointerCopy(tid,
+				 &entries[(heapBlk / pagesPerRange) % REVMAP_PAGE_MAXITEMS]);
+}
+
+/*
+ * Copy the summary tuple pointed to by the entry for heapBlk in rmbuf, which
+ * the caller holds locked in either mode, or return NULL if there is none.
+ *
+ * Summary tuples are only changed by backends holding the covering revmap
+ * page exclusively, so the tuple cannot move while we copy it.
+ */
+static BrinTuple *
+revmap_fetch_tuple(BrinRevmap *revmap, Buffer rmbuf, BlockNumber heapBlk,
+				   Size *size)
+{
+	Relation	irel = revmap->rm_irel;
+	ItemPointerData tid;
+	Buffer		buf;
+	Page		page;
+	ItemId		lp;
+	BrinTuple  *tup;
+
+	brinGetRevmapEntry(rmbuf, revmap->rm_pagesPerRange, heapBlk, &tid);
+	if (!ItemPointerIsValid(&tid))
+		return NULL;
+
+	buf = ReadBuffer(irel, ItemPointerGetBlockNumber(&tid));
+	LockBuffer(buf, BUFFER_LOCK_SHARE);
+	page = BufferGetPage(buf);
+
+	if (!BRIN_IS_REGULAR_PAGE(page) ||
+		ItemPointerGetOffsetNumber(&tid) > PageGetMaxOffsetNumber(page) ||
+		!ItemIdIsNormal(lp = PageGetItemId(page,
+										   ItemPointerGetOffsetNumber(&tid))))
+		ereport(ERROR,
+				(errcode(ERRCODE_INDEX_CORRUPTED),
+				 errmsg("corrupted BRIN index \"%s\": range map entry for heap block %u points to (%u,%u)",
+						RelationGetRelationName(irel), heapBlk,
+						ItemPointerGetBlockNumber(&tid),
+						ItemPointerGetOffsetNumber(&tid))));
+
+	*size = ItemIdGetLength(lp);
+	tup = (BrinTuple *) palloc(*size);
+	memcpy(tup, PageGetItem(page, lp), *size);
+
+	UnlockReleaseBuffer(buf);
+
+	return tup;
+}
+
+/*
+ * Fetch a copy of the summary tuple of the range containing heapBlk, or NULL
+ * if the range has not been summarized.  The length is stored in *size.
+ */
+BrinTuple *
+brinGetTupleForHeapBlock(BrinRevmap *revmap, BlockNumber heapBlk,
+						 Size *size)
+{
+	BlockNumber blkno;
+	BrinTuple  *tup;
+
+	blkno = revmap_get_blkno(revmap, heapBlk);
+	if (blkno == InvalidBlockNumber)
+		return NULL;
+
+	revmap->rm_currbuf = ReleaseAndReadBuffer(revmap->rm_currbuf,
+											  revmap->rm_irel, blkno);
+	LockBuffer(revmap->rm_currbuf, BUFFER_LOCK_SHARE);
+	tup = revmap_fetch_tuple(revmap, revmap->rm_currbuf, heapBlk, size);
+	LockBuffer(revmap->rm_currbuf, BUFFER_LOCK_UNLOCK);
+
+	return tup;
+}
+
+/*
+ * Like brinGetTupleForHeapBlock, for a caller that already holds the revmap
+ * page returned by brinLockRevmapPageForUpdate.
+ */
+BrinTuple *
+brinGetTupleForUpdate(BrinRevmap *revmap, Buffer rmbuf, BlockNumber heapBlk,
+					  Size *size)
+{
+	return revmap_fetch_tuple(revmap, rmbuf, heapBlk, size);
+}
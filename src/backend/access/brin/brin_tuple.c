@@ -0,0 +1,303 @@
+/*-------------------------------------------------------------------------
+ *
+ * brin_tuple.c
+ *	  Forming, deforming and comparing BRIN summary tuples
+ *
+ * A summary records, for each indexed column, the smallest and largest
+ * non-null value in the block range plus whether any nulls were seen.  All
+ * comparisons go through the column's btree-style comparison proc, so any
+ * type with a btree opclass can have a minmax BRIN opclass.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ * IDENTIFICATION
+ *			src/backend/access/brin/brin_tuple.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/brin_private.h"
+#include "access/genam.h"
+#include "access/tupdesc.h"
+#include "utils/datum.h"
+
+
+/*
+ * Build the working state for a BRIN index.  Everything is allocated in the
+ * current memory context.
+ */
+BrinDesc *
+brin_build_desc(Relation rel)
+{
+	BrinDesc   *bdesc;
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	int			natts = tupdesc->natts;
+	int			i;
+
+	bdesc = (BrinDesc *) palloc0(sizeof(BrinDesc));
+	bdesc->bd_index = rel;
+	bdesc->bd_tupdesc = tupdesc;
+
+	/* the stored tuple has a min and a max attribute for each column */
+	bdesc->bd_disktdesc = CreateTemplateTupleDesc(natts * 2, false);
+	for (i = 0; i < natts; i++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[i];
+
+		TupleDescInitEntry(bdesc->bd_disktdesc, (AttrNumber) (2 * i + 1),
+						   NULL, attr->atttypid, attr->atttypmod, 0);
+		TupleDescInitEntry(bdesc->bd_disktdesc, (AttrNumber) (2 * i + 2),
+						   NULL, attr->atttypid, attr->atttypmod, 0);
+
+		bdesc->bd_cmp[i] = index_getprocinfo(rel, i + 1, BRIN_ORDER_PROC);
+	}
+
+	return bdesc;
+}
+
+/*
+ * Return a new in-memory summary of an empty range starting at blkno.
+ */
+BrinMemTuple *
+brin_new_memtuple(BrinDesc *bdesc, BlockNumber blkno)
+{
+	BrinMemTuple *dtup;
+	int			i;
+
+	dtup = palloc0(offsetof(BrinMemTuple, bt_columns) +
+				   sizeof(BrinValues) * bdesc->bd_tupdesc->natts);
+	dtup->bt_blkno = blkno;
+	dtup->bt_placeholder = false;
+	for (i = 0; i < bdesc->bd_tupdesc->natts; i++)
+		dtup->bt_columns[i].allnulls = true;
+
+	return dtup;
+}
+
+/*
+ * Build an on-disk tuple from an in-memory summary.  The length of the
+ * result is stored in *size.
+ */
+BrinTuple *
+brin_form_tuple(BrinDesc *bdesc, BrinMemTuple *dtup, Size *size)
+{
+	int			natts = bdesc->bd_tupdesc->natts;
+	Datum		values[INDEX_MAX_KEYS * 2];
+	bool		nulls[INDEX_MAX_KEYS * 2];
+	IndexTuple	itup;
+	BrinTuple  *tuple;
+	Size		len;
+	int			i;
+
+	for (i = 0; i < natts; i++)
+	{
+		BrinValues *col = &dtup->bt_columns[i];
+
+		values[2 * i] = col->min;
+		values[2 * i + 1] = col->max;
+		nulls[2 * i] = nulls[2 * i + 1] = col->allnulls;
+	}
+
+	itup = index_form_tuple(bdesc->bd_disktdesc, values, nulls);
+
+	len = BrinTupleDataOffset(natts) + IndexTupleSize(itup);
+	if (len > BrinMaxItemSize)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+			errmsg("index row size %lu exceeds maximum %lu for index \"%s\"",
+				   (unsigned long) len,
+				   (unsigned long) BrinMaxItemSize,
+				   RelationGetRelationName(bdesc->bd_index))));
+
+	tuple = (BrinTuple *) palloc0(len);
+	tuple->bt_blkno = dtup->bt_blkno;
+	tuple->bt_info = dtup->bt_placeholder ? BRIN_PLACEHOLDER : 0;
+	for (i = 0; i < natts; i++)
+	{
+		BrinValues *col = &dtup->bt_columns[i];
+
+		if (col->allnulls)
+			tuple->bt_colflags[i] |= BRIN_COL_ALLNULLS;
+		if (col->hasnulls)
+			tuple->bt_colflags[i] |= BRIN_COL_HASNULLS;
+	}
+	memcpy(BrinTupleGetIndexTuple(tuple, natts), itup, IndexTupleSize(itup));
+	pfree(itup);
+
+	*size = len;
+	return tuple;
+}
+
+/*
+ * Deform an on-disk tuple.  The values are copied, so the result does not
+ * depend on the tuple's storage.
+ */
+BrinMemTuple *
+brin_deform_tuple(BrinDesc *bdesc, BrinTuple *tuple)
+{
+	TupleDesc	tupdesc = bdesc->bd_tupdesc;
+	int			natts = tupdesc->natts;
+	Datum		values[INDEX_MAX_KEYS * 2];
+	bool		nulls[INDEX_MAX_KEYS * 2];
+	BrinMemTuple *dtup;
+	int			i;
+
+	dtup = brin_new_memtuple(bdesc, tuple->bt_blkno);
+	dtup->bt_placeholder = BrinTupleIsPlaceholder(tuple);
+
+	index_deform_tuple(BrinTupleGetIndexTuple(tuple, natts),
+					   bdesc->bd_disktdesc, values, nulls);
+
+	for (i = 0; i < natts; i++)
+	{
+		BrinValues *col = &dtup->bt_columns[i];
+		Form_pg_attribute attr = tupdesc->attrs[i];
+
+		col->allnulls = (tuple->bt_colflags[i] & BRIN_COL_ALLNULLS) != 0;
+		col->hasnulls = (tuple->bt_colflags[i] & BRIN_COL_HASNULLS) != 0;
+		if (!col->allnulls)
+		{
+			col->min = datumCopy(values[2 * i], attr->attbyval, attr->attlen);
+			col->max = datumCopy(values[2 * i + 1], attr->attbyval,
+								 attr->attlen);
+		}
+	}
+
+	return dtup;
+}
+
+static int32
+brin_compare(BrinDesc *bdesc, int keyno, Datum a, Datum b)
+{
+	return DatumGetInt32(FunctionCall2Coll(bdesc->bd_cmp[keyno],
+								bdesc->bd_index->rd_indcollation[keyno],
+										   a, b));
+}
+
+/* Replace *dst by a copy of value, freeing the previous copy */
+static void
+brin_store_value(Form_pg_attribute attr, Datum *dst, Datum value,
+				 bool hadvalue)
+{
+	if (hadvalue && !attr->attbyval)
+		pfree(DatumGetPointer(*dst));
+	*dst = datumCopy(value, attr->attbyval, attr->attlen);
+}
+
+/*
+ * Widen the summary of column keyno to cover the given value.  Returns true
+ * if the summary changed.
+ */
+bool
+brin_add_value(BrinDesc *bdesc, BrinMemTuple *dtup, int keyno,
+			   Datum value, bool isnull)
+{
+	BrinValues *col = &dtup->bt_columns[keyno];
+	Form_pg_attribute attr = bdesc->bd_tupdesc->attrs[keyno];
+	bool		changed = false;
+
+	if (isnull)
+	{
+		if (col->hasnulls)
+			return false;
+		col->hasnulls = true;
+		return true;
+	}
+
+	if (col->allnulls)
+	{
+		brin_store_value(attr, &col->min, value, false);
+		brin_store_value(attr, &col->max, value, false);
+		col->allnulls = false;
+		return true;
+	}
+
+	if (brin_compare(bdesc, keyno, value, col->min) < 0)
+	{
+		brin_store_value(attr, &col->min, value, true);
+		changed = true;
+	}
+	if (brin_compare(bdesc, keyno, value, col->max) > 0)
+	{
+		brin_store_value(attr, &col->max, value, true);
+		changed = true;
+	}
+
+	return changed;
+}
+
+/*
+ * Widen summary a to also cover everything summarized by b.
+ */
+void
+brin_union_tuples(BrinDesc *bdesc, BrinMemTuple *a, BrinMemTuple *b)
+{
+	int			keyno;
+
+	for (keyno = 0; keyno < bdesc->bd_tupdesc->natts; keyno++)
+	{
+		BrinValues *col = &b->bt_columns[keyno];
+
+		if (col->hasnulls)
+			brin_add_value(bdesc, a, keyno, (Datum) 0, true);
+		if (!col->allnulls)
+		{
+			brin_add_value(bdesc, a, keyno, col->min, false);
+			brin_add_value(bdesc, a, keyno, col->max, false);
+		}
+	}
+}
+
+/*
+ * Could the range summarized by dtup contain a row matching the scan key?
+ */
+bool
+brin_consistent(BrinDesc *bdesc, BrinMemTuple *dtup, ScanKey key)
+{
+	int			keyno = key->sk_attno - 1;
+	BrinValues *col = &dtup->bt_columns[keyno];
+	int32		cmp;
+
+	if (key->sk_flags & SK_ISNULL)
+	{
+		if (key->sk_flags & SK_SEARCHNULL)
+			return col->hasnulls;
+		if (key->sk_flags & SK_SEARCHNOTNULL)
+			return !col->allnulls;
+
+		/* ordinary operators are strict, so a null argument matches nothing */
+		return false;
+	}
+
+	if (col->allnulls)
+		return false;
+
+	switch (key->sk_strategy)
+	{
+		case BTLessStrategyNumber:
+			cmp = brin_compare(bdesc, keyno, col->min, key->sk_argument);
+			return cmp < 0;
+		case BTLessEqualStrategyNumber:
+			cmp = brin_compare(bdesc, keyno, col->min, key->sk_argument);
+			return cmp <= 0;
+		case BTEqualStrategyNumber:
+			cmp = brin_compare(bdesc, keyno, col->min, key->sk_argument);
+			if (cmp > 0)
+				return false;
+			cmp = brin_compare(bdesc, keyno, col->max, key->sk_argument);
+			return cmp >= 0;
+		case BTGreaterEqualStrategyNumber:
+			cmp = brin_compare(bdesc, keyno, col->max, key->sk_argument);
+			return cmp >= 0;
+		case BTGreaterStrategyNumber:
+			cmp = brin_compare(bdesc, keyno, col->max, key->sk_argument);
+			return cmp > 0;
+		default:
+			elog(ERROR, "unrecognized strategy number: %d",
+				 key->sk_strategy);
+	}
+
+	return false;				/* keep compiler quiet */
+}
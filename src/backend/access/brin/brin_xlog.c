@@ -0,0 +1,257 @@
+/*-------------------------------------------------------------------------
+ *
+ * brin_xlog.c
+ *	  WAL replay logic for BRIN indexes
+ *
+ * Where a record touches both a regular page and the range map, the regular
+ * page is replayed first, so that a hot standby backend following the range
+ * map never finds a tuple missing.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ * IDENTIFICATION
+ *			src/backend/access/brin/brin_xlog.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/brin_private.h"
+#include "access/xlogutils.h"
+#include "storage/freespace.h"
+
+
+static void
+brinRedoCreateIndex(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_brin_createidx *xlrec = (xl_brin_createidx *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+
+	/* Backup blocks are not used in create_index records */
+	Assert(!(record->xl_info & XLR_BKP_BLOCK_MASK));
+
+	buffer = XLogReadBuffer(xlrec->node, BRIN_METAPAGE_BLKNO, true);
+	Assert(BufferIsValid(buffer));
+	page = (Page) BufferGetPage(buffer);
+	brin_metapage_init(page, xlrec->pagesPerRange);
+	PageSetLSN(page, lsn);
+	MarkBufferDirty(buffer);
+	UnlockReleaseBuffer(buffer);
+}
+
+/*
+ * Replay the addition of a summary tuple at xlrec->tid and the range map
+ * update pointing to it, common to insert and update records.
+ */
+static void
+brinRedoInsertTuple(XLogRecPtr lsn, XLogRecord *record, xl_brin_insert *xlrec,
+					BrinTuple *tup, Size tuplen, int revmapbkp, int databkp)
+{
+	BlockNumber blkno = ItemPointerGetBlockNumber(&xlrec->tid);
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(&xlrec->tid);
+	Buffer		buffer;
+	Page		page;
+
+	if (record->xl_info & XLOG_BRIN_INIT_PAGE)
+	{
+		buffer = XLogReadBuffer(xlrec->node, blkno, true);
+		Assert(BufferIsValid(buffer));
+		page = (Page) BufferGetPage(buffer);
+		brin_page_init(page, BRIN_PAGETYPE_REGULAR);
+	}
+	else if (record->xl_info & XLR_BKP_BLOCK(databkp))
+	{
+		buffer = RestoreBackupBlock(lsn, record, databkp, false, true);
+		page = (Page) BufferGetPage(buffer);
+	}
+	else
+	{
+		buffer = XLogReadBuffer(xlrec->node, blkno, false);
+		page = BufferIsValid(buffer) ? (Page) BufferGetPage(buffer) : NULL;
+	}
+
+	if (BufferIsValid(buffer))
+	{
+		if ((record->xl_info & XLOG_BRIN_INIT_PAGE) ||
+			(!(record->xl_info & XLR_BKP_BLOCK(databkp)) &&
+			 lsn > PageGetLSN(page)))
+		{
+			if (PageAddItem(page, (Item) tup, tuplen, offnum,
+							true, false) != offnum)
+				elog(PANIC, "brin_redo: failed to add tuple");
+			PageSetLSN(page, lsn);
+			MarkBufferDirty(buffer);
+		}
+		XLogRecordPageWithFreeSpace(xlrec->node, blkno,
+									PageGetFreeSpace(page));
+		UnlockReleaseBuffer(buffer);
+	}
+
+	if (record->xl_info & XLR_BKP_BLOCK(revmapbkp))
+		(void) RestoreBackupBlock(lsn, record, revmapbkp, false, false);
+	else
+	{
+		buffer = XLogReadBuffer(xlrec->node, xlrec->revmapBlk, false);
+		if (BufferIsValid(buffer))
+		{
+			page = (Page) BufferGetPage(buffer);
+			if (lsn > PageGetLSN(page))
+			{
+				brinSetRevmapEntry(buffer, xlrec->pagesPerRange,
+								   xlrec->heapBlk, &xlrec->tid);
+				PageSetLSN(page, lsn);
+				MarkBufferDirty(buffer);
+			}
+			UnlockReleaseBuffer(buffer);
+		}
+	}
+}
+
+static void
+brinRedoInsert(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_brin_insert *xlrec = (xl_brin_insert *) XLogRecGetData(record);
+	BrinTuple  *tup = (BrinTuple *) ((char *) xlrec + SizeOfBrinInsert);
+	Size		tuplen = record->xl_len - SizeOfBrinInsert;
+
+	brinRedoInsertTuple(lsn, record, xlrec, tup, tuplen, 0, 1);
+}
+
+static void
+brinRedoUpdate(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_brin_update *xlrec = (xl_brin_update *) XLogRecGetData(record);
+	BrinTuple  *tup = (BrinTuple *) ((char *) xlrec + SizeOfBrinUpdate);
+	Size		tuplen = record->xl_len - SizeOfBrinUpdate;
+	Buffer		buffer;
+	Page		page;
+
+	brinRedoInsertTuple(lsn, record, &xlrec->new, tup, tuplen, 0, 2);
+
+	/* now remove the old tuple */
+	if (record->xl_info & XLR_BKP_BLOCK(1))
+		(void) RestoreBackupBlock(lsn, record, 1, false, false);
+	else
+	{
+		buffer = XLogReadBuffer(xlrec->new.node,
+								ItemPointerGetBlockNumber(&xlrec->oldtid),
+								false);
+		if (BufferIsValid(buffer))
+		{
+			page = (Page) BufferGetPage(buffer);
+			if (lsn > PageGetLSN(page))
+			{
+				ItemIdSetUnused(PageGetItemId(page,
+								ItemPointerGetOffsetNumber(&xlrec->oldtid)));
+				PageRepairFragmentation(page);
+				PageSetLSN(page, lsn);
+				MarkBufferDirty(buffer);
+			}
+			UnlockReleaseBuffer(buffer);
+		}
+	}
+}
+
+static void
+brinRedoSamepageUpdate(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_brin_samepage_update *xlrec;
+	BrinTuple  *tup;
+	Size		tuplen;
+	OffsetNumber offnum;
+	Buffer		buffer;
+	Page		page;
+
+	if (record->xl_info & XLR_BKP_BLOCK(0))
+	{
+		(void) RestoreBackupBlock(lsn, record, 0, false, false);
+		return;
+	}
+
+	xlrec = (xl_brin_samepage_update *) XLogRecGetData(record);
+	tup = (BrinTuple *) ((char *) xlrec + SizeOfBrinSamepageUpdate);
+	tuplen = record->xl_len - SizeOfBrinSamepageUpdate;
+	offnum = ItemPointerGetOffsetNumber(&xlrec->tid);
+
+	buffer = XLogReadBuffer(xlrec->node,
+							ItemPointerGetBlockNumber(&xlrec->tid), false);
+	if (!BufferIsValid(buffer))
+		return;
+	page = (Page) BufferGetPage(buffer);
+
+	if (lsn > PageGetLSN(page))
+	{
+		ItemIdSetUnused(PageGetItemId(page, offnum));
+		PageRepairFragmentation(page);
+		if (PageAddItem(page, (Item) tup, tuplen, offnum,
+						true, false) != offnum)
+			elog(PANIC, "brin_redo: failed to replace tuple");
+		PageSetLSN(page, lsn);
+		MarkBufferDirty(buffer);
+	}
+	UnlockReleaseBuffer(buffer);
+}
+
+static void
+brinRedoNewMapPage(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_brin_new_map_page *xlrec = (xl_brin_new_map_page *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+
+	/* initialize the new page before linking to it */
+	buffer = XLogReadBuffer(xlrec->node, xlrec->newBlk, true);
+	Assert(BufferIsValid(buffer));
+	page = (Page) BufferGetPage(buffer);
+	brin_page_init(page, xlrec->pageType);
+	PageSetLSN(page, lsn);
+	MarkBufferDirty(buffer);
+	UnlockReleaseBuffer(buffer);
+
+	if (record->xl_info & XLR_BKP_BLOCK(0))
+		(void) RestoreBackupBlock(lsn, record, 0, false, false);
+	else
+	{
+		buffer = XLogReadBuffer(xlrec->node, xlrec->parentBlk, false);
+		if (BufferIsValid(buffer))
+		{
+			page = (Page) BufferGetPage(buffer);
+			if (lsn > PageGetLSN(page))
+			{
+				brinSetMapLink(page, xlrec->slot, xlrec->newBlk);
+				PageSetLSN(page, lsn);
+				MarkBufferDirty(buffer);
+			}
+			UnlockReleaseBuffer(buffer);
+		}
+	}
+}
+
+void
+brin_redo(XLogRecPtr lsn, XLogRecord *record)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+
+	switch (info & XLOG_BRIN_OPMASK)
+	{
+		case XLOG_BRIN_CREATE_INDEX:
+			brinRedoCreateIndex(lsn, record);
+			break;
+		case XLOG_BRIN_INSERT:
+			brinRedoInsert(lsn, record);
+			break;
+		case XLOG_BRIN_UPDATE:
+			brinRedoUpdate(lsn, record);
+			break;
+		case XLOG_BRIN_SAMEPAGE_UPDATE:
+			brinRedoSamepageUpdate(lsn, record);
+			break;
+		case XLOG_BRIN_NEW_MAP_PAGE:
+			brinRedoNewMapPage(lsn, record);
+			break;
+		default:
+			elog(PANIC, "brin_redo: unknown op code %u", info);
+	}
+}
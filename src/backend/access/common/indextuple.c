@@ -434,3 +434,33 @@ CopyIndexTuple(IndexTuple source)
 	memcpy(result, source, size);
 	return result;
 }
+
+/*
+ * Create a palloc'd copy of an index tuple that keeps only its first
+ * leavenatts attributes.  The result is never larger than the source, and
+ * its remaining attributes can still be read with tupleDescriptor.
+ */
+IndexTuple
+index_truncate_tuple(TupleDesc tupleDescriptor, IndexTuple source,
+					 int leavenatts)
+{
+	TupleDesc	truncdesc;
+	Datum		values[INDEX_MAX_KEYS];
+	bool		isnull[INDEX_MAX_KEYS];
+	IndexTuple	result;
+
+	Assert(leavenatts > 0 && leavenatts <= tupleDescriptor->natts);
+
+	/* a descriptor for the leading attributes, sharing their definitions */
+	truncdesc = CreateTupleDesc(leavenatts, tupleDescriptor->tdhasoid,
+								tupleDescriptor->attrs);
+
+	index_deform_tuple(source, truncdesc, values, isnull);
+	result = index_form_tuple(truncdesc, values, isnull);
+	result->t_tid = source->t_tid;
+	Assert(IndexTupleSize(result) <= IndexTupleSize(source));
+
+	pfree(truncdesc);
+
+	return result;
+}
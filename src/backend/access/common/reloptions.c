@@ -15,6 +15,7 @@
 
 #include "postgres.h"
 
+#include "access/brin.h"
 #include "access/gist_private.h"
 #include "access/hash.h"
 #include "access/htup_details.h"
@@ -68,6 +69,14 @@ static relopt_bool boolRelOpts[] =
 		},
 		true
 	},
+	{
+		{
+			"deduplicate_items",
+			"Enables \"deduplicate items\" feature for this btree index",
+			RELOPT_KIND_BTREE
+		},
+		true
+	},
 	{
 		{
 			"security_barrier",
@@ -122,6 +131,15 @@ static relopt_int intRelOpts[] =
 		},
 		SPGIST_DEFAULT_FILLFACTOR, SPGIST_MIN_FILLFACTOR, 100
 	},
+	{
+		{
+			"pages_per_range",
+			"Number of pages that each block range of a BRIN index covers",
+			RELOPT_KIND_BRIN
+		},
+		BRIN_DEFAULT_PAGES_PER_RANGE, BRIN_MIN_PAGES_PER_RANGE,
+		BRIN_MAX_PAGES_PER_RANGE
+	},
 	{
 		{
 			"autovacuum_vacuum_threshold",
@@ -177,6 +195,14 @@ static relopt_int intRelOpts[] =
 			RELOPT_KIND_HEAP | RELOPT_KIND_TOAST
 		}, -1, 0, 2000000000
 	},
+	{
+		{
+			"parallel_vacuum_workers",
+			"Number of parallel workers VACUUM may use to vacuum the indexes of this table",
+			RELOPT_KIND_HEAP
+		},
+		-1, 0, 256
+	},
 	/* list terminator */
 	{{NULL}}
 };
@@ -1152,6 +1178,10 @@ default_reloptions(Datum reloptions, bool validate, relopt_kind kind)
 		offsetof(StdRdOptions, autovacuum) +offsetof(AutoVacOpts, analyze_scale_factor)},
 		{"security_barrier", RELOPT_TYPE_BOOL,
 		offsetof(StdRdOptions, security_barrier)},
+		{"deduplicate_items", RELOPT_TYPE_BOOL,
+		offsetof(StdRdOptions, deduplicate_items)},
+		{"parallel_vacuum_workers", RELOPT_TYPE_INT,
+		offsetof(StdRdOptions, parallel_vacuum_workers)},
 	};
 
 	options = parseRelOptions(reloptions, validate, kind, &numoptions);
@@ -151,7 +151,8 @@ IndexScanEnd(IndexScanDesc scan)
  *
  * Construct a string describing the contents of an index entry, in the
  * form "(key_name, ...)=(key_value, ...)".  This is currently used
- * for building unique-constraint and exclusion-constraint error messages.
+ * for building unique-constraint and exclusion-constraint error messages,
+ * so INCLUDE columns are left out.
  *
  * The passed-in values/nulls arrays are the "raw" input to the index AM,
  * e.g. results of FormIndexDatum --- this is not necessarily what is stored
@@ -162,7 +163,7 @@ BuildIndexValueDescription(Relation indexRelation,
 						   Datum *values, bool *isnull)
 {
 	StringInfoData buf;
-	int			natts = indexRelation->rd_rel->relnatts;
+	int			natts = IndexRelationGetNumberOfKeyAttributes(indexRelation);
 	int			i;
 
 	initStringInfo(&buf);
@@ -0,0 +1,293 @@
+/*-------------------------------------------------------------------------
+ *
+ * nbtdedup.c
+ *	  Deduplication of equal keys into posting list tuples.
+ *
+ * A run of leaf tuples with equal keys is stored as a single posting list
+ * tuple, see nbtree.h.  Runs are merged when a leaf page is about to be
+ * split and while a new index is being built; nothing else in nbtree needs
+ * to know more about posting lists than how to walk their heap TIDs.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/nbtree/nbtdedup.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/heapam_xlog.h"
+#include "access/nbtree.h"
+#include "miscadmin.h"
+#include "utils/rel.h"
+
+
+/* size of a leaf tuple's key, that is everything but its posting list */
+#define BTreeTupleGetKeySize(itup) \
+	(BTreeTupleIsPosting(itup) ? BTreeTupleGetPostingOffset(itup) : \
+	 IndexTupleSize(itup))
+
+static bool _bt_dedup_equal(IndexTuple itup1, IndexTuple itup2);
+static int	_bt_tid_cmp(const void *a, const void *b);
+static void _bt_dedup_addtup(Page page, IndexTuple itup, bool isdead);
+
+
+/*
+ * Start a new run of equal tuples with base as its first member.  base must
+ * stay valid until the run is finished.
+ */
+void
+_bt_dedup_start_run(BTDedupState state, IndexTuple base)
+{
+	int			nhtids = BTreeTupleGetNHeapTIDs(base);
+	int			i;
+
+	state->base = base;
+	state->basekeysize = BTreeTupleGetKeySize(base);
+	state->nitems = 1;
+	state->nhtids = 0;
+	state->sorted = true;
+	for (i = 0; i < nhtids; i++)
+		state->htids[state->nhtids++] = *BTreeTupleGetHeapTID(base, i);
+}
+
+/*
+ * Try to add itup to the current run.  Returns false, leaving the run alone,
+ * if itup's key differs from the run's or the posting list would grow past
+ * BTMaxPostingSize.
+ */
+bool
+_bt_dedup_add_tuple(BTDedupState state, IndexTuple itup)
+{
+	int			nhtids = BTreeTupleGetNHeapTIDs(itup);
+	int			i;
+
+	if (!_bt_dedup_equal(state->base, itup))
+		return false;
+	if (MAXALIGN(state->basekeysize +
+				 (state->nhtids + nhtids) * sizeof(ItemPointerData)) >
+		BTMaxPostingSize)
+		return false;
+
+	for (i = 0; i < nhtids; i++)
+	{
+		ItemPointer htid = BTreeTupleGetHeapTID(itup, i);
+
+		if (ItemPointerCompare(htid, &state->htids[state->nhtids - 1]) < 0)
+			state->sorted = false;
+		state->htids[state->nhtids++] = *htid;
+	}
+	state->nitems++;
+
+	return true;
+}
+
+/*
+ * Finish the current run, returning the tuple that replaces it: the run's
+ * base tuple itself if nothing was added to it, else a palloc'd posting
+ * list tuple.
+ */
+IndexTuple
+_bt_dedup_finish_run(BTDedupState state)
+{
+	if (state->nitems == 1)
+		return state->base;
+
+	if (!state->sorted)
+		qsort(state->htids, state->nhtids, sizeof(ItemPointerData),
+			  _bt_tid_cmp);
+
+	return _bt_form_posting(state->base, state->htids, state->nhtids);
+}
+
+/*
+ * _bt_dedup_one_page - merge runs of equal tuples on a leaf page.
+ *
+ * This is tried before splitting a leaf page of an index that allows it.
+ * The page is rewritten, keeping its items in order, with every run of
+ * tuples with equal keys merged into posting lists as far as
+ * BTMaxPostingSize allows.  Returns false, leaving the page untouched, if
+ * there was nothing to merge.
+ *
+ * The passed buffer must be exclusive-locked.  Moving items around the page
+ * needs no stronger lock than _bt_vacuum_one_page does; scans that are
+ * still working from items they saved from the page identify them by heap
+ * TID when they come back to mark them LP_DEAD, and tolerate missing them.
+ *
+ * The rewritten page is WAL-logged as a full page image, as nbtsort.c does
+ * for pages of a new index.
+ */
+bool
+_bt_dedup_one_page(Relation rel, Buffer buf)
+{
+	Page		page = BufferGetPage(buf);
+	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+	Page		newpage;
+	BTDedupStateData state;
+	OffsetNumber offnum,
+				minoff,
+				maxoff;
+	int			nmerged = 0;
+
+	Assert(P_ISLEAF(opaque));
+
+	/* the rewritten page is built in a temporary copy, as in _bt_split */
+	newpage = PageGetTempPageCopySpecial(page);
+	PageSetLSN(newpage, PageGetLSN(page));
+
+	if (!P_RIGHTMOST(opaque))
+		_bt_dedup_addtup(newpage,
+						 (IndexTuple) PageGetItem(page,
+												  PageGetItemId(page, P_HIKEY)),
+						 false);
+
+	state.base = NULL;
+	state.htids = (ItemPointer) palloc(BTMaxPostingSize);
+
+	minoff = P_FIRSTDATAKEY(opaque);
+	maxoff = PageGetMaxOffsetNumber(page);
+	for (offnum = minoff; offnum <= maxoff; offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		IndexTuple	itup = (IndexTuple) PageGetItem(page, itemid);
+
+		if (state.base != NULL && !ItemIdIsDead(itemid) &&
+			_bt_dedup_add_tuple(&state, itup))
+			continue;
+
+		/* itup doesn't belong to the pending run, so write that out */
+		if (state.base != NULL)
+		{
+			IndexTuple	newitup = _bt_dedup_finish_run(&state);
+
+			_bt_dedup_addtup(newpage, newitup, false);
+			nmerged += state.nitems - 1;
+			if (newitup != state.base)
+				pfree(newitup);
+			state.base = NULL;
+		}
+
+		/* LP_DEAD items are copied as they are, and never merged */
+		if (ItemIdIsDead(itemid))
+			_bt_dedup_addtup(newpage, itup, true);
+		else
+			_bt_dedup_start_run(&state, itup);
+	}
+	if (state.base != NULL)
+	{
+		IndexTuple	newitup = _bt_dedup_finish_run(&state);
+
+		_bt_dedup_addtup(newpage, newitup, false);
+		nmerged += state.nitems - 1;
+		if (newitup != state.base)
+			pfree(newitup);
+	}
+
+	pfree(state.htids);
+
+	if (nmerged == 0)
+	{
+		pfree(newpage);
+		return false;
+	}
+
+	/* No ereport(ERROR) until changes are logged */
+	START_CRIT_SECTION();
+
+	PageRestoreTempPage(newpage, page);
+	MarkBufferDirty(buf);
+
+	if (RelationNeedsWAL(rel))
+		log_newpage_buffer(buf);
+
+	END_CRIT_SECTION();
+
+	return true;
+}
+
+/*
+ * Form a leaf tuple with base's key and the given heap TIDs, which must be
+ * in ascending order.  With a single TID, that is a plain tuple.
+ */
+IndexTuple
+_bt_form_posting(IndexTuple base, ItemPointer htids, int nhtids)
+{
+	Size		keysize = BTreeTupleGetKeySize(base);
+	Size		newsize;
+	IndexTuple	itup;
+
+	Assert(nhtids > 0);
+
+	if (nhtids == 1)
+		newsize = keysize;
+	else
+		newsize = MAXALIGN(keysize + nhtids * sizeof(ItemPointerData));
+	Assert(newsize <= INDEX_SIZE_MASK);
+
+	itup = (IndexTuple) palloc0(newsize);
+	memcpy(itup, base, keysize);
+	itup->t_info &= ~(INDEX_SIZE_MASK | BT_IS_POSTING);
+	itup->t_info |= newsize;
+
+	if (nhtids == 1)
+		itup->t_tid = htids[0];
+	else
+	{
+		itup->t_info |= BT_IS_POSTING;
+		ItemPointerSet(&itup->t_tid, keysize, nhtids);
+		memcpy(BTreeTupleGetPosting(itup), htids,
+			   nhtids * sizeof(ItemPointerData));
+	}
+
+	return itup;
+}
+
+/*
+ * Are the keys of two leaf tuples equal?
+ *
+ * Keys are compared as bytes rather than with the index's comparison
+ * function: values the opclass considers equal but that are not identical,
+ * such as numerics 1.0 and 1.00, must stay separate tuples so that
+ * index-only scans return each one as it was stored.
+ */
+static bool
+_bt_dedup_equal(IndexTuple itup1, IndexTuple itup2)
+{
+	Size		keysize = BTreeTupleGetKeySize(itup1);
+
+	if (BTreeTupleGetKeySize(itup2) != keysize)
+		return false;
+	if ((itup1->t_info & ~(INDEX_SIZE_MASK | BT_IS_POSTING)) !=
+		(itup2->t_info & ~(INDEX_SIZE_MASK | BT_IS_POSTING)))
+		return false;
+
+	return memcmp((char *) itup1 + sizeof(IndexTupleData),
+				  (char *) itup2 + sizeof(IndexTupleData),
+				  keysize - sizeof(IndexTupleData)) == 0;
+}
+
+/* qsort comparator for heap TIDs */
+static int
+_bt_tid_cmp(const void *a, const void *b)
+{
+	return ItemPointerCompare((ItemPointer) a, (ItemPointer) b);
+}
+
+/*
+ * Add an item to the end of a page being rebuilt by _bt_dedup_one_page.
+ */
+static void
+_bt_dedup_addtup(Page page, IndexTuple itup, bool isdead)
+{
+	OffsetNumber offnum = OffsetNumberNext(PageGetMaxOffsetNumber(page));
+
+	if (PageAddItem(page, (Item) itup, IndexTupleSize(itup), offnum,
+					false, false) == InvalidOffsetNumber)
+		elog(ERROR, "failed to add item to the page being deduplicated");
+	if (isdead)
+		ItemIdMarkDead(PageGetItemId(page, offnum));
+}
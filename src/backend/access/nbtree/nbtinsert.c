@@ -104,7 +104,7 @@ _bt_doinsert(Relation rel, IndexTuple itup,
 			 IndexUniqueCheck checkUnique, Relation heapRel)
 {
 	bool		is_unique = false;
-	int			natts = rel->rd_rel->relnatts;
+	int			natts = IndexRelationGetNumberOfKeyAttributes(rel);
 	ScanKey		itup_scankey;
 	BTStack		stack;
 	Buffer		buf;
@@ -206,6 +206,8 @@ top:
  * also point to end-of-page, which means that the first tuple to check
  * is the first tuple on the next page.
  *
+ * Only key columns are compared; INCLUDE columns don't affect uniqueness.
+ *
  * Returns InvalidTransactionId if there is no conflict, else an xact ID
  * we must wait for to see if it commits a conflicting tuple.	If an actual
  * conflict is detected, no return --- just ereport().
@@ -221,7 +223,7 @@ _bt_check_unique(Relation rel, IndexTuple itup, Relation heapRel,
 				 IndexUniqueCheck checkUnique, bool *is_unique)
 {
 	TupleDesc	itupdesc = RelationGetDescr(rel);
-	int			natts = rel->rd_rel->relnatts;
+	int			natts = IndexRelationGetNumberOfKeyAttributes(rel);
 	SnapshotData SnapshotDirty;
 	OffsetNumber maxoff;
 	Page		page;
@@ -487,7 +489,8 @@ _bt_check_unique(Relation rel, IndexTuple itup, Relation heapRel,
  *		any existing equal keys because of the way _bt_binsrch() works.
  *
  *		If there's not enough room in the space, we try to make room by
- *		removing any LP_DEAD tuples.
+ *		removing any LP_DEAD tuples, and then by merging equal keys into
+ *		posting lists.
  *
  *		On entry, *buf and *offsetptr point to the first legal position
  *		where the new tuple could be inserted.	The caller should hold an
@@ -515,7 +518,8 @@ _bt_findinsertloc(Relation rel,
 	Size		itemsz;
 	BTPageOpaque lpageop;
 	bool		movedright,
-				vacuumed;
+				vacuumed,
+				deduped;
 	OffsetNumber newitemoff;
 	OffsetNumber firstlegaloff = *offsetptr;
 
@@ -567,6 +571,7 @@ _bt_findinsertloc(Relation rel,
 	 */
 	movedright = false;
 	vacuumed = false;
+	deduped = false;
 	while (PageGetFreeSpace(page) < itemsz)
 	{
 		Buffer		rbuf;
@@ -589,6 +594,22 @@ _bt_findinsertloc(Relation rel,
 				break;			/* OK, now we have enough space */
 		}
 
+		/*
+		 * next, see if merging equal keys into posting lists frees enough.
+		 * That moves tuples around too, so the caller's hint is invalid.
+		 */
+		if (P_ISLEAF(lpageop) && !deduped && BTDeduplicationEnabled(rel))
+		{
+			deduped = true;
+			if (_bt_dedup_one_page(rel, buf))
+			{
+				vacuumed = true;
+
+				if (PageGetFreeSpace(page) >= itemsz)
+					break;		/* OK, now we have enough space */
+			}
+		}
+
 		/*
 		 * nope, so check conditions (b) and (c) enumerated above
 		 */
@@ -624,6 +645,7 @@ _bt_findinsertloc(Relation rel,
 		buf = rbuf;
 		movedright = true;
 		vacuumed = false;
+		deduped = false;
 	}
 
 	/*
@@ -1014,6 +1036,12 @@ _bt_split(Relation rel, Buffer buf, OffsetNumber firstright,
 		itemsz = ItemIdGetLength(itemid);
 		item = (IndexTuple) PageGetItem(origpage, itemid);
 	}
+	/* a leaf high key carries no posting list and no INCLUDE columns */
+	if (P_ISLEAF(oopaque) && BTreeTupleNeedsPivotCopy(rel, item))
+	{
+		item = _bt_pivot_copy(rel, item);
+		itemsz = IndexTupleSize(item);
+	}
 	if (PageAddItem(leftpage, (Item) item, itemsz, leftoff,
 					false, false) == InvalidOffsetNumber)
 	{
@@ -1215,24 +1243,25 @@ _bt_split(Relation rel, Buffer buf, OffsetNumber firstright,
 			lastrdata->data = (char *) &newitem->t_tid.ip_blkid;
 			lastrdata->len = sizeof(BlockIdData);
 			lastrdata->buffer = InvalidBuffer;
+		}
 
-			/*
-			 * We must also log the left page's high key, because the right
-			 * page's leftmost key is suppressed on non-leaf levels.  Show it
-			 * as belonging to the left page buffer, so that it is not stored
-			 * if XLogInsert decides it needs a full-page image of the left
-			 * page.
-			 */
-			lastrdata->next = lastrdata + 1;
-			lastrdata++;
+		/*
+		 * We must also log the left page's high key, because the right
+		 * page's leftmost key is suppressed on non-leaf levels, and the leaf
+		 * high key is cut down from it by _bt_pivot_copy.  Show it as
+		 * belonging to the left page buffer, so that it is not stored if
+		 * XLogInsert decides it needs a full-page image of the left page.
+		 * This also ensures that the left page is always backup block 1.
+		 */
+		lastrdata->next = lastrdata + 1;
+		lastrdata++;
 
-			itemid = PageGetItemId(origpage, P_HIKEY);
-			item = (IndexTuple) PageGetItem(origpage, itemid);
-			lastrdata->data = (char *) item;
-			lastrdata->len = MAXALIGN(IndexTupleSize(item));
-			lastrdata->buffer = buf;	/* backup block 1 */
-			lastrdata->buffer_std = true;
-		}
+		itemid = PageGetItemId(origpage, P_HIKEY);
+		item = (IndexTuple) PageGetItem(origpage, itemid);
+		lastrdata->data = (char *) item;
+		lastrdata->len = MAXALIGN(IndexTupleSize(item));
+		lastrdata->buffer = buf;	/* backup block 1 */
+		lastrdata->buffer_std = true;
 
 		/*
 		 * Log the new item and its offset, if it was inserted on the left
@@ -1260,22 +1289,6 @@ _bt_split(Relation rel, Buffer buf, OffsetNumber firstright,
 			lastrdata->buffer = buf;	/* backup block 1 */
 			lastrdata->buffer_std = true;
 		}
-		else if (ropaque->btpo.level == 0)
-		{
-			/*
-			 * Although we don't need to WAL-log the new item, we still need
-			 * XLogInsert to consider storing a full-page image of the left
-			 * page, so make an empty entry referencing that buffer. This also
-			 * ensures that the left page is always backup block 1.
-			 */
-			lastrdata->next = lastrdata + 1;
-			lastrdata++;
-
-			lastrdata->data = NULL;
-			lastrdata->len = 0;
-			lastrdata->buffer = buf;	/* backup block 1 */
-			lastrdata->buffer_std = true;
-		}
 
 		/*
 		 * Log the contents of the right page in the format understood by
@@ -779,6 +779,9 @@ _bt_page_recyclable(Page page)
  *
  * This routine assumes that the caller has pinned and locked the buffer.
  * Also, the given itemnos *must* appear in increasing order in the array.
+ * Posting list tuples that lose only some of their heap TIDs are replaced:
+ * updated[i] takes the place of the tuple at updatednos[i], which must also
+ * be in increasing order and disjoint from itemnos.
  *
  * We record VACUUMs and b-tree deletes differently in WAL. InHotStandby
  * we need to be able to pin all of the blocks in the btree in physical
@@ -793,15 +796,47 @@ _bt_page_recyclable(Page page)
 void
 _bt_delitems_vacuum(Relation rel, Buffer buf,
 					OffsetNumber *itemnos, int nitems,
-					BlockNumber lastBlockVacuumed)
+					OffsetNumber *updatednos, IndexTuple *updated,
+					int nupdated, BlockNumber lastBlockVacuumed)
 {
 	Page		page = BufferGetPage(buf);
 	BTPageOpaque opaque;
+	char	   *updatedbuf = NULL;
+	Size		updatedbuflen = 0;
+	int			i;
+
+	/* Collect the replacement tuples in one chunk for WAL */
+	if (nupdated > 0 && RelationNeedsWAL(rel))
+	{
+		for (i = 0; i < nupdated; i++)
+			updatedbuflen += MAXALIGN(IndexTupleSize(updated[i]));
+		updatedbuf = palloc(updatedbuflen);
+		updatedbuflen = 0;
+		for (i = 0; i < nupdated; i++)
+		{
+			Size		itemsz = MAXALIGN(IndexTupleSize(updated[i]));
+
+			memcpy(updatedbuf + updatedbuflen, updated[i], itemsz);
+			updatedbuflen += itemsz;
+		}
+	}
 
 	/* No ereport(ERROR) until changes are logged */
 	START_CRIT_SECTION();
 
-	/* Fix the page */
+	/*
+	 * Fix the page.  Replacing a tuple leaves the other items' offsets
+	 * unchanged, so do that before the deletions.
+	 */
+	for (i = 0; i < nupdated; i++)
+	{
+		PageIndexTupleDelete(page, updatednos[i]);
+		if (PageAddItem(page, (Item) updated[i],
+						MAXALIGN(IndexTupleSize(updated[i])), updatednos[i],
+						false, false) == InvalidOffsetNumber)
+			elog(PANIC, "failed to replace posting list item in index \"%s\"",
+				 RelationGetRelationName(rel));
+	}
 	if (nitems > 0)
 		PageIndexMultiDelete(page, itemnos, nitems);
 
@@ -827,36 +862,42 @@ _bt_delitems_vacuum(Relation rel, Buffer buf,
 	if (RelationNeedsWAL(rel))
 	{
 		XLogRecPtr	recptr;
-		XLogRecData rdata[2];
+		XLogRecData rdata[4];
 		xl_btree_vacuum xlrec_vacuum;
 
 		xlrec_vacuum.node = rel->rd_node;
 		xlrec_vacuum.block = BufferGetBlockNumber(buf);
 
 		xlrec_vacuum.lastBlockVacuumed = lastBlockVacuumed;
+		xlrec_vacuum.ndeleted = nitems;
+		xlrec_vacuum.nupdated = nupdated;
 		rdata[0].data = (char *) &xlrec_vacuum;
 		rdata[0].len = SizeOfBtreeVacuum;
 		rdata[0].buffer = InvalidBuffer;
 		rdata[0].next = &(rdata[1]);
 
 		/*
-		 * The target-offsets array is not in the buffer, but pretend that it
-		 * is.	When XLogInsert stores the whole buffer, the offsets array
-		 * need not be stored too.
+		 * The target-offsets arrays and replacement tuples are not in the
+		 * buffer, but pretend that they are.  When XLogInsert stores the
+		 * whole buffer, they need not be stored too.
 		 */
-		if (nitems > 0)
-		{
-			rdata[1].data = (char *) itemnos;
-			rdata[1].len = nitems * sizeof(OffsetNumber);
-		}
-		else
-		{
-			rdata[1].data = NULL;
-			rdata[1].len = 0;
-		}
+		rdata[1].data = (char *) itemnos;
+		rdata[1].len = nitems * sizeof(OffsetNumber);
 		rdata[1].buffer = buf;
 		rdata[1].buffer_std = true;
-		rdata[1].next = NULL;
+		rdata[1].next = &(rdata[2]);
+
+		rdata[2].data = (char *) updatednos;
+		rdata[2].len = nupdated * sizeof(OffsetNumber);
+		rdata[2].buffer = buf;
+		rdata[2].buffer_std = true;
+		rdata[2].next = &(rdata[3]);
+
+		rdata[3].data = updatedbuf;
+		rdata[3].len = updatedbuflen;
+		rdata[3].buffer = buf;
+		rdata[3].buffer_std = true;
+		rdata[3].next = NULL;
 
 		recptr = XLogInsert(RM_BTREE_ID, XLOG_BTREE_VACUUM, rdata);
 
@@ -864,6 +905,9 @@ _bt_delitems_vacuum(Relation rel, Buffer buf,
 	}
 
 	END_CRIT_SECTION();
+
+	if (updatedbuf)
+		pfree(updatedbuf);
 }
 
 /*
@@ -1138,8 +1182,9 @@ _bt_pagedel(Relation rel, Buffer buf, BTStack stack)
 			/* we need an insertion scan key to do our search, so build one */
 			itup_scankey = _bt_mkscankey(rel, targetkey);
 			/* find the leftmost leaf page containing this key */
-			stack = _bt_search(rel, rel->rd_rel->relnatts, itup_scankey, false,
-							   &lbuf, BT_READ);
+			stack = _bt_search(rel,
+							   IndexRelationGetNumberOfKeyAttributes(rel),
+							   itup_scankey, false, &lbuf, BT_READ);
 			/* don't need a pin on that either */
 			_bt_relbuf(rel, lbuf);
 
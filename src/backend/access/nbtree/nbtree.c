@@ -74,6 +74,8 @@ static void btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 			 BTCycleId cycleid);
 static void btvacuumpage(BTVacState *vstate, BlockNumber blkno,
 			 BlockNumber orig_blkno);
+static IndexTuple btvacuumposting(BTVacState *vstate, IndexTuple itup,
+				int *nremaining);
 
 
 /*
@@ -319,8 +321,8 @@ btgettuple(PG_FUNCTION_ARGS)
 				 */
 				if (so->killedItems == NULL)
 					so->killedItems = (int *)
-						palloc(MaxIndexTuplesPerPage * sizeof(int));
-				if (so->numKilled < MaxIndexTuplesPerPage)
+						palloc(MaxTIDsPerBTreePage * sizeof(int));
+				if (so->numKilled < MaxTIDsPerBTreePage)
 					so->killedItems[so->numKilled++] = so->currPos.itemIndex;
 			}
 
@@ -840,7 +842,8 @@ btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 		buf = ReadBufferExtended(rel, MAIN_FORKNUM, num_pages - 1, RBM_NORMAL,
 								 info->strategy);
 		LockBufferForCleanup(buf);
-		_bt_delitems_vacuum(rel, buf, NULL, 0, vstate.lastBlockVacuumed);
+		_bt_delitems_vacuum(rel, buf, NULL, 0, NULL, NULL, 0,
+							vstate.lastBlockVacuumed);
 		_bt_relbuf(rel, buf);
 	}
 
@@ -940,6 +943,9 @@ restart:
 	{
 		OffsetNumber deletable[MaxOffsetNumber];
 		int			ndeletable;
+		OffsetNumber updatednos[MaxOffsetNumber];
+		IndexTuple	updated[MaxOffsetNumber];
+		int			nupdated;
 		OffsetNumber offnum,
 					minoff,
 					maxoff;
@@ -972,6 +978,7 @@ restart:
 		 * callback function.
 		 */
 		ndeletable = 0;
+		nupdated = 0;
 		minoff = P_FIRSTDATAKEY(opaque);
 		maxoff = PageGetMaxOffsetNumber(page);
 		if (callback)
@@ -985,6 +992,29 @@ restart:
 
 				itup = (IndexTuple) PageGetItem(page,
 												PageGetItemId(page, offnum));
+
+				/*
+				 * A posting list is deleted if all its heap TIDs are, and
+				 * otherwise replaced by a copy without the dead ones.
+				 */
+				if (BTreeTupleIsPosting(itup))
+				{
+					IndexTuple	newitup;
+					int			nremaining;
+
+					newitup = btvacuumposting(vstate, itup, &nremaining);
+					stats->tuples_removed +=
+						BTreeTupleGetNPosting(itup) - nremaining;
+					if (nremaining == 0)
+						deletable[ndeletable++] = offnum;
+					else if (newitup != NULL)
+					{
+						updatednos[nupdated] = offnum;
+						updated[nupdated++] = newitup;
+					}
+					continue;
+				}
+
 				htup = &(itup->t_tid);
 
 				/*
@@ -1009,7 +1039,10 @@ restart:
 				 * killed.
 				 */
 				if (callback(htup, callback_state))
+				{
 					deletable[ndeletable++] = offnum;
+					stats->tuples_removed++;
+				}
 			}
 		}
 
@@ -1017,12 +1050,16 @@ restart:
 		 * Apply any needed deletes.  We issue just one _bt_delitems_vacuum()
 		 * call per page, so as to minimize WAL traffic.
 		 */
-		if (ndeletable > 0)
+		if (ndeletable > 0 || nupdated > 0)
 		{
 			BlockNumber lastBlockVacuumed = BufferGetBlockNumber(buf);
+			int			i;
 
 			_bt_delitems_vacuum(rel, buf, deletable, ndeletable,
+								updatednos, updated, nupdated,
 								vstate->lastBlockVacuumed);
+			for (i = 0; i < nupdated; i++)
+				pfree(updated[i]);
 
 			/*
 			 * Keep track of the block number of the lastBlockVacuumed, so we
@@ -1033,7 +1070,6 @@ restart:
 			if (lastBlockVacuumed > vstate->lastBlockVacuumed)
 				vstate->lastBlockVacuumed = lastBlockVacuumed;
 
-			stats->tuples_removed += ndeletable;
 			/* must recompute maxoff */
 			maxoff = PageGetMaxOffsetNumber(page);
 		}
@@ -1065,7 +1101,18 @@ restart:
 		if (minoff > maxoff)
 			delete_now = (blkno == orig_blkno);
 		else
-			stats->num_index_tuples += maxoff - minoff + 1;
+		{
+			for (offnum = minoff;
+				 offnum <= maxoff;
+				 offnum = OffsetNumberNext(offnum))
+			{
+				IndexTuple	itup;
+
+				itup = (IndexTuple) PageGetItem(page,
+												PageGetItemId(page, offnum));
+				stats->num_index_tuples += BTreeTupleGetNHeapTIDs(itup);
+			}
+		}
 	}
 
 	if (delete_now)
@@ -1103,6 +1150,54 @@ restart:
 	}
 }
 
+/*
+ * btvacuumposting --- check the heap TIDs of a posting list tuple
+ *
+ * Returns a palloc'd copy of itup holding only the heap TIDs that the
+ * callback doesn't report as dead, or NULL if all of them are alive or all
+ * are dead.  *nremaining is set to the number of live TIDs.
+ */
+static IndexTuple
+btvacuumposting(BTVacState *vstate, IndexTuple itup, int *nremaining)
+{
+	int			nposting = BTreeTupleGetNPosting(itup);
+	ItemPointer posting = BTreeTupleGetPosting(itup);
+	ItemPointer live = NULL;
+	int			nlive = 0;
+	int			i;
+
+	for (i = 0; i < nposting; i++)
+	{
+		if (vstate->callback(&posting[i], vstate->callback_state))
+		{
+			/* first dead TID, so start collecting the live ones */
+			if (live == NULL)
+			{
+				live = (ItemPointer) palloc(nposting * sizeof(ItemPointerData));
+				memcpy(live, posting, i * sizeof(ItemPointerData));
+				nlive = i;
+			}
+		}
+		else if (live != NULL)
+			live[nlive++] = posting[i];
+		else
+			nlive++;
+	}
+
+	*nremaining = nlive;
+	if (live == NULL)
+		return NULL;			/* nothing to remove */
+	if (nlive == 0)
+	{
+		pfree(live);
+		return NULL;			/* remove the whole tuple */
+	}
+
+	itup = _bt_form_posting(itup, live, nlive);
+	pfree(live);
+	return itup;
+}
+
 /*
  *	btcanreturn() -- Check whether btree indexes support index-only scans.
  *
@@ -28,6 +28,9 @@ static bool _bt_readpage(IndexScanDesc scan, ScanDirection dir,
 			 OffsetNumber offnum);
 static void _bt_saveitem(BTScanOpaque so, int itemIndex,
 			 OffsetNumber offnum, IndexTuple itup);
+static void _bt_savepostingitem(BTScanOpaque so, int itemIndex,
+					OffsetNumber offnum, IndexTuple itup, int nth,
+					int *tupleOffset);
 static bool _bt_steppage(IndexScanDesc scan, ScanDirection dir);
 static Buffer _bt_walk_left(Relation rel, Buffer buf);
 static bool _bt_endpoint(IndexScanDesc scan, ScanDirection dir);
@@ -1092,12 +1095,25 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 		while (offnum <= maxoff)
 		{
 			itup = _bt_checkkeys(scan, page, offnum, dir, &continuescan);
-			if (itup != NULL)
+			if (itup != NULL && !BTreeTupleIsPosting(itup))
 			{
 				/* tuple passes all scan key conditions, so remember it */
 				_bt_saveitem(so, itemIndex, offnum, itup);
 				itemIndex++;
 			}
+			else if (itup != NULL)
+			{
+				/* remember each heap TID of a posting list, in order */
+				int			tupleOffset = -1;
+				int			i;
+
+				for (i = 0; i < BTreeTupleGetNPosting(itup); i++)
+				{
+					_bt_savepostingitem(so, itemIndex, offnum, itup, i,
+										&tupleOffset);
+					itemIndex++;
+				}
+			}
 			if (!continuescan)
 			{
 				/* there can't be any more matches, so stop */
@@ -1108,7 +1124,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 			offnum = OffsetNumberNext(offnum);
 		}
 
-		Assert(itemIndex <= MaxIndexTuplesPerPage);
+		Assert(itemIndex <= MaxTIDsPerBTreePage);
 		so->currPos.firstItem = 0;
 		so->currPos.lastItem = itemIndex - 1;
 		so->currPos.itemIndex = 0;
@@ -1116,19 +1132,32 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 	else
 	{
 		/* load items[] in descending order */
-		itemIndex = MaxIndexTuplesPerPage;
+		itemIndex = MaxTIDsPerBTreePage;
 
 		offnum = Min(offnum, maxoff);
 
 		while (offnum >= minoff)
 		{
 			itup = _bt_checkkeys(scan, page, offnum, dir, &continuescan);
-			if (itup != NULL)
+			if (itup != NULL && !BTreeTupleIsPosting(itup))
 			{
 				/* tuple passes all scan key conditions, so remember it */
 				itemIndex--;
 				_bt_saveitem(so, itemIndex, offnum, itup);
 			}
+			else if (itup != NULL)
+			{
+				/* remember each heap TID of a posting list, in order */
+				int			tupleOffset = -1;
+				int			i;
+
+				for (i = BTreeTupleGetNPosting(itup) - 1; i >= 0; i--)
+				{
+					itemIndex--;
+					_bt_savepostingitem(so, itemIndex, offnum, itup, i,
+										&tupleOffset);
+				}
+			}
 			if (!continuescan)
 			{
 				/* there can't be any more matches, so stop */
@@ -1141,8 +1170,8 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 
 		Assert(itemIndex >= 0);
 		so->currPos.firstItem = itemIndex;
-		so->currPos.lastItem = MaxIndexTuplesPerPage - 1;
-		so->currPos.itemIndex = MaxIndexTuplesPerPage - 1;
+		so->currPos.lastItem = MaxTIDsPerBTreePage - 1;
+		so->currPos.itemIndex = MaxTIDsPerBTreePage - 1;
 	}
 
 	return (so->currPos.firstItem <= so->currPos.lastItem);
@@ -1167,6 +1196,39 @@ _bt_saveitem(BTScanOpaque so, int itemIndex,
 	}
 }
 
+/*
+ * Save the nth heap TID of a posting list tuple into
+ * so->currPos.items[itemIndex].  For an index-only scan, all the TIDs of a
+ * posting list share one copy of its key in the workspace: *tupleOffset is
+ * -1 until the first of them is saved, and then locates that copy.
+ */
+static void
+_bt_savepostingitem(BTScanOpaque so, int itemIndex, OffsetNumber offnum,
+					IndexTuple itup, int nth, int *tupleOffset)
+{
+	BTScanPosItem *currItem = &so->currPos.items[itemIndex];
+
+	currItem->heapTid = BTreeTupleGetPosting(itup)[nth];
+	currItem->indexOffset = offnum;
+	if (so->currTuples)
+	{
+		if (*tupleOffset < 0)
+		{
+			Size		keysz = BTreeTupleGetPostingOffset(itup);
+			IndexTuple	base;
+
+			*tupleOffset = so->currPos.nextTupleOffset;
+			base = (IndexTuple) (so->currTuples + *tupleOffset);
+			memcpy(base, itup, keysz);
+			base->t_info &= ~(INDEX_SIZE_MASK | BT_IS_POSTING);
+			base->t_info |= keysz;
+			base->t_tid = currItem->heapTid;
+			so->currPos.nextTupleOffset += MAXALIGN(keysz);
+		}
+		currItem->tupleOffset = *tupleOffset;
+	}
+}
+
 /*
  *	_bt_steppage() -- Step to next page containing valid data for scan
  *
@@ -133,6 +133,8 @@ static void _bt_sortaddtup(Page page, Size itemsize,
 			   IndexTuple itup, OffsetNumber itup_off);
 static void _bt_buildadd(BTWriteState *wstate, BTPageState *state,
 			 IndexTuple itup);
+static void _bt_buildadd_run(BTWriteState *wstate, BTPageState *state,
+				 BTDedupState dstate);
 static void _bt_uppershutdown(BTWriteState *wstate, BTPageState *state);
 static void _bt_load(BTWriteState *wstate,
 		 BTSpool *btspool, BTSpool *btspool2);
@@ -535,6 +537,22 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 		ItemIdSetUnused(ii);	/* redundant */
 		((PageHeader) opage)->pd_lower -= sizeof(ItemIdData);
 
+		/*
+		 * A leaf high key carries no posting list and no INCLUDE columns.
+		 * Since the cut-down copy is never larger, it can replace the tuple
+		 * where it stands.
+		 */
+		if (state->btps_level == 0 &&
+			BTreeTupleNeedsPivotCopy(wstate->index, oitup))
+		{
+			IndexTuple	hikey = _bt_pivot_copy(wstate->index, oitup);
+
+			Assert(IndexTupleSize(hikey) <= ItemIdGetLength(hii));
+			memcpy(oitup, hikey, IndexTupleSize(hikey));
+			ItemIdSetNormal(hii, ItemIdGetOffset(hii), IndexTupleSize(hikey));
+			pfree(hikey);
+		}
+
 		/*
 		 * Link the old page into its parent, using its minimum key. If we
 		 * don't have a parent, we have to create one; this adds a new btree
@@ -588,7 +606,10 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 	if (last_off == P_HIKEY)
 	{
 		Assert(state->btps_minkey == NULL);
-		state->btps_minkey = CopyIndexTuple(itup);
+		if (state->btps_level == 0)
+			state->btps_minkey = _bt_pivot_copy(wstate->index, itup);
+		else
+			state->btps_minkey = CopyIndexTuple(itup);
 	}
 
 	/*
@@ -602,6 +623,22 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 	state->btps_lastoff = last_off;
 }
 
+/*
+ * Add the tuple that replaces the run of equal tuples in dstate to the leaf
+ * level, and free the run's base tuple.
+ */
+static void
+_bt_buildadd_run(BTWriteState *wstate, BTPageState *state, BTDedupState dstate)
+{
+	IndexTuple	itup = _bt_dedup_finish_run(dstate);
+
+	_bt_buildadd(wstate, state, itup);
+	if (itup != dstate->base)
+		pfree(itup);
+	pfree(dstate->base);
+	dstate->base = NULL;
+}
+
 /*
  * Finish writing out the completed btree.
  */
@@ -683,7 +720,7 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 				load1;
 	TupleDesc	tupdes = RelationGetDescr(wstate->index);
 	int			i,
-				keysz = RelationGetNumberOfAttributes(wstate->index);
+				keysz = IndexRelationGetNumberOfKeyAttributes(wstate->index);
 	ScanKey		indexScanKey = NULL;
 
 	if (merge)
@@ -786,7 +823,18 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 	}
 	else
 	{
-		/* merge is unnecessary */
+		/*
+		 * merge is unnecessary, but runs of equal tuples can be deduplicated
+		 * into posting lists.  tuplesort returns equal tuples in heap TID
+		 * order, as posting lists need them.
+		 */
+		bool		deduplicate = BTDeduplicationEnabled(wstate->index);
+		BTDedupStateData dstate;
+
+		dstate.base = NULL;
+		if (deduplicate)
+			dstate.htids = (ItemPointer) palloc(BTMaxPostingSize);
+
 		while ((itup = tuplesort_getindextuple(btspool->sortstate,
 											   true, &should_free)) != NULL)
 		{
@@ -794,10 +842,31 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 			if (state == NULL)
 				state = _bt_pagestate(wstate, 0);
 
-			_bt_buildadd(wstate, state, itup);
-			if (should_free)
-				pfree(itup);
+			if (!deduplicate)
+			{
+				_bt_buildadd(wstate, state, itup);
+				if (should_free)
+					pfree(itup);
+				continue;
+			}
+
+			if (dstate.base != NULL && _bt_dedup_add_tuple(&dstate, itup))
+			{
+				if (should_free)
+					pfree(itup);
+				continue;
+			}
+
+			if (dstate.base != NULL)
+				_bt_buildadd_run(wstate, state, &dstate);
+			/* the run's base must outlive the next tuplesort call */
+			_bt_dedup_start_run(&dstate,
+								should_free ? itup : CopyIndexTuple(itup));
 		}
+		if (dstate.base != NULL)
+			_bt_buildadd_run(wstate, state, &dstate);
+		if (deduplicate)
+			pfree(dstate.htids);
 	}
 
 	/* Close down final pages and write the metapage */
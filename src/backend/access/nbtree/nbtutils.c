@@ -49,6 +49,8 @@ static void _bt_mark_scankey_required(ScanKey skey);
 static bool _bt_check_rowcompare(ScanKey skey,
 					 IndexTuple tuple, TupleDesc tupdesc,
 					 ScanDirection dir, bool *continuescan);
+static bool _bt_posting_contains(IndexTuple itup, ItemPointer htid);
+static bool _bt_posting_killed(BTScanOpaque so, IndexTuple itup);
 
 
 /*
@@ -56,7 +58,9 @@ static bool _bt_check_rowcompare(ScanKey skey,
  *		Build an insertion scan key that contains comparison data from itup
  *		as well as comparator routines appropriate to the key datatypes.
  *
- *		The result is intended for use with _bt_compare().
+ *		The result is intended for use with _bt_compare().  It has one entry
+ *		per key column; INCLUDE columns are never compared, and itup may be
+ *		a pivot tuple that lacks them.
  */
 ScanKey
 _bt_mkscankey(Relation rel, IndexTuple itup)
@@ -68,7 +72,7 @@ _bt_mkscankey(Relation rel, IndexTuple itup)
 	int			i;
 
 	itupdesc = RelationGetDescr(rel);
-	natts = RelationGetNumberOfAttributes(rel);
+	natts = IndexRelationGetNumberOfKeyAttributes(rel);
 	indoption = rel->rd_indoption;
 
 	skey = (ScanKey) palloc(natts * sizeof(ScanKeyData));
@@ -109,7 +113,8 @@ _bt_mkscankey(Relation rel, IndexTuple itup)
  *		The result cannot be used with _bt_compare(), unless comparison
  *		data is first stored into the key entries.	Currently this
  *		routine is only called by nbtsort.c and tuplesort.c, which have
- *		their own comparison routines.
+ *		their own comparison routines.  As with _bt_mkscankey, there is one
+ *		entry per key column.
  */
 ScanKey
 _bt_mkscankey_nodata(Relation rel)
@@ -119,7 +124,7 @@ _bt_mkscankey_nodata(Relation rel)
 	int16	   *indoption;
 	int			i;
 
-	natts = RelationGetNumberOfAttributes(rel);
+	natts = IndexRelationGetNumberOfKeyAttributes(rel);
 	indoption = rel->rd_indoption;
 
 	skey = (ScanKey) palloc(natts * sizeof(ScanKeyData));
@@ -173,6 +178,33 @@ _bt_freestack(BTStack stack)
 	}
 }
 
+/*
+ * _bt_pivot_copy() -- copy a leaf tuple for use as a high key or downlink.
+ *
+ * Nothing above the leaf level looks past the key columns, so the palloc'd
+ * copy is cut down to those: a posting list tuple loses its posting list,
+ * and INCLUDE columns are truncated away, keeping internal pages small.
+ * Use BTreeTupleNeedsPivotCopy to tell whether this is needed at all.
+ */
+IndexTuple
+_bt_pivot_copy(Relation rel, IndexTuple itup)
+{
+	int			nkeyatts = IndexRelationGetNumberOfKeyAttributes(rel);
+	IndexTuple	pivot;
+
+	if (nkeyatts < IndexRelationGetNumberOfAttributes(rel))
+	{
+		pivot = index_truncate_tuple(RelationGetDescr(rel), itup, nkeyatts);
+		pivot->t_tid = *BTreeTupleGetHeapTID(itup, 0);
+	}
+	else if (BTreeTupleIsPosting(itup))
+		pivot = _bt_form_posting(itup, BTreeTupleGetPosting(itup), 1);
+	else
+		pivot = CopyIndexTuple(itup);
+
+	return pivot;
+}
+
 
 /*
  *	_bt_preprocess_array_keys() -- Preprocess SK_SEARCHARRAY scan keys
@@ -1732,6 +1764,9 @@ _bt_check_rowcompare(ScanKey skey, IndexTuple tuple, TupleDesc tupdesc,
  * (This observation also guarantees that the item is still the right one
  * to delete, which might otherwise be questionable since heap TIDs can get
  * recycled.)
+ *
+ * A posting list tuple is marked only if every one of its heap TIDs was
+ * killed, since the LP_DEAD bit applies to all of them.
  */
 void
 _bt_killitems(IndexScanDesc scan, bool haveLock)
@@ -1769,7 +1804,20 @@ _bt_killitems(IndexScanDesc scan, bool haveLock)
 			ItemId		iid = PageGetItemId(page, offnum);
 			IndexTuple	ituple = (IndexTuple) PageGetItem(page, iid);
 
-			if (ItemPointerEquals(&ituple->t_tid, &kitem->heapTid))
+			if (BTreeTupleIsPosting(ituple))
+			{
+				if (_bt_posting_contains(ituple, &kitem->heapTid))
+				{
+					/* found the item, but all its TIDs must be dead */
+					if (_bt_posting_killed(so, ituple))
+					{
+						ItemIdMarkDead(iid);
+						killedsomething = true;
+					}
+					break;		/* out of inner search loop */
+				}
+			}
+			else if (ItemPointerEquals(&ituple->t_tid, &kitem->heapTid))
 			{
 				/* found the item */
 				ItemIdMarkDead(iid);
@@ -1802,6 +1850,48 @@ _bt_killitems(IndexScanDesc scan, bool haveLock)
 	so->numKilled = 0;
 }
 
+/*
+ * Is htid one of the heap TIDs of posting list tuple itup?
+ */
+static bool
+_bt_posting_contains(IndexTuple itup, ItemPointer htid)
+{
+	ItemPointer posting = BTreeTupleGetPosting(itup);
+	int			i;
+
+	for (i = 0; i < BTreeTupleGetNPosting(itup); i++)
+	{
+		if (ItemPointerEquals(&posting[i], htid))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Has the scan killed every heap TID of posting list tuple itup?
+ */
+static bool
+_bt_posting_killed(BTScanOpaque so, IndexTuple itup)
+{
+	ItemPointer posting = BTreeTupleGetPosting(itup);
+	int			i,
+				j;
+
+	for (i = 0; i < BTreeTupleGetNPosting(itup); i++)
+	{
+		for (j = 0; j < so->numKilled; j++)
+		{
+			BTScanPosItem *kitem = &so->currPos.items[so->killedItems[j]];
+
+			if (ItemPointerEquals(&kitem->heapTid, &posting[i]))
+				break;
+		}
+		if (j == so->numKilled)
+			return false;
+	}
+	return true;
+}
+
 
 /*
  * The following routines manage a shared-memory area in which we track
@@ -292,17 +292,17 @@ btree_xlog_split(bool onleft, bool isroot,
 		datalen -= sizeof(BlockIdData);
 
 		forget_matching_split(xlrec->node, downlink, false);
+	}
 
-		/* Extract left hikey and its size (still assuming 16-bit alignment) */
-		if (!(record->xl_info & XLR_BKP_BLOCK(0)))
-		{
-			/* We assume 16-bit alignment is enough for IndexTupleSize */
-			left_hikey = (Item) datapos;
-			left_hikeysz = MAXALIGN(IndexTupleSize(left_hikey));
+	/* Extract left hikey and its size (still assuming 16-bit alignment) */
+	if (!(record->xl_info & XLR_BKP_BLOCK(0)))
+	{
+		/* We assume 16-bit alignment is enough for IndexTupleSize */
+		left_hikey = (Item) datapos;
+		left_hikeysz = MAXALIGN(IndexTupleSize(left_hikey));
 
-			datapos += left_hikeysz;
-			datalen -= left_hikeysz;
-		}
+		datapos += left_hikeysz;
+		datalen -= left_hikeysz;
 	}
 
 	/* Extract newitem and newitemoff, if present */
@@ -343,18 +343,6 @@ btree_xlog_split(bool onleft, bool isroot,
 
 	_bt_restore_page(rpage, datapos, datalen);
 
-	/*
-	 * On leaf level, the high key of the left page is equal to the first key
-	 * on the right page.
-	 */
-	if (xlrec->level == 0)
-	{
-		ItemId		hiItemId = PageGetItemId(rpage, P_FIRSTDATAKEY(ropaque));
-
-		left_hikey = PageGetItem(rpage, hiItemId);
-		left_hikeysz = ItemIdGetLength(hiItemId);
-	}
-
 	PageSetLSN(rpage, lsn);
 	MarkBufferDirty(rbuf);
 
@@ -541,13 +529,31 @@ btree_xlog_vacuum(XLogRecPtr lsn, XLogRecord *record)
 	if (record->xl_len > SizeOfBtreeVacuum)
 	{
 		OffsetNumber *unused;
-		OffsetNumber *unend;
+		OffsetNumber *updatednos;
+		char	   *updated;
+		int			i;
 
 		unused = (OffsetNumber *) ((char *) xlrec + SizeOfBtreeVacuum);
-		unend = (OffsetNumber *) ((char *) xlrec + record->xl_len);
+		updatednos = unused + xlrec->ndeleted;
+		updated = (char *) (updatednos + xlrec->nupdated);
 
-		if ((unend - unused) > 0)
-			PageIndexMultiDelete(page, unused, unend - unused);
+		/*
+		 * Replace shrunken posting lists first, as _bt_delitems_vacuum()
+		 * does.  We assume 16-bit alignment is enough for IndexTupleSize.
+		 */
+		for (i = 0; i < xlrec->nupdated; i++)
+		{
+			Size		itemsz = MAXALIGN(IndexTupleSize((IndexTuple) updated));
+
+			PageIndexTupleDelete(page, updatednos[i]);
+			if (PageAddItem(page, (Item) updated, itemsz, updatednos[i],
+							false, false) == InvalidOffsetNumber)
+				elog(PANIC, "btree_xlog_vacuum: failed to replace item");
+			updated += itemsz;
+		}
+
+		if (xlrec->ndeleted > 0)
+			PageIndexMultiDelete(page, unused, xlrec->ndeleted);
 	}
 
 	/*
@@ -588,7 +594,8 @@ btree_xlog_delete_get_latestRemovedXid(xl_btree_delete *xlrec)
 	BlockNumber hblkno;
 	OffsetNumber hoffnum;
 	TransactionId latestRemovedXid = InvalidTransactionId;
-	int			i;
+	int			i,
+				j;
 
 	/*
 	 * If there's nothing running on the standby we don't need to derive a
@@ -639,62 +646,70 @@ btree_xlog_delete_get_latestRemovedXid(xl_btree_delete *xlrec)
 		iitemid = PageGetItemId(ipage, unused[i]);
 		itup = (IndexTuple) PageGetItem(ipage, iitemid);
 
-		/*
-		 * Locate the heap page that the index tuple points at
-		 */
-		hblkno = ItemPointerGetBlockNumber(&(itup->t_tid));
-		hbuffer = XLogReadBuffer(xlrec->hnode, hblkno, false);
-		if (!BufferIsValid(hbuffer))
+		/* a posting list tuple points to several heap tuples */
+		for (j = 0; j < BTreeTupleGetNHeapTIDs(itup); j++)
 		{
-			UnlockReleaseBuffer(ibuffer);
-			return InvalidTransactionId;
-		}
-		hpage = (Page) BufferGetPage(hbuffer);
+			ItemPointer htid = BTreeTupleGetHeapTID(itup, j);
 
-		/*
-		 * Look up the heap tuple header that the index tuple points at by
-		 * using the heap node supplied with the xlrec. We can't use
-		 * heap_fetch, since it uses ReadBuffer rather than XLogReadBuffer.
-		 * Note that we are not looking at tuple data here, just headers.
-		 */
-		hoffnum = ItemPointerGetOffsetNumber(&(itup->t_tid));
-		hitemid = PageGetItemId(hpage, hoffnum);
+			/*
+			 * Locate the heap page that the index tuple points at
+			 */
+			hblkno = ItemPointerGetBlockNumber(htid);
+			hbuffer = XLogReadBuffer(xlrec->hnode, hblkno, false);
+			if (!BufferIsValid(hbuffer))
+			{
+				UnlockReleaseBuffer(ibuffer);
+				return InvalidTransactionId;
+			}
+			hpage = (Page) BufferGetPage(hbuffer);
 
-		/*
-		 * Follow any redirections until we find something useful.
-		 */
-		while (ItemIdIsRedirected(hitemid))
-		{
-			hoffnum = ItemIdGetRedirect(hitemid);
+			/*
+			 * Look up the heap tuple header that the index tuple points at
+			 * by using the heap node supplied with the xlrec. We can't use
+			 * heap_fetch, since it uses ReadBuffer rather than
+			 * XLogReadBuffer. Note that we are not looking at tuple data
+			 * here, just headers.
+			 */
+			hoffnum = ItemPointerGetOffsetNumber(htid);
 			hitemid = PageGetItemId(hpage, hoffnum);
-			CHECK_FOR_INTERRUPTS();
-		}
 
-		/*
-		 * If the heap item has storage, then read the header and use that to
-		 * set latestRemovedXid.
-		 *
-		 * Some LP_DEAD items may not be accessible, so we ignore them.
-		 */
-		if (ItemIdHasStorage(hitemid))
-		{
-			htuphdr = (HeapTupleHeader) PageGetItem(hpage, hitemid);
+			/*
+			 * Follow any redirections until we find something useful.
+			 */
+			while (ItemIdIsRedirected(hitemid))
+			{
+				hoffnum = ItemIdGetRedirect(hitemid);
+				hitemid = PageGetItemId(hpage, hoffnum);
+				CHECK_FOR_INTERRUPTS();
+			}
 
-			HeapTupleHeaderAdvanceLatestRemovedXid(htuphdr, &latestRemovedXid);
-		}
-		else if (ItemIdIsDead(hitemid))
-		{
 			/*
-			 * Conjecture: if hitemid is dead then it had xids before the xids
-			 * marked on LP_NORMAL items. So we just ignore this item and move
-			 * onto the next, for the purposes of calculating
-			 * latestRemovedxids.
+			 * If the heap item has storage, then read the header and use that
+			 * to set latestRemovedXid.
+			 *
+			 * Some LP_DEAD items may not be accessible, so we ignore them.
 			 */
-		}
-		else
-			Assert(!ItemIdIsUsed(hitemid));
+			if (ItemIdHasStorage(hitemid))
+			{
+				htuphdr = (HeapTupleHeader) PageGetItem(hpage, hitemid);
 
-		UnlockReleaseBuffer(hbuffer);
+				HeapTupleHeaderAdvanceLatestRemovedXid(htuphdr,
+													   &latestRemovedXid);
+			}
+			else if (ItemIdIsDead(hitemid))
+			{
+				/*
+				 * Conjecture: if hitemid is dead then it had xids before the
+				 * xids marked on LP_NORMAL items. So we just ignore this item
+				 * and move onto the next, for the purposes of calculating
+				 * latestRemovedxids.
+				 */
+			}
+			else
+				Assert(!ItemIdIsUsed(hitemid));
+
+			UnlockReleaseBuffer(hbuffer);
+		}
 	}
 
 	UnlockReleaseBuffer(ibuffer);
@@ -0,0 +1,89 @@
+/*-------------------------------------------------------------------------
+ *
+ * brindesc.c
+ *	  rmgr descriptor routines for access/brin/brin_xlog.c
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/rmgrdesc/brindesc.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/brin_private.h"
+
+static void
+out_target(StringInfo buf, RelFileNode node)
+{
+	appendStringInfo(buf, "rel %u/%u/%u ",
+					 node.spcNode, node.dbNode, node.relNode);
+}
+
+void
+brin_desc(StringInfo buf, uint8 xl_info, char *rec)
+{
+	uint8		info = xl_info & ~XLR_INFO_MASK;
+
+	switch (info & XLOG_BRIN_OPMASK)
+	{
+		case XLOG_BRIN_CREATE_INDEX:
+			out_target(buf, ((xl_brin_createidx *) rec)->node);
+			appendStringInfo(buf, "create index: pages per range %u",
+							 ((xl_brin_createidx *) rec)->pagesPerRange);
+			break;
+		case XLOG_BRIN_INSERT:
+			{
+				xl_brin_insert *xlrec = (xl_brin_insert *) rec;
+
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "insert%s: heap block %u, revmap block %u, tid (%u,%u)",
+								 (info & XLOG_BRIN_INIT_PAGE) ? " (init page)" : "",
+								 xlrec->heapBlk, xlrec->revmapBlk,
+								 ItemPointerGetBlockNumber(&xlrec->tid),
+								 ItemPointerGetOffsetNumber(&xlrec->tid));
+			}
+			break;
+		case XLOG_BRIN_UPDATE:
+			{
+				xl_brin_update *xlrec = (xl_brin_update *) rec;
+
+				out_target(buf, xlrec->new.node);
+				appendStringInfo(buf, "update%s: heap block %u, revmap block %u, old tid (%u,%u), new tid (%u,%u)",
+								 (info & XLOG_BRIN_INIT_PAGE) ? " (init page)" : "",
+								 xlrec->new.heapBlk, xlrec->new.revmapBlk,
+								 ItemPointerGetBlockNumber(&xlrec->oldtid),
+								 ItemPointerGetOffsetNumber(&xlrec->oldtid),
+								 ItemPointerGetBlockNumber(&xlrec->new.tid),
+								 ItemPointerGetOffsetNumber(&xlrec->new.tid));
+			}
+			break;
+		case XLOG_BRIN_SAMEPAGE_UPDATE:
+			{
+				xl_brin_samepage_update *xlrec = (xl_brin_samepage_update *) rec;
+
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "samepage update: tid (%u,%u)",
+								 ItemPointerGetBlockNumber(&xlrec->tid),
+								 ItemPointerGetOffsetNumber(&xlrec->tid));
+			}
+			break;
+		case XLOG_BRIN_NEW_MAP_PAGE:
+			{
+				xl_brin_new_map_page *xlrec = (xl_brin_new_map_page *) rec;
+
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "new %s page %u, parent block %u slot %u",
+								 xlrec->pageType == BRIN_PAGETYPE_DIRECTORY ?
+								 "directory" : "revmap",
+								 xlrec->newBlk, xlrec->parentBlk, xlrec->slot);
+			}
+			break;
+		default:
+			appendStringInfo(buf, "unknown brin op code %u", info);
+			break;
+	}
+}
@@ -114,6 +114,8 @@ heap_desc(StringInfo buf, uint8 xl_info, char *rec)
 		out_target(buf, &(xlrec->target));
 		appendStringInfoChar(buf, ' ');
 		out_infobits(buf, xlrec->infobits_set);
+		if (xlrec->flags & XLH_LOCK_ALL_FROZEN_CLEARED)
+			appendStringInfo(buf, " all-frozen cleared");
 	}
 	else if (info == XLOG_HEAP_INPLACE)
 	{
@@ -160,9 +162,10 @@ heap2_desc(StringInfo buf, uint8 xl_info, char *rec)
 	{
 		xl_heap_visible *xlrec = (xl_heap_visible *) rec;
 
-		appendStringInfo(buf, "visible: rel %u/%u/%u; blk %u",
+		appendStringInfo(buf, "visible: rel %u/%u/%u; blk %u; cutoff %u; flags 0x%02X",
 						 xlrec->node.spcNode, xlrec->node.dbNode,
-						 xlrec->node.relNode, xlrec->block);
+						 xlrec->node.relNode, xlrec->block,
+						 xlrec->cutoff_xid, xlrec->flags);
 	}
 	else if (info == XLOG_HEAP2_MULTI_INSERT)
 	{
@@ -183,6 +186,8 @@ heap2_desc(StringInfo buf, uint8 xl_info, char *rec)
 		appendStringInfo(buf, "lock updated: xmax %u msk %04x; ", xlrec->xmax,
 						 xlrec->infobits_set);
 		out_target(buf, &(xlrec->target));
+		if (xlrec->flags & XLH_LOCK_ALL_FROZEN_CLEARED)
+			appendStringInfo(buf, " all-frozen cleared");
 	}
 	else
 		appendStringInfo(buf, "UNKNOWN");
@@ -82,6 +82,9 @@ static SlruCtlData ClogCtlData;
 
 #define ClogCtl (&ClogCtlData)
 
+/* GUC parameter: number of CLOG buffers, 0 to size them from shared_buffers */
+int			clog_buffers = 0;
+
 
 static int	ZeroCLOGPage(int pageno, bool writeXlog);
 static bool CLOGPagePrecedes(int page1, int page2);
@@ -270,7 +273,7 @@ TransactionIdSetPageStatus(TransactionId xid, int nsubxids,
 		   status == TRANSACTION_STATUS_ABORTED ||
 		   (status == TRANSACTION_STATUS_SUB_COMMITTED && !TransactionIdIsValid(xid)));
 
-	LWLockAcquire(CLogControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(SimpleLruGetBankLock(ClogCtl, pageno), LW_EXCLUSIVE);
 
 	/*
 	 * If we're doing an async commit (ie, lsn is valid), then we must wait
@@ -319,13 +322,13 @@ TransactionIdSetPageStatus(TransactionId xid, int nsubxids,
 
 	ClogCtl->shared->page_dirty[slotno] = true;
 
-	LWLockRelease(CLogControlLock);
+	LWLockRelease(SimpleLruGetBankLock(ClogCtl, pageno));
 }
 
 /*
  * Sets the commit status of a single transaction.
  *
- * Must be called with CLogControlLock held
+ * Must be called with the page's bank lock held
  */
 static void
 TransactionIdSetStatusBit(TransactionId xid, XidStatus status, XLogRecPtr lsn, int slotno)
@@ -417,7 +420,7 @@ TransactionIdGetStatus(TransactionId xid, XLogRecPtr *lsn)
 	lsnindex = GetLSNIndex(slotno, xid);
 	*lsn = ClogCtl->shared->group_lsn[lsnindex];
 
-	LWLockRelease(CLogControlLock);
+	LWLockRelease(SimpleLruGetBankLock(ClogCtl, pageno));
 
 	return status;
 }
@@ -432,23 +435,25 @@ TransactionIdGetStatus(TransactionId xid, XLogRecPtr *lsn)
  * performance dropped off with more than 32 CLOG buffers, possibly because
  * the linear buffer search algorithm doesn't scale well.
  *
- * Unconditionally increasing the number of CLOG buffers to 32 did not seem
- * like a good idea, because it would increase the minimum amount of shared
- * memory required to start, which could be a problem for people running very
- * small configurations.  The following formula seems to represent a reasonable
- * compromise: people with very low values for shared_buffers will get fewer
- * CLOG buffers as well, and everyone else will get 32.
- *
- * It is likely that some further work will be needed here in future releases;
- * for example, on a 64-core server, the maximum number of CLOG requests that
- * can be simultaneously in flight will be even larger.  But that will
- * apparently require more than just changing the formula, so for now we take
- * the easy way out.
+ * The buffers are now split into banks that are searched and locked
+ * separately (see slru.c), so a larger pool no longer costs a longer search
+ * or a hotter lock.  A Datanode of a cluster sees XIDs of every transaction
+ * in the cluster, many of them touching it only briefly, so the span of CLOG
+ * it looks at is wider than for a standalone server.  clog_buffers sets the
+ * pool size explicitly; when it is zero, people with very low values for
+ * shared_buffers get 16 buffers and everyone else gets one per 512 shared
+ * buffers, up to 128.
  */
 Size
 CLOGShmemBuffers(void)
 {
-	return Min(32, Max(4, NBuffers / 512));
+	int			nbuffers;
+
+	if (clog_buffers > 0)
+		return clog_buffers;
+
+	nbuffers = Min(128, Max(SLRU_BANK_SIZE, NBuffers / 512));
+	return nbuffers - nbuffers % SLRU_BANK_SIZE;
 }
 
 /*
@@ -465,7 +470,7 @@ CLOGShmemInit(void)
 {
 	ClogCtl->PagePrecedes = CLOGPagePrecedes;
 	SimpleLruInit(ClogCtl, "CLOG Ctl", CLOGShmemBuffers(), CLOG_LSNS_PER_PAGE,
-				  CLogControlLock, "pg_clog");
+				  CLogControlLock, "pg_clog", true);
 }
 
 /*
@@ -479,7 +484,7 @@ BootStrapCLOG(void)
 {
 	int			slotno;
 
-	LWLockAcquire(CLogControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(SimpleLruGetBankLock(ClogCtl, 0), LW_EXCLUSIVE);
 
 	/* Create and zero the first page of the commit log */
 	slotno = ZeroCLOGPage(0, false);
@@ -488,7 +493,7 @@ BootStrapCLOG(void)
 	SimpleLruWritePage(ClogCtl, slotno);
 	Assert(!ClogCtl->shared->page_dirty[slotno]);
 
-	LWLockRelease(CLogControlLock);
+	LWLockRelease(SimpleLruGetBankLock(ClogCtl, 0));
 }
 
 /*
@@ -523,14 +528,14 @@ StartupCLOG(void)
 	TransactionId xid = ShmemVariableCache->nextXid;
 	int			pageno = TransactionIdToPage(xid);
 
-	LWLockAcquire(CLogControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(SimpleLruGetBankLock(ClogCtl, pageno), LW_EXCLUSIVE);
 
 	/*
 	 * Initialize our idea of the latest page number.
 	 */
 	ClogCtl->shared->latest_page_number = pageno;
 
-	LWLockRelease(CLogControlLock);
+	LWLockRelease(SimpleLruGetBankLock(ClogCtl, pageno));
 }
 
 /*
@@ -542,7 +547,7 @@ TrimCLOG(void)
 	TransactionId xid = ShmemVariableCache->nextXid;
 	int			pageno = TransactionIdToPage(xid);
 
-	LWLockAcquire(CLogControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(SimpleLruGetBankLock(ClogCtl, pageno), LW_EXCLUSIVE);
 
 	/*
 	 * Re-Initialize our idea of the latest page number.
@@ -579,7 +584,7 @@ TrimCLOG(void)
 		ClogCtl->shared->page_dirty[slotno] = true;
 	}
 
-	LWLockRelease(CLogControlLock);
+	LWLockRelease(SimpleLruGetBankLock(ClogCtl, pageno));
 }
 
 /*
@@ -653,7 +658,7 @@ ExtendCLOG(TransactionId newestXact)
 	pageno = TransactionIdToPage(newestXact);
 #endif
 
-	LWLockAcquire(CLogControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(SimpleLruGetBankLock(ClogCtl, pageno), LW_EXCLUSIVE);
 
 #ifdef PGXC
 	/*
@@ -664,7 +669,7 @@ ExtendCLOG(TransactionId newestXact)
 	if (ClogCtl->shared->latest_page_number - pageno <= CLOG_WRAP_CHECK_DELTA 
 			&& pageno <= ClogCtl->shared->latest_page_number)
 	{
-		LWLockRelease(CLogControlLock);
+		LWLockRelease(SimpleLruGetBankLock(ClogCtl, pageno));
 		return;
 	}
 #endif
@@ -672,7 +677,7 @@ ExtendCLOG(TransactionId newestXact)
 	/* Zero the page and make an XLOG entry about it */
 	ZeroCLOGPage(pageno, !InRecovery);
 
-	LWLockRelease(CLogControlLock);
+	LWLockRelease(SimpleLruGetBankLock(ClogCtl, pageno));
 }
 
 /*
@@ -790,13 +795,13 @@ clog_redo(XLogRecPtr lsn, XLogRecord *record)
 
 		memcpy(&pageno, XLogRecGetData(record), sizeof(int));
 
-		LWLockAcquire(CLogControlLock, LW_EXCLUSIVE);
+		LWLockAcquire(SimpleLruGetBankLock(ClogCtl, pageno), LW_EXCLUSIVE);
 
 		slotno = ZeroCLOGPage(pageno, false);
 		SimpleLruWritePage(ClogCtl, slotno);
 		Assert(!ClogCtl->shared->page_dirty[slotno]);
 
-		LWLockRelease(CLogControlLock);
+		LWLockRelease(SimpleLruGetBankLock(ClogCtl, pageno));
 	}
 	else if (info == CLOG_TRUNCATE)
 	{
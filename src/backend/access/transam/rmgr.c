@@ -7,6 +7,7 @@
  */
 #include "postgres.h"
 
+#include "access/brin.h"
 #include "access/clog.h"
 #include "access/gin.h"
 #include "access/gist_private.h"
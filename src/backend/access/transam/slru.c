@@ -8,10 +8,14 @@
  * traffic will occur mostly to the latest page (and to the just-prior
  * page, soon after a page transition).  Read traffic will probably touch
  * a larger span of pages, but in any case a fairly small number of page
- * buffers should be sufficient.  So, we just search the buffers using plain
- * linear search; there's no need for a hashtable or anything fancy.
- * The management algorithm is straight LRU except that we will never swap
- * out the latest page (since we know it's going to be hit again eventually).
+ * buffers should be sufficient.  Still, busy systems keep many more pages of
+ * pg_clog and pg_subtrans in use than a handful, so the buffers are divided
+ * into banks of SLRU_BANK_SIZE slots and a page is only ever looked for, or
+ * loaded into, the bank picked by its page number.  Within a bank we use
+ * plain linear search; there's no need for a hashtable or anything fancy.
+ * The management algorithm is straight LRU within each bank, except that we
+ * will never swap out the latest page (since we know it's going to be hit
+ * again eventually).
  *
  * We use a control LWLock to protect the shared data structures, plus
  * per-buffer LWLocks that synchronize I/O for each buffer.  The control lock
@@ -19,6 +23,12 @@
  * reading in or writing out a page buffer does not hold the control lock,
  * only the per-buffer lock for the buffer it is working on.
  *
+ * A partitioned SLRU has a separate control lock for each bank, each of which
+ * protects only the slots of its bank; see SimpleLruGetBankLock().  Nothing
+ * here ever holds two bank locks at once.  In an SLRU that is not partitioned
+ * all banks share one lock, and everything below reads the same as before.
+ * Either way, "the control lock" below means the lock of the bank concerned.
+ *
  * "Holding the control lock" means exclusive lock in all cases except for
  * SimpleLruReadPage_ReadOnly(); see comments for SlruRecentlyUsed() for
  * the implications of that.
@@ -92,7 +102,7 @@ typedef struct SlruFlushData *SlruFlush;
  * We allow this code to be executed concurrently by multiple processes within
  * SimpleLruReadPage_ReadOnly().  As long as int reads and writes are atomic,
  * this should not cause any completely-bogus values to enter the computation.
- * However, it is possible for either cur_lru_count or individual
+ * However, it is possible for either a bank's cur_lru_count or individual
  * page_lru_count entries to be "reset" to lower values than they should have,
  * in case a process is delayed while it executes this macro.  With care in
  * SlruSelectLRUPage(), this does little harm, and in any case the absolute
@@ -101,13 +111,32 @@ typedef struct SlruFlushData *SlruFlush;
  */
 #define SlruRecentlyUsed(shared, slotno)	\
 	do { \
-		int		new_lru_count = (shared)->cur_lru_count; \
+		int		lru_bankno = SlruSlotBank(shared, slotno); \
+		int		new_lru_count = (shared)->bank_cur_lru_count[lru_bankno]; \
 		if (new_lru_count != (shared)->page_lru_count[slotno]) { \
-			(shared)->cur_lru_count = ++new_lru_count; \
+			(shared)->bank_cur_lru_count[lru_bankno] = ++new_lru_count; \
 			(shared)->page_lru_count[slotno] = new_lru_count; \
 		} \
 	} while (0)
 
+/* Number of banks for an SLRU of the given size */
+#define SlruNumBanks(nslots)	Max(1, (nslots) / SLRU_BANK_SIZE)
+
+/* Bank a page is kept in, and bank a slot belongs to */
+#define SlruPageBank(shared, pageno)	((pageno) % (shared)->num_banks)
+#define SlruSlotBank(shared, slotno) \
+	Min((slotno) / (shared)->bank_size, (shared)->num_banks - 1)
+
+/* First slot of a bank, and one past its last slot */
+#define SlruBankStart(shared, bankno)	((bankno) * (shared)->bank_size)
+#define SlruBankEnd(shared, bankno) \
+	((bankno) == (shared)->num_banks - 1 ? (shared)->num_slots : \
+	 ((bankno) + 1) * (shared)->bank_size)
+
+/* Control lock covering a slot */
+#define SlruSlotLock(shared, slotno) \
+	((shared)->bank_locks[SlruSlotBank(shared, slotno)])
+
 /* Saved info for SlruReportIOError */
 typedef enum
 {
@@ -152,6 +181,8 @@ SimpleLruShmemSize(int nslots, int nlsns)
 	sz += MAXALIGN(nslots * sizeof(int));		/* page_number[] */
 	sz += MAXALIGN(nslots * sizeof(int));		/* page_lru_count[] */
 	sz += MAXALIGN(nslots * sizeof(LWLockId));	/* buffer_locks[] */
+	sz += MAXALIGN(SlruNumBanks(nslots) * sizeof(LWLockId));	/* bank_locks[] */
+	sz += MAXALIGN(SlruNumBanks(nslots) * sizeof(int));	/* bank_cur_lru_count[] */
 
 	if (nlsns > 0)
 		sz += MAXALIGN(nslots * nlsns * sizeof(XLogRecPtr));	/* group_lsn[] */
@@ -159,12 +190,24 @@ SimpleLruShmemSize(int nslots, int nlsns)
 	return BUFFERALIGN(sz) + BLCKSZ * nslots;
 }
 
+/*
+ * Number of LWLocks SimpleLruInit will assign for an SLRU of this size,
+ * besides the control lock passed to it: one per buffer, plus one per bank
+ * after the first if the SLRU is partitioned.
+ */
+int
+SimpleLruNumLWLocks(int nslots, bool partitioned)
+{
+	return nslots + (partitioned ? SlruNumBanks(nslots) - 1 : 0);
+}
+
 void
 SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
-			  LWLockId ctllock, const char *subdir)
+			  LWLockId ctllock, const char *subdir, bool partitioned)
 {
 	SlruShared	shared;
 	bool		found;
+	int			nbanks = SlruNumBanks(nslots);
 
 	shared = (SlruShared) ShmemInitStruct(name,
 										  SimpleLruShmemSize(nslots, nlsns),
@@ -176,6 +219,7 @@ SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
 		char	   *ptr;
 		Size		offset;
 		int			slotno;
+		int			bankno;
 
 		Assert(!found);
 
@@ -184,10 +228,10 @@ SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
 		shared->ControlLock = ctllock;
 
 		shared->num_slots = nslots;
+		shared->num_banks = nbanks;
+		shared->bank_size = nslots / nbanks;
 		shared->lsn_groups_per_page = nlsns;
 
-		shared->cur_lru_count = 0;
-
 		/* shared->latest_page_number will be set later */
 
 		ptr = (char *) shared;
@@ -204,6 +248,10 @@ SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
 		offset += MAXALIGN(nslots * sizeof(int));
 		shared->buffer_locks = (LWLockId *) (ptr + offset);
 		offset += MAXALIGN(nslots * sizeof(LWLockId));
+		shared->bank_locks = (LWLockId *) (ptr + offset);
+		offset += MAXALIGN(nbanks * sizeof(LWLockId));
+		shared->bank_cur_lru_count = (int *) (ptr + offset);
+		offset += MAXALIGN(nbanks * sizeof(int));
 
 		if (nlsns > 0)
 		{
@@ -221,6 +269,15 @@ SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
 			shared->buffer_locks[slotno] = LWLockAssign();
 			ptr += BLCKSZ;
 		}
+
+		for (bankno = 0; bankno < nbanks; bankno++)
+		{
+			if (bankno == 0 || !partitioned)
+				shared->bank_locks[bankno] = ctllock;
+			else
+				shared->bank_locks[bankno] = LWLockAssign();
+			shared->bank_cur_lru_count[bankno] = 0;
+		}
 	}
 	else
 		Assert(found);
@@ -304,12 +361,13 @@ static void
 SimpleLruWaitIO(SlruCtl ctl, int slotno)
 {
 	SlruShared	shared = ctl->shared;
+	LWLockId	banklock = SlruSlotLock(shared, slotno);
 
 	/* See notes at top of file */
-	LWLockRelease(shared->ControlLock);
+	LWLockRelease(banklock);
 	LWLockAcquire(shared->buffer_locks[slotno], LW_SHARED);
 	LWLockRelease(shared->buffer_locks[slotno]);
-	LWLockAcquire(shared->ControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(banklock, LW_EXCLUSIVE);
 
 	/*
 	 * If the slot is still in an io-in-progress state, then either someone
@@ -404,7 +462,7 @@ SimpleLruReadPage(SlruCtl ctl, int pageno, bool write_ok,
 		LWLockAcquire(shared->buffer_locks[slotno], LW_EXCLUSIVE);
 
 		/* Release control lock while doing I/O */
-		LWLockRelease(shared->ControlLock);
+		LWLockRelease(SlruSlotLock(shared, slotno));
 
 		/* Do the read */
 		ok = SlruPhysicalReadPage(ctl, pageno, slotno);
@@ -413,7 +471,7 @@ SimpleLruReadPage(SlruCtl ctl, int pageno, bool write_ok,
 		SimpleLruZeroLSNs(ctl, slotno);
 
 		/* Re-acquire control lock and update page state */
-		LWLockAcquire(shared->ControlLock, LW_EXCLUSIVE);
+		LWLockAcquire(SlruSlotLock(shared, slotno), LW_EXCLUSIVE);
 
 		Assert(shared->page_number[slotno] == pageno &&
 			   shared->page_status[slotno] == SLRU_PAGE_READ_IN_PROGRESS &&
@@ -450,13 +508,16 @@ int
 SimpleLruReadPage_ReadOnly(SlruCtl ctl, int pageno, TransactionId xid)
 {
 	SlruShared	shared = ctl->shared;
+	int			bankno = SlruPageBank(shared, pageno);
+	LWLockId	banklock = shared->bank_locks[bankno];
 	int			slotno;
 
 	/* Try to find the page while holding only shared lock */
-	LWLockAcquire(shared->ControlLock, LW_SHARED);
+	LWLockAcquire(banklock, LW_SHARED);
 
 	/* See if page is already in a buffer */
-	for (slotno = 0; slotno < shared->num_slots; slotno++)
+	for (slotno = SlruBankStart(shared, bankno);
+		 slotno < SlruBankEnd(shared, bankno); slotno++)
 	{
 		if (shared->page_number[slotno] == pageno &&
 			shared->page_status[slotno] != SLRU_PAGE_EMPTY &&
@@ -469,8 +530,8 @@ SimpleLruReadPage_ReadOnly(SlruCtl ctl, int pageno, TransactionId xid)
 	}
 
 	/* No luck, so switch to normal exclusive lock and do regular read */
-	LWLockRelease(shared->ControlLock);
-	LWLockAcquire(shared->ControlLock, LW_EXCLUSIVE);
+	LWLockRelease(banklock);
+	LWLockAcquire(banklock, LW_EXCLUSIVE);
 
 	return SimpleLruReadPage(ctl, pageno, true, xid);
 }
@@ -520,7 +581,7 @@ SlruInternalWritePage(SlruCtl ctl, int slotno, SlruFlush fdata)
 	LWLockAcquire(shared->buffer_locks[slotno], LW_EXCLUSIVE);
 
 	/* Release control lock while doing I/O */
-	LWLockRelease(shared->ControlLock);
+	LWLockRelease(SlruSlotLock(shared, slotno));
 
 	/* Do the write */
 	ok = SlruPhysicalWritePage(ctl, pageno, slotno, fdata);
@@ -535,7 +596,7 @@ SlruInternalWritePage(SlruCtl ctl, int slotno, SlruFlush fdata)
 	}
 
 	/* Re-acquire control lock and update page state */
-	LWLockAcquire(shared->ControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(SlruSlotLock(shared, slotno), LW_EXCLUSIVE);
 
 #ifdef PGXC
 	/*
@@ -903,7 +964,7 @@ SlruReportIOError(SlruCtl ctl, int pageno, TransactionId xid)
  * any slot already holds the target page, and return that slot if so.
  * Thus, the returned slot is *either* a slot already holding the pageno
  * (could be any state except EMPTY), *or* a freeable slot (state EMPTY
- * or CLEAN).
+ * or CLEAN).  Only the slots of the page's bank are considered.
  *
  * Control lock must be held at entry, and will be held at exit.
  */
@@ -911,6 +972,9 @@ static int
 SlruSelectLRUPage(SlruCtl ctl, int pageno)
 {
 	SlruShared	shared = ctl->shared;
+	int			bankno = SlruPageBank(shared, pageno);
+	int			bankstart = SlruBankStart(shared, bankno);
+	int			bankend = SlruBankEnd(shared, bankno);
 
 	/* Outer loop handles restart after I/O */
 	for (;;)
@@ -925,7 +989,7 @@ SlruSelectLRUPage(SlruCtl ctl, int pageno)
 		int			best_invalid_page_number = 0;		/* keep compiler quiet */
 
 		/* See if page already has a buffer assigned */
-		for (slotno = 0; slotno < shared->num_slots; slotno++)
+		for (slotno = bankstart; slotno < bankend; slotno++)
 		{
 			if (shared->page_number[slotno] == pageno &&
 				shared->page_status[slotno] != SLRU_PAGE_EMPTY)
@@ -951,16 +1015,16 @@ SlruSelectLRUPage(SlruCtl ctl, int pageno)
 		 * acquire the same lru_count values.  In that case we break ties by
 		 * choosing the furthest-back page.
 		 *
-		 * Notice that this next line forcibly advances cur_lru_count to a
-		 * value that is certainly beyond any value that will be in the
-		 * page_lru_count array after the loop finishes.  This ensures that
-		 * the next execution of SlruRecentlyUsed will mark the page newly
-		 * used, even if it's for a page that has the current counter value.
-		 * That gets us back on the path to having good data when there are
-		 * multiple pages with the same lru_count.
+		 * Notice that this next line forcibly advances the bank's
+		 * cur_lru_count to a value that is certainly beyond any value that
+		 * will be in its page_lru_count entries after the loop finishes.
+		 * This ensures that the next execution of SlruRecentlyUsed will mark
+		 * the page newly used, even if it's for a page that has the current
+		 * counter value.  That gets us back on the path to having good data
+		 * when there are multiple pages with the same lru_count.
 		 */
-		cur_count = (shared->cur_lru_count)++;
-		for (slotno = 0; slotno < shared->num_slots; slotno++)
+		cur_count = (shared->bank_cur_lru_count[bankno])++;
+		for (slotno = bankstart; slotno < bankend; slotno++)
 		{
 			int			this_delta;
 			int			this_page_number;
@@ -1050,33 +1114,40 @@ SimpleLruFlush(SlruCtl ctl, bool checkpoint)
 	SlruShared	shared = ctl->shared;
 	SlruFlushData fdata;
 	int			slotno;
+	int			bankno;
 	int			pageno = 0;
 	int			i;
 	bool		ok;
 
 	/*
-	 * Find and write dirty pages
+	 * Find and write dirty pages, one bank at a time
 	 */
 	fdata.num_files = 0;
 
-	LWLockAcquire(shared->ControlLock, LW_EXCLUSIVE);
-
-	for (slotno = 0; slotno < shared->num_slots; slotno++)
+	for (bankno = 0; bankno < shared->num_banks; bankno++)
 	{
-		SlruInternalWritePage(ctl, slotno, &fdata);
+		LWLockId	banklock = shared->bank_locks[bankno];
 
-		/*
-		 * When called during a checkpoint, we cannot assert that the slot is
-		 * clean now, since another process might have re-dirtied it already.
-		 * That's okay.
-		 */
-		Assert(checkpoint ||
-			   shared->page_status[slotno] == SLRU_PAGE_EMPTY ||
-			   (shared->page_status[slotno] == SLRU_PAGE_VALID &&
-				!shared->page_dirty[slotno]));
-	}
+		LWLockAcquire(banklock, LW_EXCLUSIVE);
+
+		for (slotno = SlruBankStart(shared, bankno);
+			 slotno < SlruBankEnd(shared, bankno); slotno++)
+		{
+			SlruInternalWritePage(ctl, slotno, &fdata);
+
+			/*
+			 * When called during a checkpoint, we cannot assert that the slot
+			 * is clean now, since another process might have re-dirtied it
+			 * already.  That's okay.
+			 */
+			Assert(checkpoint ||
+				   shared->page_status[slotno] == SLRU_PAGE_EMPTY ||
+				   (shared->page_status[slotno] == SLRU_PAGE_VALID &&
+					!shared->page_dirty[slotno]));
+		}
 
-	LWLockRelease(shared->ControlLock);
+		LWLockRelease(banklock);
+	}
 
 	/*
 	 * Now fsync and close any files that were open
@@ -1112,6 +1183,7 @@ SimpleLruTruncate(SlruCtl ctl, int cutoffPage)
 {
 	SlruShared	shared = ctl->shared;
 	int			slotno;
+	int			bankno;
 
 	/*
 	 * The cutoff point is the start of the segment containing cutoffPage.
@@ -1119,63 +1191,71 @@ SimpleLruTruncate(SlruCtl ctl, int cutoffPage)
 	cutoffPage -= cutoffPage % SLRU_PAGES_PER_SEGMENT;
 
 	/*
-	 * Scan shared memory and remove any pages preceding the cutoff page, to
-	 * ensure we won't rewrite them later.  (Since this is normally called in
-	 * or just after a checkpoint, any dirty pages should have been flushed
-	 * already ... we're just being extra careful here.)
-	 */
-	LWLockAcquire(shared->ControlLock, LW_EXCLUSIVE);
-
-restart:;
-
-	/*
-	 * While we are holding the lock, make an important safety check: the
-	 * planned cutoff point must be <= the current endpoint page. Otherwise we
-	 * have already wrapped around, and proceeding with the truncation would
-	 * risk removing the current segment.
+	 * Make an important safety check: the planned cutoff point must be <= the
+	 * current endpoint page. Otherwise we have already wrapped around, and
+	 * proceeding with the truncation would risk removing the current segment.
+	 * latest_page_number only moves forward, so reading it under the first
+	 * bank's lock is good enough even when it is set under another one.
 	 */
+	LWLockAcquire(shared->bank_locks[0], LW_SHARED);
 	if (ctl->PagePrecedes(shared->latest_page_number, cutoffPage))
 	{
-		LWLockRelease(shared->ControlLock);
+		LWLockRelease(shared->bank_locks[0]);
 		ereport(LOG,
 		  (errmsg("could not truncate directory \"%s\": apparent wraparound",
 				  ctl->Dir)));
 		return;
 	}
+	LWLockRelease(shared->bank_locks[0]);
 
-	for (slotno = 0; slotno < shared->num_slots; slotno++)
+	/*
+	 * Scan shared memory and remove any pages preceding the cutoff page, to
+	 * ensure we won't rewrite them later.  (Since this is normally called in
+	 * or just after a checkpoint, any dirty pages should have been flushed
+	 * already ... we're just being extra careful here.)
+	 */
+	for (bankno = 0; bankno < shared->num_banks; bankno++)
 	{
-		if (shared->page_status[slotno] == SLRU_PAGE_EMPTY)
-			continue;
-		if (!ctl->PagePrecedes(shared->page_number[slotno], cutoffPage))
-			continue;
+		LWLockId	banklock = shared->bank_locks[bankno];
 
-		/*
-		 * If page is clean, just change state to EMPTY (expected case).
-		 */
-		if (shared->page_status[slotno] == SLRU_PAGE_VALID &&
-			!shared->page_dirty[slotno])
+		LWLockAcquire(banklock, LW_EXCLUSIVE);
+
+restart:;
+		for (slotno = SlruBankStart(shared, bankno);
+			 slotno < SlruBankEnd(shared, bankno); slotno++)
 		{
-			shared->page_status[slotno] = SLRU_PAGE_EMPTY;
-			continue;
+			if (shared->page_status[slotno] == SLRU_PAGE_EMPTY)
+				continue;
+			if (!ctl->PagePrecedes(shared->page_number[slotno], cutoffPage))
+				continue;
+
+			/*
+			 * If page is clean, just change state to EMPTY (expected case).
+			 */
+			if (shared->page_status[slotno] == SLRU_PAGE_VALID &&
+				!shared->page_dirty[slotno])
+			{
+				shared->page_status[slotno] = SLRU_PAGE_EMPTY;
+				continue;
+			}
+
+			/*
+			 * Hmm, we have (or may have) I/O operations acting on the page,
+			 * so we've got to wait for them to finish and then start again.
+			 * This is the same logic as in SlruSelectLRUPage.  (XXX if page
+			 * is dirty, wouldn't it be OK to just discard it without writing
+			 * it?  For now, keep the logic the same as it was.)
+			 */
+			if (shared->page_status[slotno] == SLRU_PAGE_VALID)
+				SlruInternalWritePage(ctl, slotno, NULL);
+			else
+				SimpleLruWaitIO(ctl, slotno);
+			goto restart;
 		}
 
-		/*
-		 * Hmm, we have (or may have) I/O operations acting on the page, so
-		 * we've got to wait for them to finish and then start again. This is
-		 * the same logic as in SlruSelectLRUPage.	(XXX if page is dirty,
-		 * wouldn't it be OK to just discard it without writing it?  For now,
-		 * keep the logic the same as it was.)
-		 */
-		if (shared->page_status[slotno] == SLRU_PAGE_VALID)
-			SlruInternalWritePage(ctl, slotno, NULL);
-		else
-			SimpleLruWaitIO(ctl, slotno);
-		goto restart;
+		LWLockRelease(banklock);
 	}
 
-	LWLockRelease(shared->ControlLock);
-
 	/* Now we can remove the old segment(s) */
 	(void) SlruScanDirectory(ctl, SlruScanDirCbDeleteCutoff, &cutoffPage);
 }
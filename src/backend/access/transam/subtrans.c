@@ -66,6 +66,9 @@ static SlruCtlData SubTransCtlData;
 
 #define SubTransCtl  (&SubTransCtlData)
 
+/* GUC parameter: number of SUBTRANS buffers */
+int			subtrans_buffers = 32;
+
 
 static int	ZeroSUBTRANSPage(int pageno);
 static bool SubTransPagePrecedes(int page1, int page2);
@@ -86,7 +89,7 @@ SubTransSetParent(TransactionId xid, TransactionId parent, bool overwriteOK)
 
 	Assert(TransactionIdIsValid(parent));
 
-	LWLockAcquire(SubtransControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(SimpleLruGetBankLock(SubTransCtl, pageno), LW_EXCLUSIVE);
 
 	slotno = SimpleLruReadPage(SubTransCtl, pageno, true, xid);
 	ptr = (TransactionId *) SubTransCtl->shared->page_buffer[slotno];
@@ -100,7 +103,7 @@ SubTransSetParent(TransactionId xid, TransactionId parent, bool overwriteOK)
 
 	SubTransCtl->shared->page_dirty[slotno] = true;
 
-	LWLockRelease(SubtransControlLock);
+	LWLockRelease(SimpleLruGetBankLock(SubTransCtl, pageno));
 }
 
 /*
@@ -130,7 +133,7 @@ SubTransGetParent(TransactionId xid)
 
 	parent = *ptr;
 
-	LWLockRelease(SubtransControlLock);
+	LWLockRelease(SimpleLruGetBankLock(SubTransCtl, pageno));
 
 	return parent;
 }
@@ -176,15 +179,15 @@ SubTransGetTopmostTransaction(TransactionId xid)
 Size
 SUBTRANSShmemSize(void)
 {
-	return SimpleLruShmemSize(NUM_SUBTRANS_BUFFERS, 0);
+	return SimpleLruShmemSize(subtrans_buffers, 0);
 }
 
 void
 SUBTRANSShmemInit(void)
 {
 	SubTransCtl->PagePrecedes = SubTransPagePrecedes;
-	SimpleLruInit(SubTransCtl, "SUBTRANS Ctl", NUM_SUBTRANS_BUFFERS, 0,
-				  SubtransControlLock, "pg_subtrans");
+	SimpleLruInit(SubTransCtl, "SUBTRANS Ctl", subtrans_buffers, 0,
+				  SubtransControlLock, "pg_subtrans", true);
 	/* Override default assumption that writes should be fsync'd */
 	SubTransCtl->do_fsync = false;
 }
@@ -204,7 +207,7 @@ BootStrapSUBTRANS(void)
 {
 	int			slotno;
 
-	LWLockAcquire(SubtransControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(SimpleLruGetBankLock(SubTransCtl, 0), LW_EXCLUSIVE);
 
 	/* Create and zero the first page of the subtrans log */
 	slotno = ZeroSUBTRANSPage(0);
@@ -213,7 +216,7 @@ BootStrapSUBTRANS(void)
 	SimpleLruWritePage(SubTransCtl, slotno);
 	Assert(!SubTransCtl->shared->page_dirty[slotno]);
 
-	LWLockRelease(SubtransControlLock);
+	LWLockRelease(SimpleLruGetBankLock(SubTransCtl, 0));
 }
 
 /*
@@ -249,19 +252,21 @@ StartupSUBTRANS(TransactionId oldestActiveXID)
 	 * Whenever we advance into a new page, ExtendSUBTRANS will likewise zero
 	 * the new page without regard to whatever was previously on disk.
 	 */
-	LWLockAcquire(SubtransControlLock, LW_EXCLUSIVE);
-
 	startPage = TransactionIdToPage(oldestActiveXID);
 	endPage = TransactionIdToPage(ShmemVariableCache->nextXid);
 
-	while (startPage != endPage)
+	for (;;)
 	{
+		LWLockId	lock = SimpleLruGetBankLock(SubTransCtl, startPage);
+
+		LWLockAcquire(lock, LW_EXCLUSIVE);
 		(void) ZeroSUBTRANSPage(startPage);
+		LWLockRelease(lock);
+
+		if (startPage == endPage)
+			break;
 		startPage++;
 	}
-	(void) ZeroSUBTRANSPage(startPage);
-
-	LWLockRelease(SubtransControlLock);
 }
 
 /*
@@ -345,7 +350,7 @@ ExtendSUBTRANS(TransactionId newestXact)
 	pageno = TransactionIdToPage(newestXact);
 #endif
 
-	LWLockAcquire(SubtransControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(SimpleLruGetBankLock(SubTransCtl, pageno), LW_EXCLUSIVE);
 
 #ifdef PGXC
 	/*
@@ -356,7 +361,7 @@ ExtendSUBTRANS(TransactionId newestXact)
 	if (SubTransCtl->shared->latest_page_number - pageno <= SUBTRANS_WRAP_CHECK_DELTA 
 			&& pageno <= SubTransCtl->shared->latest_page_number)
 	{
-		LWLockRelease(SubtransControlLock);
+		LWLockRelease(SimpleLruGetBankLock(SubTransCtl, pageno));
 		return;
 	}
 #endif
@@ -364,7 +369,7 @@ ExtendSUBTRANS(TransactionId newestXact)
 	/* Zero the page */
 	ZeroSUBTRANSPage(pageno);
 
-	LWLockRelease(SubtransControlLock);
+	LWLockRelease(SimpleLruGetBankLock(SubTransCtl, pageno));
 }
 
 
@@ -29,8 +29,12 @@
  *		In order to survive crashes and shutdowns, all prepared
  *		transactions must be stored in permanent storage. This includes
  *		locking information, pending notifications etc. All that state
- *		information is written to the per-transaction state file in
- *		the pg_twophase directory.
+ *		information is written to the PREPARE record in WAL, and read back
+ *		from there by COMMIT/ROLLBACK PREPARED.  Only if a transaction is
+ *		still prepared when a checkpoint moves the redo pointer past its
+ *		PREPARE record is the state copied to a per-transaction state file
+ *		in the pg_twophase directory, since the WAL may then be recycled.
+ *		WAL replay recreates the state files from the PREPARE records.
  *
  *-------------------------------------------------------------------------
  */
@@ -48,6 +52,7 @@
 #include "access/twophase.h"
 #include "access/twophase_rmgr.h"
 #include "access/xact.h"
+#include "access/xlogreader.h"
 #include "access/xlogutils.h"
 #include "catalog/pg_type.h"
 #include "catalog/storage.h"
@@ -120,10 +125,12 @@ typedef struct GlobalTransactionData
 	int			pgprocno;		/* ID of associated dummy PGPROC */
 	BackendId	dummyBackendId; /* similar to backend id for backends */
 	TimestampTz prepared_at;	/* time of preparation */
-	XLogRecPtr	prepare_lsn;	/* XLOG offset of prepare record */
+	XLogRecPtr	prepare_start_lsn;	/* XLOG offset of prepare record start */
+	XLogRecPtr	prepare_end_lsn;	/* XLOG offset of prepare record end */
 	Oid			owner;			/* ID of user that executed the xact */
 	TransactionId locking_xid;	/* top-level XID of backend working on xact */
 	bool		valid;			/* TRUE if fully prepared */
+	bool		ondisk;			/* TRUE if state file is in pg_twophase */
 	char		gid[GIDSIZE];	/* The GID assigned to the prepared xact */
 }	GlobalTransactionData;
 
@@ -164,6 +171,8 @@ static void RecordTransactionAbortPrepared(TransactionId xid,
 							   RelFileNode *rels);
 static void ProcessRecords(char *bufptr, TransactionId xid,
 			   const TwoPhaseCallback callbacks[]);
+static char *XlogReadTwoPhaseData(TransactionId xid, XLogRecPtr lsn,
+					 int *len);
 
 
 /*
@@ -344,11 +353,13 @@ MarkAsPreparing(TransactionId xid, const char *gid,
 	pgxact->nxids = 0;
 
 	gxact->prepared_at = prepared_at;
-	/* initialize LSN to 0 (start of WAL) */
-	gxact->prepare_lsn = 0;
+	/* initialize LSNs to 0 (start of WAL) */
+	gxact->prepare_start_lsn = 0;
+	gxact->prepare_end_lsn = 0;
 	gxact->owner = owner;
 	gxact->locking_xid = xid;
 	gxact->valid = false;
+	gxact->ondisk = false;
 	strcpy(gxact->gid, gid);
 
 	/* And insert it into the active array */
@@ -494,7 +505,12 @@ LockGXact(const char *gid, Oid user)
 
 /*
  * RemoveGXact
- *		Remove the prepared transaction from the shared memory array.
+ *		Remove the prepared transaction from the shared memory array, and
+ *		its state file if a checkpoint wrote one.
+ *
+ * The state file is removed while we hold TwoPhaseStateLock, which
+ * CheckPointTwoPhase holds while writing state files, so that one cannot
+ * be left behind.
  *
  * NB: caller should have already removed it from ProcArray
  */
@@ -509,6 +525,10 @@ RemoveGXact(GlobalTransaction gxact)
 	{
 		if (gxact == TwoPhaseState->prepXacts[i])
 		{
+			if (gxact->ondisk)
+				RemoveTwoPhaseFile(ProcGlobal->allPgXact[gxact->pgprocno].xid,
+								   true);
+
 			/* remove from the active array */
 			TwoPhaseState->numPrepXacts--;
 			TwoPhaseState->prepXacts[i] = TwoPhaseState->prepXacts[TwoPhaseState->numPrepXacts];
@@ -528,41 +548,6 @@ RemoveGXact(GlobalTransaction gxact)
 	elog(ERROR, "failed to find %p in GlobalTransaction array", gxact);
 }
 
-/*
- * TransactionIdIsPrepared
- *		True iff transaction associated with the identifier is prepared
- *		for two-phase commit
- *
- * Note: only gxacts marked "valid" are considered; but notice we do not
- * check the locking status.
- *
- * This is not currently exported, because it is only needed internally.
- */
-static bool
-TransactionIdIsPrepared(TransactionId xid)
-{
-	bool		result = false;
-	int			i;
-
-	LWLockAcquire(TwoPhaseStateLock, LW_SHARED);
-
-	for (i = 0; i < TwoPhaseState->numPrepXacts; i++)
-	{
-		GlobalTransaction gxact = TwoPhaseState->prepXacts[i];
-		PGXACT	   *pgxact = &ProcGlobal->allPgXact[gxact->pgprocno];
-
-		if (gxact->valid && pgxact->xid == xid)
-		{
-			result = true;
-			break;
-		}
-	}
-
-	LWLockRelease(TwoPhaseStateLock);
-
-	return result;
-}
-
 /*
  * Returns an array of all prepared transactions for the user-level
  * function pg_prepared_xact.
@@ -796,15 +781,15 @@ TwoPhaseGetDummyProc(TransactionId xid)
  *	6. TwoPhaseRecordOnDisk
  *	7. ...
  *	8. TwoPhaseRecordOnDisk (end sentinel, rmid == TWOPHASE_RM_END_ID)
- *	9. CRC32
+ *	9. CRC32C
  *
- * Each segment except the final CRC32 is MAXALIGN'd.
+ * Each segment except the final CRC32C is MAXALIGN'd.
  */
 
 /*
  * Header for a 2PC state file
  */
-#define TWOPHASE_MAGIC	0x57F94532		/* format identifier */
+#define TWOPHASE_MAGIC	0x57F94533		/* format identifier */
 
 typedef struct TwoPhaseFileHeader
 {
@@ -837,9 +822,8 @@ typedef struct TwoPhaseRecordOnDisk
 
 /*
  * During prepare, the state file is assembled in memory before writing it
- * to WAL and the actual state file.  We use a chain of XLogRecData blocks
- * so that we will be able to pass the state file contents directly to
- * XLogInsert.
+ * to WAL.  We use a chain of XLogRecData blocks so that we will be able to
+ * pass the state file contents directly to XLogInsert.
  */
 static struct xllist
 {
@@ -958,19 +942,14 @@ StartPrepare(GlobalTransaction gxact)
 /*
  * Finish preparing state file.
  *
- * Calculates CRC and writes state file to WAL and in pg_twophase directory.
+ * Writes state data to WAL.  No state file is written: the PREPARE record
+ * is read back by FinishPreparedTransaction, or copied to a file by
+ * CheckPointTwoPhase if the transaction outlives a checkpoint.
  */
 void
 EndPrepare(GlobalTransaction gxact)
 {
-	PGXACT	   *pgxact = &ProcGlobal->allPgXact[gxact->pgprocno];
-	TransactionId xid = pgxact->xid;
 	TwoPhaseFileHeader *hdr;
-	char		path[MAXPGPATH];
-	XLogRecData *record;
-	pg_crc32	statefile_crc;
-	pg_crc32	bogus_crc;
-	int			fd;
 
 	/* Add the end sentinel to the list of 2PC records */
 	RegisterTwoPhaseRecord(TWOPHASE_RM_END_ID, 0,
@@ -979,10 +958,10 @@ EndPrepare(GlobalTransaction gxact)
 	/* Go back and fill in total_len in the file header record */
 	hdr = (TwoPhaseFileHeader *) records.head->data;
 	Assert(hdr->magic == TWOPHASE_MAGIC);
-	hdr->total_len = records.total_len + sizeof(pg_crc32);
+	hdr->total_len = records.total_len + sizeof(pg_crc32c);
 
 	/*
-	 * If the file size exceeds MaxAllocSize, we won't be able to read it in
+	 * If the data size exceeds MaxAllocSize, we won't be able to read it in
 	 * ReadTwoPhaseFile. Check for that now, rather than fail at commit time.
 	 */
 	if (hdr->total_len > MaxAllocSize)
@@ -991,105 +970,32 @@ EndPrepare(GlobalTransaction gxact)
 				 errmsg("two-phase state file maximum length exceeded")));
 
 	/*
-	 * Create the 2PC state file.
-	 */
-
-	TwoPhaseFilePath(path, xid);
-
-	fd = OpenTransientFile(path,
-						   O_CREAT | O_EXCL | O_WRONLY | PG_BINARY,
-						   S_IRUSR | S_IWUSR);
-	if (fd < 0)
-		ereport(ERROR,
-				(errcode_for_file_access(),
-				 errmsg("could not create two-phase state file \"%s\": %m",
-						path)));
-
-	/* Write data to file, and calculate CRC as we pass over it */
-	INIT_CRC32(statefile_crc);
-
-	for (record = records.head; record != NULL; record = record->next)
-	{
-		COMP_CRC32(statefile_crc, record->data, record->len);
-		if ((write(fd, record->data, record->len)) != record->len)
-		{
-			CloseTransientFile(fd);
-			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("could not write two-phase state file: %m")));
-		}
-	}
-
-	FIN_CRC32(statefile_crc);
-
-	/*
-	 * Write a deliberately bogus CRC to the state file; this is just paranoia
-	 * to catch the case where four more bytes will run us out of disk space.
-	 */
-	bogus_crc = ~statefile_crc;
-
-	if ((write(fd, &bogus_crc, sizeof(pg_crc32))) != sizeof(pg_crc32))
-	{
-		CloseTransientFile(fd);
-		ereport(ERROR,
-				(errcode_for_file_access(),
-				 errmsg("could not write two-phase state file: %m")));
-	}
-
-	/* Back up to prepare for rewriting the CRC */
-	if (lseek(fd, -((off_t) sizeof(pg_crc32)), SEEK_CUR) < 0)
-	{
-		CloseTransientFile(fd);
-		ereport(ERROR,
-				(errcode_for_file_access(),
-				 errmsg("could not seek in two-phase state file: %m")));
-	}
-
-	/*
-	 * The state file isn't valid yet, because we haven't written the correct
-	 * CRC yet.  Before we do that, insert entry in WAL and flush it to disk.
-	 *
-	 * Between the time we have written the WAL entry and the time we write
-	 * out the correct state file CRC, we have an inconsistency: the xact is
-	 * prepared according to WAL but not according to our on-disk state. We
-	 * use a critical section to force a PANIC if we are unable to complete
-	 * the write --- then, WAL replay should repair the inconsistency.	The
-	 * odds of a PANIC actually occurring should be very tiny given that we
-	 * were able to write the bogus CRC above.
+	 * Insert the PREPARE record in WAL and flush it to disk.  We use a
+	 * critical section to force a PANIC if we are unable to mark the gxact
+	 * valid afterwards, since the xact is prepared according to WAL.
 	 *
 	 * We have to set delayChkpt here, too; otherwise a checkpoint starting
 	 * immediately after the WAL record is inserted could complete without
-	 * fsync'ing our state file.  (This is essentially the same kind of race
-	 * condition as the COMMIT-to-clog-write case that RecordTransactionCommit
-	 * uses delayChkpt for; see notes there.)
+	 * writing out our state, even though its redo pointer is past our
+	 * PREPARE record.  (This is essentially the same kind of race condition
+	 * as the COMMIT-to-clog-write case that RecordTransactionCommit uses
+	 * delayChkpt for; see notes there.)
 	 *
 	 * We save the PREPARE record's location in the gxact for later use by
-	 * CheckPointTwoPhase.
+	 * FinishPreparedTransaction and CheckPointTwoPhase.
 	 */
-
 	START_CRIT_SECTION();
 
 	MyPgXact->delayChkpt = true;
 
-	gxact->prepare_lsn = XLogInsert(RM_XACT_ID, XLOG_XACT_PREPARE,
-									records.head);
-	XLogFlush(gxact->prepare_lsn);
+	gxact->prepare_end_lsn = XLogInsert(RM_XACT_ID, XLOG_XACT_PREPARE,
+										records.head);
+	XLogFlush(gxact->prepare_end_lsn);
 
 	/* If we crash now, we have prepared: WAL replay will fix things */
 
-	/* write correct CRC and close file */
-	if ((write(fd, &statefile_crc, sizeof(pg_crc32))) != sizeof(pg_crc32))
-	{
-		CloseTransientFile(fd);
-		ereport(ERROR,
-				(errcode_for_file_access(),
-				 errmsg("could not write two-phase state file: %m")));
-	}
-
-	if (CloseTransientFile(fd) != 0)
-		ereport(ERROR,
-				(errcode_for_file_access(),
-				 errmsg("could not close two-phase state file: %m")));
+	/* Store record's start location to read that later on Commit */
+	gxact->prepare_start_lsn = ProcLastRecPtr;
 
 	/*
 	 * Mark the prepared transaction as valid.	As soon as xact.c marks
@@ -1108,7 +1014,7 @@ EndPrepare(GlobalTransaction gxact)
 	/*
 	 * Now we can mark ourselves as out of the commit critical section: a
 	 * checkpoint starting after this will certainly see the gxact as a
-	 * candidate for fsyncing.
+	 * candidate for writing out.
 	 */
 	MyPgXact->delayChkpt = false;
 
@@ -1120,7 +1026,7 @@ EndPrepare(GlobalTransaction gxact)
 	 * Note that at this stage we have marked the prepare, but still show as
 	 * running in the procarray (twice!) and continue to hold locks.
 	 */
-	SyncRepWaitForLSN(gxact->prepare_lsn);
+	SyncRepWaitForLSN(gxact->prepare_end_lsn);
 
 	records.tail = records.head = NULL;
 }
@@ -1158,7 +1064,7 @@ ReadTwoPhaseFile(TransactionId xid, bool give_warnings)
 	int			fd;
 	struct stat stat;
 	uint32		crc_offset;
-	pg_crc32	calc_crc,
+	pg_crc32c	calc_crc,
 				file_crc;
 
 	TwoPhaseFilePath(path, xid);
@@ -1193,14 +1099,14 @@ ReadTwoPhaseFile(TransactionId xid, bool give_warnings)
 
 	if (stat.st_size < (MAXALIGN(sizeof(TwoPhaseFileHeader)) +
 						MAXALIGN(sizeof(TwoPhaseRecordOnDisk)) +
-						sizeof(pg_crc32)) ||
+						sizeof(pg_crc32c)) ||
 		stat.st_size > MaxAllocSize)
 	{
 		CloseTransientFile(fd);
 		return NULL;
 	}
 
-	crc_offset = stat.st_size - sizeof(pg_crc32);
+	crc_offset = stat.st_size - sizeof(pg_crc32c);
 	if (crc_offset != MAXALIGN(crc_offset))
 	{
 		CloseTransientFile(fd);
@@ -1233,13 +1139,13 @@ ReadTwoPhaseFile(TransactionId xid, bool give_warnings)
 		return NULL;
 	}
 
-	INIT_CRC32(calc_crc);
-	COMP_CRC32(calc_crc, buf, crc_offset);
-	FIN_CRC32(calc_crc);
+	INIT_CRC32C(calc_crc);
+	COMP_CRC32C(calc_crc, buf, crc_offset);
+	FIN_CRC32C(calc_crc);
 
-	file_crc = *((pg_crc32 *) (buf + crc_offset));
+	file_crc = *((pg_crc32c *) (buf + crc_offset));
 
-	if (!EQ_CRC32(calc_crc, file_crc))
+	if (!EQ_CRC32C(calc_crc, file_crc))
 	{
 		pfree(buf);
 		return NULL;
@@ -1248,6 +1154,112 @@ ReadTwoPhaseFile(TransactionId xid, bool give_warnings)
 	return buf;
 }
 
+/*
+ * WAL segment XlogReadTwoPhaseData is reading from, if any
+ */
+static int	twophaseReadFile = -1;
+static XLogSegNo twophaseReadSegNo = 0;
+
+/*
+ * XLogReader callback for XlogReadTwoPhaseData.
+ *
+ * PREPARE records read back from WAL were written since the server started,
+ * so they are flushed, in pg_xlog, on the current timeline.  The segment
+ * may have been recycled once a checkpoint wrote the state file, in which
+ * case we just fail.
+ */
+static int
+TwoPhaseReadPage(XLogReaderState *state, XLogRecPtr targetPagePtr,
+				 int reqLen, XLogRecPtr targetRecPtr, char *readBuf,
+				 TimeLineID *pageTLI)
+{
+	XLogRecPtr	flushptr = GetFlushRecPtr();
+	uint32		startoff;
+	int			count;
+
+	if (targetPagePtr + reqLen > flushptr)
+		return -1;
+	if (targetPagePtr + XLOG_BLCKSZ <= flushptr)
+		count = XLOG_BLCKSZ;
+	else
+		count = flushptr - targetPagePtr;
+
+	if (twophaseReadFile < 0 ||
+		!XLByteInSeg(targetPagePtr, twophaseReadSegNo))
+	{
+		char		path[MAXPGPATH];
+
+		if (twophaseReadFile >= 0)
+			close(twophaseReadFile);
+
+		XLByteToSeg(targetPagePtr, twophaseReadSegNo);
+		XLogFilePath(path, ThisTimeLineID, twophaseReadSegNo);
+
+		twophaseReadFile = BasicOpenFile(path, O_RDONLY | PG_BINARY, 0);
+		if (twophaseReadFile < 0)
+			return -1;
+	}
+
+	startoff = targetPagePtr % XLogSegSize;
+	if (lseek(twophaseReadFile, (off_t) startoff, SEEK_SET) < 0 ||
+		read(twophaseReadFile, readBuf, count) != count)
+		return -1;
+
+	*pageTLI = ThisTimeLineID;
+	return count;
+}
+
+/*
+ * Read the PREPARE record of xid at lsn back from WAL.
+ *
+ * Returns the palloc'd record contents, which are those of the state file
+ * without its CRC, and stores their length in *len.  Returns NULL if the
+ * record cannot be read anymore.
+ */
+static char *
+XlogReadTwoPhaseData(TransactionId xid, XLogRecPtr lsn, int *len)
+{
+	XLogReaderState *xlogreader;
+	XLogRecord *record;
+	char	   *errormsg;
+	char	   *buf = NULL;
+
+	/* Never reuse a segment opened by an earlier call: it may be recycled */
+	if (twophaseReadFile >= 0)
+	{
+		close(twophaseReadFile);
+		twophaseReadFile = -1;
+	}
+
+	xlogreader = XLogReaderAllocate(&TwoPhaseReadPage, NULL);
+	if (!xlogreader)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating an XLog reading processor.")));
+
+	record = XLogReadRecord(xlogreader, lsn, &errormsg);
+	if (record != NULL &&
+		record->xl_rmid == RM_XACT_ID &&
+		(record->xl_info & ~XLR_INFO_MASK) == XLOG_XACT_PREPARE &&
+		TransactionIdEquals(record->xl_xid, xid))
+	{
+		buf = (char *) palloc(record->xl_len);
+		memcpy(buf, XLogRecGetData(record), record->xl_len);
+		*len = record->xl_len;
+	}
+
+	XLogReaderFree(xlogreader);
+
+	if (twophaseReadFile >= 0)
+	{
+		close(twophaseReadFile);
+		twophaseReadFile = -1;
+	}
+
+	return buf;
+}
+
 /*
  * Confirms an xid is prepared, during recovery
  */
@@ -1322,9 +1334,19 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
 	xid = pgxact->xid;
 
 	/*
-	 * Read and validate the state file
+	 * Read and validate the state data.  It is normally still in WAL; if a
+	 * checkpoint has written it out meanwhile, the WAL may be gone but the
+	 * state file is there.
 	 */
-	buf = ReadTwoPhaseFile(xid, true);
+	buf = NULL;
+	if (!gxact->ondisk)
+	{
+		int			len;
+
+		buf = XlogReadTwoPhaseData(xid, gxact->prepare_start_lsn, &len);
+	}
+	if (buf == NULL)
+		buf = ReadTwoPhaseFile(xid, true);
 	if (buf == NULL)
 		ereport(ERROR,
 				(errcode(ERRCODE_DATA_CORRUPTED),
@@ -1430,8 +1452,6 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
 	/*
 	 * And now we can clean up our mess.
 	 */
-	RemoveTwoPhaseFile(xid, true);
-
 	RemoveGXact(gxact);
 
 	pfree(buf);
@@ -1492,13 +1512,13 @@ void
 RecreateTwoPhaseFile(TransactionId xid, void *content, int len)
 {
 	char		path[MAXPGPATH];
-	pg_crc32	statefile_crc;
+	pg_crc32c	statefile_crc;
 	int			fd;
 
 	/* Recompute CRC */
-	INIT_CRC32(statefile_crc);
-	COMP_CRC32(statefile_crc, content, len);
-	FIN_CRC32(statefile_crc);
+	INIT_CRC32C(statefile_crc);
+	COMP_CRC32C(statefile_crc, content, len);
+	FIN_CRC32C(statefile_crc);
 
 	TwoPhaseFilePath(path, xid);
 
@@ -1519,7 +1539,7 @@ RecreateTwoPhaseFile(TransactionId xid, void *content, int len)
 				(errcode_for_file_access(),
 				 errmsg("could not write two-phase state file: %m")));
 	}
-	if (write(fd, &statefile_crc, sizeof(pg_crc32)) != sizeof(pg_crc32))
+	if (write(fd, &statefile_crc, sizeof(pg_crc32c)) != sizeof(pg_crc32c))
 	{
 		CloseTransientFile(fd);
 		ereport(ERROR,
@@ -1548,47 +1568,34 @@ RecreateTwoPhaseFile(TransactionId xid, void *content, int len)
 /*
  * CheckPointTwoPhase -- handle 2PC component of checkpointing.
  *
- * We must fsync the state file of any GXACT that is valid and has a PREPARE
- * LSN <= the checkpoint's redo horizon.  (If the gxact isn't valid yet or
- * has a later LSN, this checkpoint is not responsible for fsyncing it.)
+ * We must write out the state of any GXACT that is valid and whose PREPARE
+ * record is before the checkpoint's redo horizon, since the WAL holding it
+ * may be recycled once the checkpoint is done.  (If the gxact isn't valid
+ * yet or has a later PREPARE record, this checkpoint is not responsible for
+ * it.)  The state file is written and fsync'd by RecreateTwoPhaseFile, and
+ * is not written again by later checkpoints.
  *
  * This is deliberately run as late as possible in the checkpoint sequence,
  * because GXACTs ordinarily have short lifespans, and so it is quite
  * possible that GXACTs that were valid at checkpoint start will no longer
- * exist if we wait a little bit.
+ * exist if we wait a little bit.  With typical short-lived transactions,
+ * no state file is ever written.
  *
- * If a GXACT remains valid across multiple checkpoints, it'll be fsynced
- * each time.  This is considered unusual enough that we don't bother to
- * expend any extra code to avoid the redundant fsyncs.  (They should be
- * reasonably cheap anyway, since they won't cause I/O.)
+ * We hold TwoPhaseStateLock while doing I/O, so that a GXACT cannot be
+ * removed, leaving its state file behind, while we write the file.  This is
+ * acceptable as long-lived prepared transactions are rare.
  */
 void
 CheckPointTwoPhase(XLogRecPtr redo_horizon)
 {
-	TransactionId *xids;
-	int			nxids;
-	char		path[MAXPGPATH];
 	int			i;
+	int			nfiles = 0;
 
-	/*
-	 * We don't want to hold the TwoPhaseStateLock while doing I/O, so we grab
-	 * it just long enough to make a list of the XIDs that require fsyncing,
-	 * and then do the I/O afterwards.
-	 *
-	 * This approach creates a race condition: someone else could delete a
-	 * GXACT between the time we release TwoPhaseStateLock and the time we try
-	 * to open its state file.	We handle this by special-casing ENOENT
-	 * failures: if we see that, we verify that the GXACT is no longer valid,
-	 * and if so ignore the failure.
-	 */
 	if (max_prepared_xacts <= 0)
 		return;					/* nothing to do */
 
 	TRACE_POSTGRESQL_TWOPHASE_CHECKPOINT_START();
 
-	xids = (TransactionId *) palloc(max_prepared_xacts * sizeof(TransactionId));
-	nxids = 0;
-
 	LWLockAcquire(TwoPhaseStateLock, LW_SHARED);
 
 	for (i = 0; i < TwoPhaseState->numPrepXacts; i++)
@@ -1596,54 +1603,37 @@ CheckPointTwoPhase(XLogRecPtr redo_horizon)
 		GlobalTransaction gxact = TwoPhaseState->prepXacts[i];
 		PGXACT	   *pgxact = &ProcGlobal->allPgXact[gxact->pgprocno];
 
-		if (gxact->valid &&
-			gxact->prepare_lsn <= redo_horizon)
-			xids[nxids++] = pgxact->xid;
-	}
-
-	LWLockRelease(TwoPhaseStateLock);
-
-	for (i = 0; i < nxids; i++)
-	{
-		TransactionId xid = xids[i];
-		int			fd;
-
-		TwoPhaseFilePath(path, xid);
-
-		fd = OpenTransientFile(path, O_RDWR | PG_BINARY, 0);
-		if (fd < 0)
+		if (gxact->valid && !gxact->ondisk &&
+			gxact->prepare_end_lsn <= redo_horizon)
 		{
-			if (errno == ENOENT)
-			{
-				/* OK if gxact is no longer valid */
-				if (!TransactionIdIsPrepared(xid))
-					continue;
-				/* Restore errno in case it was changed */
-				errno = ENOENT;
-			}
-			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("could not open two-phase state file \"%s\": %m",
-							path)));
-		}
+			char	   *buf;
+			int			len;
 
-		if (pg_fsync(fd) != 0)
-		{
-			CloseTransientFile(fd);
-			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("could not fsync two-phase state file \"%s\": %m",
-							path)));
-		}
+			buf = XlogReadTwoPhaseData(pgxact->xid, gxact->prepare_start_lsn,
+									   &len);
+			if (buf == NULL)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not read two-phase state from WAL at %X/%X",
+								(uint32) (gxact->prepare_start_lsn >> 32),
+								(uint32) gxact->prepare_start_lsn)));
 
-		if (CloseTransientFile(fd) != 0)
-			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("could not close two-phase state file \"%s\": %m",
-							path)));
+			RecreateTwoPhaseFile(pgxact->xid, buf, len);
+			gxact->ondisk = true;
+			pfree(buf);
+			nfiles++;
+		}
 	}
 
-	pfree(xids);
+	LWLockRelease(TwoPhaseStateLock);
+
+	if (log_checkpoints && nfiles > 0)
+		ereport(LOG,
+				(errmsg_plural("%u two-phase state file was written "
+							   "for long-running prepared transactions",
+							   "%u two-phase state files were written "
+							   "for long-running prepared transactions",
+							   nfiles, nfiles)));
 
 	TRACE_POSTGRESQL_TWOPHASE_CHECKPOINT_DONE();
 }
@@ -1974,16 +1964,14 @@ RecoverPreparedTransactions(void)
 			/*
 			 * Recreate its GXACT and dummy PGPROC
 			 *
-			 * Note: since we don't have the PREPARE record's WAL location at
-			 * hand, we leave prepare_lsn zeroes.  This means the GXACT will
-			 * be fsync'd on every future checkpoint.  We assume this
-			 * situation is infrequent enough that the performance cost is
-			 * negligible (especially since we know the state file has already
-			 * been fsynced).
+			 * Its state is in the file we just read, which has already been
+			 * fsynced, so the WAL location of its PREPARE record is not
+			 * needed anymore.
 			 */
 			gxact = MarkAsPreparing(xid, hdr->gid,
 									hdr->prepared_at,
 									hdr->owner, hdr->database);
+			gxact->ondisk = true;
 			GXactLoadSubxactData(gxact, hdr->nsubxacts, subxids);
 			MarkAsPrepared(gxact);
 
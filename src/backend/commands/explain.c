@@ -982,6 +982,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_Limit:
 			pname = sname = "Limit";
 			break;
+		case T_Gather:
+			pname = sname = "Gather";
+			break;
 		case T_Hash:
 			pname = sname = "Hash";
 			break;
@@ -1405,6 +1408,14 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_Hash:
 			show_hash_info((HashState *) planstate, es);
 			break;
+		case T_Gather:
+			ExplainPropertyInteger("Workers Planned",
+								   ((Gather *) plan)->num_workers, es);
+			if (es->analyze)
+				ExplainPropertyInteger("Workers Launched",
+									   ((GatherState *) planstate)->nworkers_launched,
+									   es);
+			break;
 		default:
 			break;
 	}
@@ -2657,6 +2668,24 @@ ExplainRemoteQuery(RemoteQuery *plan, PlanState *planstate, List *ancestors, Exp
 	/* Remote query statement */
 	if (es->verbose)
 		ExplainPropertyText("Remote query", plan->sql_statement, es);
+
+	/* Where the plan came from, see pgxc_wait_shipped_plan */
+	if (es->analyze && planstate)
+	{
+		RemoteQueryState *rqs = (RemoteQueryState *) planstate;
+
+		if (OidIsValid(rqs->rqs_plan_node))
+		{
+			ExplainPropertyText("Remote Plan Made By",
+								get_pgxc_nodename(rqs->rqs_plan_node), es);
+			ExplainPropertyInteger("Remote Plan Shipped To",
+								   rqs->rqs_plan_shipped, es);
+			ExplainPropertyFloat("Remote Planning Time",
+								 rqs->rqs_remote_plan_time, 3, es);
+			ExplainPropertyFloat("Remote Plan Wait Time",
+								 rqs->rqs_plan_wait_time, 3, es);
+		}
+	}
 }
 #endif
 
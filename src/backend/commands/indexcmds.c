@@ -178,6 +178,8 @@ CheckIndexCompatible(Oid oldId,
 	 * later on, and it would have failed then anyway.
 	 */
 	indexInfo = makeNode(IndexInfo);
+	indexInfo->ii_NumIndexAttrs = numberOfAttributes;
+	indexInfo->ii_NumIndexKeyAttrs = numberOfAttributes;
 	indexInfo->ii_Expressions = NIL;
 	indexInfo->ii_ExpressionsState = NIL;
 	indexInfo->ii_PredicateState = NIL;
@@ -203,11 +205,13 @@ CheckIndexCompatible(Oid oldId,
 	indexForm = (Form_pg_index) GETSTRUCT(tuple);
 
 	/*
-	 * We don't assess expressions or predicates; assume incompatibility.
-	 * Also, if the index is invalid for any reason, treat it as incompatible.
+	 * We don't assess expressions, predicates or INCLUDE columns; assume
+	 * incompatibility.  Also, if the index is invalid for any reason, treat
+	 * it as incompatible.
 	 */
 	if (!(heap_attisnull(tuple, Anum_pg_index_indpred) &&
 		  heap_attisnull(tuple, Anum_pg_index_indexprs) &&
+		  indexForm->indnkeyatts == indexForm->indnatts &&
 		  IndexIsValid(indexForm)))
 	{
 		ReleaseSysCache(tuple);
@@ -316,6 +320,7 @@ DefineIndex(IndexStmt *stmt,
 	Oid			namespaceId;
 	Oid			tablespaceId;
 	List	   *indexColNames;
+	List	   *allIndexParams;
 	Relation	rel;
 	Relation	indexRelation;
 	HeapTuple	tuple;
@@ -326,6 +331,7 @@ DefineIndex(IndexStmt *stmt,
 	int16	   *coloptions;
 	IndexInfo  *indexInfo;
 	int			numberOfAttributes;
+	int			numberOfKeyAttributes;
 	TransactionId limitXmin;
 	VirtualTransactionId *old_lockholders;
 	VirtualTransactionId *old_snapshots;
@@ -336,13 +342,21 @@ DefineIndex(IndexStmt *stmt,
 	int			i;
 
 	/*
-	 * count attributes in index
+	 * count key attributes in index
 	 */
-	numberOfAttributes = list_length(stmt->indexParams);
-	if (numberOfAttributes <= 0)
+	numberOfKeyAttributes = list_length(stmt->indexParams);
+	if (numberOfKeyAttributes <= 0)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
 				 errmsg("must specify at least one column")));
+
+	/*
+	 * INCLUDE columns follow the key columns, and count against the same
+	 * limit.  From here on allIndexParams describes every column.
+	 */
+	allIndexParams = list_concat(list_copy(stmt->indexParams),
+								 list_copy(stmt->indexIncludingParams));
+	numberOfAttributes = list_length(allIndexParams);
 	if (numberOfAttributes > INDEX_MAX_KEYS)
 		ereport(ERROR,
 				(errcode(ERRCODE_TOO_MANY_COLUMNS),
@@ -448,7 +462,7 @@ DefineIndex(IndexStmt *stmt,
 	/*
 	 * Choose the index column names.
 	 */
-	indexColNames = ChooseIndexColumnNames(stmt->indexParams);
+	indexColNames = ChooseIndexColumnNames(allIndexParams);
 
 	/*
 	 * Select name for index if caller didn't specify
@@ -495,11 +509,20 @@ DefineIndex(IndexStmt *stmt,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 			   errmsg("access method \"%s\" does not support unique indexes",
 					  accessMethodName)));
-	if (numberOfAttributes > 1 && !accessMethodForm->amcanmulticol)
+	if (numberOfKeyAttributes > 1 && !accessMethodForm->amcanmulticol)
 		ereport(ERROR,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 		  errmsg("access method \"%s\" does not support multicolumn indexes",
 				 accessMethodName)));
+	if (stmt->indexIncludingParams != NIL && !accessMethodForm->amcaninclude)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("access method \"%s\" does not support included columns",
+						accessMethodName)));
+	if (stmt->indexIncludingParams != NIL && stmt->excludeOpNames != NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("exclusion constraints do not support included columns")));
 	if (stmt->excludeOpNames && !OidIsValid(accessMethodForm->amgettuple))
 		ereport(ERROR,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
@@ -531,6 +554,7 @@ DefineIndex(IndexStmt *stmt,
 	 */
 	indexInfo = makeNode(IndexInfo);
 	indexInfo->ii_NumIndexAttrs = numberOfAttributes;
+	indexInfo->ii_NumIndexKeyAttrs = numberOfKeyAttributes;
 	indexInfo->ii_Expressions = NIL;	/* for now */
 	indexInfo->ii_ExpressionsState = NIL;
 	indexInfo->ii_Predicate = make_ands_implicit((Expr *) stmt->whereClause);
@@ -550,7 +574,7 @@ DefineIndex(IndexStmt *stmt,
 	coloptions = (int16 *) palloc(numberOfAttributes * sizeof(int16));
 	ComputeIndexAttrs(indexInfo,
 					  typeObjectId, collationObjectId, classObjectId,
-					  coloptions, stmt->indexParams,
+					  coloptions, allIndexParams,
 					  stmt->excludeOpNames, relationId,
 					  accessMethodName, accessMethodId,
 					  amcanorder, stmt->isconstraint);
@@ -561,8 +585,11 @@ DefineIndex(IndexStmt *stmt,
 	{
 		List *indexAttrs = NIL;
 
-		/* Prepare call for shippability evaluation */
-		for (i = 0; i < indexInfo->ii_NumIndexAttrs; i++)
+		/*
+		 * Prepare call for shippability evaluation.  INCLUDE columns take no
+		 * part in uniqueness, so only key columns are passed.
+		 */
+		for (i = 0; i < indexInfo->ii_NumIndexKeyAttrs; i++)
 		{
 			/*
 			 * Expression attributes are set at 0, and do not make sense
@@ -975,6 +1002,10 @@ CheckPredicate(Expr *predicate)
 /*
  * Compute per-index-column information, including indexed column numbers
  * or index expressions, opclasses, and indoptions.
+ *
+ * attList covers every column of the index; those past
+ * indexInfo->ii_NumIndexKeyAttrs are INCLUDE columns, which must be simple
+ * columns and get no collation, opclass or options.
  */
 static void
 ComputeIndexAttrs(IndexInfo *indexInfo,
@@ -993,6 +1024,7 @@ ComputeIndexAttrs(IndexInfo *indexInfo,
 	ListCell   *nextExclOp;
 	ListCell   *lc;
 	int			attn;
+	int			nkeycols = indexInfo->ii_NumIndexKeyAttrs;
 
 	/* Allocate space for exclusion operator info, if needed */
 	if (exclusionOpNames)
@@ -1021,6 +1053,11 @@ ComputeIndexAttrs(IndexInfo *indexInfo,
 		/*
 		 * Process the column-or-expression to be indexed.
 		 */
+		if (attn >= nkeycols && attribute->name == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("expressions are not supported in included columns")));
+
 		if (attribute->name != NULL)
 		{
 			/* Simple index attribute */
@@ -1101,6 +1138,33 @@ ComputeIndexAttrs(IndexInfo *indexInfo,
 
 		typeOidP[attn] = atttype;
 
+		/*
+		 * INCLUDE columns are only stored, never compared, so they need
+		 * nothing more.
+		 */
+		if (attn >= nkeycols)
+		{
+			if (attribute->collation)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("included columns do not support collations")));
+			if (attribute->opclass)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("included columns do not support operator classes")));
+			if (attribute->ordering != SORTBY_DEFAULT ||
+				attribute->nulls_ordering != SORTBY_NULLS_DEFAULT)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("included columns do not support ASC/DESC or NULLS FIRST/LAST options")));
+
+			collationOidP[attn] = InvalidOid;
+			classOidP[attn] = InvalidOid;
+			colOptionP[attn] = 0;
+			attn++;
+			continue;
+		}
+
 		/*
 		 * Apply collation override if any
 		 */
@@ -23,6 +23,16 @@
  * of index scans performed.  So we don't use maintenance_work_mem memory for
  * the TID array, just enough to hold as many heap tuples as fit on one page.
  *
+ * On a Datanode, the indexes of a table may be vacuumed by parallel workers
+ * (see execParallel.c) while the heap scan waits.  The dead tuple array then
+ * lives in a shared memory area of parallel_vacuum_mem kilobytes instead of
+ * backend-local memory; there is only one such area, so only one VACUUM at a
+ * time can use parallel workers, and the others vacuum their indexes alone.
+ * So does a VACUUM whose dead tuple array would not fit in the area, since a
+ * smaller array would only mean more index passes than vacuuming serially.
+ * The leader and the workers each take the next index not yet taken, and
+ * the leader keeps the statistics the index AMs return.
+ *
  *
  * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -59,6 +69,15 @@
 #include "utils/pg_rusage.h"
 #include "utils/timestamp.h"
 #include "utils/tqual.h"
+#ifdef PGXC
+#include "access/xact.h"
+#include "executor/execParallel.h"
+#include "pgxc/pgxc.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "utils/rel.h"
+#endif
 
 
 /*
@@ -103,6 +122,7 @@ typedef struct LVRelStats
 	BlockNumber old_rel_pages;	/* previous value of pg_class.relpages */
 	BlockNumber rel_pages;		/* total number of pages */
 	BlockNumber scanned_pages;	/* number of pages we examined */
+	BlockNumber frozenskipped_pages;	/* # of frozen pages we skipped */
 	double		scanned_tuples; /* counts only tuples on scanned pages */
 	double		old_rel_tuples; /* previous value of pg_class.reltuples */
 	double		new_rel_tuples; /* new estimated total # of tuples */
@@ -117,8 +137,61 @@ typedef struct LVRelStats
 	int			num_index_scans;
 	TransactionId latestRemovedXid;
 	bool		lock_waiter_detected;
+#ifdef PGXC
+	int			parallel_workers;	/* workers to vacuum indexes with */
+#endif
 } LVRelStats;
 
+#ifdef PGXC
+/*
+ * Shared state of a parallel index vacuum.  The part describing a pass over
+ * the indexes is set by the leader before it starts the workers, and only
+ * read by them.  Each index is vacuumed by whoever takes it from nextindex,
+ * who alone writes its stats until the pass ends.
+ */
+#define PARALLEL_VACUUM_MAX_INDEXES		256
+
+typedef struct LVSharedIndex
+{
+	Oid			indexoid;
+	bool		has_stats;		/* is stats valid? */
+	IndexBulkDeleteResult stats;
+} LVSharedIndex;
+
+typedef struct LVShared
+{
+	slock_t		mutex;			/* protects in_use and nextindex */
+	bool		in_use;			/* area belongs to a VACUUM */
+	int			nextindex;		/* next index to vacuum */
+
+	/* the current pass */
+	Oid			heapoid;
+	bool		for_cleanup;	/* index_vacuum_cleanup or index_bulk_delete */
+	bool		estimated_count;
+	double		num_heap_tuples;
+	int			cost_delay;
+	int			cost_limit;
+	int			nindexes;
+	LVSharedIndex indexes[PARALLEL_VACUUM_MAX_INDEXES];
+
+	/* dead tuples, sorted by TID */
+	int			num_dead_tuples;
+	int			max_dead_tuples;
+	ItemPointerData dead_tuples[FLEXIBLE_ARRAY_MEMBER];
+} LVShared;
+
+/* GUC parameters */
+int			parallel_vacuum_workers = 0;
+int			parallel_vacuum_mem = 16384;
+
+static LVShared *LVSharedArea = NULL;
+
+/* state of this backend while it holds the area */
+static bool LVSharedHeld = false;
+static ParallelGroup *LVParallelGroup = NULL;
+static bool LVCallbackRegistered = false;
+#endif
+
 
 /* A few variables that don't seem worth passing around as parameters */
 static int	elevel = -1;
@@ -146,13 +219,27 @@ static int lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 static void lazy_truncate_heap(Relation onerel, LVRelStats *vacrelstats);
 static BlockNumber count_nondeletable_pages(Relation onerel,
 						 LVRelStats *vacrelstats);
-static void lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks);
+static void lazy_space_alloc(Relation onerel, LVRelStats *vacrelstats,
+				 BlockNumber relblocks, int nindexes);
+static void lazy_report_index_cleanup(Relation indrel,
+						  IndexBulkDeleteResult *stats, PGRUsage *ru0);
+#ifdef PGXC
+static int	parallel_vacuum_degree(Relation onerel, int nindexes);
+static bool lazy_shared_claim(void);
+static void lazy_shared_release(void);
+static void lazy_shared_xact_callback(XactEvent event, void *arg);
+static void lazy_vacuum_indexes_parallel(Relation *Irel, int nindexes,
+							 IndexBulkDeleteResult **indstats,
+							 LVRelStats *vacrelstats, bool for_cleanup);
+static int	lazy_next_index(LVShared *shared);
+static void lazy_vacuum_shared_index(Relation indrel, LVSharedIndex *sindex,
+						 LVRelStats *vacrelstats, int message_level);
+#endif
 static void lazy_record_dead_tuple(LVRelStats *vacrelstats,
 					   ItemPointer itemptr);
 static bool lazy_tid_reaped(ItemPointer itemptr, void *state);
-static int	vac_cmp_itemptr(const void *left, const void *right);
 static bool heap_page_is_all_visible(Buffer buf,
-						 TransactionId *visibility_cutoff_xid);
+						 TransactionId *visibility_cutoff_xid, bool *all_frozen);
 
 
 /*
@@ -224,6 +311,9 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 
 	/* Done with indexes */
 	vac_close_indexes(nindexes, Irel, NoLock);
+#ifdef PGXC
+	lazy_shared_release();
+#endif
 
 	/*
 	 * Optionally truncate the relation.
@@ -265,16 +355,23 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 		new_rel_tuples = vacrelstats->old_rel_tuples;
 	}
 
-	new_rel_allvisible = visibilitymap_count(onerel);
+	visibilitymap_count(onerel, &new_rel_allvisible, NULL);
 	if (new_rel_allvisible > new_rel_pages)
 		new_rel_allvisible = new_rel_pages;
 
+	/*
+	 * Pages skipped because they are all-frozen contain no XIDs or
+	 * MultiXactIds at all, so they don't prevent advancing relfrozenxid and
+	 * relminmxid.
+	 */
 	new_frozen_xid = FreezeLimit;
-	if (vacrelstats->scanned_pages < vacrelstats->rel_pages)
+	if ((vacrelstats->scanned_pages + vacrelstats->frozenskipped_pages)
+		< vacrelstats->rel_pages)
 		new_frozen_xid = InvalidTransactionId;
 
 	new_min_multi = MultiXactFrzLimit;
-	if (vacrelstats->scanned_pages < vacrelstats->rel_pages)
+	if ((vacrelstats->scanned_pages + vacrelstats->frozenskipped_pages)
+		< vacrelstats->rel_pages)
 		new_min_multi = InvalidMultiXactId;
 
 	vac_update_relstats(onerel,
@@ -401,8 +498,8 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 	int			i;
 	PGRUsage	ru0;
 	Buffer		vmbuffer = InvalidBuffer;
-	BlockNumber next_not_all_visible_block;
-	bool		skipping_all_visible_blocks;
+	BlockNumber next_unskippable_block;
+	bool		skipping_blocks;
 
 	pg_rusage_init(&ru0);
 
@@ -421,10 +518,11 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 	nblocks = RelationGetNumberOfBlocks(onerel);
 	vacrelstats->rel_pages = nblocks;
 	vacrelstats->scanned_pages = 0;
+	vacrelstats->frozenskipped_pages = 0;
 	vacrelstats->nonempty_pages = 0;
 	vacrelstats->latestRemovedXid = InvalidTransactionId;
 
-	lazy_space_alloc(vacrelstats, nblocks);
+	lazy_space_alloc(onerel, vacrelstats, nblocks, nindexes);
 
 	/*
 	 * We want to skip pages that don't require vacuuming according to the
@@ -432,43 +530,64 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 	 * consecutive pages.  Since we're reading sequentially, the OS should be
 	 * doing readahead for us, so there's no gain in skipping a page now and
 	 * then; that's likely to disable readahead and so be counterproductive.
-	 * Also, skipping even a single page means that we can't update
-	 * relfrozenxid, so we only want to do it if we can skip a goodly number
-	 * of pages.
+	 * Also, skipping even a single page that is not all-frozen means that we
+	 * can't update relfrozenxid, so we only want to do it if we can skip a
+	 * goodly number of pages.
+	 *
+	 * When scan_all is set, we can't skip pages just because they are
+	 * all-visible, but we can still skip pages that are all-frozen, since
+	 * such pages contain no XIDs that could need freezing.  In an
+	 * append-mostly table that makes an anti-wraparound vacuum cost roughly
+	 * as much as the pages modified since the last one, rather than the
+	 * whole table.
 	 *
 	 * Before entering the main loop, establish the invariant that
-	 * next_not_all_visible_block is the next block number >= blkno that's not
-	 * all-visible according to the visibility map, or nblocks if there's no
-	 * such block.	Also, we set up the skipping_all_visible_blocks flag,
-	 * which is needed because we need hysteresis in the decision: once we've
-	 * started skipping blocks, we may as well skip everything up to the next
+	 * next_unskippable_block is the next block number >= blkno that we can't
+	 * skip based on the visibility map, either all-visible for a regular scan
+	 * or all-frozen for a scan_all vacuum, or nblocks if there's no such
+	 * block.  We also set up the skipping_blocks flag, which is needed
+	 * because we need hysteresis in the decision: once we've started
+	 * skipping blocks, we may as well skip everything up to the next
 	 * not-all-visible block.
 	 *
-	 * Note: if scan_all is true, we won't actually skip any pages; but we
-	 * maintain next_not_all_visible_block anyway, so as to set up the
-	 * all_visible_according_to_vm flag correctly for each page.
-	 *
-	 * Note: The value returned by visibilitymap_test could be slightly
+	 * Note: The value returned by visibilitymap_get_status could be slightly
 	 * out-of-date, since we make this test before reading the corresponding
 	 * heap page or locking the buffer.  This is OK.  If we mistakenly think
-	 * that the page is all-visible when in fact the flag's just been cleared,
-	 * we might fail to vacuum the page.  But it's OK to skip pages when
-	 * scan_all is not set, so no great harm done; the next vacuum will find
-	 * them.  If we make the reverse mistake and vacuum a page unnecessarily,
-	 * it'll just be a no-op.
+	 * that the page is all-visible or all-frozen when in fact the flag's just
+	 * been cleared, we might fail to vacuum the page.  It's easy to see that
+	 * skipping a page when scan_all is not set is not a very big deal; we
+	 * might leave some dead tuples lying around, but the next vacuum will
+	 * find them.  But even when scan_all *is* set, it's still OK if we miss a
+	 * page whose all-frozen marking has just been cleared.  Any new XIDs just
+	 * added to that page are necessarily newer than the GlobalXmin we
+	 * computed, so they'll have no effect on the value to which we can safely
+	 * set relfrozenxid.  A similar argument applies for MXIDs and relminmxid.
 	 */
-	for (next_not_all_visible_block = 0;
-		 next_not_all_visible_block < nblocks;
-		 next_not_all_visible_block++)
+	for (next_unskippable_block = 0;
+		 next_unskippable_block < nblocks;
+		 next_unskippable_block++)
 	{
-		if (!visibilitymap_test(onerel, next_not_all_visible_block, &vmbuffer))
-			break;
+		uint8		vmstatus;
+
+		vmstatus = visibilitymap_get_status(onerel, next_unskippable_block,
+											&vmbuffer);
+		if (scan_all)
+		{
+			if ((vmstatus & VISIBILITYMAP_ALL_FROZEN) == 0)
+				break;
+		}
+		else
+		{
+			if ((vmstatus & VISIBILITYMAP_ALL_VISIBLE) == 0)
+				break;
+		}
 		vacuum_delay_point();
 	}
-	if (next_not_all_visible_block >= SKIP_PAGES_THRESHOLD)
-		skipping_all_visible_blocks = true;
+
+	if (next_unskippable_block >= SKIP_PAGES_THRESHOLD)
+		skipping_blocks = true;
 	else
-		skipping_all_visible_blocks = false;
+		skipping_blocks = false;
 
 	for (blkno = 0; blkno < nblocks; blkno++)
 	{
@@ -482,40 +601,79 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		OffsetNumber frozen[MaxOffsetNumber];
 		int			nfrozen;
 		Size		freespace;
-		bool		all_visible_according_to_vm;
+		bool		all_visible_according_to_vm = false;
 		bool		all_visible;
+		bool		all_frozen = true;	/* provided all_visible is also true */
 		bool		has_dead_tuples;
 		TransactionId visibility_cutoff_xid = InvalidTransactionId;
 
-		if (blkno == next_not_all_visible_block)
+		if (blkno == next_unskippable_block)
 		{
-			/* Time to advance next_not_all_visible_block */
-			for (next_not_all_visible_block++;
-				 next_not_all_visible_block < nblocks;
-				 next_not_all_visible_block++)
+			/* Time to advance next_unskippable_block */
+			for (next_unskippable_block++;
+				 next_unskippable_block < nblocks;
+				 next_unskippable_block++)
 			{
-				if (!visibilitymap_test(onerel, next_not_all_visible_block,
-										&vmbuffer))
-					break;
+				uint8		vmskipflags;
+
+				vmskipflags = visibilitymap_get_status(onerel,
+													   next_unskippable_block,
+													   &vmbuffer);
+				if (scan_all)
+				{
+					if ((vmskipflags & VISIBILITYMAP_ALL_FROZEN) == 0)
+						break;
+				}
+				else
+				{
+					if ((vmskipflags & VISIBILITYMAP_ALL_VISIBLE) == 0)
+						break;
+				}
 				vacuum_delay_point();
 			}
 
 			/*
 			 * We know we can't skip the current block.  But set up
-			 * skipping_all_visible_blocks to do the right thing at the
-			 * following blocks.
+			 * skipping_blocks to do the right thing at the following blocks.
 			 */
-			if (next_not_all_visible_block - blkno > SKIP_PAGES_THRESHOLD)
-				skipping_all_visible_blocks = true;
+			if (next_unskippable_block - blkno > SKIP_PAGES_THRESHOLD)
+				skipping_blocks = true;
 			else
-				skipping_all_visible_blocks = false;
-			all_visible_according_to_vm = false;
+				skipping_blocks = false;
+
+			/*
+			 * Normally, the fact that we can't skip this block must mean that
+			 * it's not all-visible.  But in a scan_all vacuum we know only
+			 * that it's not all-frozen, so it might still be all-visible.
+			 */
+			if (scan_all && VM_ALL_VISIBLE(onerel, blkno, &vmbuffer))
+				all_visible_according_to_vm = true;
 		}
 		else
 		{
-			/* Current block is all-visible */
-			if (skipping_all_visible_blocks && !scan_all)
+			/*
+			 * The current block is potentially skippable; if we've seen a
+			 * long enough run of skippable blocks to justify skipping it,
+			 * then go ahead and skip.  Otherwise, the page must be at least
+			 * all-visible if not all-frozen, so we can set
+			 * all_visible_according_to_vm = true.
+			 */
+			if (skipping_blocks)
+			{
+				/*
+				 * Tricky, tricky.  If this is a scan_all vacuum, the page
+				 * must have been all-frozen at the time we checked whether it
+				 * was skippable, but it might not be any more.  We must be
+				 * careful to count it as a skipped all-frozen page in that
+				 * case, or else we'll think we can't update relfrozenxid and
+				 * relminmxid.  If it's not a scan_all vacuum, we don't know
+				 * whether it was all-frozen, so we have to recheck; but in
+				 * this case an approximate answer is OK.
+				 */
+				if (scan_all || VM_ALL_FROZEN(onerel, blkno, &vmbuffer))
+					vacrelstats->frozenskipped_pages++;
 				continue;
+			}
 			all_visible_according_to_vm = true;
 		}
 
@@ -544,6 +702,12 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			vacuum_log_cleanup_info(onerel, vacrelstats);
 
 			/* Remove index entries */
+#ifdef PGXC
+			if (vacrelstats->parallel_workers > 0)
+				lazy_vacuum_indexes_parallel(Irel, nindexes, indstats,
+											 vacrelstats, false);
+			else
+#endif
 			for (i = 0; i < nindexes; i++)
 				lazy_vacuum_index(Irel[i],
 								  &indstats[i],
@@ -564,9 +728,9 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * Pin the visibility map page in case we need to mark the page
 		 * all-visible.  In most cases this will be very cheap, because we'll
 		 * already have the correct page pinned anyway.  However, it's
-		 * possible that (a) next_not_all_visible_block is covered by a
-		 * different VM page than the current block or (b) we released our pin
-		 * and did a cycle of index vacuuming.
+		 * possible that (a) next_unskippable_block is covered by a different
+		 * VM page than the current block or (b) we released our pin and did
+		 * a cycle of index vacuuming.
 		 */
 		visibilitymap_pin(onerel, blkno, &vmbuffer);
 
@@ -684,7 +848,8 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 				PageSetAllVisible(page);
 				MarkBufferDirty(buf);
 				visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-								  vmbuffer, InvalidTransactionId);
+								  vmbuffer, InvalidTransactionId,
+						   VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
 			}
 
 			UnlockReleaseBuffer(buf);
@@ -869,6 +1034,10 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 				if (heap_freeze_tuple(tuple.t_data, FreezeLimit,
 									  MultiXactFrzLimit))
 					frozen[nfrozen++] = offnum;
+
+				/* Does the page still contain any unfrozen XIDs? */
+				if (all_frozen && !heap_tuple_is_frozen(tuple.t_data))
+					all_frozen = false;
 			}
 		}						/* scan along page */
 
@@ -914,6 +1083,11 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		/* mark page all-visible, if appropriate */
 		if (all_visible && !all_visible_according_to_vm)
 		{
+			uint8		flags = VISIBILITYMAP_ALL_VISIBLE;
+
+			if (all_frozen)
+				flags |= VISIBILITYMAP_ALL_FROZEN;
+
 			/*
 			 * It should never be the case that the visibility map page is set
 			 * while the page-level bit is clear, but the reverse is allowed
@@ -930,7 +1104,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			PageSetAllVisible(page);
 			MarkBufferDirty(buf);
 			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-							  vmbuffer, visibility_cutoff_xid);
+							  vmbuffer, visibility_cutoff_xid, flags);
 		}
 
 		/*
@@ -941,11 +1115,12 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * that something bad has happened.
 		 */
 		else if (all_visible_according_to_vm && !PageIsAllVisible(page)
-				 && visibilitymap_test(onerel, blkno, &vmbuffer))
+				 && VM_ALL_VISIBLE(onerel, blkno, &vmbuffer))
 		{
 			elog(WARNING, "page is not marked all-visible but visibility map bit is set in relation \"%s\" page %u",
 				 relname, blkno);
-			visibilitymap_clear(onerel, blkno, vmbuffer);
+			visibilitymap_clear(onerel, blkno, vmbuffer,
+								VISIBILITYMAP_VALID_BITS);
 		}
 
 		/*
@@ -967,7 +1142,24 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 				 relname, blkno);
 			PageClearAllVisible(page);
 			MarkBufferDirty(buf);
-			visibilitymap_clear(onerel, blkno, vmbuffer);
+			visibilitymap_clear(onerel, blkno, vmbuffer,
+								VISIBILITYMAP_VALID_BITS);
+		}
+
+		/*
+		 * If the all-visible page turned out to be all-frozen but is not
+		 * marked as such, mark it now.  Note that all_frozen is only valid
+		 * if all_visible is true, so we must check both.  The all-visible
+		 * bit is passed along too, so that the map never ends up with the
+		 * all-frozen bit set on its own.
+		 */
+		else if (all_visible_according_to_vm && all_visible && all_frozen &&
+				 PageIsAllVisible(page) &&
+				 !VM_ALL_FROZEN(onerel, blkno, &vmbuffer))
+		{
+			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
+							  vmbuffer, visibility_cutoff_xid,
+						   VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
 		}
 
 		UnlockReleaseBuffer(buf);
@@ -1014,6 +1206,12 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		vacuum_log_cleanup_info(onerel, vacrelstats);
 
 		/* Remove index entries */
+#ifdef PGXC
+		if (vacrelstats->parallel_workers > 0)
+			lazy_vacuum_indexes_parallel(Irel, nindexes, indstats,
+										 vacrelstats, false);
+		else
+#endif
 		for (i = 0; i < nindexes; i++)
 			lazy_vacuum_index(Irel[i],
 							  &indstats[i],
@@ -1024,6 +1222,12 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 	}
 
 	/* Do post-vacuum cleanup and statistics update for each index */
+#ifdef PGXC
+	if (vacrelstats->parallel_workers > 0)
+		lazy_vacuum_indexes_parallel(Irel, nindexes, indstats,
+									 vacrelstats, true);
+	else
+#endif
 	for (i = 0; i < nindexes; i++)
 		lazy_cleanup_index(Irel[i], indstats[i], vacrelstats);
 
@@ -1135,6 +1339,7 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 	OffsetNumber unused[MaxOffsetNumber];
 	int			uncnt = 0;
 	TransactionId visibility_cutoff_xid;
+	bool		all_frozen;
 
 	START_CRIT_SECTION();
 
@@ -1165,15 +1370,20 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 
 	/*
 	 * Now that we have removed the dead tuples from the page, once again
-	 * check if the page has become all-visible.
+	 * check if the page has become all-visible, and possibly all-frozen.
 	 */
-	if (!visibilitymap_test(onerel, blkno, vmbuffer) &&
-		heap_page_is_all_visible(buffer, &visibility_cutoff_xid))
+	if (!VM_ALL_FROZEN(onerel, blkno, vmbuffer) &&
+		heap_page_is_all_visible(buffer, &visibility_cutoff_xid, &all_frozen))
 	{
+		uint8		flags = VISIBILITYMAP_ALL_VISIBLE;
+
+		if (all_frozen)
+			flags |= VISIBILITYMAP_ALL_FROZEN;
+
 		Assert(BufferIsValid(*vmbuffer));
 		PageSetAllVisible(page);
 		visibilitymap_set(onerel, blkno, buffer, InvalidXLogRecPtr, *vmbuffer,
-						  visibility_cutoff_xid);
+						  visibility_cutoff_xid, flags);
 	}
 
 	/* XLOG stuff */
@@ -1297,6 +1507,19 @@ lazy_cleanup_index(Relation indrel,
 	if (!stats)
 		return;
 
+	lazy_report_index_cleanup(indrel, stats, &ru0);
+
+	pfree(stats);
+}
+
+/*
+ *	lazy_report_index_cleanup() -- update and report the statistics of an
+ *		index after its cleanup.
+ */
+static void
+lazy_report_index_cleanup(Relation indrel, IndexBulkDeleteResult *stats,
+						  PGRUsage *ru0)
+{
 	/*
 	 * Now update statistics in pg_class, but only if the index says the count
 	 * is accurate.
@@ -1320,9 +1543,7 @@ lazy_cleanup_index(Relation indrel,
 					   "%s.",
 					   stats->tuples_removed,
 					   stats->pages_deleted, stats->pages_free,
-					   pg_rusage_show(&ru0))));
-
-	pfree(stats);
+					   pg_rusage_show(ru0))));
 }
 
 /*
@@ -1571,7 +1792,8 @@ count_nondeletable_pages(Relation onerel, LVRelStats *vacrelstats)
  * See the comments at the head of this file for rationale.
  */
 static void
-lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks)
+lazy_space_alloc(Relation onerel, LVRelStats *vacrelstats,
+				 BlockNumber relblocks, int nindexes)
 {
 	long		maxtuples;
 
@@ -1594,6 +1816,28 @@ lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks)
 	}
 
 	vacrelstats->num_dead_tuples = 0;
+
+#ifdef PGXC
+	/*
+	 * Put the dead tuples where parallel workers can see them, if they all
+	 * fit there.  The size of the area is fixed at startup, so it can be
+	 * checked before claiming it.
+	 */
+	vacrelstats->parallel_workers = parallel_vacuum_degree(onerel, nindexes);
+	if (vacrelstats->parallel_workers > 0 &&
+		maxtuples <= LVSharedArea->max_dead_tuples &&
+		lazy_shared_claim())
+	{
+		LVShared   *shared = LVSharedArea;
+
+		shared->heapoid = RelationGetRelid(onerel);
+		vacrelstats->max_dead_tuples = (int) maxtuples;
+		vacrelstats->dead_tuples = shared->dead_tuples;
+		return;
+	}
+	vacrelstats->parallel_workers = 0;
+#endif
+
 	vacrelstats->max_dead_tuples = (int) maxtuples;
 	vacrelstats->dead_tuples = (ItemPointer)
 		palloc(maxtuples * sizeof(ItemPointerData));
@@ -1618,65 +1862,442 @@ lazy_record_dead_tuple(LVRelStats *vacrelstats,
 	}
 }
 
+/*
+ * Encode an item pointer as an integer that sorts the same way, so that
+ * lazy_tid_reaped can compare TIDs with plain integer comparisons.
+ */
+static inline int64
+vac_itemptr_encode(ItemPointer itemptr)
+{
+	return ((int64) ItemPointerGetBlockNumber(itemptr) << 16) |
+		(int64) ItemPointerGetOffsetNumber(itemptr);
+}
+
 /*
  *	lazy_tid_reaped() -- is a particular tid deletable?
  *
  *		This has the right signature to be an IndexBulkDeleteCallback.
  *
  *		Assumes dead_tuples array is in sorted order.
+ *
+ *		This is called once for every tuple of every index of the table, so
+ *		it is worth some effort: TIDs outside the range of collected dead
+ *		tuples are rejected right away, which is the common case when the
+ *		dead tuples are concentrated in part of the heap, and the binary
+ *		search compares integers inline instead of calling a comparator
+ *		through bsearch().
  */
 static bool
 lazy_tid_reaped(ItemPointer itemptr, void *state)
 {
 	LVRelStats *vacrelstats = (LVRelStats *) state;
-	ItemPointer res;
+	ItemPointer dead_tuples = vacrelstats->dead_tuples;
+	int64		key;
+	int			lo,
+				hi;
+
+	if (vacrelstats->num_dead_tuples == 0)
+		return false;
+
+	key = vac_itemptr_encode(itemptr);
 
-	res = (ItemPointer) bsearch((void *) itemptr,
-								(void *) vacrelstats->dead_tuples,
-								vacrelstats->num_dead_tuples,
-								sizeof(ItemPointerData),
-								vac_cmp_itemptr);
+	lo = 0;
+	hi = vacrelstats->num_dead_tuples - 1;
 
-	return (res != NULL);
+	/* Quick exit if the TID is outside the range of dead tuples */
+	if (key < vac_itemptr_encode(&dead_tuples[lo]) ||
+		key > vac_itemptr_encode(&dead_tuples[hi]))
+		return false;
+
+	while (lo <= hi)
+	{
+		int			mid = lo + (hi - lo) / 2;
+		int64		midkey = vac_itemptr_encode(&dead_tuples[mid]);
+
+		if (midkey < key)
+			lo = mid + 1;
+		else if (midkey > key)
+			hi = mid - 1;
+		else
+			return true;
+	}
+
+	return false;
 }
 
+#ifdef PGXC
+/* ----------------------------------------------------------------
+ *		Parallel index vacuum
+ * ----------------------------------------------------------------
+ */
+
 /*
- * Comparator routines for use with qsort() and bsearch().
+ * The shared area exists only on a Datanode with parallel workers.
+ */
+Size
+LazyVacuumShmemSize(void)
+{
+	if (!IS_PGXC_DATANODE || max_parallel_scan_workers == 0 ||
+		parallel_vacuum_mem == 0)
+		return 0;
+
+	return Max(mul_size(parallel_vacuum_mem, 1024),
+			   offsetof(LVShared, dead_tuples) +
+			   MaxHeapTuplesPerPage * sizeof(ItemPointerData));
+}
+
+void
+LazyVacuumShmemInit(void)
+{
+	Size		size = LazyVacuumShmemSize();
+	bool		found;
+
+	if (size == 0)
+		return;
+
+	LVSharedArea = (LVShared *)
+		ShmemInitStruct("Parallel Vacuum Area", size, &found);
+
+	if (!found)
+	{
+		SpinLockInit(&LVSharedArea->mutex);
+		LVSharedArea->in_use = false;
+		LVSharedArea->nextindex = 0;
+		LVSharedArea->nindexes = 0;
+		LVSharedArea->max_dead_tuples = (int)
+			Min((size - offsetof(LVShared, dead_tuples)) / sizeof(ItemPointerData),
+				INT_MAX);
+	}
+}
+
+/*
+ * parallel_vacuum_degree - how many workers vacuum the indexes of a table
+ *
+ * The parallel_vacuum_workers storage parameter of the table comes first,
+ * then autovacuum_parallel_vacuum_workers in an autovacuum worker, then the
+ * parallel_vacuum_workers setting.  It takes at least two indexes for a
+ * worker to have something to do alongside us.
  */
 static int
-vac_cmp_itemptr(const void *left, const void *right)
+parallel_vacuum_degree(Relation onerel, int nindexes)
 {
-	BlockNumber lblk,
-				rblk;
-	OffsetNumber loff,
-				roff;
+	int			nworkers = -1;
 
-	lblk = ItemPointerGetBlockNumber((ItemPointer) left);
-	rblk = ItemPointerGetBlockNumber((ItemPointer) right);
+	if (LVSharedArea == NULL || nindexes < 2 ||
+		nindexes > PARALLEL_VACUUM_MAX_INDEXES)
+		return 0;
 
-	if (lblk < rblk)
-		return -1;
-	if (lblk > rblk)
-		return 1;
+	if (onerel->rd_options != NULL)
+		nworkers = ((StdRdOptions *) onerel->rd_options)->parallel_vacuum_workers;
+	if (nworkers < 0 && IsAutoVacuumWorkerProcess())
+		nworkers = autovacuum_parallel_vacuum_workers;
+	if (nworkers < 0)
+		nworkers = parallel_vacuum_workers;
 
-	loff = ItemPointerGetOffsetNumber((ItemPointer) left);
-	roff = ItemPointerGetOffsetNumber((ItemPointer) right);
+	return Min(nworkers, nindexes - 1);
+}
 
-	if (loff < roff)
-		return -1;
-	if (loff > roff)
-		return 1;
+/*
+ * Take the shared area for this VACUUM, if no other VACUUM has it.
+ */
+static bool
+lazy_shared_claim(void)
+{
+	LVShared   *shared = LVSharedArea;
+	bool		claimed = false;
+
+	SpinLockAcquire(&shared->mutex);
+	if (!shared->in_use)
+	{
+		shared->in_use = true;
+		shared->nindexes = 0;
+		shared->nextindex = 0;
+		claimed = true;
+	}
+	SpinLockRelease(&shared->mutex);
+
+	if (!claimed)
+		return false;
+
+	/* from now on, an error leaves the area to the callback */
+	LVSharedHeld = true;
+	if (!LVCallbackRegistered)
+	{
+		RegisterXactCallback(lazy_shared_xact_callback, NULL);
+		LVCallbackRegistered = true;
+	}
+
+	return true;
+}
+
+/*
+ * Give the shared area back, after stopping any worker still using it.
+ * This is also called at transaction abort, so it must not throw an error.
+ */
+static void
+lazy_shared_release(void)
+{
+	LVShared   *shared = LVSharedArea;
+
+	if (!LVSharedHeld)
+		return;
+
+	/* workers take no more indexes */
+	SpinLockAcquire(&shared->mutex);
+	shared->nextindex = shared->nindexes;
+	SpinLockRelease(&shared->mutex);
+
+	if (LVParallelGroup != NULL)
+	{
+		ExecParallelFinish(LVParallelGroup);
+		LVParallelGroup = NULL;
+	}
+
+	SpinLockAcquire(&shared->mutex);
+	shared->in_use = false;
+	SpinLockRelease(&shared->mutex);
 
-	return 0;
+	LVSharedHeld = false;
+}
+
+static void
+lazy_shared_xact_callback(XactEvent event, void *arg)
+{
+	lazy_shared_release();
 }
 
+/*
+ * lazy_vacuum_indexes_parallel() -- vacuum or clean up all the indexes of a
+ *		table, together with parallel workers.
+ *
+ *		The workers open the indexes themselves; we report on all of them
+ *		once they are done, as lazy_vacuum_index and lazy_cleanup_index do.
+ */
+static void
+lazy_vacuum_indexes_parallel(Relation *Irel, int nindexes,
+							 IndexBulkDeleteResult **indstats,
+							 LVRelStats *vacrelstats, bool for_cleanup)
+{
+	LVShared   *shared = LVSharedArea;
+	PGRUsage	ru0;
+	int			i;
+
+	pg_rusage_init(&ru0);
+
+	/* no worker looks at the pass before it is started */
+	shared->for_cleanup = for_cleanup;
+	if (for_cleanup)
+	{
+		shared->estimated_count =
+			(vacrelstats->scanned_pages < vacrelstats->rel_pages);
+		shared->num_heap_tuples = vacrelstats->new_rel_tuples;
+	}
+	else
+	{
+		shared->estimated_count = true;
+		shared->num_heap_tuples = vacrelstats->old_rel_tuples;
+	}
+	shared->cost_delay = VacuumCostActive ? VacuumCostDelay : 0;
+	shared->cost_limit = VacuumCostLimit;
+	shared->num_dead_tuples = vacrelstats->num_dead_tuples;
+	for (i = 0; i < nindexes; i++)
+	{
+		LVSharedIndex *sindex = &shared->indexes[i];
+
+		sindex->indexoid = RelationGetRelid(Irel[i]);
+		sindex->has_stats = (indstats[i] != NULL);
+		if (sindex->has_stats)
+			memcpy(&sindex->stats, indstats[i], sizeof(IndexBulkDeleteResult));
+	}
+
+	SpinLockAcquire(&shared->mutex);
+	shared->nindexes = nindexes;
+	shared->nextindex = 0;
+	SpinLockRelease(&shared->mutex);
+
+	LVParallelGroup = ExecParallelBeginJob(PJOB_INDEX_VACUUM,
+										   vacrelstats->parallel_workers);
+
+	/* do our part of the work */
+	while ((i = lazy_next_index(shared)) >= 0)
+		lazy_vacuum_shared_index(Irel[i], &shared->indexes[i],
+								 vacrelstats, elevel);
+
+	ExecParallelWaitAll(LVParallelGroup);
+	ExecParallelFinish(LVParallelGroup);
+	LVParallelGroup = NULL;
+
+	for (i = 0; i < nindexes; i++)
+	{
+		LVSharedIndex *sindex = &shared->indexes[i];
+
+		if (!sindex->has_stats)
+		{
+			if (indstats[i] != NULL)
+				pfree(indstats[i]);
+			indstats[i] = NULL;
+		}
+		else
+		{
+			if (indstats[i] == NULL)
+				indstats[i] = (IndexBulkDeleteResult *)
+					palloc(sizeof(IndexBulkDeleteResult));
+			memcpy(indstats[i], &sindex->stats, sizeof(IndexBulkDeleteResult));
+		}
+
+		if (!for_cleanup)
+			ereport(elevel,
+					(errmsg("scanned index \"%s\" to remove %d row versions",
+							RelationGetRelationName(Irel[i]),
+							vacrelstats->num_dead_tuples),
+					 errdetail("%s.", pg_rusage_show(&ru0))));
+		else if (indstats[i] != NULL)
+		{
+			lazy_report_index_cleanup(Irel[i], indstats[i], &ru0);
+			pfree(indstats[i]);
+			indstats[i] = NULL;
+		}
+	}
+}
+
+/*
+ * Take the next index of the current pass, or return -1 if none is left.
+ */
+static int
+lazy_next_index(LVShared *shared)
+{
+	int			i = -1;
+
+	SpinLockAcquire(&shared->mutex);
+	if (shared->nextindex < shared->nindexes)
+		i = shared->nextindex++;
+	SpinLockRelease(&shared->mutex);
+
+	return i;
+}
+
+/*
+ *	lazy_vacuum_shared_index() -- vacuum or clean up one index for the
+ *		current pass, leaving its statistics in the shared area.
+ */
+static void
+lazy_vacuum_shared_index(Relation indrel, LVSharedIndex *sindex,
+						 LVRelStats *vacrelstats, int message_level)
+{
+	LVShared   *shared = LVSharedArea;
+	IndexVacuumInfo ivinfo;
+	IndexBulkDeleteResult *stats = NULL;
+
+	if (sindex->has_stats)
+	{
+		stats = (IndexBulkDeleteResult *) palloc(sizeof(IndexBulkDeleteResult));
+		memcpy(stats, &sindex->stats, sizeof(IndexBulkDeleteResult));
+	}
+
+	ivinfo.index = indrel;
+	ivinfo.analyze_only = false;
+	ivinfo.estimated_count = shared->estimated_count;
+	ivinfo.message_level = message_level;
+	ivinfo.num_heap_tuples = shared->num_heap_tuples;
+	ivinfo.strategy = vac_strategy;
+
+	if (shared->for_cleanup)
+		stats = index_vacuum_cleanup(&ivinfo, stats);
+	else
+		stats = index_bulk_delete(&ivinfo, stats,
+								  lazy_tid_reaped, (void *) vacrelstats);
+
+	sindex->has_stats = (stats != NULL);
+	if (stats != NULL)
+	{
+		memcpy(&sindex->stats, stats, sizeof(IndexBulkDeleteResult));
+		pfree(stats);
+	}
+}
+
+/*
+ * lazy_vacuum_indexes_worker() -- the part of a parallel worker in a
+ *		parallel index vacuum
+ *
+ * Called within a transaction, with the snapshot of the VACUUM.  The VACUUM
+ * holds its locks on the table and its indexes; we take ours only if we can
+ * get them at once, so that we can't end up waiting behind someone who is
+ * waiting for the VACUUM, and leave the indexes to the VACUUM otherwise.
+ */
+void
+lazy_vacuum_indexes_worker(void)
+{
+	LVShared   *shared = LVSharedArea;
+	LVRelStats	vacrelstats;
+	int			i;
+
+	if (shared == NULL)
+		return;
+
+	if (!ConditionalLockRelationOid(shared->heapoid, AccessShareLock))
+		return;
+	for (i = 0; i < shared->nindexes; i++)
+	{
+		if (!ConditionalLockRelationOid(shared->indexes[i].indexoid,
+										RowExclusiveLock))
+			return;
+	}
+
+	/* like the VACUUM, don't hold back the xmin of other vacuums */
+	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
+	MyPgXact->vacuumFlags |= PROC_IN_VACUUM;
+	LWLockRelease(ProcArrayLock);
+
+	/* lazy_tid_reaped only needs the dead tuples */
+	MemSet(&vacrelstats, 0, sizeof(LVRelStats));
+	vacrelstats.dead_tuples = shared->dead_tuples;
+	vacrelstats.num_dead_tuples = shared->num_dead_tuples;
+	vacrelstats.max_dead_tuples = shared->max_dead_tuples;
+
+	vac_strategy = GetAccessStrategy(BAS_VACUUM);
+
+	/* each worker keeps to the cost limit of the VACUUM on its own */
+	VacuumCostDelay = shared->cost_delay;
+	VacuumCostLimit = shared->cost_limit;
+	VacuumCostActive = (VacuumCostDelay > 0);
+	VacuumCostBalance = 0;
+	VacuumPageHit = 0;
+	VacuumPageMiss = 0;
+	VacuumPageDirty = 0;
+
+	PG_TRY();
+	{
+		while ((i = lazy_next_index(shared)) >= 0)
+		{
+			Relation	indrel;
+
+			indrel = index_open(shared->indexes[i].indexoid, NoLock);
+			lazy_vacuum_shared_index(indrel, &shared->indexes[i],
+									 &vacrelstats, DEBUG2);
+			index_close(indrel, NoLock);
+		}
+	}
+	PG_CATCH();
+	{
+		VacuumCostActive = false;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	VacuumCostActive = false;
+	FreeAccessStrategy(vac_strategy);
+	vac_strategy = NULL;
+}
+#endif   /* PGXC */
+
 /*
  * Check if every tuple in the given page is visible to all current and future
  * transactions. Also return the visibility_cutoff_xid which is the highest
  * xmin amongst the visible tuples.
  */
 static bool
-heap_page_is_all_visible(Buffer buf, TransactionId *visibility_cutoff_xid)
+heap_page_is_all_visible(Buffer buf, TransactionId *visibility_cutoff_xid,
+						 bool *all_frozen)
 {
 	Page		page = BufferGetPage(buf);
 	OffsetNumber offnum,
@@ -1684,6 +2305,7 @@ heap_page_is_all_visible(Buffer buf, TransactionId *visibility_cutoff_xid)
 	bool		all_visible = true;
 
 	*visibility_cutoff_xid = InvalidTransactionId;
+	*all_frozen = true;
 
 	/*
 	 * This is a stripped down version of the line pointer scan in
@@ -1746,6 +2368,11 @@ heap_page_is_all_visible(Buffer buf, TransactionId *visibility_cutoff_xid)
 					/* Track newest xmin on page. */
 					if (TransactionIdFollows(xmin, *visibility_cutoff_xid))
 						*visibility_cutoff_xid = xmin;
+
+					/* Check whether this tuple is already frozen or not */
+					if (all_visible && *all_frozen &&
+						!heap_tuple_is_frozen(tuple.t_data))
+						*all_frozen = false;
 				}
 				break;
 
@@ -0,0 +1,1238 @@
+/*-------------------------------------------------------------------------
+ *
+ * execParallel.c
+ *	  Background workers running copies of a plan for a Gather node
+ *
+ * A Datanode started with max_parallel_scan_workers > 0 registers that many
+ * background workers, each owning a slot in shared memory.  A worker sits
+ * idle until a backend executing a Gather node claims its slot and leaves a
+ * job there: the subplan of the Gather as a node string, the snapshot of the
+ * backend, and the user to run it as.  The worker runs the subplan in a
+ * transaction of its own, and sends the tuples it produces back through a
+ * queue in the slot.  The SeqScan in the subplan shares its scan state, kept
+ * in the first slot of the group, with the other workers and with the copy
+ * of the subplan the backend runs itself, so that together they read every
+ * page of the relation exactly once.
+ *
+ * Each queue has a single writer and a single reader.  The writer advances
+ * q_written after copying data in, the reader advances q_read after copying
+ * data out, and each side sets the latch of the other after it moves.  A
+ * tuple that does not fit in the free space of the queue is sent in pieces.
+ *
+ * A worker connects to the database of its first job and stays there.  An
+ * idle worker connected to another database than the one a backend wants is
+ * asked to exit, so that the postmaster starts a fresh one in its place.
+ *
+ * VACUUM borrows workers from the same pool to vacuum the indexes of a table
+ * in parallel (PJOB_INDEX_VACUUM).  Such a job carries nothing but the
+ * snapshot; the work to do is found in a shared area of vacuumlazy.c, and
+ * the workers send back no tuples.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execParallel.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "access/relscan.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "commands/vacuum.h"
+#include "executor/execParallel.h"
+#include "executor/executor.h"
+#include "miscadmin.h"
+#include "nodes/nodes.h"
+#include "parser/parsetree.h"
+#include "pgxc/pgxc.h"
+#include "postmaster/bgworker.h"
+#include "storage/barrier.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lmgr.h"
+#include "storage/proc.h"
+#include "storage/procarray.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/memutils.h"
+#include "utils/ps_status.h"
+#include "utils/snapmgr.h"
+#include "utils/tqual.h"
+
+
+/* GUC variable */
+int			max_parallel_scan_workers = 0;
+
+#define PARALLEL_JOB_SIZE		(64 * 1024)
+#define PARALLEL_QUEUE_SIZE		(64 * 1024)
+#define PARALLEL_ERRMSG_SIZE	256
+
+typedef enum ParallelSlotState
+{
+	PSLOT_NOWORKER,				/* no worker is attached to the slot */
+	PSLOT_IDLE,					/* worker is waiting for a job */
+	PSLOT_CLAIMED,				/* slot belongs to a backend, no job yet */
+	PSLOT_ASSIGNED,				/* job is ready for the worker */
+	PSLOT_RUNNING,				/* worker is running the job */
+	PSLOT_DONE,					/* worker has sent all its tuples */
+	PSLOT_FAILED,				/* worker gave up on the job */
+	PSLOT_RECYCLE				/* worker should exit and be started anew */
+} ParallelSlotState;
+
+typedef struct ParallelSlot
+{
+	slock_t		mutex;			/* protects the fields up to leader_detached */
+	ParallelSlotState state;
+	pid_t		worker_pid;		/* 0 if no worker is attached */
+	PGPROC	   *worker_proc;
+	Oid			dbid;			/* database the worker is connected to */
+	PGPROC	   *leader_proc;	/* backend the slot belongs to */
+	bool		leader_detached;	/* backend wants no more tuples */
+
+	/* the job, filled in by the backend before it sets PSLOT_ASSIGNED */
+	ParallelJobKind job_kind;
+	Oid			job_dbid;
+	Oid			job_userid;
+	TransactionId job_xmin;
+	TransactionId job_xmax;
+	int			job_xcnt;
+	int			job_scan_slot;	/* slot holding the shared scan state */
+	char		job_data[PARALLEL_JOB_SIZE];	/* xip array, then plan */
+
+	/* why the job failed, set by the worker with PSLOT_FAILED */
+	int			sqlerrcode;
+	char		errmsg[PARALLEL_ERRMSG_SIZE];
+
+	/* scan state shared by a group whose first slot this is */
+	ParallelHeapScanDescData scan;
+
+	/* tuples sent by the worker */
+	uint32		q_written;		/* bytes written so far, modulo 2^32 */
+	uint32		q_read;			/* bytes read so far, modulo 2^32 */
+	char		q_data[PARALLEL_QUEUE_SIZE];
+} ParallelSlot;
+
+/* A worker as seen by the backend it works for */
+typedef struct ParallelReader
+{
+	int			slotno;
+	bool		finished;		/* all its tuples have been read */
+	uint32		read;			/* local copy of q_read */
+	char	   *buf;			/* tuple being received */
+	uint32		bufsize;
+	uint32		received;		/* bytes of it received so far */
+} ParallelReader;
+
+struct ParallelGroup
+{
+	int			nworkers;
+	int			nfinished;		/* number of readers finished */
+	int			nextreader;		/* reader to try first */
+	ParallelReader *readers;
+	ParallelHeapScanDesc pscan;
+	SubTransactionId subid;		/* subtransaction that started the group */
+	bool		finished;		/* ExecParallelFinish has been done */
+	struct ParallelGroup *next;
+};
+
+typedef struct TQueueDestReceiver
+{
+	DestReceiver pub;			/* publicly-known function pointers */
+	volatile ParallelSlot *slot;	/* slot whose queue gets the tuples */
+} TQueueDestReceiver;
+
+static ParallelSlot *ParallelSlots = NULL;
+
+/* groups of the current transaction not finished yet */
+static ParallelGroup *active_groups = NULL;
+static bool callbacks_registered = false;
+
+static int	parallel_slot_count(void);
+static ParallelGroup *new_group(void);
+static int	claim_slots(int nwanted, int *slotnos);
+static void assign_jobs(ParallelGroup *group, ParallelJobKind kind,
+			Snapshot snapshot, const char *plan_string, Size plan_len);
+static char *worker_plan_string(Gather *node, EState *estate);
+static bool read_queue(ParallelGroup *group, ParallelReader *reader);
+static void parallel_xact_callback(XactEvent event, void *arg);
+static void parallel_subxact_callback(SubXactEvent event,
+						  SubTransactionId mySubid,
+						  SubTransactionId parentSubid, void *arg);
+static void ParallelWorkerMain(void *main_arg);
+static void parallel_worker_exit(int code, Datum arg);
+static void run_job(volatile ParallelSlot *slot);
+static void run_plan_job(volatile ParallelSlot *slot, Size xip_len);
+static void report_job_end(volatile ParallelSlot *slot,
+			   ParallelSlotState state, int sqlerrcode, const char *errmsg);
+static void raise_job_error(volatile ParallelSlot *slot);
+static void tqueue_receive(TupleTableSlot *slot, DestReceiver *self);
+static void tqueue_startup(DestReceiver *self, int operation,
+			   TupleDesc typeinfo);
+static void tqueue_shutdown(DestReceiver *self);
+static void tqueue_destroy(DestReceiver *self);
+
+
+/*
+ * Only Datanodes have parallel scan workers.
+ */
+static int
+parallel_slot_count(void)
+{
+	return IS_PGXC_DATANODE ? max_parallel_scan_workers : 0;
+}
+
+Size
+ParallelShmemSize(void)
+{
+	return mul_size(parallel_slot_count(), sizeof(ParallelSlot));
+}
+
+void
+ParallelShmemInit(void)
+{
+	bool		found;
+	int			i;
+
+	if (parallel_slot_count() == 0)
+		return;
+
+	ParallelSlots = (ParallelSlot *)
+		ShmemInitStruct("Parallel Scan Slots", ParallelShmemSize(), &found);
+
+	if (!found)
+	{
+		for (i = 0; i < parallel_slot_count(); i++)
+		{
+			ParallelSlot *slot = &ParallelSlots[i];
+
+			SpinLockInit(&slot->mutex);
+			slot->state = PSLOT_NOWORKER;
+			slot->worker_pid = 0;
+			slot->worker_proc = NULL;
+			slot->dbid = InvalidOid;
+			slot->leader_proc = NULL;
+			slot->leader_detached = false;
+		}
+	}
+}
+
+/*
+ * Register one background worker per slot.  Called by the postmaster while
+ * shared_preload_libraries are processed, which is the only time background
+ * workers may be registered.
+ */
+void
+RegisterParallelWorkers(void)
+{
+	BackgroundWorker worker;
+	char		name[NAMEDATALEN];
+	int			i;
+
+	if (!IsPostmasterEnvironment)
+		return;
+
+	for (i = 0; i < parallel_slot_count(); i++)
+	{
+		snprintf(name, sizeof(name), "parallel scan worker %d", i);
+
+		worker.bgw_name = name;
+		worker.bgw_flags = BGWORKER_SHMEM_ACCESS |
+			BGWORKER_BACKEND_DATABASE_CONNECTION;
+		worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+		worker.bgw_restart_time = 10;
+		worker.bgw_main = ParallelWorkerMain;
+		worker.bgw_main_arg = (void *) (intptr_t) i;
+		worker.bgw_sighup = NULL;
+		worker.bgw_sigterm = die;
+
+		RegisterBackgroundWorker(&worker);
+	}
+}
+
+
+/* ----------------------------------------------------------------
+ *		Backend side
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * ExecParallelBegin
+ *
+ * Set up the scan state shared by the copies of the subplan of a Gather
+ * node, and hand the subplan to as many idle workers as we can get, up to
+ * the number the node asks for.  The group is returned even when no worker
+ * could be had; the backend then runs the subplan alone.
+ */
+ParallelGroup *
+ExecParallelBegin(Gather *node, EState *estate, int eflags)
+{
+	Snapshot	snapshot = estate->es_snapshot;
+	ParallelGroup *group;
+	MemoryContext oldcontext;
+	Plan	   *plan;
+	Relation	rel;
+	char	   *plan_string = NULL;
+	Size		plan_len = 0;
+	Size		xip_len;
+	int		   *slotnos;
+	int			nwanted;
+	int			i;
+
+	/* find the relation whose pages the copies of the subplan divide */
+	for (plan = outerPlan(node); plan != NULL; plan = outerPlan(plan))
+	{
+		if (IsA(plan, SeqScan))
+			break;
+	}
+	if (plan == NULL)
+		elog(ERROR, "no sequential scan found under Gather node");
+
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+
+	/* from now on, an error leaves the group to the abort callbacks */
+	group = new_group();
+
+	/*
+	 * Workers see neither changes made by our transaction nor what a
+	 * serializable transaction would have to track, and can't give tuples a
+	 * place for OIDs.  They only get an MVCC snapshot as a plain xmin, xmax
+	 * and xip array, and the subplan must not be needed just for EXPLAIN.
+	 */
+	nwanted = Min(node->num_workers, parallel_slot_count());
+	if ((eflags & (EXEC_FLAG_EXPLAIN_ONLY | EXEC_FLAG_WITH_OIDS)) != 0 ||
+		!IsMVCCSnapshot(snapshot) ||
+		snapshot->subxcnt > 0 || snapshot->suboverflowed ||
+		TransactionIdIsValid(GetTopTransactionIdIfAny()) ||
+		IsolationIsSerializable())
+		nwanted = 0;
+
+	xip_len = MAXALIGN(snapshot->xcnt * sizeof(TransactionId));
+	if (nwanted > 0)
+	{
+		plan_string = worker_plan_string(node, estate);
+		plan_len = strlen(plan_string) + 1;
+		if (xip_len + plan_len > PARALLEL_JOB_SIZE)
+			nwanted = 0;
+	}
+
+	slotnos = (int *) palloc(Max(nwanted, 1) * sizeof(int));
+	group->readers = (ParallelReader *)
+		palloc0(Max(nwanted, 1) * sizeof(ParallelReader));
+	group->nworkers = nwanted > 0 ? claim_slots(nwanted, slotnos) : 0;
+	for (i = 0; i < group->nworkers; i++)
+		group->readers[i].slotno = slotnos[i];
+
+	/* the scan state lives in shared memory only if anyone else needs it */
+	if (group->nworkers > 0)
+		group->pscan = &ParallelSlots[slotnos[0]].scan;
+	else
+		group->pscan = (ParallelHeapScanDesc)
+			palloc(heap_parallelscan_estimate());
+
+	rel = heap_open(getrelid(((Scan *) plan)->scanrelid, estate->es_range_table),
+					AccessShareLock);
+	heap_parallelscan_initialize(group->pscan, rel);
+	heap_close(rel, NoLock);
+
+	for (i = 0; i < group->nworkers; i++)
+	{
+		ParallelReader *reader = &group->readers[i];
+
+		reader->bufsize = 1024;
+		reader->buf = palloc(reader->bufsize);
+	}
+	assign_jobs(group, PJOB_PLAN, snapshot, plan_string, plan_len);
+
+	pfree(slotnos);
+	if (plan_string)
+		pfree(plan_string);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return group;
+}
+
+/*
+ * ExecParallelBeginJob
+ *
+ * Hand a job other than a plan to as many idle workers as we can get, up to
+ * nwanted, and return the group they make up, which may have no worker at
+ * all.  The workers get the active snapshot.  Wait for them with
+ * ExecParallelWaitAll, and release them with ExecParallelFinish.
+ */
+ParallelGroup *
+ExecParallelBeginJob(ParallelJobKind kind, int nwanted)
+{
+	Snapshot	snapshot = GetActiveSnapshot();
+	ParallelGroup *group;
+	MemoryContext oldcontext;
+	int		   *slotnos;
+	int			i;
+
+	Assert(kind != PJOB_PLAN);
+
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+
+	group = new_group();
+
+	nwanted = Min(nwanted, parallel_slot_count());
+	if (!IsMVCCSnapshot(snapshot) ||
+		MAXALIGN(snapshot->xcnt * sizeof(TransactionId)) > PARALLEL_JOB_SIZE)
+		nwanted = 0;
+
+	slotnos = (int *) palloc(Max(nwanted, 1) * sizeof(int));
+	group->readers = (ParallelReader *)
+		palloc0(Max(nwanted, 1) * sizeof(ParallelReader));
+	group->nworkers = nwanted > 0 ? claim_slots(nwanted, slotnos) : 0;
+	for (i = 0; i < group->nworkers; i++)
+		group->readers[i].slotno = slotnos[i];
+
+	assign_jobs(group, kind, snapshot, NULL, 0);
+
+	pfree(slotnos);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return group;
+}
+
+/*
+ * Create a group and register it, so that it gets finished if the
+ * transaction aborts.
+ */
+static ParallelGroup *
+new_group(void)
+{
+	ParallelGroup *group;
+
+	group = (ParallelGroup *) palloc0(sizeof(ParallelGroup));
+	group->subid = GetCurrentSubTransactionId();
+	if (!callbacks_registered)
+	{
+		RegisterXactCallback(parallel_xact_callback, NULL);
+		RegisterSubXactCallback(parallel_subxact_callback, NULL);
+		callbacks_registered = true;
+	}
+	group->next = active_groups;
+	active_groups = group;
+
+	return group;
+}
+
+/*
+ * Claim up to nwanted idle workers connected to our database or to none.
+ * If there are not enough, ask as many idle workers connected to other
+ * databases to make room for fresh ones, which later queries will get.
+ */
+static int
+claim_slots(int nwanted, int *slotnos)
+{
+	int			nclaimed = 0;
+	int			nrecycled = 0;
+	int			i;
+
+	for (i = 0; i < parallel_slot_count() && nclaimed < nwanted; i++)
+	{
+		volatile ParallelSlot *slot = &ParallelSlots[i];
+
+		SpinLockAcquire(&slot->mutex);
+		if (slot->state == PSLOT_IDLE &&
+			(slot->dbid == MyDatabaseId || !OidIsValid(slot->dbid)))
+		{
+			slot->state = PSLOT_CLAIMED;
+			slot->leader_proc = MyProc;
+			slot->leader_detached = false;
+			slotnos[nclaimed++] = i;
+		}
+		SpinLockRelease(&slot->mutex);
+	}
+
+	for (i = 0; i < parallel_slot_count() && nclaimed + nrecycled < nwanted; i++)
+	{
+		volatile ParallelSlot *slot = &ParallelSlots[i];
+		PGPROC	   *proc = NULL;
+
+		SpinLockAcquire(&slot->mutex);
+		if (slot->state == PSLOT_IDLE && OidIsValid(slot->dbid) &&
+			slot->dbid != MyDatabaseId)
+		{
+			slot->state = PSLOT_RECYCLE;
+			proc = slot->worker_proc;
+		}
+		SpinLockRelease(&slot->mutex);
+
+		if (proc != NULL)
+		{
+			SetLatch(&proc->procLatch);
+			nrecycled++;
+		}
+	}
+
+	return nclaimed;
+}
+
+/*
+ * Fill in the job of each worker of the group and wake it up.  The first
+ * slot of the group holds the scan state of a plan job.
+ */
+static void
+assign_jobs(ParallelGroup *group, ParallelJobKind kind, Snapshot snapshot,
+			const char *plan_string, Size plan_len)
+{
+	Size		xip_len = MAXALIGN(snapshot->xcnt * sizeof(TransactionId));
+	int			i;
+
+	for (i = 0; i < group->nworkers; i++)
+	{
+		volatile ParallelSlot *slot = &ParallelSlots[group->readers[i].slotno];
+		PGPROC	   *proc;
+
+		/* the slot is ours, so no lock is needed to fill in the job */
+		slot->job_kind = kind;
+		slot->job_dbid = MyDatabaseId;
+		slot->job_userid = GetUserId();
+		slot->job_xmin = snapshot->xmin;
+		slot->job_xmax = snapshot->xmax;
+		slot->job_xcnt = snapshot->xcnt;
+		slot->job_scan_slot = group->readers[0].slotno;
+		memcpy((char *) slot->job_data, snapshot->xip,
+			   snapshot->xcnt * sizeof(TransactionId));
+		if (plan_string != NULL)
+			memcpy((char *) slot->job_data + xip_len, plan_string, plan_len);
+		slot->q_written = 0;
+		slot->q_read = 0;
+
+		SpinLockAcquire(&slot->mutex);
+		slot->state = PSLOT_ASSIGNED;
+		proc = slot->worker_proc;
+		SpinLockRelease(&slot->mutex);
+
+		if (proc != NULL)
+			SetLatch(&proc->procLatch);
+	}
+}
+
+/*
+ * The job of a worker is the subplan of the Gather as a plain SELECT.  Its
+ * tuples must come out exactly as the subplan returns them to the Gather, so
+ * no column may be filtered out as junk.
+ */
+static char *
+worker_plan_string(Gather *node, EState *estate)
+{
+	PlannedStmt *stmt = makeNode(PlannedStmt);
+	Plan	   *plan = (Plan *) copyObject(outerPlan(node));
+	ListCell   *lc;
+
+	foreach(lc, plan->targetlist)
+		((TargetEntry *) lfirst(lc))->resjunk = false;
+
+	stmt->commandType = CMD_SELECT;
+	stmt->canSetTag = true;
+	stmt->planTree = plan;
+	stmt->rtable = estate->es_range_table;
+
+	return nodeToString(stmt);
+}
+
+ParallelHeapScanDesc
+ExecParallelScanDesc(ParallelGroup *group)
+{
+	return group->pscan;
+}
+
+int
+ExecParallelNumWorkers(ParallelGroup *group)
+{
+	return group->nworkers;
+}
+
+/*
+ * ExecParallelReadTuple
+ *
+ * Return the next tuple any worker of the group has sent, without waiting.
+ * The tuple stays valid until the next call.  If there is none, *done tells
+ * whether every worker has finished.
+ */
+MinimalTuple
+ExecParallelReadTuple(ParallelGroup *group, bool *done)
+{
+	int			i;
+
+	for (i = 0; i < group->nworkers; i++)
+	{
+		int			r = (group->nextreader + i) % group->nworkers;
+		ParallelReader *reader = &group->readers[r];
+
+		if (reader->finished)
+			continue;
+		if (read_queue(group, reader))
+		{
+			/* keep reading from the same worker while it has tuples */
+			group->nextreader = r;
+			return (MinimalTuple) reader->buf;
+		}
+	}
+
+	*done = (group->nfinished == group->nworkers);
+	return NULL;
+}
+
+/*
+ * Move whatever the queue of a worker holds into the buffer of the reader,
+ * up to the end of the tuple being received.  Return true when it is
+ * complete.
+ */
+static bool
+read_queue(ParallelGroup *group, ParallelReader *reader)
+{
+	volatile ParallelSlot *slot = &ParallelSlots[reader->slotno];
+
+	for (;;)
+	{
+		PGPROC	   *worker;
+		uint32		avail;
+		uint32		needed;
+		uint32		offset;
+		uint32		n;
+
+		avail = slot->q_written - reader->read;
+		if (avail == 0)
+		{
+			ParallelSlotState state;
+
+			SpinLockAcquire(&slot->mutex);
+			state = slot->state;
+			SpinLockRelease(&slot->mutex);
+
+			if (state != PSLOT_DONE && state != PSLOT_FAILED)
+				return false;
+			/* the worker may have written more before it finished */
+			if (slot->q_written != reader->read)
+				continue;
+			if (state == PSLOT_FAILED)
+				raise_job_error(slot);
+			reader->finished = true;
+			group->nfinished++;
+			return false;
+		}
+		pg_read_barrier();
+
+		/* the length word of the tuple comes first */
+		if (reader->received < sizeof(uint32))
+			needed = sizeof(uint32);
+		else
+			needed = ((MinimalTuple) reader->buf)->t_len;
+
+		n = Min(avail, needed - reader->received);
+		offset = reader->read % PARALLEL_QUEUE_SIZE;
+		if (offset + n > PARALLEL_QUEUE_SIZE)
+		{
+			uint32		first = PARALLEL_QUEUE_SIZE - offset;
+
+			memcpy(reader->buf + reader->received,
+				   (char *) slot->q_data + offset, first);
+			memcpy(reader->buf + reader->received + first,
+				   (char *) slot->q_data, n - first);
+		}
+		else
+			memcpy(reader->buf + reader->received,
+				   (char *) slot->q_data + offset, n);
+		reader->received += n;
+		reader->read += n;
+
+		/* data must be out before the worker may overwrite it */
+		pg_memory_barrier();
+		slot->q_read = reader->read;
+		worker = slot->worker_proc;
+		if (worker != NULL)
+			SetLatch(&worker->procLatch);
+
+		if (reader->received == sizeof(uint32))
+		{
+			uint32		len = ((MinimalTuple) reader->buf)->t_len;
+
+			if (len > reader->bufsize)
+			{
+				reader->buf = repalloc(reader->buf, len);
+				reader->bufsize = len;
+			}
+		}
+		else if (reader->received == ((MinimalTuple) reader->buf)->t_len)
+		{
+			reader->received = 0;
+			return true;
+		}
+	}
+}
+
+/*
+ * ExecParallelWait
+ *
+ * Sleep until a worker of the group sends something or finishes.
+ */
+void
+ExecParallelWait(ParallelGroup *group)
+{
+	WaitLatch(&MyProc->procLatch, WL_LATCH_SET, -1);
+	ResetLatch(&MyProc->procLatch);
+	CHECK_FOR_INTERRUPTS();
+}
+
+/*
+ * ExecParallelWaitAll
+ *
+ * Wait until every worker of a group given a job by ExecParallelBeginJob
+ * has finished it, and throw an error if any of them failed.
+ */
+void
+ExecParallelWaitAll(ParallelGroup *group)
+{
+	for (;;)
+	{
+		int			ndone = 0;
+		int			i;
+
+		for (i = 0; i < group->nworkers; i++)
+		{
+			volatile ParallelSlot *slot = &ParallelSlots[group->readers[i].slotno];
+			ParallelSlotState state;
+
+			SpinLockAcquire(&slot->mutex);
+			state = slot->state;
+			SpinLockRelease(&slot->mutex);
+
+			if (state == PSLOT_FAILED)
+				raise_job_error(slot);
+			if (state == PSLOT_DONE)
+				ndone++;
+		}
+		if (ndone == group->nworkers)
+			break;
+
+		ExecParallelWait(group);
+	}
+}
+
+/*
+ * ExecParallelFinish
+ *
+ * Stop the workers of the group, wait for them to be done, and give their
+ * slots back.  This is also how a group gets cleaned up when the transaction
+ * aborts, so it must not throw an error.
+ */
+void
+ExecParallelFinish(ParallelGroup *group)
+{
+	ParallelGroup **prev;
+	int			i;
+
+	if (group->finished)
+		return;
+	group->finished = true;
+
+	HOLD_INTERRUPTS();
+
+	/* workers reach the end of their scan at their next page */
+	if (group->pscan != NULL)
+		heap_parallelscan_abort(group->pscan);
+
+	for (i = 0; i < group->nworkers; i++)
+	{
+		volatile ParallelSlot *slot = &ParallelSlots[group->readers[i].slotno];
+		PGPROC	   *proc;
+
+		SpinLockAcquire(&slot->mutex);
+		slot->leader_detached = true;
+		/* a job not started yet can just be taken back */
+		if (slot->state == PSLOT_ASSIGNED)
+			slot->state = PSLOT_CLAIMED;
+		proc = slot->worker_proc;
+		SpinLockRelease(&slot->mutex);
+
+		if (proc != NULL)
+			SetLatch(&proc->procLatch);
+	}
+
+	for (;;)
+	{
+		bool		running = false;
+
+		for (i = 0; i < group->nworkers; i++)
+		{
+			volatile ParallelSlot *slot = &ParallelSlots[group->readers[i].slotno];
+
+			SpinLockAcquire(&slot->mutex);
+			if (slot->state == PSLOT_RUNNING)
+				running = true;
+			SpinLockRelease(&slot->mutex);
+		}
+		if (!running)
+			break;
+
+		WaitLatch(&MyProc->procLatch, WL_LATCH_SET | WL_TIMEOUT, 1000L);
+		ResetLatch(&MyProc->procLatch);
+	}
+
+	for (i = 0; i < group->nworkers; i++)
+	{
+		volatile ParallelSlot *slot = &ParallelSlots[group->readers[i].slotno];
+
+		SpinLockAcquire(&slot->mutex);
+		slot->state = slot->worker_pid != 0 ? PSLOT_IDLE : PSLOT_NOWORKER;
+		slot->leader_proc = NULL;
+		SpinLockRelease(&slot->mutex);
+	}
+
+	for (prev = &active_groups; *prev != NULL; prev = &(*prev)->next)
+	{
+		if (*prev == group)
+		{
+			*prev = group->next;
+			break;
+		}
+	}
+
+	RESUME_INTERRUPTS();
+}
+
+/*
+ * Groups are normally finished by ExecEndGather.  Those left behind by an
+ * error are finished when the (sub)transaction that started them ends.
+ */
+static void
+parallel_xact_callback(XactEvent event, void *arg)
+{
+	while (active_groups != NULL)
+		ExecParallelFinish(active_groups);
+}
+
+static void
+parallel_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
+						  SubTransactionId parentSubid, void *arg)
+{
+	ParallelGroup *group;
+	ParallelGroup *next;
+
+	for (group = active_groups; group != NULL; group = next)
+	{
+		next = group->next;
+		if (group->subid != mySubid)
+			continue;
+		if (event == SUBXACT_EVENT_ABORT_SUB)
+			ExecParallelFinish(group);
+		else if (event == SUBXACT_EVENT_COMMIT_SUB)
+			group->subid = parentSubid;
+	}
+}
+
+
+/* ----------------------------------------------------------------
+ *		Worker side
+ * ----------------------------------------------------------------
+ */
+
+static void
+ParallelWorkerMain(void *main_arg)
+{
+	int			slotno = (int) (intptr_t) main_arg;
+	volatile ParallelSlot *slot = &ParallelSlots[slotno];
+	sigjmp_buf	local_sigjmp_buf;
+
+	on_shmem_exit(parallel_worker_exit, Int32GetDatum(slotno));
+
+	/* a backend may still hold the slot after our predecessor exited */
+	SpinLockAcquire(&slot->mutex);
+	slot->worker_pid = MyProcPid;
+	slot->worker_proc = MyProc;
+	slot->dbid = InvalidOid;
+	if (slot->state == PSLOT_NOWORKER)
+		slot->state = PSLOT_IDLE;
+	SpinLockRelease(&slot->mutex);
+
+	/*
+	 * If an error is thrown while running a job, report it to the backend
+	 * the job is for, clean up and wait for the next one.  See the similar
+	 * code in postgres.c.
+	 */
+	if (sigsetjmp(local_sigjmp_buf, 1) != 0)
+	{
+		ErrorData  *edata;
+
+		/* Since not using PG_TRY, must reset error stack by hand */
+		error_context_stack = NULL;
+
+		/* Prevent interrupts while cleaning up */
+		HOLD_INTERRUPTS();
+
+		MemoryContextSwitchTo(TopMemoryContext);
+		edata = CopyErrorData();
+
+		/* Report the error to the server log */
+		EmitErrorReport();
+
+		AbortCurrentTransaction();
+#ifdef PGXC
+		UnsetGlobalSnapshotData();
+#endif
+		report_job_end(slot, PSLOT_FAILED, edata->sqlerrcode,
+					   edata->message ? edata->message : "unknown error");
+
+		FreeErrorData(edata);
+		FlushErrorState();
+
+		/* a worker which could not even connect has nothing left to do */
+		if (!OidIsValid(MyDatabaseId))
+			proc_exit(1);
+
+		RESUME_INTERRUPTS();
+	}
+
+	/* We can now handle ereport(ERROR) */
+	PG_exception_stack = &local_sigjmp_buf;
+
+	BackgroundWorkerUnblockSignals();
+
+	for (;;)
+	{
+		ParallelSlotState state;
+		int			rc;
+
+		ResetLatch(&MyProc->procLatch);
+
+		SpinLockAcquire(&slot->mutex);
+		state = slot->state;
+		SpinLockRelease(&slot->mutex);
+
+		if (state == PSLOT_RECYCLE)
+			proc_exit(0);
+		if (state == PSLOT_ASSIGNED)
+		{
+			run_job(slot);
+			continue;
+		}
+
+		rc = WaitLatch(&MyProc->procLatch,
+					   WL_LATCH_SET | WL_POSTMASTER_DEATH, -1);
+		if (rc & WL_POSTMASTER_DEATH)
+			proc_exit(1);
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/*
+ * on_shmem_exit callback: detach from the slot, failing the job in progress
+ * if there is one.
+ */
+static void
+parallel_worker_exit(int code, Datum arg)
+{
+	volatile ParallelSlot *slot = &ParallelSlots[DatumGetInt32(arg)];
+	PGPROC	   *leader = NULL;
+
+	SpinLockAcquire(&slot->mutex);
+	slot->worker_pid = 0;
+	slot->worker_proc = NULL;
+	slot->dbid = InvalidOid;
+	switch (slot->state)
+	{
+		case PSLOT_IDLE:
+		case PSLOT_RECYCLE:
+			slot->state = PSLOT_NOWORKER;
+			break;
+		case PSLOT_ASSIGNED:
+		case PSLOT_RUNNING:
+			slot->sqlerrcode = ERRCODE_INTERNAL_ERROR;
+			strlcpy((char *) slot->errmsg, "worker exited",
+					PARALLEL_ERRMSG_SIZE);
+			slot->state = PSLOT_FAILED;
+			leader = slot->leader_proc;
+			break;
+		default:
+			/* slot belongs to a backend, which will release it */
+			break;
+	}
+	SpinLockRelease(&slot->mutex);
+
+	if (leader != NULL)
+		SetLatch(&leader->procLatch);
+}
+
+static void
+run_job(volatile ParallelSlot *slot)
+{
+	ParallelSlotState state;
+	Oid			save_userid;
+	int			save_sec_context;
+
+	/* a worker stays connected to the database of its first job */
+	if (!OidIsValid(MyDatabaseId))
+	{
+		BackgroundWorkerInitializeConnectionByOid(slot->job_dbid, NULL);
+#ifdef PGXC
+		/* the snapshot comes from the backend, just as from a Coordinator */
+		remoteConnType = REMOTE_CONN_COORD;
+#endif
+
+		SpinLockAcquire(&slot->mutex);
+		slot->dbid = MyDatabaseId;
+		SpinLockRelease(&slot->mutex);
+	}
+
+	SpinLockAcquire(&slot->mutex);
+	state = slot->state;
+	if (state == PSLOT_ASSIGNED)
+		slot->state = PSLOT_RUNNING;
+	SpinLockRelease(&slot->mutex);
+
+	/* the backend may have taken the job back meanwhile */
+	if (state != PSLOT_ASSIGNED)
+		return;
+
+	if (slot->job_dbid != MyDatabaseId)
+		elog(ERROR, "parallel scan worker is connected to another database");
+
+	set_ps_display(slot->job_kind == PJOB_PLAN ?
+				   "parallel scan" : "parallel vacuum", false);
+
+	/* transaction abort puts the user back, but we must do it on commit */
+	StartTransactionCommand();
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+	SetUserIdAndSecContext(slot->job_userid, SECURITY_LOCAL_USERID_CHANGE);
+
+#ifdef PGXC
+	{
+		int		   *xip = NULL;
+
+		if (slot->job_xcnt > 0)
+		{
+			xip = malloc(slot->job_xcnt * sizeof(int));
+			if (xip == NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_OUT_OF_MEMORY),
+						 errmsg("out of memory")));
+			memcpy(xip, (char *) slot->job_data,
+				   slot->job_xcnt * sizeof(int));
+		}
+		SetGlobalSnapshotData(slot->job_xmin, slot->job_xmax,
+							  slot->job_xcnt, xip);
+	}
+#endif
+	PushActiveSnapshot(GetTransactionSnapshot());
+
+	switch (slot->job_kind)
+	{
+		case PJOB_PLAN:
+			run_plan_job(slot,
+						 MAXALIGN(slot->job_xcnt * sizeof(TransactionId)));
+			break;
+		case PJOB_INDEX_VACUUM:
+			lazy_vacuum_indexes_worker();
+			break;
+	}
+
+	PopActiveSnapshot();
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+	CommitTransactionCommand();
+#ifdef PGXC
+	UnsetGlobalSnapshotData();
+#endif
+
+	report_job_end(slot, PSLOT_DONE, 0, NULL);
+	set_ps_display("idle", false);
+}
+
+/*
+ * Run the copy of the subplan of a Gather node, sending its tuples to the
+ * queue of the slot.
+ */
+static void
+run_plan_job(volatile ParallelSlot *slot, Size xip_len)
+{
+	PlannedStmt *stmt;
+	QueryDesc  *queryDesc;
+	DestReceiver *dest;
+	ListCell   *lc;
+
+	stmt = (PlannedStmt *) stringToNode(pstrdup((char *) slot->job_data + xip_len));
+	Assert(IsA(stmt, PlannedStmt));
+
+	/*
+	 * The backend holds locks on all these relations already.  Waiting for
+	 * ours could deadlock behind someone queued up for a stronger lock, who
+	 * is waiting for the backend, who is waiting for us; rather than that,
+	 * leave the work to the backend.
+	 */
+	foreach(lc, stmt->rtable)
+	{
+		RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc);
+
+		if (rte->rtekind == RTE_RELATION &&
+			!ConditionalLockRelationOid(rte->relid, AccessShareLock))
+			return;
+	}
+
+	dest = CreateDestReceiver(DestTupleQueue);
+	((TQueueDestReceiver *) dest)->slot = slot;
+
+	queryDesc = CreateQueryDesc(stmt, "parallel scan",
+								GetActiveSnapshot(), InvalidSnapshot,
+								dest, NULL, 0);
+	queryDesc->parallel_scan = &ParallelSlots[slot->job_scan_slot].scan;
+
+	ExecutorStart(queryDesc, 0);
+	ExecutorRun(queryDesc, ForwardScanDirection, 0L);
+	ExecutorFinish(queryDesc);
+	ExecutorEnd(queryDesc);
+	FreeQueryDesc(queryDesc);
+	(*dest->rDestroy) (dest);
+}
+
+static void
+report_job_end(volatile ParallelSlot *slot, ParallelSlotState state,
+			   int sqlerrcode, const char *errmsg)
+{
+	PGPROC	   *leader = NULL;
+
+	SpinLockAcquire(&slot->mutex);
+	if (slot->state == PSLOT_RUNNING)
+	{
+		if (errmsg != NULL)
+		{
+			slot->sqlerrcode = sqlerrcode;
+			strlcpy((char *) slot->errmsg, errmsg, PARALLEL_ERRMSG_SIZE);
+		}
+		slot->state = state;
+		leader = slot->leader_proc;
+	}
+	SpinLockRelease(&slot->mutex);
+
+	if (leader != NULL)
+		SetLatch(&leader->procLatch);
+}
+
+/*
+ * Raise in the backend the error a worker gave up its job with.  It keeps
+ * its SQLSTATE and message, so it looks the same whichever process hit it.
+ */
+static void
+raise_job_error(volatile ParallelSlot *slot)
+{
+	ereport(ERROR,
+			(errcode(slot->sqlerrcode),
+			 errmsg_internal("%s", (char *) slot->errmsg),
+			 errcontext("parallel worker")));
+}
+
+
+/* ----------------------------------------------------------------
+ *		DestReceiver sending tuples through the queue of a slot
+ * ----------------------------------------------------------------
+ */
+
+static void
+tqueue_receive(TupleTableSlot *slot, DestReceiver *self)
+{
+	volatile ParallelSlot *pslot = ((TQueueDestReceiver *) self)->slot;
+	MinimalTuple tuple = ExecFetchSlotMinimalTuple(slot);
+	const char *data = (const char *) tuple;
+	uint32		len = tuple->t_len;
+	uint32		written = pslot->q_written;
+
+	while (len > 0)
+	{
+		uint32		space;
+		uint32		offset;
+		uint32		n;
+
+		space = PARALLEL_QUEUE_SIZE - (written - pslot->q_read);
+		if (space == 0)
+		{
+			bool		detached;
+			int			rc;
+
+			SpinLockAcquire(&pslot->mutex);
+			detached = pslot->leader_detached;
+			SpinLockRelease(&pslot->mutex);
+
+			/* nobody will read the rest */
+			if (detached)
+				return;
+
+			rc = WaitLatch(&MyProc->procLatch,
+						   WL_LATCH_SET | WL_POSTMASTER_DEATH, -1);
+			if (rc & WL_POSTMASTER_DEATH)
+				proc_exit(1);
+			ResetLatch(&MyProc->procLatch);
+			CHECK_FOR_INTERRUPTS();
+			continue;
+		}
+
+		/* the reader must be done with the space before we overwrite it */
+		pg_memory_barrier();
+
+		n = Min(space, len);
+		offset = written % PARALLEL_QUEUE_SIZE;
+		if (offset + n > PARALLEL_QUEUE_SIZE)
+		{
+			uint32		first = PARALLEL_QUEUE_SIZE - offset;
+
+			memcpy((char *) pslot->q_data + offset, data, first);
+			memcpy((char *) pslot->q_data, data + first, n - first);
+		}
+		else
+			memcpy((char *) pslot->q_data + offset, data, n);
+		data += n;
+		len -= n;
+		written += n;
+
+		/* data must be in before the reader may look at it */
+		pg_write_barrier();
+		pslot->q_written = written;
+		SetLatch(&pslot->leader_proc->procLatch);
+	}
+}
+
+static void
+tqueue_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
+{
+	/* do nothing */
+}
+
+static void
+tqueue_shutdown(DestReceiver *self)
+{
+	/* do nothing */
+}
+
+static void
+tqueue_destroy(DestReceiver *self)
+{
+	pfree(self);
+}
+
+/*
+ * Create a DestReceiver for a parallel scan worker to send its tuples with.
+ * The slot is set by run_job.
+ */
+DestReceiver *
+CreateTupleQueueDestReceiver(void)
+{
+	TQueueDestReceiver *self;
+
+	self = (TQueueDestReceiver *) palloc0(sizeof(TQueueDestReceiver));
+
+	self->pub.receiveSlot = tqueue_receive;
+	self->pub.rStartup = tqueue_startup;
+	self->pub.rShutdown = tqueue_shutdown;
+	self->pub.rDestroy = tqueue_destroy;
+	self->pub.mydest = DestTupleQueue;
+
+	return (DestReceiver *) self;
+}
@@ -87,6 +87,7 @@
 #include "executor/nodeCtescan.h"
 #include "executor/nodeForeignscan.h"
 #include "executor/nodeFunctionscan.h"
+#include "executor/nodeGather.h"
 #include "executor/nodeGroup.h"
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
@@ -317,6 +318,11 @@ ExecInitNode(Plan *node, EState *estate, int eflags)
 												 estate, eflags);
 			break;
 
+		case T_Gather:
+			result = (PlanState *) ExecInitGather((Gather *) node,
+												  estate, eflags);
+			break;
+
 #ifdef PGXC
 		case T_RemoteQuery:
 			result = (PlanState *) ExecInitRemoteQuery((RemoteQuery *) node,
@@ -509,6 +515,10 @@ ExecProcNode(PlanState *node)
 			result = ExecLimit((LimitState *) node);
 			break;
 
+		case T_GatherState:
+			result = ExecGather((GatherState *) node);
+			break;
+
 #ifdef PGXC
 		case T_RemoteQueryState:
 			result = ExecRemoteQuery((RemoteQueryState *) node);
@@ -751,6 +761,10 @@ ExecEndNode(PlanState *node)
 			ExecEndLimit((LimitState *) node);
 			break;
 
+		case T_GatherState:
+			ExecEndGather((GatherState *) node);
+			break;
+
 #ifdef PGXC
 		case T_RemoteQueryState:
 			ExecEndRemoteQuery((RemoteQueryState *) node);
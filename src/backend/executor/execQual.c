@@ -59,6 +59,91 @@
 #include "utils/xml.h"
 
 
+/*
+ * Flattened expression programs (see ExecCompileExpr)
+ *
+ * A program is an array of steps, run in order by ExecInterpExpr unless a
+ * step jumps.  Each step stores its result into *resvalue and *resnull,
+ * which point wherever the step's consumer expects its input: the argument
+ * arrays of a function's FunctionCallInfoData, the result location of an
+ * enclosing AND/OR, or the program's own result.
+ */
+typedef enum ExprStepOp
+{
+	EEOP_DONE,					/* return the program's result */
+	EEOP_VAR_FIRST,				/* check Var, then turn into one of: */
+	EEOP_SCAN_VAR,				/* fetch attribute from ecxt_scantuple */
+	EEOP_INNER_VAR,				/* fetch attribute from ecxt_innertuple */
+	EEOP_OUTER_VAR,				/* fetch attribute from ecxt_outertuple */
+	EEOP_CONST,					/* return a constant */
+	EEOP_FUNCEXPR_INIT,			/* look up function, then turn into one of: */
+	EEOP_FUNCEXPR,				/* call non-strict function */
+	EEOP_FUNCEXPR_STRICT,		/* call strict function */
+	EEOP_FUNCEXPR_STRICT_2,		/* call strict function of two arguments */
+	EEOP_BOOL_AND_STEP_FIRST,	/* check first argument of AND */
+	EEOP_BOOL_AND_STEP,			/* check a middle argument of AND */
+	EEOP_BOOL_AND_STEP_LAST,	/* check last argument of AND */
+	EEOP_BOOL_OR_STEP_FIRST,	/* likewise for OR */
+	EEOP_BOOL_OR_STEP,
+	EEOP_BOOL_OR_STEP_LAST,
+	EEOP_BOOL_NOT,				/* negate result of the previous step */
+	EEOP_SUBTREE,				/* evaluate an ExprState tree the old way */
+	EEOP_LAST					/* must be last */
+} ExprStepOp;
+
+typedef struct ExprStep
+{
+	ExprStepOp	opcode;
+	Datum	   *resvalue;		/* where to store the result */
+	bool	   *resnull;
+	union
+	{
+		/* for EEOP_*VAR* */
+		struct
+		{
+			Var		   *var;
+			AttrNumber	attnum;
+		}			var;
+
+		/* for EEOP_CONST */
+		struct
+		{
+			Datum		value;
+			bool		isnull;
+		}			constval;
+
+		/* for EEOP_FUNCEXPR* */
+		struct
+		{
+			FuncExprState *fcache;	/* arguments go to its fcinfo_data */
+			FunctionCallInfo fcinfo;	/* set up by EEOP_FUNCEXPR_INIT */
+			int			nargs;
+		}			func;
+
+		/* for EEOP_BOOL_*_STEP* */
+		struct
+		{
+			bool	   *anynull;	/* has any input been NULL so far? */
+			int			jumpdone;	/* step to go to once result is known */
+		}			boolexpr;
+
+		/* for EEOP_SUBTREE */
+		struct
+		{
+			ExprState  *state;
+		}			subtree;
+	}			d;
+} ExprStep;
+
+struct ExprProgram
+{
+	ExprStep   *steps;
+	int			nsteps;
+	int			maxsteps;		/* allocated length of steps[] */
+	Datum		resvalue;		/* result of the whole expression */
+	bool		resnull;
+};
+
 /* static function decls */
 static Datum ExecEvalArrayRef(ArrayRefExprState *astate,
 				 ExprContext *econtext,
@@ -181,6 +266,15 @@ static Datum ExecEvalArrayCoerceExpr(ArrayCoerceExprState *astate,
 						bool *isNull, ExprDoneCond *isDone);
 static Datum ExecEvalCurrentOfExpr(ExprState *exprstate, ExprContext *econtext,
 					  bool *isNull, ExprDoneCond *isDone);
+static void CheckVarSlotCompatibility(Var *variable, TupleTableSlot *slot);
+static ExprState *ExecInitExprRec(Expr *node, PlanState *parent);
+static void ExecCompileExpr(ExprState *state);
+static void ExecCompileExprRec(ExprProgram *prog, ExprState *state,
+				   Datum *resvalue, bool *resnull);
+static int	ExprProgramAddStep(ExprProgram *prog, ExprStepOp opcode,
+				   Datum *resvalue, bool *resnull);
+static Datum ExecInterpExpr(ExprState *state, ExprContext *econtext,
+			   bool *isNull, ExprDoneCond *isDone);
 
 
 /* ----------------------------------------------------------------
@@ -606,22 +700,41 @@ ExecEvalScalarVar(ExprState *exprstate, ExprContext *econtext,
 	Assert(attnum != InvalidAttrNumber);
 
 	/*
-	 * If it's a user attribute, check validity (bogus system attnums will be
-	 * caught inside slot_getattr).  What we have to check for here is the
-	 * possibility of an attribute having been changed in type since the plan
-	 * tree was created.  Ideally the plan will get invalidated and not
-	 * re-used, but just in case, we keep these defenses.  Fortunately it's
-	 * sufficient to check once on the first time through.
-	 *
-	 * Note: we allow a reference to a dropped attribute.  slot_getattr will
-	 * force a NULL result in such cases.
-	 *
-	 * Note: ideally we'd check typmod as well as typid, but that seems
-	 * impractical at the moment: in many cases the tupdesc will have been
-	 * generated by ExecTypeFromTL(), and that can't guarantee to generate an
-	 * accurate typmod in all cases, because some expression node types don't
-	 * carry typmod.
+	 * Check validity of the attribute.  It's sufficient to do so once on the
+	 * first time through.
 	 */
+	CheckVarSlotCompatibility(variable, slot);
+
+	/* Skip the checking on future executions of node */
+	exprstate->evalfunc = ExecEvalScalarVarFast;
+
+	/* Fetch the value from the slot */
+	return slot_getattr(slot, attnum, isNull);
+}
+
+/*
+ * CheckVarSlotCompatibility
+ *
+ * If the Var is a user attribute, check validity (bogus system attnums will
+ * be caught inside slot_getattr).  What we have to check for here is the
+ * possibility of an attribute having been changed in type since the plan
+ * tree was created.  Ideally the plan will get invalidated and not re-used,
+ * but just in case, we keep these defenses.
+ *
+ * Note: we allow a reference to a dropped attribute.  slot_getattr will
+ * force a NULL result in such cases.
+ *
+ * Note: ideally we'd check typmod as well as typid, but that seems
+ * impractical at the moment: in many cases the tupdesc will have been
+ * generated by ExecTypeFromTL(), and that can't guarantee to generate an
+ * accurate typmod in all cases, because some expression node types don't
+ * carry typmod.
+ */
+static void
+CheckVarSlotCompatibility(Var *variable, TupleTableSlot *slot)
+{
+	AttrNumber	attnum = variable->varattno;
+
 	if (attnum > 0)
 	{
 		TupleDesc	slot_tupdesc = slot->tts_tupleDescriptor;
@@ -644,12 +757,6 @@ ExecEvalScalarVar(ExprState *exprstate, ExprContext *econtext,
 								   format_type_be(variable->vartype))));
 		}
 	}
-
-	/* Skip the checking on future executions of node */
-	exprstate->evalfunc = ExecEvalScalarVarFast;
-
-	/* Fetch the value from the slot */
-	return slot_getattr(slot, attnum, isNull);
 }
 
 /* ----------------------------------------------------------------
@@ -4344,12 +4451,42 @@ ExecEvalExprSwitchContext(ExprState *expression,
  * 'parent' may be NULL if we are preparing an expression that is not
  * associated with a plan tree.  (If so, it can't have aggs or subplans.)
  * This case should usually come through ExecPrepareExpr, not directly here.
+ *
+ * Once the state tree is built, its top node (or the top node of each list
+ * member, for an implicit-AND qual list or a targetlist) is compiled into a
+ * flattened program if that is worthwhile; see ExecCompileExpr.
  */
 ExprState *
 ExecInitExpr(Expr *node, PlanState *parent)
 {
 	ExprState  *state;
 
+	state = ExecInitExprRec(node, parent);
+
+	if (state == NULL)
+		return NULL;
+
+	if (IsA(state, List))
+	{
+		ListCell   *l;
+
+		foreach(l, (List *) state)
+			ExecCompileExpr((ExprState *) lfirst(l));
+	}
+	else
+		ExecCompileExpr(state);
+
+	return state;
+}
+
+/*
+ * ExecInitExprRec: the recursive workhorse of ExecInitExpr
+ */
+static ExprState *
+ExecInitExprRec(Expr *node, PlanState *parent)
+{
+	ExprState  *state;
+
 	if (node == NULL)
 		return NULL;
 
@@ -4417,8 +4554,8 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					aggstate->aggs = lcons(astate, aggstate->aggs);
 					naggs = ++aggstate->numaggs;
 
-					astate->args = (List *) ExecInitExpr((Expr *) aggref->args,
-														 parent);
+					astate->args = (List *) ExecInitExprRec((Expr *) aggref->args,
+															parent);
 
 					/*
 					 * Complain if the aggregate's arguments contain any
@@ -4455,8 +4592,8 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					if (wfunc->winagg)
 						winstate->numaggs++;
 
-					wfstate->args = (List *) ExecInitExpr((Expr *) wfunc->args,
-														  parent);
+					wfstate->args = (List *) ExecInitExprRec((Expr *) wfunc->args,
+															 parent);
 
 					/*
 					 * Complain if the windowfunc's arguments contain any
@@ -4484,12 +4621,12 @@ ExecInitExpr(Expr *node, PlanState *parent)
 
 				astate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalArrayRef;
 				astate->refupperindexpr = (List *)
-					ExecInitExpr((Expr *) aref->refupperindexpr, parent);
+					ExecInitExprRec((Expr *) aref->refupperindexpr, parent);
 				astate->reflowerindexpr = (List *)
-					ExecInitExpr((Expr *) aref->reflowerindexpr, parent);
-				astate->refexpr = ExecInitExpr(aref->refexpr, parent);
-				astate->refassgnexpr = ExecInitExpr(aref->refassgnexpr,
-													parent);
+					ExecInitExprRec((Expr *) aref->reflowerindexpr, parent);
+				astate->refexpr = ExecInitExprRec(aref->refexpr, parent);
+				astate->refassgnexpr = ExecInitExprRec(aref->refassgnexpr,
+													   parent);
 				/* do one-time catalog lookups for type info */
 				astate->refattrlength = get_typlen(aref->refarraytype);
 				get_typlenbyvalalign(aref->refelemtype,
@@ -4506,7 +4643,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 
 				fstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalFunc;
 				fstate->args = (List *)
-					ExecInitExpr((Expr *) funcexpr->args, parent);
+					ExecInitExprRec((Expr *) funcexpr->args, parent);
 				fstate->func.fn_oid = InvalidOid;		/* not initialized */
 				state = (ExprState *) fstate;
 			}
@@ -4518,7 +4655,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 
 				fstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalOper;
 				fstate->args = (List *)
-					ExecInitExpr((Expr *) opexpr->args, parent);
+					ExecInitExprRec((Expr *) opexpr->args, parent);
 				fstate->func.fn_oid = InvalidOid;		/* not initialized */
 				state = (ExprState *) fstate;
 			}
@@ -4530,7 +4667,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 
 				fstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalDistinct;
 				fstate->args = (List *)
-					ExecInitExpr((Expr *) distinctexpr->args, parent);
+					ExecInitExprRec((Expr *) distinctexpr->args, parent);
 				fstate->func.fn_oid = InvalidOid;		/* not initialized */
 				state = (ExprState *) fstate;
 			}
@@ -4542,7 +4679,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 
 				fstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalNullIf;
 				fstate->args = (List *)
-					ExecInitExpr((Expr *) nullifexpr->args, parent);
+					ExecInitExprRec((Expr *) nullifexpr->args, parent);
 				fstate->func.fn_oid = InvalidOid;		/* not initialized */
 				state = (ExprState *) fstate;
 			}
@@ -4554,7 +4691,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 
 				sstate->fxprstate.xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalScalarArrayOp;
 				sstate->fxprstate.args = (List *)
-					ExecInitExpr((Expr *) opexpr->args, parent);
+					ExecInitExprRec((Expr *) opexpr->args, parent);
 				sstate->fxprstate.func.fn_oid = InvalidOid;		/* not initialized */
 				sstate->element_type = InvalidOid;		/* ditto */
 				state = (ExprState *) sstate;
@@ -4582,7 +4719,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 						break;
 				}
 				bstate->args = (List *)
-					ExecInitExpr((Expr *) boolexpr->args, parent);
+					ExecInitExprRec((Expr *) boolexpr->args, parent);
 				state = (ExprState *) bstate;
 			}
 			break;
@@ -4621,7 +4758,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				FieldSelectState *fstate = makeNode(FieldSelectState);
 
 				fstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalFieldSelect;
-				fstate->arg = ExecInitExpr(fselect->arg, parent);
+				fstate->arg = ExecInitExprRec(fselect->arg, parent);
 				fstate->argdesc = NULL;
 				state = (ExprState *) fstate;
 			}
@@ -4632,8 +4769,8 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				FieldStoreState *fstate = makeNode(FieldStoreState);
 
 				fstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalFieldStore;
-				fstate->arg = ExecInitExpr(fstore->arg, parent);
-				fstate->newvals = (List *) ExecInitExpr((Expr *) fstore->newvals, parent);
+				fstate->arg = ExecInitExprRec(fstore->arg, parent);
+				fstate->newvals = (List *) ExecInitExprRec((Expr *) fstore->newvals, parent);
 				fstate->argdesc = NULL;
 				state = (ExprState *) fstate;
 			}
@@ -4644,7 +4781,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				GenericExprState *gstate = makeNode(GenericExprState);
 
 				gstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalRelabelType;
-				gstate->arg = ExecInitExpr(relabel->arg, parent);
+				gstate->arg = ExecInitExprRec(relabel->arg, parent);
 				state = (ExprState *) gstate;
 			}
 			break;
@@ -4656,7 +4793,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				bool		typisvarlena;
 
 				iostate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalCoerceViaIO;
-				iostate->arg = ExecInitExpr(iocoerce->arg, parent);
+				iostate->arg = ExecInitExprRec(iocoerce->arg, parent);
 				/* lookup the result type's input function */
 				getTypeInputInfo(iocoerce->resulttype, &iofunc,
 								 &iostate->intypioparam);
@@ -4674,7 +4811,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				ArrayCoerceExprState *astate = makeNode(ArrayCoerceExprState);
 
 				astate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalArrayCoerceExpr;
-				astate->arg = ExecInitExpr(acoerce->arg, parent);
+				astate->arg = ExecInitExprRec(acoerce->arg, parent);
 				astate->resultelemtype = get_element_type(acoerce->resulttype);
 				if (astate->resultelemtype == InvalidOid)
 					ereport(ERROR,
@@ -4694,7 +4831,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				ConvertRowtypeExprState *cstate = makeNode(ConvertRowtypeExprState);
 
 				cstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalConvertRowtype;
-				cstate->arg = ExecInitExpr(convert->arg, parent);
+				cstate->arg = ExecInitExprRec(convert->arg, parent);
 				state = (ExprState *) cstate;
 			}
 			break;
@@ -4706,7 +4843,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				ListCell   *l;
 
 				cstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalCase;
-				cstate->arg = ExecInitExpr(caseexpr->arg, parent);
+				cstate->arg = ExecInitExprRec(caseexpr->arg, parent);
 				foreach(l, caseexpr->args)
 				{
 					CaseWhen   *when = (CaseWhen *) lfirst(l);
@@ -4715,12 +4852,12 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					Assert(IsA(when, CaseWhen));
 					wstate->xprstate.evalfunc = NULL;	/* not used */
 					wstate->xprstate.expr = (Expr *) when;
-					wstate->expr = ExecInitExpr(when->expr, parent);
-					wstate->result = ExecInitExpr(when->result, parent);
+					wstate->expr = ExecInitExprRec(when->expr, parent);
+					wstate->result = ExecInitExprRec(when->result, parent);
 					outlist = lappend(outlist, wstate);
 				}
 				cstate->args = outlist;
-				cstate->defresult = ExecInitExpr(caseexpr->defresult, parent);
+				cstate->defresult = ExecInitExprRec(caseexpr->defresult, parent);
 				state = (ExprState *) cstate;
 			}
 			break;
@@ -4737,7 +4874,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					Expr	   *e = (Expr *) lfirst(l);
 					ExprState  *estate;
 
-					estate = ExecInitExpr(e, parent);
+					estate = ExecInitExprRec(e, parent);
 					outlist = lappend(outlist, estate);
 				}
 				astate->elements = outlist;
@@ -4806,7 +4943,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 						 */
 						e = (Expr *) makeNullConst(INT4OID, -1, InvalidOid);
 					}
-					estate = ExecInitExpr(e, parent);
+					estate = ExecInitExprRec(e, parent);
 					outlist = lappend(outlist, estate);
 					i++;
 				}
@@ -4833,7 +4970,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					Expr	   *e = (Expr *) lfirst(l);
 					ExprState  *estate;
 
-					estate = ExecInitExpr(e, parent);
+					estate = ExecInitExprRec(e, parent);
 					outlist = lappend(outlist, estate);
 				}
 				rstate->largs = outlist;
@@ -4844,7 +4981,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					Expr	   *e = (Expr *) lfirst(l);
 					ExprState  *estate;
 
-					estate = ExecInitExpr(e, parent);
+					estate = ExecInitExprRec(e, parent);
 					outlist = lappend(outlist, estate);
 				}
 				rstate->rargs = outlist;
@@ -4897,7 +5034,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					Expr	   *e = (Expr *) lfirst(l);
 					ExprState  *estate;
 
-					estate = ExecInitExpr(e, parent);
+					estate = ExecInitExprRec(e, parent);
 					outlist = lappend(outlist, estate);
 				}
 				cstate->args = outlist;
@@ -4918,7 +5055,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					Expr	   *e = (Expr *) lfirst(l);
 					ExprState  *estate;
 
-					estate = ExecInitExpr(e, parent);
+					estate = ExecInitExprRec(e, parent);
 					outlist = lappend(outlist, estate);
 				}
 				mstate->args = outlist;
@@ -4955,7 +5092,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					Expr	   *e = (Expr *) lfirst(arg);
 					ExprState  *estate;
 
-					estate = ExecInitExpr(e, parent);
+					estate = ExecInitExprRec(e, parent);
 					outlist = lappend(outlist, estate);
 				}
 				xstate->named_args = outlist;
@@ -4966,7 +5103,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					Expr	   *e = (Expr *) lfirst(arg);
 					ExprState  *estate;
 
-					estate = ExecInitExpr(e, parent);
+					estate = ExecInitExprRec(e, parent);
 					outlist = lappend(outlist, estate);
 				}
 				xstate->args = outlist;
@@ -4980,7 +5117,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				NullTestState *nstate = makeNode(NullTestState);
 
 				nstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalNullTest;
-				nstate->arg = ExecInitExpr(ntest->arg, parent);
+				nstate->arg = ExecInitExprRec(ntest->arg, parent);
 				nstate->argdesc = NULL;
 				state = (ExprState *) nstate;
 			}
@@ -4991,7 +5128,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				GenericExprState *gstate = makeNode(GenericExprState);
 
 				gstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalBooleanTest;
-				gstate->arg = ExecInitExpr(btest->arg, parent);
+				gstate->arg = ExecInitExprRec(btest->arg, parent);
 				state = (ExprState *) gstate;
 			}
 			break;
@@ -5001,7 +5138,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				CoerceToDomainState *cstate = makeNode(CoerceToDomainState);
 
 				cstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalCoerceToDomain;
-				cstate->arg = ExecInitExpr(ctest->arg, parent);
+				cstate->arg = ExecInitExprRec(ctest->arg, parent);
 				cstate->constraints = GetDomainConstraints(ctest->resulttype);
 				state = (ExprState *) cstate;
 			}
@@ -5016,7 +5153,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				GenericExprState *gstate = makeNode(GenericExprState);
 
 				gstate->xprstate.evalfunc = NULL;		/* not used */
-				gstate->arg = ExecInitExpr(tle->expr, parent);
+				gstate->arg = ExecInitExprRec(tle->expr, parent);
 				state = (ExprState *) gstate;
 			}
 			break;
@@ -5028,8 +5165,8 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				foreach(l, (List *) node)
 				{
 					outlist = lappend(outlist,
-									  ExecInitExpr((Expr *) lfirst(l),
-												   parent));
+									  ExecInitExprRec((Expr *) lfirst(l),
+													  parent));
 				}
 				/* Don't fall through to the "common" code below */
 				return (ExprState *) outlist;
@@ -5076,6 +5213,555 @@ ExecPrepareExpr(Expr *node, EState *estate)
 }
 
 
+/* ----------------------------------------------------------------
+ *					 Flattened expression programs
+ *
+ * Evaluating an ExprState tree costs an indirect function call per node,
+ * plus a loop over the argument list of every function, for each row.  For
+ * the expressions that dominate typical quals (comparisons of columns with
+ * constants or parameters, combined with AND and OR) that overhead is a
+ * good part of the total.  So ExecInitExpr additionally compiles the top of
+ * such an expression into a flat array of steps, which ExecInterpExpr runs
+ * in a single loop.  Each step stores its result directly where its
+ * consumer wants it, and AND/OR jump past their remaining arguments as soon
+ * as the result is known.
+ *
+ * Only Vars, Consts, functions and operators, boolean expressions and
+ * RelabelTypes have steps of their own.  Any other node becomes a step that
+ * evaluates that node's ExprState tree in the usual way.
+ *
+ * The ExprState tree is left intact, since some callers look into it (for
+ * instance to find the hash keys of a hash join), and it is still used for
+ * the nodes without steps.  Only the evalfunc of the top node is replaced.
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * ExecCompileExpr: compile the expression below 'state' into a program, if
+ * that is worthwhile
+ */
+static void
+ExecCompileExpr(ExprState *state)
+{
+	ExprProgram *prog;
+	Expr	   *expr;
+
+	/* A targetlist entry is evaluated by way of its argument */
+	if (IsA(state, GenericExprState) && IsA(state->expr, TargetEntry))
+		state = ((GenericExprState *) state)->arg;
+
+	if (state == NULL || IsA(state, List))
+		return;
+
+	/*
+	 * Only bother if the top node is one that a step can do better than its
+	 * evalfunc.  Expressions that might return a set are evaluated the old
+	 * way, since the interpreter has no notion of ExprMultipleResult.
+	 */
+	expr = state->expr;
+	if (!IsA(expr, FuncExpr) && !IsA(expr, OpExpr) && !IsA(expr, BoolExpr))
+		return;
+	if (expression_returns_set((Node *) expr))
+		return;
+
+	prog = (ExprProgram *) palloc(sizeof(ExprProgram));
+	prog->maxsteps = 16;
+	prog->steps = (ExprStep *) palloc(prog->maxsteps * sizeof(ExprStep));
+	prog->nsteps = 0;
+	prog->resvalue = (Datum) 0;
+	prog->resnull = true;
+
+	ExecCompileExprRec(prog, state, &prog->resvalue, &prog->resnull);
+	ExprProgramAddStep(prog, EEOP_DONE, NULL, NULL);
+
+	state->program = prog;
+	state->evalfunc = ExecInterpExpr;
+}
+
+/*
+ * ExecCompileExprRec: append the steps that evaluate 'state' into *resvalue
+ * and *resnull
+ */
+static void
+ExecCompileExprRec(ExprProgram *prog, ExprState *state,
+				   Datum *resvalue, bool *resnull)
+{
+	Expr	   *expr = state->expr;
+	int			stepno;
+
+	switch (nodeTag(expr))
+	{
+		case T_Var:
+			{
+				Var		   *variable = (Var *) expr;
+
+				/* whole-row Vars need their WholeRowVarExprState */
+				if (variable->varattno == InvalidAttrNumber)
+					break;
+
+				stepno = ExprProgramAddStep(prog, EEOP_VAR_FIRST,
+											resvalue, resnull);
+				prog->steps[stepno].d.var.var = variable;
+				prog->steps[stepno].d.var.attnum = variable->varattno;
+				return;
+			}
+		case T_Const:
+			{
+				Const	   *con = (Const *) expr;
+
+				stepno = ExprProgramAddStep(prog, EEOP_CONST,
+											resvalue, resnull);
+				prog->steps[stepno].d.constval.value = con->constvalue;
+				prog->steps[stepno].d.constval.isnull = con->constisnull;
+				return;
+			}
+		case T_FuncExpr:
+		case T_OpExpr:
+			{
+				FuncExprState *fcache = (FuncExprState *) state;
+				int			nargs = list_length(fcache->args);
+				ListCell   *l;
+				int			i;
+
+				/* let the tree complain about this, on first use */
+				if (nargs > FUNC_MAX_ARGS)
+					break;
+
+				/* arguments go straight into the function's call info */
+				i = 0;
+				foreach(l, fcache->args)
+				{
+					ExecCompileExprRec(prog, (ExprState *) lfirst(l),
+									   &fcache->fcinfo_data.arg[i],
+									   &fcache->fcinfo_data.argnull[i]);
+					i++;
+				}
+
+				stepno = ExprProgramAddStep(prog, EEOP_FUNCEXPR_INIT,
+											resvalue, resnull);
+				prog->steps[stepno].d.func.fcache = fcache;
+				prog->steps[stepno].d.func.fcinfo = NULL;
+				prog->steps[stepno].d.func.nargs = nargs;
+				return;
+			}
+		case T_BoolExpr:
+			{
+				BoolExprState *bstate = (BoolExprState *) state;
+				BoolExprType boolop = ((BoolExpr *) expr)->boolop;
+				int			nargs = list_length(bstate->args);
+				bool	   *anynull;
+				List	   *adjust_jumps = NIL;
+				ListCell   *l;
+				int			i;
+
+				if (boolop == NOT_EXPR)
+				{
+					ExecCompileExprRec(prog,
+									   (ExprState *) linitial(bstate->args),
+									   resvalue, resnull);
+					ExprProgramAddStep(prog, EEOP_BOOL_NOT,
+									   resvalue, resnull);
+					return;
+				}
+
+				/*
+				 * Each argument is evaluated into our own result location,
+				 * then checked by a step that jumps to the end if it decided
+				 * the result.  The last check works out the final result.
+				 */
+				anynull = (bool *) palloc(sizeof(bool));
+				i = 0;
+				foreach(l, bstate->args)
+				{
+					ExprStepOp	opcode;
+
+					ExecCompileExprRec(prog, (ExprState *) lfirst(l),
+									   resvalue, resnull);
+
+					if (i == 0)
+						opcode = (boolop == AND_EXPR) ?
+							EEOP_BOOL_AND_STEP_FIRST : EEOP_BOOL_OR_STEP_FIRST;
+					else if (i == nargs - 1)
+						opcode = (boolop == AND_EXPR) ?
+							EEOP_BOOL_AND_STEP_LAST : EEOP_BOOL_OR_STEP_LAST;
+					else
+						opcode = (boolop == AND_EXPR) ?
+							EEOP_BOOL_AND_STEP : EEOP_BOOL_OR_STEP;
+
+					stepno = ExprProgramAddStep(prog, opcode,
+												resvalue, resnull);
+					prog->steps[stepno].d.boolexpr.anynull = anynull;
+					adjust_jumps = lappend_int(adjust_jumps, stepno);
+					i++;
+				}
+
+				/* all the checks jump to just after the last one */
+				foreach(l, adjust_jumps)
+					prog->steps[lfirst_int(l)].d.boolexpr.jumpdone =
+						prog->nsteps;
+				list_free(adjust_jumps);
+				return;
+			}
+		case T_RelabelType:
+			/* a no-op at runtime, so just evaluate the argument */
+			ExecCompileExprRec(prog, ((GenericExprState *) state)->arg,
+							   resvalue, resnull);
+			return;
+		default:
+			break;
+	}
+
+	/* No specialized step, so let the ExprState tree do the work */
+	stepno = ExprProgramAddStep(prog, EEOP_SUBTREE, resvalue, resnull);
+	prog->steps[stepno].d.subtree.state = state;
+}
+
+/*
+ * ExprProgramAddStep: append a step to the program, returning its index
+ *
+ * Steps may move while the program is being built, so callers must
+ * remember the index rather than a pointer.
+ */
+static int
+ExprProgramAddStep(ExprProgram *prog, ExprStepOp opcode,
+				   Datum *resvalue, bool *resnull)
+{
+	ExprStep   *step;
+
+	if (prog->nsteps >= prog->maxsteps)
+	{
+		prog->maxsteps *= 2;
+		prog->steps = (ExprStep *) repalloc(prog->steps,
+										prog->maxsteps * sizeof(ExprStep));
+	}
+
+	step = &prog->steps[prog->nsteps];
+	step->opcode = opcode;
+	step->resvalue = resvalue;
+	step->resnull = resnull;
+
+	return prog->nsteps++;
+}
+
+/*
+ * Dispatch to the next step.  Where the compiler supports taking the
+ * address of a label (GCC and compatibles), jump straight to the code for
+ * the opcode; this saves the range check of a switch, and lets the branch
+ * predictor learn each opcode's likely successor.
+ */
+#if defined(__GNUC__)
+#define EEO_USE_COMPUTED_GOTO
+#endif
+
+#ifdef EEO_USE_COMPUTED_GOTO
+#define EEO_SWITCH()
+#define EEO_CASE(name)		CASE_##name:
+#define EEO_DISPATCH()		goto *dispatch_table[op->opcode]
+#else
+#define EEO_SWITCH()		starteval: switch ((int) op->opcode)
+#define EEO_CASE(name)		case name:
+#define EEO_DISPATCH()		goto starteval
+#endif
+
+#define EEO_NEXT() \
+	do { \
+		op++; \
+		EEO_DISPATCH(); \
+	} while (0)
+
+#define EEO_JUMP(stepno) \
+	do { \
+		op = &prog->steps[(stepno)]; \
+		EEO_DISPATCH(); \
+	} while (0)
+
+/* ----------------------------------------------------------------
+ *		ExecInterpExpr
+ *
+ *		Evaluate an expression compiled by ExecCompileExpr.
+ * ----------------------------------------------------------------
+ */
+static Datum
+ExecInterpExpr(ExprState *state, ExprContext *econtext,
+			   bool *isNull, ExprDoneCond *isDone)
+{
+	ExprProgram *prog = state->program;
+	ExprStep   *op;
+	PgStat_FunctionCallUsage fcusage;
+
+#ifdef EEO_USE_COMPUTED_GOTO
+	static const void *const dispatch_table[] = {
+		&&CASE_EEOP_DONE,
+		&&CASE_EEOP_VAR_FIRST,
+		&&CASE_EEOP_SCAN_VAR,
+		&&CASE_EEOP_INNER_VAR,
+		&&CASE_EEOP_OUTER_VAR,
+		&&CASE_EEOP_CONST,
+		&&CASE_EEOP_FUNCEXPR_INIT,
+		&&CASE_EEOP_FUNCEXPR,
+		&&CASE_EEOP_FUNCEXPR_STRICT,
+		&&CASE_EEOP_FUNCEXPR_STRICT_2,
+		&&CASE_EEOP_BOOL_AND_STEP_FIRST,
+		&&CASE_EEOP_BOOL_AND_STEP,
+		&&CASE_EEOP_BOOL_AND_STEP_LAST,
+		&&CASE_EEOP_BOOL_OR_STEP_FIRST,
+		&&CASE_EEOP_BOOL_OR_STEP,
+		&&CASE_EEOP_BOOL_OR_STEP_LAST,
+		&&CASE_EEOP_BOOL_NOT,
+		&&CASE_EEOP_SUBTREE
+	};
+
+	StaticAssertStmt(lengthof(dispatch_table) == EEOP_LAST,
+					 "dispatch_table out of sync with ExprStepOp");
+#endif
+
+	/* Guard against stack overflow due to overly complex expressions */
+	check_stack_depth();
+
+	if (isDone)
+		*isDone = ExprSingleResult;
+
+	op = prog->steps;
+
+	EEO_SWITCH()
+	{
+		EEO_CASE(EEOP_DONE)
+		{
+			*isNull = prog->resnull;
+			return prog->resvalue;
+		}
+
+		EEO_CASE(EEOP_VAR_FIRST)
+		{
+			Var		   *variable = op->d.var.var;
+
+			/* as in ExecEvalScalarVar, check the Var once, then fetch */
+			switch (variable->varno)
+			{
+				case INNER_VAR:
+					CheckVarSlotCompatibility(variable,
+											  econtext->ecxt_innertuple);
+					op->opcode = EEOP_INNER_VAR;
+					break;
+				case OUTER_VAR:
+					CheckVarSlotCompatibility(variable,
+											  econtext->ecxt_outertuple);
+					op->opcode = EEOP_OUTER_VAR;
+					break;
+				default:
+					CheckVarSlotCompatibility(variable,
+											  econtext->ecxt_scantuple);
+					op->opcode = EEOP_SCAN_VAR;
+					break;
+			}
+			EEO_DISPATCH();
+		}
+
+		EEO_CASE(EEOP_SCAN_VAR)
+		{
+			*op->resvalue = slot_getattr(econtext->ecxt_scantuple,
+										 op->d.var.attnum, op->resnull);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_INNER_VAR)
+		{
+			*op->resvalue = slot_getattr(econtext->ecxt_innertuple,
+										 op->d.var.attnum, op->resnull);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_OUTER_VAR)
+		{
+			*op->resvalue = slot_getattr(econtext->ecxt_outertuple,
+										 op->d.var.attnum, op->resnull);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_CONST)
+		{
+			*op->resvalue = op->d.constval.value;
+			*op->resnull = op->d.constval.isnull;
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_FUNCEXPR_INIT)
+		{
+			FuncExprState *fcache = op->d.func.fcache;
+
+			/*
+			 * Look up the function on first use, as ExecEvalFunc and
+			 * ExecEvalOper do, then pick the step that calls it.  The
+			 * arguments have already been stored; init_fcache doesn't touch
+			 * them.
+			 */
+			if (fcache->func.fn_oid == InvalidOid)
+			{
+				if (IsA(fcache->xprstate.expr, FuncExpr))
+				{
+					FuncExpr   *func = (FuncExpr *) fcache->xprstate.expr;
+
+					init_fcache(func->funcid, func->inputcollid, fcache,
+								econtext->ecxt_per_query_memory, false);
+				}
+				else
+				{
+					OpExpr	   *opexpr = (OpExpr *) fcache->xprstate.expr;
+
+					init_fcache(opexpr->opfuncid, opexpr->inputcollid, fcache,
+								econtext->ecxt_per_query_memory, false);
+				}
+			}
+
+			op->d.func.fcinfo = &fcache->fcinfo_data;
+			if (!fcache->func.fn_strict)
+				op->opcode = EEOP_FUNCEXPR;
+			else if (op->d.func.nargs == 2)
+				op->opcode = EEOP_FUNCEXPR_STRICT_2;
+			else
+				op->opcode = EEOP_FUNCEXPR_STRICT;
+			EEO_DISPATCH();
+		}
+
+		EEO_CASE(EEOP_FUNCEXPR)
+		{
+			FunctionCallInfo fcinfo = op->d.func.fcinfo;
+
+			pgstat_init_function_usage(fcinfo, &fcusage);
+			fcinfo->isnull = false;
+			*op->resvalue = FunctionCallInvoke(fcinfo);
+			*op->resnull = fcinfo->isnull;
+			pgstat_end_function_usage(&fcusage, true);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_FUNCEXPR_STRICT)
+		{
+			FunctionCallInfo fcinfo = op->d.func.fcinfo;
+			int			i;
+
+			for (i = 0; i < op->d.func.nargs; i++)
+			{
+				if (fcinfo->argnull[i])
+				{
+					*op->resvalue = (Datum) 0;
+					*op->resnull = true;
+					EEO_NEXT();
+				}
+			}
+
+			pgstat_init_function_usage(fcinfo, &fcusage);
+			fcinfo->isnull = false;
+			*op->resvalue = FunctionCallInvoke(fcinfo);
+			*op->resnull = fcinfo->isnull;
+			pgstat_end_function_usage(&fcusage, true);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_FUNCEXPR_STRICT_2)
+		{
+			FunctionCallInfo fcinfo = op->d.func.fcinfo;
+
+			if (fcinfo->argnull[0] || fcinfo->argnull[1])
+			{
+				*op->resvalue = (Datum) 0;
+				*op->resnull = true;
+				EEO_NEXT();
+			}
+
+			pgstat_init_function_usage(fcinfo, &fcusage);
+			fcinfo->isnull = false;
+			*op->resvalue = FunctionCallInvoke(fcinfo);
+			*op->resnull = fcinfo->isnull;
+			pgstat_end_function_usage(&fcusage, true);
+			EEO_NEXT();
+		}
+
+		/*
+		 * AND is false if any input is false, else NULL if any input is
+		 * NULL, else true; cf. ExecEvalAnd.  A false input decides the
+		 * result, which is then already in place, so we can skip the rest.
+		 */
+		EEO_CASE(EEOP_BOOL_AND_STEP_FIRST)
+		{
+			*op->d.boolexpr.anynull = false;
+			/* FALL THRU */
+		}
+
+		EEO_CASE(EEOP_BOOL_AND_STEP)
+		{
+			if (*op->resnull)
+				*op->d.boolexpr.anynull = true;
+			else if (!DatumGetBool(*op->resvalue))
+				EEO_JUMP(op->d.boolexpr.jumpdone);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_BOOL_AND_STEP_LAST)
+		{
+			if (*op->resnull)
+				;				/* result is NULL */
+			else if (!DatumGetBool(*op->resvalue))
+				;				/* result is false */
+			else if (*op->d.boolexpr.anynull)
+			{
+				*op->resvalue = (Datum) 0;
+				*op->resnull = true;
+			}
+			EEO_NEXT();
+		}
+
+		/* OR is the same, with true and false swapped; cf. ExecEvalOr */
+		EEO_CASE(EEOP_BOOL_OR_STEP_FIRST)
+		{
+			*op->d.boolexpr.anynull = false;
+			/* FALL THRU */
+		}
+
+		EEO_CASE(EEOP_BOOL_OR_STEP)
+		{
+			if (*op->resnull)
+				*op->d.boolexpr.anynull = true;
+			else if (DatumGetBool(*op->resvalue))
+				EEO_JUMP(op->d.boolexpr.jumpdone);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_BOOL_OR_STEP_LAST)
+		{
+			if (*op->resnull)
+				;				/* result is NULL */
+			else if (DatumGetBool(*op->resvalue))
+				;				/* result is true */
+			else if (*op->d.boolexpr.anynull)
+			{
+				*op->resvalue = (Datum) 0;
+				*op->resnull = true;
+			}
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_BOOL_NOT)
+		{
+			/* NOT NULL is NULL, so leave a NULL input alone */
+			if (!*op->resnull)
+				*op->resvalue = BoolGetDatum(!DatumGetBool(*op->resvalue));
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_SUBTREE)
+		{
+			*op->resvalue = ExecEvalExpr(op->d.subtree.state, econtext,
+										 op->resnull, NULL);
+			EEO_NEXT();
+		}
+	}
+
+	elog(ERROR, "unrecognized expression step: %d", (int) op->opcode);
+	return (Datum) 0;			/* keep compiler quiet */
+}
+
+
 /* ----------------------------------------------------------------
  *					 ExecQual / ExecTargetList / ExecProject
  * ----------------------------------------------------------------
@@ -154,6 +154,8 @@ CreateExecutorState(void)
 	estate->es_epqTupleSet = NULL;
 	estate->es_epqScanDone = NULL;
 
+	estate->es_parallel_scan = NULL;
+
 	/*
 	 * Return the executor state structure
 	 */
@@ -44,6 +44,21 @@
  *	  is used to run finalize functions and compute the output tuple;
  *	  this context can be reset once per output tuple.
  *
+ *	  In AGG_HASHED mode, the hash table is not allowed to grow beyond
+ *	  work_mem.  Once it is full, no new groups are added to it: input tuples
+ *	  of groups already in the table are aggregated as usual, while all the
+ *	  others are written to one of HASHAGG_PARTITIONS temporary batch files,
+ *	  chosen by their hash value.  When the groups in the table have been
+ *	  returned, each batch is aggregated in turn with a fresh hash table,
+ *	  and a batch that still does not fit is split again, on the next
+ *	  HASHAGG_PARTITION_BITS bits of the hash value.  All the tuples of a
+ *	  group always go to the same batch, so each group is aggregated exactly
+ *	  once.  The memory in use is only checked when a group is added, and
+ *	  only new groups are kept out of the table: transition values that
+ *	  keep growing as tuples are aggregated into groups already in the table
+ *	  (array_agg, string_agg and the like) can still take it past work_mem,
+ *	  since their state cannot be written out and resumed later.
+ *
  *	  The executor's AggState node is passed as the fmgr "context" value in
  *	  all transfunc and finalfunc calls.  It is not recommended that the
  *	  transition functions look at the AggState node directly, but they can
@@ -78,6 +93,8 @@
 
 #include "postgres.h"
 
+#include <limits.h>
+
 #include "access/htup_details.h"
 #include "catalog/objectaccess.h"
 #include "catalog/pg_aggregate.h"
@@ -92,6 +109,7 @@
 #include "parser/parse_agg.h"
 #include "parser/parse_coerce.h"
 #include "pgxc/pgxc.h"
+#include "storage/buffile.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
@@ -275,6 +293,27 @@ typedef struct AggHashEntryData
 	AggStatePerGroupData pergroup[1];	/* VARIABLE LENGTH ARRAY */
 }	AggHashEntryData;	/* VARIABLE LENGTH STRUCT */
 
+/*
+ * Batch files being written by a hashed aggregation pass that ran out of
+ * memory.  Each file holds the input tuples of one partition, each preceded
+ * by its hash value.
+ */
+typedef struct HashAggSpillData
+{
+	int			shift;			/* shift hash value right this much ... */
+	/* ... and take the low HASHAGG_PARTITION_BITS bits as partition number */
+	BufFile   **files;			/* one per partition, created on demand */
+} HashAggSpillData;
+
+/*
+ * A batch of spilled input tuples, waiting to be aggregated by a later pass.
+ */
+typedef struct HashAggBatch
+{
+	BufFile    *file;			/* spilled tuples and their hash values */
+	int			depth;			/* partitioning depth of the pass to come */
+} HashAggBatch;
+
 
 static void initialize_aggregates(AggState *aggstate,
 					  AggStatePerAgg peragg,
@@ -302,6 +341,16 @@ static AggHashEntry lookup_hash_entry(AggState *aggstate,
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
 static void agg_fill_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
+static bool agg_refill_hash_table(AggState *aggstate);
+static uint32 hash_agg_hash_tuple(AggState *aggstate, TupleTableSlot *slot);
+static void hash_agg_check_limits(AggState *aggstate);
+static void hash_agg_enter_spill_mode(AggState *aggstate);
+static void hash_agg_spill_tuple(AggState *aggstate, TupleTableSlot *slot,
+					 uint32 hashvalue);
+static TupleTableSlot *hash_agg_read_tuple(BufFile *file, uint32 *hashvalue,
+					TupleTableSlot *slot);
+static void hash_agg_finish_spill(AggState *aggstate);
+static void hash_agg_reset_spill(AggState *aggstate);
 static Datum GetAggInitVal(Datum textInitVal, Oid transtype);
 
 
@@ -700,10 +749,10 @@ advance_aggregates(AggState *aggstate, AggStatePerGroup pergroup)
 #ifdef PGXC
 			if (aggstate->skip_trans)
 			{
-				Assert(IS_PGXC_COORDINATOR);
 				/*
-				 * we are collecting results sent by the Datanodes, so advance
-				 * collections instead of transitions
+				 * we are collecting results sent by the Datanodes, or by the
+				 * parallel scan workers of a Datanode, so advance collections
+				 * instead of transitions
 				 */
 				advance_collection_function(aggstate, peraggstate,
 											pergroupstate, &fcinfo);
@@ -1016,6 +1065,7 @@ build_hash_table(AggState *aggstate)
 	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
 	MemoryContext tmpmem = aggstate->tmpcontext->ecxt_per_tuple_memory;
 	Size		entrysize;
+	long		nbuckets;
 
 	Assert(node->aggstrategy == AGG_HASHED);
 	Assert(node->numGroups > 0);
@@ -1023,11 +1073,16 @@ build_hash_table(AggState *aggstate)
 	entrysize = sizeof(AggHashEntryData) +
 		(aggstate->numaggs - 1) * sizeof(AggStatePerGroupData);
 
+	/* No point in sizing the table for more groups than memory allows */
+	nbuckets = Min(node->numGroups,
+				   (long) (aggstate->hash_mem_limit / entrysize));
+	nbuckets = Max(nbuckets, 1);
+
 	aggstate->hashtable = BuildTupleHashTable(node->numCols,
 											  node->grpColIdx,
 											  aggstate->eqfunctions,
 											  aggstate->hashfunctions,
-											  node->numGroups,
+											  nbuckets,
 											  entrysize,
 											  aggstate->aggcontext,
 											  tmpmem);
@@ -1104,6 +1159,9 @@ hash_agg_entry_size(int numAggs)
  * Find or create a hashtable entry for the tuple group containing the
  * given tuple.
  *
+ * Once the hash table is full (hash_spill_mode), no entries are created any
+ * more, and NULL is returned if the group is not in the table already.
+ *
  * When called, CurrentMemoryContext should be the per-query context.
  */
 static AggHashEntry
@@ -1112,7 +1170,7 @@ lookup_hash_entry(AggState *aggstate, TupleTableSlot *inputslot)
 	TupleTableSlot *hashslot = aggstate->hashslot;
 	ListCell   *l;
 	AggHashEntry entry;
-	bool		isnew;
+	bool		isnew = false;
 
 	/* if first time through, initialize hashslot by cloning input slot */
 	if (hashslot->tts_tupleDescriptor == NULL)
@@ -1132,15 +1190,23 @@ lookup_hash_entry(AggState *aggstate, TupleTableSlot *inputslot)
 		hashslot->tts_isnull[varNumber] = inputslot->tts_isnull[varNumber];
 	}
 
-	/* find or create the hashtable entry using the filtered tuple */
+	/*
+	 * find or create the hashtable entry using the filtered tuple; passing
+	 * NULL for isnew only looks it up
+	 */
 	entry = (AggHashEntry) LookupTupleHashEntry(aggstate->hashtable,
 												hashslot,
-												&isnew);
+								   aggstate->hash_spill_mode ? NULL : &isnew);
+	if (entry == NULL)
+		return NULL;
 
 	if (isnew)
 	{
 		/* initialize aggregates for new tuple group */
 		initialize_aggregates(aggstate, aggstate->peragg, entry->pergroup);
+
+		aggstate->hash_ngroups_current++;
+		hash_agg_check_limits(aggstate);
 	}
 
 	return entry;
@@ -1432,18 +1498,89 @@ agg_fill_hash_table(AggState *aggstate)
 		/* Find or build hashtable entry for this tuple's group */
 		entry = lookup_hash_entry(aggstate, outerslot);
 
-		/* Advance the aggregates */
-		advance_aggregates(aggstate, entry->pergroup);
+		/* Advance the aggregates, or keep the tuple for a later batch */
+		if (entry != NULL)
+			advance_aggregates(aggstate, entry->pergroup);
+		else
+			hash_agg_spill_tuple(aggstate, outerslot,
+								 hash_agg_hash_tuple(aggstate, outerslot));
 
 		/* Reset per-input-tuple context after each tuple */
 		ResetExprContext(tmpcontext);
 	}
 
+	/* Queue up the batches this pass has spilled, if any */
+	hash_agg_finish_spill(aggstate);
+
 	aggstate->table_filled = true;
 	/* Initialize to walk the hash table */
 	ResetTupleHashIterator(aggstate->hashtable, &aggstate->hashiter);
 }
 
+/*
+ * ExecAgg for hashed case: aggregate the next spilled batch
+ *
+ * This replaces the contents of the hash table, whose groups must all have
+ * been returned, with the groups of the next batch; tuples of groups that
+ * again do not fit are spilled to new batches.  Returns false if there are
+ * no batches left.
+ */
+static bool
+agg_refill_hash_table(AggState *aggstate)
+{
+	ExprContext *tmpcontext = aggstate->tmpcontext;
+	TupleTableSlot *spillslot = aggstate->hash_spill_slot;
+	HashAggBatch *batch;
+	AggHashEntry entry;
+	uint32		hashvalue;
+
+	if (aggstate->hash_batches == NIL)
+		return false;
+
+	batch = (HashAggBatch *) linitial(aggstate->hash_batches);
+	aggstate->hash_batches = list_delete_first(aggstate->hash_batches);
+
+	/*
+	 * Throw away the groups of the previous pass and start over with an
+	 * empty hash table.  As in ExecReScanAgg, the hash table's own memory
+	 * context has to go too.
+	 */
+	ExecClearTuple(aggstate->ss.ss_ScanTupleSlot);
+	MemoryContextResetAndDeleteChildren(aggstate->aggcontext);
+	build_hash_table(aggstate);
+	aggstate->hash_ngroups_current = 0;
+	aggstate->hash_ngroups_check = 1;
+	aggstate->hash_spill_mode = false;
+	aggstate->hash_pass_depth = batch->depth;
+
+	if (BufFileSeek(batch->file, 0, 0L, SEEK_SET))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+			   errmsg("could not rewind hash-aggregate temporary file: %m")));
+
+	while (hash_agg_read_tuple(batch->file, &hashvalue, spillslot))
+	{
+		tmpcontext->ecxt_outertuple = spillslot;
+
+		entry = lookup_hash_entry(aggstate, spillslot);
+
+		if (entry != NULL)
+			advance_aggregates(aggstate, entry->pergroup);
+		else
+			hash_agg_spill_tuple(aggstate, spillslot, hashvalue);
+
+		ResetExprContext(tmpcontext);
+	}
+
+	BufFileClose(batch->file);
+	pfree(batch);
+
+	hash_agg_finish_spill(aggstate);
+
+	ResetTupleHashIterator(aggstate->hashtable, &aggstate->hashiter);
+	return true;
+}
+
 /*
  * ExecAgg for hashed case: phase 2, retrieving groups from hash table
  */
@@ -1481,7 +1618,11 @@ agg_retrieve_hash_table(AggState *aggstate)
 		entry = (AggHashEntry) ScanTupleHashTable(&aggstate->hashiter);
 		if (entry == NULL)
 		{
-			/* No more entries in hashtable, so done */
+			/* No more entries in hashtable; go on with the next batch */
+			if (agg_refill_hash_table(aggstate))
+				continue;
+
+			/* No more batches either, so done */
 			aggstate->agg_done = TRUE;
 			return NULL;
 		}
@@ -1551,6 +1692,272 @@ agg_retrieve_hash_table(AggState *aggstate)
 	return NULL;
 }
 
+/*
+ * Compute the hash value of an input tuple's grouping columns, for choosing
+ * the batch it is spilled to.
+ */
+static uint32
+hash_agg_hash_tuple(AggState *aggstate, TupleTableSlot *slot)
+{
+	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
+	MemoryContext oldContext;
+	uint32		hashkey = 0;
+	int			i;
+
+	/* Hash functions may leak; use the per-input-tuple context */
+	oldContext = MemoryContextSwitchTo(aggstate->tmpcontext->ecxt_per_tuple_memory);
+
+	for (i = 0; i < node->numCols; i++)
+	{
+		Datum		attr;
+		bool		isNull;
+
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		attr = slot_getattr(slot, node->grpColIdx[i], &isNull);
+
+		/* treat nulls as having hash key 0 */
+		if (!isNull)
+			hashkey ^= DatumGetUInt32(FunctionCall1(&aggstate->hashfunctions[i],
+													attr));
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	return hashkey;
+}
+
+/*
+ * Called after a new group has been added to the hash table, to stop adding
+ * more once the table has used up its memory.
+ *
+ * Finding out how much memory is in use means walking the memory contexts,
+ * which is too slow to do for every group.  Instead, we extrapolate from the
+ * average size of the groups so far and check again once about half of the
+ * remaining space should have been used up.
+ */
+static void
+hash_agg_check_limits(AggState *aggstate)
+{
+	long		ngroups = aggstate->hash_ngroups_current;
+	Size		mem;
+	Size		per_group;
+	long		headroom;
+
+	if (ngroups < aggstate->hash_ngroups_check)
+		return;
+
+	mem = MemoryContextMemAllocated(aggstate->aggcontext, true);
+
+	if (mem > aggstate->hash_mem_limit)
+	{
+		if ((aggstate->hash_pass_depth + 1) * HASHAGG_PARTITION_BITS <= 32)
+			hash_agg_enter_spill_mode(aggstate);
+		else
+		{
+			/*
+			 * The hash value has no bits left to split this batch with (all
+			 * its tuples have much the same hash value), so just let the
+			 * table grow.
+			 */
+			aggstate->hash_ngroups_check = LONG_MAX;
+		}
+		return;
+	}
+
+	per_group = mem / ngroups + 1;
+	headroom = (long) ((aggstate->hash_mem_limit - mem) / per_group / 2);
+	aggstate->hash_ngroups_check = ngroups + Max(headroom, 1);
+}
+
+/*
+ * Stop adding groups to the hash table; set up the batch files that the
+ * tuples of other groups are to be written to instead.
+ */
+static void
+hash_agg_enter_spill_mode(AggState *aggstate)
+{
+	MemoryContext oldContext;
+	HashAggSpillData *spill;
+
+	oldContext = MemoryContextSwitchTo(aggstate->ss.ps.state->es_query_cxt);
+
+	spill = (HashAggSpillData *) palloc(sizeof(HashAggSpillData));
+	spill->shift = 32 - (aggstate->hash_pass_depth + 1) * HASHAGG_PARTITION_BITS;
+	spill->files = (BufFile **) palloc0(sizeof(BufFile *) * HASHAGG_PARTITIONS);
+
+	MemoryContextSwitchTo(oldContext);
+
+	aggstate->hash_spill = spill;
+	aggstate->hash_spill_mode = true;
+	aggstate->hash_ever_spilled = true;
+}
+
+/*
+ * Write an input tuple, whose group is not in the hash table, to its batch
+ * file.  The data recorded for each tuple is its hash value, then the tuple
+ * in MinimalTuple format, as for hash join batches.
+ */
+static void
+hash_agg_spill_tuple(AggState *aggstate, TupleTableSlot *slot,
+					 uint32 hashvalue)
+{
+	HashAggSpillData *spill = aggstate->hash_spill;
+	int			partition;
+	BufFile    *file;
+	MinimalTuple tuple;
+	MemoryContext oldContext;
+	size_t		written;
+
+	Assert(aggstate->hash_spill_mode);
+
+	partition = (hashvalue >> spill->shift) & (HASHAGG_PARTITIONS - 1);
+
+	/* The batch files must outlive the hash table; see ExecHashJoinSaveTuple */
+	oldContext = MemoryContextSwitchTo(aggstate->ss.ps.state->es_query_cxt);
+
+	file = spill->files[partition];
+	if (file == NULL)
+	{
+		file = BufFileCreateTemp(false);
+		spill->files[partition] = file;
+	}
+
+	tuple = ExecFetchSlotMinimalTuple(slot);
+
+	written = BufFileWrite(file, (void *) &hashvalue, sizeof(uint32));
+	if (written != sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+			  errmsg("could not write to hash-aggregate temporary file: %m")));
+
+	written = BufFileWrite(file, (void *) tuple, tuple->t_len);
+	if (written != tuple->t_len)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+			  errmsg("could not write to hash-aggregate temporary file: %m")));
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+/*
+ * Read the next tuple from a batch file.  Returns NULL at end of file;
+ * otherwise *hashvalue is set to the tuple's hash value and the tuple is
+ * stored in the given slot.
+ */
+static TupleTableSlot *
+hash_agg_read_tuple(BufFile *file, uint32 *hashvalue, TupleTableSlot *slot)
+{
+	uint32		header[2];
+	size_t		nread;
+	MinimalTuple tuple;
+
+	/* The hash value and the MinimalTuple length word are both uint32 */
+	nread = BufFileRead(file, (void *) header, sizeof(header));
+	if (nread == 0)				/* end of file */
+	{
+		ExecClearTuple(slot);
+		return NULL;
+	}
+	if (nread != sizeof(header))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+			 errmsg("could not read from hash-aggregate temporary file: %m")));
+	*hashvalue = header[0];
+	tuple = (MinimalTuple) palloc(header[1]);
+	tuple->t_len = header[1];
+	nread = BufFileRead(file,
+						(void *) ((char *) tuple + sizeof(uint32)),
+						header[1] - sizeof(uint32));
+	if (nread != header[1] - sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+			 errmsg("could not read from hash-aggregate temporary file: %m")));
+	return ExecStoreMinimalTuple(tuple, slot, true);
+}
+
+/*
+ * At the end of a pass, add the batch files it has written to the list of
+ * batches still to be aggregated.
+ *
+ * The new batches go to the front of the list, so that the batches split
+ * from one batch are processed before its siblings.  That keeps the number
+ * of batch files in existence down.
+ */
+static void
+hash_agg_finish_spill(AggState *aggstate)
+{
+	HashAggSpillData *spill = aggstate->hash_spill;
+	MemoryContext oldContext;
+	int			i;
+
+	if (spill == NULL)
+		return;
+
+	oldContext = MemoryContextSwitchTo(aggstate->ss.ps.state->es_query_cxt);
+
+	for (i = 0; i < HASHAGG_PARTITIONS; i++)
+	{
+		HashAggBatch *batch;
+
+		if (spill->files[i] == NULL)
+			continue;
+
+		batch = (HashAggBatch *) palloc(sizeof(HashAggBatch));
+		batch->file = spill->files[i];
+		batch->depth = aggstate->hash_pass_depth + 1;
+		aggstate->hash_batches = lcons(batch, aggstate->hash_batches);
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	pfree(spill->files);
+	pfree(spill);
+	aggstate->hash_spill = NULL;
+}
+
+/*
+ * Close all batch files and forget about them, and reset the spilling state
+ * for a new first pass.
+ */
+static void
+hash_agg_reset_spill(AggState *aggstate)
+{
+	HashAggSpillData *spill = aggstate->hash_spill;
+	ListCell   *lc;
+
+	if (spill != NULL)
+	{
+		int			i;
+
+		for (i = 0; i < HASHAGG_PARTITIONS; i++)
+		{
+			if (spill->files[i] != NULL)
+				BufFileClose(spill->files[i]);
+		}
+		pfree(spill->files);
+		pfree(spill);
+		aggstate->hash_spill = NULL;
+	}
+
+	foreach(lc, aggstate->hash_batches)
+	{
+		HashAggBatch *batch = (HashAggBatch *) lfirst(lc);
+
+		BufFileClose(batch->file);
+		pfree(batch);
+	}
+	list_free(aggstate->hash_batches);
+	aggstate->hash_batches = NIL;
+
+	aggstate->hash_ngroups_current = 0;
+	aggstate->hash_ngroups_check = 1;
+	aggstate->hash_spill_mode = false;
+	aggstate->hash_ever_spilled = false;
+	aggstate->hash_pass_depth = 0;
+}
+
 /* -----------------
  * ExecInitAgg
  *
@@ -1606,13 +2013,33 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	 * context are driven by a simple decision: we want to reset the
 	 * aggcontext at group boundaries (if not hashing) and in ExecReScanAgg to
 	 * recover no-longer-wanted space.
+	 *
+	 * When hashing, the memory used by the aggcontext is what decides when
+	 * to start spilling, so keep its blocks small relative to work_mem;
+	 * otherwise a single new block could take it far over the limit.
 	 */
-	aggstate->aggcontext =
-		AllocSetContextCreate(CurrentMemoryContext,
-							  "AggContext",
-							  ALLOCSET_DEFAULT_MINSIZE,
-							  ALLOCSET_DEFAULT_INITSIZE,
-							  ALLOCSET_DEFAULT_MAXSIZE);
+	if (node->aggstrategy == AGG_HASHED)
+	{
+		Size		maxBlockSize;
+
+		aggstate->hash_mem_limit = work_mem * 1024L;
+		maxBlockSize = Min(aggstate->hash_mem_limit / 16,
+						   ALLOCSET_DEFAULT_MAXSIZE);
+		maxBlockSize = Max(maxBlockSize, ALLOCSET_DEFAULT_INITSIZE);
+		aggstate->aggcontext =
+			AllocSetContextCreate(CurrentMemoryContext,
+								  "AggContext",
+								  ALLOCSET_DEFAULT_MINSIZE,
+								  ALLOCSET_DEFAULT_INITSIZE,
+								  maxBlockSize);
+	}
+	else
+		aggstate->aggcontext =
+			AllocSetContextCreate(CurrentMemoryContext,
+								  "AggContext",
+								  ALLOCSET_DEFAULT_MINSIZE,
+								  ALLOCSET_DEFAULT_INITSIZE,
+								  ALLOCSET_DEFAULT_MAXSIZE);
 
 	/*
 	 * tuple table initialization
@@ -1709,10 +2136,15 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 
 	if (node->aggstrategy == AGG_HASHED)
 	{
+		hash_agg_reset_spill(aggstate);
 		build_hash_table(aggstate);
 		aggstate->table_filled = false;
 		/* Compute the columns we actually need to hash on */
 		aggstate->hash_needed = find_hash_columns(aggstate);
+		/* Spilled input tuples are read back into this slot */
+		aggstate->hash_spill_slot = ExecInitExtraTupleSlot(estate);
+		ExecSetSlotDescriptor(aggstate->hash_spill_slot,
+							  ExecGetResultType(outerPlanState(aggstate)));
 	}
 	else
 	{
@@ -1824,12 +2256,14 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 		peraggstate->collectfn_oid = collectfn_oid = aggform->aggcollectfn;
 		/*
 		 * For PGXC final and collection functions are used to combine results at Coordinator,
-		 * disable those for Datanode
+		 * disable those for Datanode.  A Datanode still collects the partial
+		 * results of its parallel scan workers, see planparallel.c.
 		 */
 		if (IS_PGXC_DATANODE)
 		{
 			peraggstate->finalfn_oid = finalfn_oid = InvalidOid;
-			peraggstate->collectfn_oid = collectfn_oid = InvalidOid;
+			if (!node->skip_trans)
+				peraggstate->collectfn_oid = collectfn_oid = InvalidOid;
 		}
 #endif /* PGXC */
 		/* Check that aggregate owner has permission to call component fns */
@@ -2157,6 +2591,10 @@ ExecEndAgg(AggState *node)
 			tuplesort_end(peraggstate->sortstate);
 	}
 
+	/* And any batch files of a hashed aggregation */
+	if (((Agg *) node->ss.ps.plan)->aggstrategy == AGG_HASHED)
+		hash_agg_reset_spill(node);
+
 	/*
 	 * Free both the expr contexts.
 	 */
@@ -2197,9 +2635,12 @@ ExecReScanAgg(AggState *node)
 		/*
 		 * If we do have the hash table and the subplan does not have any
 		 * parameter changes, then we can just rescan the existing hash table;
-		 * no need to build it again.
+		 * no need to build it again.  That is, unless some of the groups were
+		 * spilled to disk, in which case the hash table holds only the last
+		 * batch.
 		 */
-		if (node->ss.ps.lefttree->chgParam == NULL)
+		if (node->ss.ps.lefttree->chgParam == NULL &&
+			!node->hash_ever_spilled)
 		{
 			ResetTupleHashIterator(node->hashtable, &node->hashiter);
 			return;
@@ -2238,7 +2679,8 @@ ExecReScanAgg(AggState *node)
 
 	if (((Agg *) node->ss.ps.plan)->aggstrategy == AGG_HASHED)
 	{
-		/* Rebuild an empty hash table */
+		/* Forget about any spilled batches, and rebuild an empty hash table */
+		hash_agg_reset_spill(node);
 		build_hash_table(node);
 		node->table_filled = false;
 	}
@@ -59,6 +59,9 @@
 
 #include "executor/execdebug.h"
 #include "executor/nodeAppend.h"
+#ifdef PGXC
+#include "pgxc/execRemote.h"
+#endif
 
 static bool exec_append_initialize_next(AppendState *appendstate);
 
@@ -180,6 +183,12 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 	 */
 	appendstate->as_whichplan = 0;
 	exec_append_initialize_next(appendstate);
+#ifdef PGXC
+	appendstate->as_remote_started = false;
+	/* the order of the rows matters only if they may be read backward */
+	appendstate->as_remote_any_order = (eflags & EXEC_FLAG_BACKWARD) == 0;
+	appendstate->as_remote = NULL;
+#endif
 
 	return appendstate;
 }
@@ -193,6 +202,32 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 TupleTableSlot *
 ExecAppend(AppendState *node)
 {
+#ifdef PGXC
+	/*
+	 * Send down the remote subplans before reading the first one, so that
+	 * the Datanodes work on all of them at once rather than one at a time.
+	 */
+	if (!node->as_remote_started &&
+		ScanDirectionIsForward(node->ps.state->es_direction))
+	{
+		node->as_remote =
+			ExecStartRemoteQueries(node->appendplans + node->as_whichplan,
+								   node->as_nplans - node->as_whichplan,
+								   node->as_remote_any_order);
+		node->as_remote_started = true;
+	}
+
+	/* If they are all remote, return rows as they arrive from any of them */
+	if (node->as_remote != NULL)
+	{
+		TupleTableSlot *result = ExecRemoteQueriesNext(node->as_remote);
+
+		if (TupIsNull(result))
+			return ExecClearTuple(node->ps.ps_ResultTupleSlot);
+		return result;
+	}
+#endif
+
 	for (;;)
 	{
 		PlanState  *subnode;
@@ -287,4 +322,13 @@ ExecReScanAppend(AppendState *node)
 	}
 	node->as_whichplan = 0;
 	exec_append_initialize_next(node);
+#ifdef PGXC
+	/* remote subplans to be run again may be sent down ahead again */
+	if (node->as_remote != NULL)
+	{
+		ExecEndRemoteQueries(node->as_remote);
+		node->as_remote = NULL;
+	}
+	node->as_remote_started = false;
+#endif
 }
@@ -0,0 +1,143 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeGather.c
+ *	  Routines to run a subplan in several processes at once
+ *
+ * A Gather node hands copies of its subplan to parallel scan workers (see
+ * execParallel.c) and runs one more copy itself.  The SeqScan of every copy
+ * takes its pages from the same shared scan state, so the copies together
+ * return each tuple of the subplan once, in no particular order.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeGather.c
+ *
+ *-------------------------------------------------------------------------
+ */
+/*
+ * INTERFACE ROUTINES
+ *		ExecGather		- return the next tuple of any copy of the subplan
+ *		ExecInitGather	- initialize node, start workers and init subplan
+ *		ExecEndGather	- shutdown subplan and workers
+ */
+
+#include "postgres.h"
+
+#include "executor/execParallel.h"
+#include "executor/executor.h"
+#include "executor/nodeGather.h"
+
+
+/* ----------------------------------------------------------------
+ *		ExecGather
+ *
+ *		Tuples sent by the workers are returned as soon as they are
+ *		there; in between, the local copy of the subplan is run.
+ * ----------------------------------------------------------------
+ */
+TupleTableSlot *
+ExecGather(GatherState *node)
+{
+	TupleTableSlot *slot;
+	MinimalTuple tuple;
+
+	for (;;)
+	{
+		if (!node->workers_done)
+		{
+			tuple = ExecParallelReadTuple(node->group, &node->workers_done);
+			if (tuple != NULL)
+				return ExecStoreMinimalTuple(tuple, node->funnel_slot, false);
+		}
+
+		if (!node->local_done)
+		{
+			slot = ExecProcNode(outerPlanState(node));
+			if (!TupIsNull(slot))
+				return slot;
+			node->local_done = true;
+		}
+
+		if (node->workers_done)
+			return NULL;
+
+		/* nothing to do but wait for the workers */
+		ExecParallelWait(node->group);
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitGather
+ * ----------------------------------------------------------------
+ */
+GatherState *
+ExecInitGather(Gather *node, EState *estate, int eflags)
+{
+	GatherState *gatherstate;
+	ParallelHeapScanDesc save_parallel_scan;
+
+	/* Gather returns tuples in no repeatable order */
+	Assert(!(eflags & (EXEC_FLAG_REWIND | EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	gatherstate = makeNode(GatherState);
+	gatherstate->ps.plan = (Plan *) node;
+	gatherstate->ps.state = estate;
+
+	/*
+	 * Tuple table initialization: the result slot is never used, the funnel
+	 * slot holds the tuples received from workers.
+	 */
+	ExecInitResultTupleSlot(estate, &gatherstate->ps);
+	gatherstate->funnel_slot = ExecInitExtraTupleSlot(estate);
+
+	/*
+	 * Start the workers before the local copy of the subplan, whose SeqScan
+	 * must join the scan state of the group.
+	 */
+	gatherstate->group = ExecParallelBegin(node, estate, eflags);
+	gatherstate->nworkers_launched = ExecParallelNumWorkers(gatherstate->group);
+	gatherstate->workers_done = (gatherstate->nworkers_launched == 0);
+	gatherstate->local_done = false;
+
+	save_parallel_scan = estate->es_parallel_scan;
+	estate->es_parallel_scan = ExecParallelScanDesc(gatherstate->group);
+	outerPlanState(gatherstate) = ExecInitNode(outerPlan(node), estate, eflags);
+	estate->es_parallel_scan = save_parallel_scan;
+
+	/*
+	 * Gather nodes do no projections, so initialize projection info for this
+	 * node appropriately
+	 */
+	ExecAssignResultTypeFromTL(&gatherstate->ps);
+	gatherstate->ps.ps_ProjInfo = NULL;
+
+	ExecSetSlotDescriptor(gatherstate->funnel_slot,
+						  gatherstate->ps.ps_ResultTupleSlot->tts_tupleDescriptor);
+
+	return gatherstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndGather
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndGather(GatherState *node)
+{
+	ExecEndNode(outerPlanState(node));
+	ExecParallelFinish(node->group);
+	ExecClearTuple(node->funnel_slot);
+}
+
+void
+ExecReScanGather(GatherState *node)
+{
+	/* the workers cannot be restarted */
+	elog(ERROR, "Gather node cannot be rescanned");
+}
@@ -31,6 +31,9 @@
 #include "executor/hashjoin.h"
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
+#ifdef PGXC
+#include "lib/bloomfilter.h"
+#endif
 #include "miscadmin.h"
 #include "utils/dynahash.h"
 #include "utils/memutils.h"
@@ -110,6 +113,10 @@ MultiExecHash(HashState *node)
 		{
 			int			bucketNumber;
 
+#ifdef PGXC
+			if (hashtable->bloomfilter)
+				bloom_add_hash(hashtable->bloomfilter, hashvalue);
+#endif
 			bucketNumber = ExecHashGetSkewBucket(hashtable, hashvalue);
 			if (bucketNumber != INVALID_SKEW_BUCKET_NO)
 			{
@@ -293,6 +300,9 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 	hashtable->spaceUsedSkew = 0;
 	hashtable->spaceAllowedSkew =
 		hashtable->spaceAllowed * SKEW_WORK_MEM_PERCENT / 100;
+#ifdef PGXC
+	hashtable->bloomfilter = NULL;
+#endif
 
 	/*
 	 * Get info about the hash functions to be used for each hash key. Also
@@ -22,6 +22,13 @@
 #include "executor/nodeHashjoin.h"
 #include "miscadmin.h"
 #include "utils/memutils.h"
+#ifdef PGXC
+#include "lib/bloomfilter.h"
+#include "optimizer/cost.h"
+#include "parser/parsetree.h"
+#include "pgxc/execRemote.h"
+#include "utils/lsyscache.h"
+#endif
 
 
 /*
@@ -39,6 +46,14 @@
 /* Returns true if doing null-fill on inner relation */
 #define HJ_FILL_INNER(hjstate)	((hjstate)->hj_NullOuterTupleSlot != NULL)
 
+#ifdef PGXC
+/*
+ * Upper limit on the size of a Bloom filter pushed to remote nodes.  It is
+ * sent to each Datanode taking part in the outer scan, hex-encoded.
+ */
+#define HJ_BLOOM_MAX_BYTES		(1024 * 1024)
+#endif
+
 static TupleTableSlot *ExecHashJoinOuterGetTuple(PlanState *outerNode,
 						  HashJoinState *hjstate,
 						  uint32 *hashvalue);
@@ -47,6 +62,10 @@ static TupleTableSlot *ExecHashJoinGetSavedTuple(HashJoinState *hjstate,
 						  uint32 *hashvalue,
 						  TupleTableSlot *tupleSlot);
 static bool ExecHashJoinNewBatch(HashJoinState *hjstate);
+#ifdef PGXC
+static void ExecHashJoinInitBloomFilter(HashJoinState *hjstate,
+							HashJoin *node);
+#endif
 
 
 /* ----------------------------------------------------------------
@@ -147,6 +166,13 @@ ExecHashJoin(HashJoinState *node)
 					/* no chance to not build the hash table */
 					node->hj_FirstOuterTupleSlot = NULL;
 				}
+#ifdef PGXC
+				else if (node->hj_BloomPushdown)
+				{
+					/* the remote scan must wait for the Bloom filter */
+					node->hj_FirstOuterTupleSlot = NULL;
+				}
+#endif
 				else if (HJ_FILL_OUTER(node) ||
 						 (outerNode->plan->startup_cost < hashNode->ps.plan->total_cost &&
 						  !node->hj_OuterNotEmpty))
@@ -171,6 +197,27 @@ ExecHashJoin(HashJoinState *node)
 												HJ_FILL_INNER(node));
 				node->hj_HashTable = hashtable;
 
+#ifdef PGXC
+				/*
+				 * Have the Hash node collect the inner hash values into a
+				 * Bloom filter for the outer RemoteQuery.  The filter is only
+				 * needed before the remote query is first run, so this is done
+				 * once; on rescan RemoteQuery replays its stored result.
+				 */
+				if (node->hj_BloomPushdown)
+				{
+					MemoryContext oldcxt;
+
+					oldcxt = MemoryContextSwitchTo(hashtable->hashCxt);
+					hashtable->bloomfilter =
+						bloom_create(hashNode->ps.plan->plan_rows,
+									 Min((Size) work_mem * 1024L,
+										 HJ_BLOOM_MAX_BYTES));
+					MemoryContextSwitchTo(oldcxt);
+					node->hj_BloomPushdown = false;
+				}
+#endif
+
 				/*
 				 * execute the Hash node, to build the hash table
 				 */
@@ -185,6 +232,16 @@ ExecHashJoin(HashJoinState *node)
 				if (hashtable->totalTuples == 0 && !HJ_FILL_OUTER(node))
 					return NULL;
 
+#ifdef PGXC
+				if (hashtable->bloomfilter)
+				{
+					ExecRemoteQuerySetBloomFilter((RemoteQueryState *) outerNode,
+												  hashtable->bloomfilter);
+					pfree(hashtable->bloomfilter);
+					hashtable->bloomfilter = NULL;
+				}
+#endif
+
 				/*
 				 * need to remember whether nbatch has increased since we
 				 * began scanning the outer relation
@@ -591,9 +648,75 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	hjstate->hj_MatchedOuter = false;
 	hjstate->hj_OuterNotEmpty = false;
 
+#ifdef PGXC
+	ExecHashJoinInitBloomFilter(hjstate, node);
+#endif
+
 	return hjstate;
 }
 
+#ifdef PGXC
+/*
+ * ExecHashJoinInitBloomFilter
+ *
+ *		Decide whether the outer RemoteQuery can be given a Bloom filter over
+ *		the inner hash keys, so that the Datanodes only send back rows that
+ *		may find a match.
+ *
+ * That needs a single hash key that the RemoteQuery returns as a plain
+ * column, and a join type for which outer rows without a match are not
+ * returned.  Also, RemoteQuery materializes its result and replays it on
+ * rescan, so the inner side must not depend on any parameters: a filter
+ * built from one inner result has to stay valid for all later ones.
+ */
+static void
+ExecHashJoinInitBloomFilter(HashJoinState *hjstate, HashJoin *node)
+{
+	PlanState  *outerState = outerPlanState(hjstate);
+	Plan	   *hashNode = innerPlan(node);
+	OpExpr	   *hclause;
+	Expr	   *outerkey;
+	TargetEntry *tle;
+	Oid			left_hashfn;
+	Oid			right_hashfn;
+
+	hjstate->hj_BloomPushdown = false;
+
+	if (!enable_remotebloomfilter)
+		return;
+	if (node->join.jointype != JOIN_INNER &&
+		node->join.jointype != JOIN_SEMI &&
+		node->join.jointype != JOIN_RIGHT)
+		return;
+	if (!IsA(outerState, RemoteQueryState) ||
+		list_length(node->hashclauses) != 1 ||
+		!bms_is_empty(hashNode->extParam))
+		return;
+
+	/* The outer key is the left argument; see ExecInitHashJoin */
+	hclause = (OpExpr *) linitial(node->hashclauses);
+	outerkey = (Expr *) linitial(hclause->args);
+	while (IsA(outerkey, RelabelType))
+		outerkey = ((RelabelType *) outerkey)->arg;
+	if (!IsA(outerkey, Var) || ((Var *) outerkey)->varno != OUTER_VAR)
+		return;
+
+	/* Find the column of the remote result that the key comes from */
+	tle = get_tle_by_resno(outerState->plan->targetlist,
+						   ((Var *) outerkey)->varattno);
+	if (tle == NULL || !IsA(tle->expr, Var))
+		return;
+
+	if (!get_op_hash_functions(hclause->opno, &left_hashfn, &right_hashfn))
+		return;
+
+	hjstate->hj_BloomPushdown =
+		ExecRemoteQueryInitBloomFilter((RemoteQueryState *) outerState,
+									   ((Var *) tle->expr)->varattno,
+									   left_hashfn);
+}
+#endif
+
 /* ----------------------------------------------------------------
  *		ExecEndHashJoin
  *
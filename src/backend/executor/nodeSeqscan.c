@@ -135,11 +135,20 @@ InitScanRelation(SeqScanState *node, EState *estate, int eflags)
 									  ((SeqScan *) node->ps.plan)->scanrelid,
 										   eflags);
 
-	/* initialize a heapscan */
-	currentScanDesc = heap_beginscan(currentRelation,
-									 estate->es_snapshot,
-									 0,
-									 NULL);
+	/*
+	 * initialize a heapscan, taking part in the parallel scan of this
+	 * relation if one is being set up (see nodeGather.c)
+	 */
+	if (estate->es_parallel_scan != NULL &&
+		estate->es_parallel_scan->phs_relid == RelationGetRelid(currentRelation))
+		currentScanDesc = heap_beginscan_parallel(currentRelation,
+												  estate->es_snapshot,
+												  estate->es_parallel_scan);
+	else
+		currentScanDesc = heap_beginscan(currentRelation,
+										 estate->es_snapshot,
+										 0,
+										 NULL);
 
 	node->ss_currentRelation = currentRelation;
 	node->ss_currentScanDesc = currentScanDesc;
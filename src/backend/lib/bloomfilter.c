@@ -0,0 +1,173 @@
+/*-------------------------------------------------------------------------
+ *
+ * bloomfilter.c
+ *	  A Bloom filter over 32-bit hash values
+ *
+ * A Bloom filter answers "is this element in the set?" with either "no" or
+ * "maybe", using far less memory than the set itself.  It is used by the
+ * coordinator to tell Datanodes which join keys can possibly find a match,
+ * so that rows that cannot are filtered out before they are shipped.
+ *
+ * Elements are represented by a 32-bit hash value computed by the caller.
+ * The k probe positions are derived from it by double hashing (Kirsch and
+ * Mitzenmacher): position i is h1 + i * h2, where h1 is the caller's hash
+ * and h2 is a second hash of it.  The bitset size is always a power of two,
+ * so a probe position is found by masking.
+ *
+ * Portions Copyright (c) 2012-2013, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/lib/bloomfilter.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/hash.h"
+#include "lib/bloomfilter.h"
+
+/* Target number of bits per element; with optimal k that is ~1% false hits */
+#define BLOOM_BITS_PER_ELEM			10
+/* Below this many bits per element the filter rejects too little to pay */
+#define BLOOM_MIN_BITS_PER_ELEM		4
+#define BLOOM_MIN_BITSET_LOG2		13	/* 1kB */
+#define BLOOM_MAX_BITSET_LOG2		31
+#define BLOOM_MAX_PROBES			8
+
+static inline void bloom_probe_init(uint32 hash, uint32 *h1, uint32 *h2);
+
+/*
+ * bloom_create
+ *
+ * Returns a newly palloc'd, empty filter sized for total_elems elements, or
+ * NULL if that many elements cannot be represented with a useful false
+ * positive rate in max_bytes of bitset.
+ */
+bytea *
+bloom_create(double total_elems, Size max_bytes)
+{
+	double		bits_wanted;
+	double		bits_per_elem;
+	int			bitset_log2;
+	int			k_probes;
+	Size		bitset_bytes;
+	bytea	   *filter;
+	uint8	   *data;
+
+	total_elems = Max(total_elems, 1.0);
+	bits_wanted = total_elems * BLOOM_BITS_PER_ELEM;
+
+	/* Smallest power of two covering bits_wanted, within max_bytes */
+	bitset_log2 = BLOOM_MIN_BITSET_LOG2;
+	while (bitset_log2 < BLOOM_MAX_BITSET_LOG2 &&
+		   (double) ((uint64) 1 << bitset_log2) < bits_wanted &&
+		   ((uint64) 1 << (bitset_log2 + 1)) / BITS_PER_BYTE <= max_bytes)
+		bitset_log2++;
+
+	bitset_bytes = (Size) (((uint64) 1 << bitset_log2) / BITS_PER_BYTE);
+	if (bitset_bytes > max_bytes)
+		return NULL;
+
+	bits_per_elem = (double) ((uint64) 1 << bitset_log2) / total_elems;
+	if (bits_per_elem < BLOOM_MIN_BITS_PER_ELEM)
+		return NULL;
+
+	/* The false positive rate is minimized with k = ln(2) * bits/element */
+	k_probes = (int) rint(bits_per_elem * 0.693147);
+	k_probes = Max(k_probes, 1);
+	k_probes = Min(k_probes, BLOOM_MAX_PROBES);
+
+	filter = (bytea *) palloc0(VARHDRSZ + BLOOM_HEADER_SIZE + bitset_bytes);
+	SET_VARSIZE(filter, VARHDRSZ + BLOOM_HEADER_SIZE + bitset_bytes);
+	data = (uint8 *) VARDATA(filter);
+	data[0] = (uint8) bitset_log2;
+	data[1] = (uint8) k_probes;
+
+	return filter;
+}
+
+/*
+ * bloom_add_hash
+ *
+ * Add an element, given by its hash value, to a filter made by bloom_create.
+ */
+void
+bloom_add_hash(bytea *filter, uint32 hash)
+{
+	uint8	   *data = (uint8 *) VARDATA(filter);
+	uint8	   *bitset = data + BLOOM_HEADER_SIZE;
+	uint32		mask = (uint32) (((uint64) 1 << data[0]) - 1);
+	int			k_probes = data[1];
+	uint32		h1;
+	uint32		h2;
+	int			i;
+
+	bloom_probe_init(hash, &h1, &h2);
+
+	for (i = 0; i < k_probes; i++)
+	{
+		uint32		bit = (h1 + i * h2) & mask;
+
+		bitset[bit / BITS_PER_BYTE] |= 1 << (bit % BITS_PER_BYTE);
+	}
+}
+
+/*
+ * bloom_lacks_hash
+ *
+ * Returns true if the element with the given hash value is definitely not
+ * in the set.  A false result only means that it might be.
+ *
+ * The filter may have come from another node, so it is checked for
+ * consistency here, and it may have a short varlena header.
+ */
+bool
+bloom_lacks_hash(bytea *filter, uint32 hash)
+{
+	uint8	   *data = (uint8 *) VARDATA_ANY(filter);
+	Size		len = VARSIZE_ANY_EXHDR(filter);
+	uint8	   *bitset;
+	uint32		mask;
+	int			k_probes;
+	uint32		h1;
+	uint32		h2;
+	int			i;
+
+	if (len < BLOOM_HEADER_SIZE ||
+		data[0] < 3 || data[0] > BLOOM_MAX_BITSET_LOG2 ||
+		data[1] < 1 || data[1] > BLOOM_MAX_PROBES ||
+		len != BLOOM_HEADER_SIZE + ((uint64) 1 << data[0]) / BITS_PER_BYTE)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid Bloom filter")));
+
+	bitset = data + BLOOM_HEADER_SIZE;
+	mask = (uint32) (((uint64) 1 << data[0]) - 1);
+	k_probes = data[1];
+
+	bloom_probe_init(hash, &h1, &h2);
+
+	for (i = 0; i < k_probes; i++)
+	{
+		uint32		bit = (h1 + i * h2) & mask;
+
+		if ((bitset[bit / BITS_PER_BYTE] & (1 << (bit % BITS_PER_BYTE))) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Derive the two hashes used for double hashing.  The step is forced odd
+ * so that, the bitset size being a power of two, the k probes are distinct.
+ */
+static inline void
+bloom_probe_init(uint32 hash, uint32 *h1, uint32 *h2)
+{
+	*h1 = hash;
+	*h2 = DatumGetUInt32(hash_uint32(hash)) | 1;
+}
@@ -0,0 +1,147 @@
+/*-------------------------------------------------------------------------
+ *
+ * hyperloglog.c
+ *	  HyperLogLog cardinality estimator
+ *
+ * HyperLogLog (Flajolet, Fusy, Gandouet and Meunier, 2007) estimates the
+ * number of distinct elements of a set in a few hundred bytes, whatever the
+ * size of the set, with a typical error of 1.04 / sqrt(2^registerWidth).
+ * It is used by sort support routines to judge cheaply whether abbreviated
+ * keys tell the values being sorted apart well enough to be worth building.
+ *
+ * Elements are represented by a 32-bit hash value computed by the caller.
+ * The top registerWidth bits of the hash select a register, which keeps the
+ * highest position of the first set bit seen in the remaining bits.
+ *
+ * Portions Copyright (c) 2012-2013, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/lib/hyperloglog.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <math.h>
+
+#include "lib/hyperloglog.h"
+
+#define POW_2_32			(4294967296.0)
+#define NEG_POW_2_32		(-4294967296.0)
+
+static inline uint8 rho(uint32 x, uint8 b);
+
+/*
+ * Initialize a HyperLogLog estimator with 2^bwidth registers, allocated in
+ * the current memory context.
+ */
+void
+initHyperLogLog(hyperLogLogState *cState, uint8 bwidth)
+{
+	double		alpha;
+
+	if (bwidth < 4 || bwidth > 16)
+		elog(ERROR, "bit width must be between 4 and 16 inclusive");
+
+	cState->registerWidth = bwidth;
+	cState->nRegisters = (Size) 1 << bwidth;
+	cState->hashesArr = palloc0(sizeof(uint8) * cState->nRegisters);
+
+	/* Bias correction constants, from the HyperLogLog paper */
+	switch (cState->nRegisters)
+	{
+		case 16:
+			alpha = 0.673;
+			break;
+		case 32:
+			alpha = 0.697;
+			break;
+		case 64:
+			alpha = 0.709;
+			break;
+		default:
+			alpha = 0.7213 / (1.0 + 1.079 / cState->nRegisters);
+	}
+
+	cState->alphaMM = alpha * cState->nRegisters * cState->nRegisters;
+}
+
+/*
+ * Add an element, given by its hash value, to the estimator.
+ *
+ * The hash must be well mixed in all of its bits.
+ */
+void
+addHyperLogLog(hyperLogLogState *cState, uint32 hash)
+{
+	uint8		count;
+	uint32		index;
+
+	/* the first registerWidth bits select the register */
+	index = hash >> (BITS_PER_BYTE * sizeof(uint32) - cState->registerWidth);
+
+	/* the rank of the first set bit among the remaining ones */
+	count = rho(hash << cState->registerWidth,
+				BITS_PER_BYTE * sizeof(uint32) - cState->registerWidth);
+
+	cState->hashesArr[index] = Max(count, cState->hashesArr[index]);
+}
+
+/*
+ * Estimate the number of distinct elements added so far.
+ */
+double
+estimateHyperLogLog(hyperLogLogState *cState)
+{
+	double		result;
+	double		sum = 0.0;
+	Size		i;
+
+	for (i = 0; i < cState->nRegisters; i++)
+		sum += 1.0 / pow(2.0, cState->hashesArr[i]);
+
+	/* the "raw" estimate, E in the paper */
+	result = cState->alphaMM / sum;
+
+	if (result <= (5.0 / 2.0) * cState->nRegisters)
+	{
+		/* small range correction: linear counting of the empty registers */
+		int			zero_count = 0;
+
+		for (i = 0; i < cState->nRegisters; i++)
+		{
+			if (cState->hashesArr[i] == 0)
+				zero_count++;
+		}
+
+		if (zero_count != 0)
+			result = cState->nRegisters * log((double) cState->nRegisters /
+											  zero_count);
+	}
+	else if (result > (1.0 / 30.0) * POW_2_32)
+	{
+		/* large range correction, for collisions of 32-bit hashes */
+		result = NEG_POW_2_32 * log(1.0 - (result / POW_2_32));
+	}
+
+	return result;
+}
+
+/*
+ * Position of the leftmost set bit among the first b bits of x, counting
+ * from 1; b + 1 if none of them is set.
+ */
+static inline uint8
+rho(uint32 x, uint8 b)
+{
+	uint8		j = 1;
+
+	while (j <= b && !(x & 0x80000000))
+	{
+		j++;
+		x <<= 1;
+	}
+
+	return j;
+}
@@ -92,6 +92,9 @@
 #include "libpq/ip.h"
 #include "libpq/libpq.h"
 #include "miscadmin.h"
+#ifdef PGXC
+#include "pgxc/nodecompress.h"
+#endif
 #include "storage/ipc.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
@@ -126,6 +129,19 @@ static char PqRecvBuffer[PQ_RECV_BUFFER_SIZE];
 static int	PqRecvPointer;		/* Next index to read a byte from PqRecvBuffer */
 static int	PqRecvLength;		/* End of data available in PqRecvBuffer */
 
+#ifdef PGXC
+/*
+ * Stream compression, turned on at the request of a Coordinator, see
+ * pq_set_compression.  The buffers above still hold plain protocol data,
+ * and the frames sent and received over the socket go through these.
+ */
+static bool PqCompress = false;
+static StringInfoData PqCompressSend;	/* frames not sent yet, from cursor on */
+static StringInfoData PqCompressRecv;	/* frames not decompressed yet */
+static StringInfoData PqCompressRaw;	/* decompressed data not moved to
+										 * PqRecvBuffer yet, from cursor on */
+#endif
+
 /*
  * Message status
  */
@@ -135,9 +151,16 @@ static bool DoingCopyOut;
 
 /* Internal functions */
 static void pq_close(int code, Datum arg);
+static int	pq_recvsome(char *buf, int len);
 static int	internal_putbytes(const char *s, size_t len);
 static int	internal_flush(void);
+static int	internal_send(char *buf, int *start, int *end);
 static void pq_set_nonblocking(bool nonblocking);
+#ifdef PGXC
+static int	pq_recvbuf_from(StringInfo from);
+static int	pq_recvbuf_compressed(void);
+static int	internal_flush_compressed(void);
+#endif
 
 #ifdef HAVE_UNIX_SOCKETS
 static int	Lock_AF_UNIX(char *unixSocketDir, char *unixSocketPath);
@@ -829,6 +852,8 @@ pq_set_nonblocking(bool nonblocking)
 static int
 pq_recvbuf(void)
 {
+	int			r;
+
 	if (PqRecvPointer > 0)
 	{
 		if (PqRecvLength > PqRecvPointer)
@@ -843,16 +868,44 @@ pq_recvbuf(void)
 			PqRecvLength = PqRecvPointer = 0;
 	}
 
+#ifdef PGXC
+	if (PqCompress)
+		return pq_recvbuf_compressed();
+
+	/* Hand out first what was read ahead while compression was on */
+	if (pq_recvbuf_from(&PqCompressRaw) > 0 ||
+		pq_recvbuf_from(&PqCompressRecv) > 0)
+		return 0;
+#endif
+
+	/* Can fill buffer from PqRecvLength and upwards */
+	r = pq_recvsome(PqRecvBuffer + PqRecvLength,
+					PQ_RECV_BUFFER_SIZE - PqRecvLength);
+	if (r == EOF)
+		return EOF;
+	/* r contains number of bytes read, so just incr length */
+	PqRecvLength += r;
+	return 0;
+}
+
+/* --------------------------------
+ *		pq_recvsome - read what is available from the connection
+ *
+ *		blocks until something is; returns the number of bytes read, or EOF
+ *		if trouble
+ * --------------------------------
+ */
+static int
+pq_recvsome(char *buf, int len)
+{
 	/* Ensure that we're in blocking mode */
 	pq_set_nonblocking(false);
 
-	/* Can fill buffer from PqRecvLength and upwards */
 	for (;;)
 	{
 		int			r;
 
-		r = secure_read(MyProcPort, PqRecvBuffer + PqRecvLength,
-						PQ_RECV_BUFFER_SIZE - PqRecvLength);
+		r = secure_read(MyProcPort, buf, len);
 
 		if (r < 0)
 		{
@@ -877,11 +930,91 @@ pq_recvbuf(void)
 			 */
 			return EOF;
 		}
-		/* r contains number of bytes read, so just incr length */
-		PqRecvLength += r;
+		return r;
+	}
+}
+
+#ifdef PGXC
+/* --------------------------------
+ *		pq_recvbuf_from - load into the input buffer bytes held in a
+ *		compression buffer, from its cursor on
+ *
+ *		returns the number of bytes moved
+ * --------------------------------
+ */
+static int
+pq_recvbuf_from(StringInfo from)
+{
+	int			amount;
+
+	amount = Min(PQ_RECV_BUFFER_SIZE - PqRecvLength, from->len - from->cursor);
+	if (amount <= 0)
 		return 0;
+
+	memcpy(PqRecvBuffer + PqRecvLength, from->data + from->cursor, amount);
+	PqRecvLength += amount;
+	from->cursor += amount;
+	return amount;
+}
+
+/* --------------------------------
+ *		pq_recvbuf_compressed - pq_recvbuf with compression on
+ *
+ *		reads frames until one has arrived in full, and loads the input
+ *		buffer with what it decompresses to
+ * --------------------------------
+ */
+static int
+pq_recvbuf_compressed(void)
+{
+	for (;;)
+	{
+		int			framelen;
+		int			rawlen;
+		int			r;
+
+		if (pq_recvbuf_from(&PqCompressRaw) > 0)
+			return 0;
+
+		rawlen = node_frame_rawlen(PqCompressRecv.data + PqCompressRecv.cursor,
+								   PqCompressRecv.len - PqCompressRecv.cursor,
+								   &framelen);
+		if (rawlen < 0)
+		{
+			ereport(COMMERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg("invalid compressed data from client")));
+			return EOF;
+		}
+		if (rawlen > 0)
+		{
+			resetStringInfo(&PqCompressRaw);
+			enlargeStringInfo(&PqCompressRaw, rawlen);
+			node_decompress(PqCompressRecv.data + PqCompressRecv.cursor,
+							PqCompressRaw.data);
+			PqCompressRaw.len = rawlen;
+			PqCompressRecv.cursor += framelen;
+			continue;
+		}
+
+		/* Read more, keeping the incomplete frame at the start */
+		if (PqCompressRecv.cursor > 0)
+		{
+			PqCompressRecv.len -= PqCompressRecv.cursor;
+			memmove(PqCompressRecv.data,
+					PqCompressRecv.data + PqCompressRecv.cursor,
+					PqCompressRecv.len);
+			PqCompressRecv.cursor = 0;
+		}
+		enlargeStringInfo(&PqCompressRecv, PQ_RECV_BUFFER_SIZE);
+		r = pq_recvsome(PqCompressRecv.data + PqCompressRecv.len,
+						PQ_RECV_BUFFER_SIZE);
+		if (r == EOF)
+			return EOF;
+		PqCompressRecv.len += r;
 	}
 }
+#endif
 
 /* --------------------------------
  *		pq_getbyte	- get a single byte from connection, or return EOF
@@ -1239,11 +1372,28 @@ pq_flush(void)
  */
 static int
 internal_flush(void)
+{
+#ifdef PGXC
+	if (PqCompress)
+		return internal_flush_compressed();
+#endif
+	return internal_send(PqSendBuffer, &PqSendStart, &PqSendPointer);
+}
+
+/* --------------------------------
+ *		internal_send - send the bytes of buf from *start to *end
+ *
+ * *start is advanced past what has been sent; both are reset to 0 once
+ * everything has been, or on trouble.  Returns as internal_flush.
+ * --------------------------------
+ */
+static int
+internal_send(char *buf, int *start, int *end)
 {
 	static int	last_reported_send_errno = 0;
 
-	char	   *bufptr = PqSendBuffer + PqSendStart;
-	char	   *bufend = PqSendBuffer + PqSendPointer;
+	char	   *bufptr = buf + *start;
+	char	   *bufend = buf + *end;
 
 	while (bufptr < bufend)
 	{
@@ -1289,7 +1439,7 @@ internal_flush(void)
 			 * flag that'll cause the next CHECK_FOR_INTERRUPTS to terminate
 			 * the connection.
 			 */
-			PqSendStart = PqSendPointer = 0;
+			*start = *end = 0;
 			ClientConnectionLost = 1;
 			InterruptPending = 1;
 			return EOF;
@@ -1297,13 +1447,106 @@ internal_flush(void)
 
 		last_reported_send_errno = 0;	/* reset after any successful send */
 		bufptr += r;
-		PqSendStart += r;
+		*start += r;
 	}
 
-	PqSendStart = PqSendPointer = 0;
+	*start = *end = 0;
 	return 0;
 }
 
+#ifdef PGXC
+/* --------------------------------
+ *		internal_flush_compressed - internal_flush with compression on
+ *
+ * The send buffer is turned into frames only once the previous ones have
+ * all gone out, so that PqCompressSend does not grow without bound while
+ * the socket is not writable.
+ * --------------------------------
+ */
+static int
+internal_flush_compressed(void)
+{
+	for (;;)
+	{
+		if (PqCompressSend.cursor < PqCompressSend.len)
+		{
+			if (internal_send(PqCompressSend.data, &PqCompressSend.cursor,
+							  &PqCompressSend.len) == EOF)
+			{
+				PqSendStart = PqSendPointer = 0;
+				return EOF;
+			}
+			if (PqCompressSend.cursor < PqCompressSend.len)
+				return 0;		/* would block */
+		}
+
+		if (PqSendStart == PqSendPointer)
+		{
+			PqSendStart = PqSendPointer = 0;
+			return 0;
+		}
+
+		resetStringInfo(&PqCompressSend);
+		node_compress(&PqCompressSend, PqSendBuffer + PqSendStart,
+					  PqSendPointer - PqSendStart);
+		PqSendStart = PqSendPointer = 0;
+	}
+}
+
+/* --------------------------------
+ *		pq_set_compression - turn stream compression on or off
+ *
+ * Everything already queued is sent uncompressed before compression is
+ * turned on, and compressed before it is turned off.  The peer is expected
+ * to switch at the same point of the stream, see the 'z' message.
+ * --------------------------------
+ */
+void
+pq_set_compression(bool on)
+{
+	if (PqCompress == on)
+		return;
+
+	pq_flush();
+
+	if (PqCompressSend.data == NULL)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+		initStringInfo(&PqCompressSend);
+		initStringInfo(&PqCompressRecv);
+		initStringInfo(&PqCompressRaw);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	if (on)
+	{
+		StringInfoData pending;
+
+		/*
+		 * Whatever was read past the request is already compressed, and
+		 * must go through the frame decoder, in the order it was received.
+		 * Anything left undecoded when compression is turned off again
+		 * stays where it is, and is handed out first by pq_recvbuf.
+		 */
+		initStringInfo(&pending);
+		appendBinaryStringInfo(&pending, PqRecvBuffer + PqRecvPointer,
+							   PqRecvLength - PqRecvPointer);
+		appendBinaryStringInfo(&pending, PqCompressRaw.data + PqCompressRaw.cursor,
+							   PqCompressRaw.len - PqCompressRaw.cursor);
+		appendBinaryStringInfo(&pending, PqCompressRecv.data + PqCompressRecv.cursor,
+							   PqCompressRecv.len - PqCompressRecv.cursor);
+		PqRecvPointer = PqRecvLength = 0;
+		resetStringInfo(&PqCompressRaw);
+		resetStringInfo(&PqCompressRecv);
+		appendBinaryStringInfo(&PqCompressRecv, pending.data, pending.len);
+		pfree(pending.data);
+	}
+
+	PqCompress = on;
+}
+#endif
+
 /* --------------------------------
  *		pq_flush_if_writable - flush pending output if writable without blocking
  *
@@ -1316,7 +1559,7 @@ pq_flush_if_writable(void)
 	int			res;
 
 	/* Quick exit if nothing to do */
-	if (PqSendPointer == PqSendStart)
+	if (!pq_is_send_pending())
 		return 0;
 
 	/* No-op if reentrant call */
@@ -1339,6 +1582,10 @@ pq_flush_if_writable(void)
 bool
 pq_is_send_pending(void)
 {
+#ifdef PGXC
+	if (PqCompress && PqCompressSend.cursor < PqCompressSend.len)
+		return true;
+#endif
 	return (PqSendStart < PqSendPointer);
 }
 
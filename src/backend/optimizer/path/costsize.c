@@ -75,6 +75,7 @@
 
 #include "access/htup_details.h"
 #include "executor/executor.h"
+#include "executor/nodeAgg.h"
 #include "executor/nodeHash.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
@@ -123,6 +124,7 @@ bool		enable_remotejoin = true;
 bool		enable_remotegroup = true;
 bool		enable_remotesort = true;
 bool		enable_remotelimit = true;
+bool		enable_remotebloomfilter = false;
 #endif
 
 typedef struct
@@ -1506,7 +1508,7 @@ cost_agg(Path *path, PlannerInfo *root,
 	 * Note: in this cost model, AGG_SORTED and AGG_HASHED have exactly the
 	 * same total CPU cost, but AGG_SORTED has lower startup cost.	If the
 	 * input path is already sorted appropriately, AGG_SORTED should be
-	 * preferred (since it has no risk of memory overflow).  This will happen
+	 * preferred (since it never needs to spill to disk).  This will happen
 	 * as long as the computed total costs are indeed exactly equal --- but if
 	 * there's roundoff error we might do the wrong thing.  So be sure that
 	 * the computations below form the same intermediate values in the same
@@ -1553,6 +1555,42 @@ cost_agg(Path *path, PlannerInfo *root,
 	path->total_cost = total_cost;
 }
 
+/*
+ * cost_hashagg_spill
+ *	  Estimate the extra cost of a hashed aggregation whose hash table does
+ *	  not fit in work_mem.
+ *
+ * The executor then writes the input tuples of the groups that do not fit
+ * to HASHAGG_PARTITIONS batch files, and aggregates each batch in a later
+ * pass, splitting it again if it still does not fit (see nodeAgg.c).  We
+ * charge for writing and reading back the spilled fraction of the input
+ * once for each level of splitting needed.  As in cost_sort, the writes are
+ * assumed sequential and the reads 75% sequential.
+ *
+ * 'input_tuples' and 'input_width' describe the input relation,
+ * 'hashentrysize' the estimated space needed per group.
+ */
+Cost
+cost_hashagg_spill(double input_tuples, int input_width,
+				   double numGroups, double hashentrysize)
+{
+	double		hashtable_bytes = hashentrysize * numGroups;
+	double		work_mem_bytes = work_mem * 1024.0;
+	double		spill_pages;
+	double		depth;
+
+	if (hashtable_bytes <= work_mem_bytes)
+		return 0;
+
+	spill_pages = page_size(input_tuples * (1.0 - work_mem_bytes / hashtable_bytes),
+							input_width);
+	depth = ceil(log(hashtable_bytes / work_mem_bytes) / log(HASHAGG_PARTITIONS));
+	depth = Max(depth, 1.0);
+
+	return spill_pages * depth *
+		(seq_page_cost + seq_page_cost * 0.75 + random_page_cost * 0.25);
+}
+
 /*
  * cost_windowagg
  *		Determines and returns the cost of performing a WindowAgg plan node,
@@ -250,6 +250,11 @@ standard_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
 		lfirst(lp) = set_plan_references(subroot, subplan);
 	}
 
+#ifdef PGXC
+	/* let parallel scan workers share the scan of a large relation */
+	top_plan = parallelize_plan_tree(glob, parse, cursorOptions, top_plan);
+#endif
+
 	/* build the PlannedStmt result */
 	result = makeNode(PlannedStmt);
 
@@ -2594,6 +2599,7 @@ choose_hashed_grouping(PlannerInfo *root,
 	bool		can_hash;
 	bool		can_sort;
 	Size		hashentrysize;
+	Cost		hash_spill_cost;
 	List	   *target_pathkeys;
 	List	   *current_pathkeys;
 	Path		hashed_p;
@@ -2628,8 +2634,8 @@ choose_hashed_grouping(PlannerInfo *root,
 		return false;
 
 	/*
-	 * Don't do it if it doesn't look like the hashtable will fit into
-	 * work_mem.
+	 * If it doesn't look like the hashtable will fit into work_mem, the
+	 * executor will spill groups to disk; charge for that below.
 	 */
 
 	/* Estimate per-hash-entry space at tuple width... */
@@ -2639,8 +2645,8 @@ choose_hashed_grouping(PlannerInfo *root,
 	/* plus the per-hash-entry overhead */
 	hashentrysize += hash_agg_entry_size(agg_costs->numAggs);
 
-	if (hashentrysize * dNumGroups > work_mem * 1024L)
-		return false;
+	hash_spill_cost = cost_hashagg_spill(path_rows, path_width,
+										 dNumGroups, hashentrysize);
 
 	/*
 	 * When we have both GROUP BY and DISTINCT, use the more-rigorous of
@@ -2675,6 +2681,8 @@ choose_hashed_grouping(PlannerInfo *root,
 			 numGroupCols, dNumGroups,
 			 cheapest_path->startup_cost, cheapest_path->total_cost,
 			 path_rows);
+	hashed_p.startup_cost += hash_spill_cost;
+	hashed_p.total_cost += hash_spill_cost;
 	/* Result of hashed agg is always unsorted */
 	if (target_pathkeys)
 		cost_sort(&hashed_p, root, target_pathkeys, hashed_p.total_cost,
@@ -2766,6 +2774,7 @@ choose_hashed_distinct(PlannerInfo *root,
 	bool		can_sort;
 	bool		can_hash;
 	Size		hashentrysize;
+	Cost		hash_spill_cost;
 	List	   *current_pathkeys;
 	List	   *needed_pathkeys;
 	Path		hashed_p;
@@ -2800,13 +2809,13 @@ choose_hashed_distinct(PlannerInfo *root,
 		return false;
 
 	/*
-	 * Don't do it if it doesn't look like the hashtable will fit into
-	 * work_mem.
+	 * If it doesn't look like the hashtable will fit into work_mem, the
+	 * executor will spill groups to disk; charge for that below.
 	 */
 	hashentrysize = MAXALIGN(path_width) + MAXALIGN(sizeof(MinimalTupleData));
 
-	if (hashentrysize * dNumDistinctRows > work_mem * 1024L)
-		return false;
+	hash_spill_cost = cost_hashagg_spill(path_rows, path_width,
+										 dNumDistinctRows, hashentrysize);
 
 	/*
 	 * See if the estimated cost is no more than doing it the other way. While
@@ -2825,6 +2834,8 @@ choose_hashed_distinct(PlannerInfo *root,
 			 numDistinctCols, dNumDistinctRows,
 			 cheapest_startup_cost, cheapest_total_cost,
 			 path_rows);
+	hashed_p.startup_cost += hash_spill_cost;
+	hashed_p.total_cost += hash_spill_cost;
 
 	/*
 	 * Result of hashed agg is always unsorted, so if ORDER BY is present we
@@ -0,0 +1,389 @@
+/*-------------------------------------------------------------------------
+ *
+ * planparallel.c
+ *	  Planning of parallel sequential scans on a Datanode.
+ *
+ * Once a plan is complete, a sequential scan near its top may be put under a
+ * Gather node, which runs copies of the scan in parallel scan workers and in
+ * the backend itself, each reading a share of the pages of the relation.  An
+ * aggregation over the scan goes below the Gather too, each copy computing
+ * transition values over its share, and a new Agg above the Gather combines
+ * them with the collection functions of the aggregates, just as a
+ * Coordinator combines the transition values sent by the Datanodes.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/optimizer/plan/planparallel.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "catalog/pg_class.h"
+#include "catalog/pg_type.h"
+#include "executor/execParallel.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
+#include "optimizer/planmain.h"
+#include "optimizer/var.h"
+#include "parser/parsetree.h"
+#include "pgxc/pgxc.h"
+#include "storage/bufmgr.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+
+
+/* GUC parameters */
+int			parallel_scan_degree = 0;
+int			parallel_scan_min_size = 1024;
+
+typedef struct
+{
+	List	   *partial_tlist;	/* targetlist of the Agg below the Gather */
+	List	   *aggs;			/* Aggrefs in it, in the same order */
+	int			first_agg;		/* resno of the first of them */
+} fix_upper_agg_context;
+
+static Plan *parallelize_plan(PlannerGlobal *glob, Plan *plan);
+static bool parallel_scan_ok(PlannerGlobal *glob, Plan *plan);
+static bool parallel_agg_ok(Agg *agg);
+static bool contain_params_walker(Node *node, void *context);
+static Gather *make_gather(Plan *subplan);
+static Plan *make_parallel_agg(Agg *agg);
+static Node *fix_upper_agg_mutator(Node *node, fix_upper_agg_context *context);
+static AttrNumber find_var_resno(List *tlist, AttrNumber varattno);
+
+
+/*
+ * parallelize_plan_tree
+ *
+ * Put the sequential scan of a complete read-only plan under a Gather node,
+ * if the scan is worth it and its copies can run in parallel scan workers.
+ * Only the plan nodes through which tuples go up unchanged in number and
+ * content, as far as the workers are concerned, are looked through.
+ */
+Plan *
+parallelize_plan_tree(PlannerGlobal *glob, Query *parse, int cursorOptions,
+					  Plan *top_plan)
+{
+	if (!IS_PGXC_DATANODE ||
+		parallel_scan_degree <= 0 || max_parallel_scan_workers <= 0)
+		return top_plan;
+
+	/*
+	 * A cursor may be scrolled back or be left open across statements, and
+	 * the workers can do neither.
+	 */
+	if (parse->commandType != CMD_SELECT || parse->utilityStmt != NULL ||
+		cursorOptions != 0 || parse->hasModifyingCTE ||
+		glob->subplans != NIL || glob->finalrowmarks != NIL)
+		return top_plan;
+
+	return parallelize_plan(glob, top_plan);
+}
+
+static Plan *
+parallelize_plan(PlannerGlobal *glob, Plan *plan)
+{
+	switch (nodeTag(plan))
+	{
+		case T_Sort:
+		case T_Limit:
+			plan->lefttree = parallelize_plan(glob, plan->lefttree);
+			break;
+		case T_Result:
+			if (plan->lefttree != NULL)
+				plan->lefttree = parallelize_plan(glob, plan->lefttree);
+			break;
+		case T_SeqScan:
+			if (parallel_scan_ok(glob, plan))
+				return (Plan *) make_gather(plan);
+			break;
+		case T_Agg:
+			if (plan->lefttree != NULL && IsA(plan->lefttree, SeqScan) &&
+				parallel_agg_ok((Agg *) plan) &&
+				parallel_scan_ok(glob, plan->lefttree))
+				return make_parallel_agg((Agg *) plan);
+			break;
+		default:
+			break;
+	}
+
+	return plan;
+}
+
+/*
+ * The relation must be an ordinary one visible to other backends, large
+ * enough, and its scan must not depend on anything a worker does not get.
+ */
+static bool
+parallel_scan_ok(PlannerGlobal *glob, Plan *plan)
+{
+	RangeTblEntry *rte;
+	Relation	rel;
+	bool		result;
+
+	if (plan->initPlan != NIL ||
+		contain_mutable_functions((Node *) plan->targetlist) ||
+		contain_mutable_functions((Node *) plan->qual) ||
+		contain_params_walker((Node *) plan->targetlist, NULL) ||
+		contain_params_walker((Node *) plan->qual, NULL))
+		return false;
+
+	rte = rt_fetch(((Scan *) plan)->scanrelid, glob->finalrtable);
+	if (rte->rtekind != RTE_RELATION)
+		return false;
+
+	/* the relation is locked already */
+	rel = heap_open(rte->relid, NoLock);
+	result = (rel->rd_rel->relkind == RELKIND_RELATION &&
+			  rel->rd_rel->relpersistence != RELPERSISTENCE_TEMP &&
+			  RelationGetNumberOfBlocks(rel) >= (BlockNumber) parallel_scan_min_size);
+	heap_close(rel, NoLock);
+
+	return result;
+}
+
+/*
+ * Groups may only be formed by hashing or over the whole input, since the
+ * Gather mixes up the order of the tuples.  Every aggregate must have a
+ * collection function taking its transition values as they are.
+ */
+static bool
+parallel_agg_ok(Agg *agg)
+{
+	List	   *aggs;
+	ListCell   *lc;
+	bool		result = true;
+
+	if (agg->aggstrategy == AGG_SORTED || agg->plan.initPlan != NIL ||
+		contain_mutable_functions((Node *) agg->plan.targetlist) ||
+		contain_mutable_functions((Node *) agg->plan.qual) ||
+		contain_params_walker((Node *) agg->plan.targetlist, NULL) ||
+		contain_params_walker((Node *) agg->plan.qual, NULL))
+		return false;
+
+	aggs = pull_var_clause((Node *) list_concat(list_copy(agg->plan.targetlist),
+												agg->plan.qual),
+						   PVC_INCLUDE_AGGREGATES, PVC_RECURSE_PLACEHOLDERS);
+	foreach(lc, aggs)
+	{
+		Aggref	   *aggref = (Aggref *) lfirst(lc);
+
+		if (!IsA(aggref, Aggref))
+			continue;
+		if (!aggref->agghas_collectfn ||
+			aggref->aggorder != NIL || aggref->aggdistinct != NIL ||
+			aggref->aggtrantype == INTERNALOID ||
+			IsPolymorphicType(aggref->aggtrantype))
+		{
+			result = false;
+			break;
+		}
+	}
+	list_free(aggs);
+
+	return result;
+}
+
+static bool
+contain_params_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Param) || IsA(node, SubPlan))
+		return true;
+	return expression_tree_walker(node, contain_params_walker, context);
+}
+
+/*
+ * Make a Gather node returning the tuples of subplan as they are.
+ */
+static Gather *
+make_gather(Plan *subplan)
+{
+	Gather	   *node = makeNode(Gather);
+	Plan	   *plan = &node->plan;
+	List	   *tlist = NIL;
+	ListCell   *lc;
+
+	foreach(lc, subplan->targetlist)
+	{
+		TargetEntry *tle = (TargetEntry *) lfirst(lc);
+		Var		   *var;
+
+		var = makeVarFromTargetEntry(OUTER_VAR, tle);
+		tlist = lappend(tlist, makeTargetEntry((Expr *) var,
+											   tle->resno,
+											   tle->resname,
+											   tle->resjunk));
+	}
+
+	plan->startup_cost = subplan->startup_cost;
+	plan->total_cost = subplan->total_cost;
+	plan->plan_rows = subplan->plan_rows;
+	plan->plan_width = subplan->plan_width;
+	plan->targetlist = tlist;
+	plan->qual = NIL;
+	plan->lefttree = subplan;
+	plan->righttree = NULL;
+	node->num_workers = parallel_scan_degree;
+
+	return node;
+}
+
+/*
+ * Split agg in two: a copy below a Gather computing transition values over
+ * the share of the scan of each process, and agg itself above it combining
+ * them with collection functions.
+ *
+ * The targetlist of the lower Agg has the grouping columns first, then the
+ * other Vars the upper Agg needs, then the aggregates.
+ */
+static Plan *
+make_parallel_agg(Agg *agg)
+{
+	Agg		   *partial = (Agg *) copyObject(agg);
+	Plan	   *scan = agg->plan.lefttree;
+	fix_upper_agg_context context;
+	List	   *aggs_n_vars;
+	ListCell   *lc;
+	AttrNumber	resno = 0;
+	int			i;
+
+	aggs_n_vars = pull_var_clause((Node *) list_concat(list_copy(agg->plan.targetlist),
+													   agg->plan.qual),
+								  PVC_INCLUDE_AGGREGATES,
+								  PVC_RECURSE_PLACEHOLDERS);
+
+	context.partial_tlist = NIL;
+	context.aggs = NIL;
+
+	for (i = 0; i < agg->numCols; i++)
+	{
+		TargetEntry *tle = get_tle_by_resno(scan->targetlist,
+											agg->grpColIdx[i]);
+		Var		   *var = makeVarFromTargetEntry(OUTER_VAR, tle);
+
+		context.partial_tlist = lappend(context.partial_tlist,
+										makeTargetEntry((Expr *) var, ++resno,
+														NULL, false));
+	}
+
+	foreach(lc, aggs_n_vars)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+
+		if (!IsA(var, Var) ||
+			find_var_resno(context.partial_tlist, var->varattno) != 0)
+			continue;
+		context.partial_tlist = lappend(context.partial_tlist,
+										makeTargetEntry((Expr *) copyObject(var),
+														++resno, NULL, false));
+	}
+
+	context.first_agg = resno + 1;
+	foreach(lc, aggs_n_vars)
+	{
+		Node	   *node = (Node *) lfirst(lc);
+
+		if (!IsA(node, Aggref) || list_member(context.aggs, node))
+			continue;
+		context.partial_tlist = lappend(context.partial_tlist,
+										makeTargetEntry((Expr *) copyObject(node),
+														++resno, NULL, false));
+		context.aggs = lappend(context.aggs, node);
+	}
+
+	/* the lower Agg returns every group, HAVING is for the upper one */
+	partial->plan.targetlist = context.partial_tlist;
+	partial->plan.qual = NIL;
+	partial->plan.lefttree = scan;
+
+	/* the upper Agg groups on the leading columns of the Gather */
+	agg->plan.targetlist = (List *)
+		fix_upper_agg_mutator((Node *) agg->plan.targetlist, &context);
+	agg->plan.qual = (List *)
+		fix_upper_agg_mutator((Node *) agg->plan.qual, &context);
+	agg->plan.lefttree = (Plan *) make_gather((Plan *) partial);
+	for (i = 0; i < agg->numCols; i++)
+		agg->grpColIdx[i] = i + 1;
+	agg->skip_trans = true;
+
+	list_free(aggs_n_vars);
+
+	return (Plan *) agg;
+}
+
+/*
+ * Point the Vars of the upper Agg to the targetlist of the lower Agg, and
+ * feed the transition values the lower Agg returns to its aggregates.
+ */
+static Node *
+fix_upper_agg_mutator(Node *node, fix_upper_agg_context *context)
+{
+	if (node == NULL)
+		return NULL;
+	if (IsA(node, Var))
+	{
+		Var		   *var = (Var *) copyObject(node);
+
+		Assert(var->varno == OUTER_VAR);
+		var->varattno = find_var_resno(context->partial_tlist, var->varattno);
+		if (var->varattno == 0)
+			elog(ERROR, "variable not found in partial aggregate targetlist");
+		return (Node *) var;
+	}
+	if (IsA(node, Aggref))
+	{
+		Aggref	   *aggref = (Aggref *) copyObject(node);
+		ListCell   *lc;
+		int			resno = context->first_agg;
+		Var		   *var;
+
+		foreach(lc, context->aggs)
+		{
+			if (equal(lfirst(lc), node))
+				break;
+			resno++;
+		}
+		if (lc == NULL)
+			elog(ERROR, "aggregate not found in partial aggregate targetlist");
+
+		var = makeVar(OUTER_VAR, resno, aggref->aggtrantype, -1,
+					  type_is_collatable(aggref->aggtrantype) ?
+					  aggref->inputcollid : InvalidOid, 0);
+		aggref->args = list_make1(makeTargetEntry((Expr *) var, 1, NULL,
+												  false));
+		aggref->aggstar = false;
+		return (Node *) aggref;
+	}
+	return expression_tree_mutator(node, fix_upper_agg_mutator,
+								   (void *) context);
+}
+
+/*
+ * Return the resno of the Var of the lower Agg referring to the given column
+ * of the scan, or 0 if there is none.  The Vars of both Aggs refer to the
+ * scan as OUTER_VAR, so the column number is enough to tell them apart.
+ */
+static AttrNumber
+find_var_resno(List *tlist, AttrNumber varattno)
+{
+	ListCell   *lc;
+
+	foreach(lc, tlist)
+	{
+		TargetEntry *tle = (TargetEntry *) lfirst(lc);
+
+		if (IsA(tle->expr, Var) &&
+			((Var *) tle->expr)->varattno == varattno)
+			return tle->resno;
+	}
+	return 0;
+}
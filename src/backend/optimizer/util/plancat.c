@@ -205,6 +205,7 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 				RelationGetForm(indexRelation)->reltablespace;
 			info->rel = rel;
 			info->ncolumns = ncolumns = index->indnatts;
+			info->nkeycolumns = index->indnkeyatts;
 			info->indexkeys = (int *) palloc(sizeof(int) * ncolumns);
 			info->indexcollations = (Oid *) palloc(sizeof(Oid) * ncolumns);
 			info->opfamily = (Oid *) palloc(sizeof(Oid) * ncolumns);
@@ -1145,11 +1146,12 @@ has_unique_index(RelOptInfo *rel, AttrNumber attno)
 		 * that all attr values are distinct, *unless* they are marked predOK
 		 * which means we know the index's predicate is satisfied by the
 		 * query. We don't take any interest in expressional indexes either.
-		 * Also, a multicolumn unique index doesn't allow us to conclude that
-		 * just the specified attr is unique.
+		 * Also, a unique index on several key columns doesn't allow us to
+		 * conclude that just the specified attr is unique; INCLUDE columns
+		 * don't matter here.
 		 */
 		if (index->unique &&
-			index->ncolumns == 1 &&
+			index->nkeycolumns == 1 &&
 			index->indexkeys[0] == attno &&
 			(index->indpred == NIL || index->predOK))
 			return true;
@@ -53,10 +53,12 @@ int				MaxDataNodes = 16;
 /* Global number of nodes. Point to a shared memory block */
 static int	   *shmemNumCoords;
 static int	   *shmemNumDataNodes;
+static int	   *shmemNumStandbys;
 
 /* Shared memory tables of node definitions */
 NodeDefinition *coDefs;
 NodeDefinition *dnDefs;
+NodeDefinition *sbDefs;
 
 /*
  * NodeTablesInit
@@ -98,6 +100,17 @@ NodeTablesShmemInit(void)
 	/* Mark it empty upon creation */
 	if (!found)
 		*shmemNumDataNodes = 0;
+
+	/* Same for Datanode standbys, at most one per Datanode is sized for */
+	shmemNumStandbys = ShmemInitStruct("Datanode Standby Table",
+								   sizeof(int) +
+									   sizeof(NodeDefinition) * MaxDataNodes,
+								   &found);
+
+	sbDefs = (NodeDefinition *) (shmemNumStandbys + 1);
+
+	if (!found)
+		*shmemNumStandbys = 0;
 }
 
 
@@ -116,7 +129,8 @@ NodeTablesShmemSize(void)
 	dn_size = mul_size(sizeof(NodeDefinition), MaxDataNodes);
 	dn_size = add_size(dn_size, sizeof(int));
 
-	return add_size(co_size, dn_size);
+	/* Datanode and standby tables have the same size */
+	return add_size(co_size, mul_size(dn_size, 2));
 }
 
 /*
@@ -126,7 +140,7 @@ NodeTablesShmemSize(void)
 static void
 check_node_options(const char *node_name, List *options, char **node_host,
 			int *node_port, char *node_type,
-			bool *is_primary, bool *is_preferred)
+			bool *is_primary, bool *is_preferred, Oid *standby_of)
 {
 	ListCell   *option;
 
@@ -178,6 +192,18 @@ check_node_options(const char *node_name, List *options, char **node_host,
 		{
 			*is_preferred = defGetBoolean(defel);
 		}
+		else if (strcmp(defel->defname, "standby_of") == 0)
+		{
+			char   *master_name = defGetString(defel);
+
+			*standby_of = get_pgxc_nodeoid(master_name);
+			if (!OidIsValid(*standby_of) ||
+				get_pgxc_nodetype(*standby_of) != PGXC_NODE_DATANODE)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("PGXC node %s: standby_of value \"%s\" is not a Datanode",
+								node_name, master_name)));
+		}
 		else
 		{
 			ereport(ERROR,
@@ -186,6 +212,20 @@ check_node_options(const char *node_name, List *options, char **node_host,
 		}
 	}
 
+	/*
+	 * A hot standby is declared as a Datanode replicating another one, and
+	 * is kept out of the Datanode list from then on.
+	 */
+	if (OidIsValid(*standby_of))
+	{
+		if (*node_type == PGXC_NODE_COORDINATOR)
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("PGXC node %s: only a Datanode can be a standby",
+							node_name)));
+		*node_type = PGXC_NODE_DATANODE_STANDBY;
+	}
+
 	/* A primary node has to be a Datanode */
 	if (*is_primary && *node_type != PGXC_NODE_DATANODE)
 		ereport(ERROR,
@@ -311,6 +351,7 @@ PgxcNodeListAndCount(void)
 
 	*shmemNumCoords = 0;
 	*shmemNumDataNodes = 0;
+	*shmemNumStandbys = 0;
 
 	/*
 	 * Node information initialization is made in one scan:
@@ -332,6 +373,12 @@ PgxcNodeListAndCount(void)
 			case PGXC_NODE_COORDINATOR:
 				node = &coDefs[(*shmemNumCoords)++];
 				break;
+			case PGXC_NODE_DATANODE_STANDBY:
+				/* Standbys beyond the table size are not used for reads */
+				if (*shmemNumStandbys >= MaxDataNodes)
+					continue;
+				node = &sbDefs[(*shmemNumStandbys)++];
+				break;
 			case PGXC_NODE_DATANODE:
 			default:
 				node = &dnDefs[(*shmemNumDataNodes)++];
@@ -345,6 +392,7 @@ PgxcNodeListAndCount(void)
 		node->nodeport = nodeForm->node_port;
 		node->nodeisprimary = nodeForm->nodeis_primary;
 		node->nodeispreferred = nodeForm->nodeis_preferred;
+		node->nodestandbyof = nodeForm->node_standby_of;
 	}
 	heap_endscan(scan);
 	heap_close(rel, AccessShareLock);
@@ -465,12 +513,68 @@ PgxcNodeGetDefinition(Oid node)
 		}
 	}
 
+	/* finally through the Datanode standbys */
+	for (i = 0; i < *shmemNumStandbys; i++)
+	{
+		if (sbDefs[i].nodeoid == node)
+		{
+			result = (NodeDefinition *) palloc(sizeof(NodeDefinition));
+
+			memcpy(result, sbDefs + i, sizeof(NodeDefinition));
+
+			LWLockRelease(NodeTableLock);
+
+			return result;
+		}
+	}
+
 	/* not found, return NULL */
 	LWLockRelease(NodeTableLock);
 	return NULL;
 }
 
 
+/*
+ * PgxcNodeGetStandby
+ *
+ * Return the Oid of a hot standby of the given Datanode, or InvalidOid if it
+ * has none.  When there are several, hint picks one of them, so that callers
+ * passing different hints spread over all the standbys.
+ */
+Oid
+PgxcNodeGetStandby(Oid node, uint32 hint)
+{
+	Oid			result = InvalidOid;
+	int			nstandbys = 0;
+	int			i;
+
+	LWLockAcquire(NodeTableLock, LW_SHARED);
+
+	for (i = 0; i < *shmemNumStandbys; i++)
+	{
+		if (sbDefs[i].nodestandbyof == node)
+			nstandbys++;
+	}
+
+	if (nstandbys > 0)
+	{
+		int			pick = hint % nstandbys;
+
+		for (i = 0; i < *shmemNumStandbys; i++)
+		{
+			if (sbDefs[i].nodestandbyof == node && pick-- == 0)
+			{
+				result = sbDefs[i].nodeoid;
+				break;
+			}
+		}
+	}
+
+	LWLockRelease(NodeTableLock);
+	return result;
+}
+
+
 /*
  * PgxcNodeCreate
  *
@@ -491,6 +595,7 @@ PgxcNodeCreate(CreateNodeStmt *stmt)
 	int			node_port = 0;
 	bool		is_primary = false;
 	bool		is_preferred = false;
+	Oid			standby_of = InvalidOid;
 	Datum		node_id;
 	Oid			nodeOid;
 
@@ -517,7 +622,7 @@ PgxcNodeCreate(CreateNodeStmt *stmt)
 	/* Filter options */
 	check_node_options(node_name, stmt->options, &node_host,
 				&node_port, &node_type,
-				&is_primary, &is_preferred);
+				&is_primary, &is_preferred, &standby_of);
 
 	/* Compute node identifier */
 	node_id = generate_node_id(node_name);
@@ -574,6 +679,7 @@ PgxcNodeCreate(CreateNodeStmt *stmt)
 	values[Anum_pgxc_node_is_primary - 1] = BoolGetDatum(is_primary);
 	values[Anum_pgxc_node_is_preferred - 1] = BoolGetDatum(is_preferred);
 	values[Anum_pgxc_node_id - 1] = node_id;
+	values[Anum_pgxc_node_standby_of - 1] = ObjectIdGetDatum(standby_of);
 
 	htup = heap_form_tuple(pgxcnodesrel->rd_att, values, nulls);
 
@@ -605,6 +711,7 @@ PgxcNodeAlter(AlterNodeStmt *stmt)
 	bool		was_primary;
 	bool		primary_off = false;
 	Oid			new_primary = InvalidOid;
+	Oid			standby_of;
 	HeapTuple	oldtup, newtup;
 	Oid			nodeOid = get_pgxc_nodeoid(node_name);
 	Relation	rel;
@@ -645,11 +752,12 @@ PgxcNodeAlter(AlterNodeStmt *stmt)
 	node_type = get_pgxc_nodetype(nodeOid);
 	node_type_old = node_type;
 	node_id = get_pgxc_node_id(nodeOid);
+	standby_of = ((Form_pgxc_node) GETSTRUCT(oldtup))->node_standby_of;
 
 	/* Filter options */
 	check_node_options(node_name, stmt->options, &node_host,
 				&node_port, &node_type,
-				&is_primary, &is_preferred);
+				&is_primary, &is_preferred, &standby_of);
 
 	/*
 	 * Two nodes cannot be primary at the same time. If the primary
@@ -688,6 +796,18 @@ PgxcNodeAlter(AlterNodeStmt *stmt)
 				(errcode(ERRCODE_SYNTAX_ERROR),
 				 errmsg("PGXC node %s: cannot alter Datanode to Coordinator",
 						node_name)));
+	else if (node_type_old == PGXC_NODE_DATANODE &&
+			 node_type == PGXC_NODE_DATANODE_STANDBY)
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("PGXC node %s: cannot alter Datanode to Datanode standby",
+						node_name)));
+	else if (node_type_old == PGXC_NODE_DATANODE_STANDBY &&
+			 node_type != PGXC_NODE_DATANODE_STANDBY)
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("PGXC node %s: cannot alter Datanode standby to another node type",
+						node_name)));
 
 	/* Update values for catalog entry */
 	MemSet(new_record, 0, sizeof(new_record));
@@ -706,6 +826,8 @@ PgxcNodeAlter(AlterNodeStmt *stmt)
 	new_record_repl[Anum_pgxc_node_is_preferred - 1] = true;
 	new_record[Anum_pgxc_node_id - 1] = UInt32GetDatum(node_id);
 	new_record_repl[Anum_pgxc_node_id - 1] = true;
+	new_record[Anum_pgxc_node_standby_of - 1] = ObjectIdGetDatum(standby_of);
+	new_record_repl[Anum_pgxc_node_standby_of - 1] = true;
 
 	/* Update relation */
 	newtup = heap_modify_tuple(oldtup, RelationGetDescr(rel),
@@ -737,6 +859,8 @@ PgxcNodeRemove(DropNodeStmt *stmt)
 {
 	Relation	relation;
 	HeapTuple	tup;
+	HeapScanDesc scan;
+	HeapTuple	standbytup;
 	const char	*node_name = stmt->node_name;
 	Oid		noid = get_pgxc_nodeoid(node_name);
 	bool 		is_primary;
@@ -771,6 +895,22 @@ PgxcNodeRemove(DropNodeStmt *stmt)
 
 	/* Delete the pgxc_node tuple */
 	relation = heap_open(PgxcNodeRelationId, RowExclusiveLock);
+
+	/* A Datanode cannot go away before its standbys */
+	scan = heap_beginscan(relation, SnapshotNow, 0, NULL);
+	while ((standbytup = heap_getnext(scan, ForwardScanDirection)) != NULL)
+	{
+		Form_pgxc_node	nodeForm = (Form_pgxc_node) GETSTRUCT(standbytup);
+
+		if (nodeForm->node_standby_of == noid)
+			ereport(ERROR,
+					(errcode(ERRCODE_DEPENDENT_OBJECTS_STILL_EXIST),
+					 errmsg("PGXC Node %s: cannot drop a Datanode that has standbys",
+							node_name),
+					 errhint("Drop standby node %s first.",
+							 NameStr(nodeForm->node_name))));
+	}
+	heap_endscan(scan);
 	tup = SearchSysCache1(PGXCNODEOID, ObjectIdGetDatum(noid));
 	is_primary = is_pgxc_nodeprimary(noid);
 	if (!HeapTupleIsValid(tup)) /* should not happen */
@@ -15,6 +15,7 @@
  *-------------------------------------------------------------------------
  */
 
+#include <ctype.h>
 #include <time.h>
 #include "postgres.h"
 #include "access/twophase.h"
@@ -31,7 +32,9 @@
 #endif
 #include "executor/executor.h"
 #include "gtm/gtm_c.h"
+#include "lib/bloomfilter.h"
 #include "libpq/libpq.h"
+#include "libpq/pqformat.h"
 #include "miscadmin.h"
 #include "pgxc/execRemote.h"
 #include "nodes/nodes.h"
@@ -39,7 +42,9 @@
 #include "optimizer/var.h"
 #include "pgxc/copyops.h"
 #include "pgxc/nodemgr.h"
+#include "pgxc/planship.h"
 #include "pgxc/poolmgr.h"
+#include "portability/instr_time.h"
 #include "storage/ipc.h"
 #include "utils/datum.h"
 #include "utils/lsyscache.h"
@@ -47,6 +52,7 @@
 #include "utils/tuplesort.h"
 #include "utils/snapmgr.h"
 #include "utils/builtins.h"
+#include "utils/bytea.h"
 #include "pgxc/locator.h"
 #include "pgxc/pgxc.h"
 #include "parser/parse_type.h"
@@ -159,6 +165,9 @@ static PGXCNodeAllHandles * get_exec_connections(RemoteQueryState *planstate,
 					 RemoteQueryExecType exec_type);
 
 static void close_node_cursors(PGXCNodeHandle **connections, int conn_count, char *cursor);
+static void cancel_remote_query(RemoteQueryState *node);
+static void do_query_send(RemoteQueryState *node);
+static void do_query_receive(RemoteQueryState *node);
 
 static int pgxc_get_transaction_nodes(PGXCNodeHandle *connections[], int size, bool writeOnly);
 static int pgxc_get_connections(PGXCNodeHandle *connections[], int size, List *connlist);
@@ -190,6 +199,10 @@ static void pgxc_rq_fire_astriggers(RemoteQueryState *node);
 
 static int flushPGXCNodeHandleData(PGXCNodeHandle *handle);
 
+static bool pgxc_plan_shippable(RemoteQueryState *node, int conn_count);
+static void pgxc_wait_shipped_plan(RemoteQueryState *node,
+					   PGXCNodeHandle *conn);
+
 /*
  * Create a structure to store parameters needed to combine responses from
  * multiple connections as well as state information
@@ -220,6 +233,7 @@ CreateResponseCombiner(int node_count, CombineType combine_type)
 	combiner->errorMessage = NULL;
 	combiner->errorDetail = NULL;
 	combiner->query_Done = false;
+	combiner->query_pending = false;
 	combiner->currentRow.msg = NULL;
 	combiner->currentRow.msglen = 0;
 	combiner->currentRow.msgnode = 0;
@@ -950,6 +964,20 @@ BufferConnection(PGXCNodeHandle *conn)
 	 */
 	oldcontext = MemoryContextSwitchTo(combiner->ss.ss_ScanTupleSlot->tts_mcxt);
 
+	/*
+	 * If the query was sent down ahead of time, its first response has not
+	 * been read yet; do that now, the way the query would have done itself.
+	 */
+	if (combiner->query_pending)
+	{
+		do_query_receive(combiner);
+		if (conn->state != DN_CONNECTION_STATE_QUERY)
+		{
+			MemoryContextSwitchTo(oldcontext);
+			return;
+		}
+	}
+
 	/* Verify the connection is in use by the combiner */
 	combiner->current_conn = 0;
 	while (combiner->current_conn < combiner->conn_count)
@@ -1123,7 +1151,15 @@ FetchTuple(RemoteQueryState *combiner, TupleTableSlot *slot)
 		res = handle_response(conn, combiner);
 		if (res == RESPONSE_EOF)
 		{
-			/* incomplete message, read more */
+			/*
+			 * Incomplete message.  If we have a tuple, return it rather than
+			 * wait for the Datanode; the caller may have other rows to read
+			 * meanwhile (see ExecRemoteQueriesNext).
+			 */
+			if (have_tuple)
+				return true;
+
+			/* read more */
 			if (pgxc_node_receive(1, &conn, NULL))
 				ereport(ERROR,
 						(errcode(ERRCODE_INTERNAL_ERROR),
@@ -1357,6 +1393,8 @@ handle_response(PGXCNodeHandle * conn, RemoteQueryState *combiner)
 			case 'b':
 				conn->state = DN_CONNECTION_STATE_IDLE;
 				return RESPONSE_BARRIER_OK;
+			case 'Y':			/* Plan, see pgxc_wait_shipped_plan */
+				break;
 			case 'I':			/* EmptyQuery */
 			default:
 				/* sync lost? */
@@ -2859,8 +2897,12 @@ pgxc_start_command_on_connection(PGXCNodeHandle *connection,
 		    step->has_row_marks)
 			send_desc = true;
 
-		/* if prepared statement is referenced see if it is already exist */
-		if (step->statement)
+		/*
+		 * if prepared statement is referenced see if it is already exist.
+		 * It is not left on a standby connection: the next transactions of
+		 * the session may use the Datanode instead.
+		 */
+		if (step->statement && !connection->standby)
 			prepared = ActivateDatanodeStatementOnNode(step->statement,
 													   PGXCNodeGetNodeId(connection->nodeoid,
 																		 PGXC_NODE_DATANODE));
@@ -2872,8 +2914,11 @@ pgxc_start_command_on_connection(PGXCNodeHandle *connection,
 			fetch = 1;
 
 		if (pgxc_node_send_query_extended(connection,
-							prepared ? NULL : step->sql_statement,
-							step->statement,
+							prepared ? NULL :
+							(remotestate->rqs_bloom_statement ?
+							 remotestate->rqs_bloom_statement :
+							 step->sql_statement),
+							connection->standby ? NULL : step->statement,
 							step->cursor,
 							remotestate->rqs_num_params,
 							remotestate->rqs_param_types,
@@ -2883,6 +2928,14 @@ pgxc_start_command_on_connection(PGXCNodeHandle *connection,
 							fetch) != 0)
 			return false;
 	}
+	else if (remotestate->rqs_shipped_plan)
+	{
+		if (pgxc_node_send_plan(connection, step->sql_statement,
+								remotestate->rqs_shipped_plan,
+								remotestate->rqs_shipped_planlen) != 0)
+			return false;
+		remotestate->rqs_plan_shipped++;
+	}
 	else
 	{
 		if (pgxc_node_send_query(connection, step->sql_statement) != 0)
@@ -2891,6 +2944,92 @@ pgxc_start_command_on_connection(PGXCNodeHandle *connection,
 	return true;
 }
 
+/*
+ * pgxc_plan_shippable
+ *
+ * Should the first Datanode be asked for its plan, to be run by the other
+ * ones?  Only plain reads sent with the simple query protocol qualify.
+ */
+static bool
+pgxc_plan_shippable(RemoteQueryState *node, int conn_count)
+{
+	RemoteQuery *step = (RemoteQuery *) node->ss.ps.plan;
+
+	return enable_plan_shipping &&
+		conn_count > 1 &&
+		step->exec_type == EXEC_ON_DATANODES &&
+		step->exec_nodes != NULL &&
+		step->exec_nodes->accesstype == RELATION_ACCESS_READ &&
+		!step->has_row_marks &&
+		step->sql_statement != NULL &&
+		step->statement == NULL &&
+		step->cursor == NULL &&
+		node->rqs_num_params == 0;
+}
+
+/*
+ * pgxc_wait_shipped_plan
+ *
+ * Read the answer of a Datanode to a plan request, which comes before the
+ * results of the statement.  If something else comes first, the Datanode
+ * did not get as far as planning: leave that message for handle_response,
+ * and have the statement planned by every node.
+ */
+static void
+pgxc_wait_shipped_plan(RemoteQueryState *node, PGXCNodeHandle *conn)
+{
+	instr_time	start;
+	instr_time	elapsed;
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	for (;;)
+	{
+		size_t		savestart = conn->inStart;
+		char	   *msg;
+		int			len;
+		char		msgtype;
+
+		msgtype = get_message(conn, &len, &msg);
+		if (msgtype == '\0')
+		{
+			if (pgxc_node_receive(1, &conn, NULL))
+				ereport(ERROR,
+						(errcode(ERRCODE_INTERNAL_ERROR),
+						 errmsg("Failed to read response from Datanodes")));
+			continue;
+		}
+
+		if (msgtype == 'Y')
+		{
+			StringInfoData buf;
+
+			buf.data = msg;
+			buf.len = len;
+			buf.maxlen = len;
+			buf.cursor = 0;
+			node->rqs_remote_plan_time = pq_getmsgfloat8(&buf);
+			if (buf.cursor < len)
+			{
+				node->rqs_shipped_planlen = len - buf.cursor;
+				node->rqs_shipped_plan = palloc(node->rqs_shipped_planlen);
+				memcpy(node->rqs_shipped_plan, msg + buf.cursor,
+					   node->rqs_shipped_planlen);
+			}
+		}
+		else
+		{
+			conn->inStart = savestart;
+			conn->inCursor = savestart;
+		}
+		break;
+	}
+
+	INSTR_TIME_SET_CURRENT(elapsed);
+	INSTR_TIME_SUBTRACT(elapsed, start);
+	node->rqs_plan_wait_time = INSTR_TIME_GET_MILLISEC(elapsed);
+}
+
 
 /*
  * IsReturningDMLOnReplicatedTable
@@ -2916,8 +3055,26 @@ IsReturningDMLOnReplicatedTable(RemoteQuery *rq)
 	return false;
 }
 
+/*
+ * do_query
+ * Send the query down to the nodes and wait for the first row, or for all
+ * of them to complete.
+ */
 void
 do_query(RemoteQueryState *node)
+{
+	do_query_send(node);
+	do_query_receive(node);
+}
+
+/*
+ * do_query_send
+ * Send the query down to the nodes.  The Datanode connections the results
+ * are to be read from are left in node->connections, and query_pending is
+ * set until do_query_receive has read the first response.
+ */
+static void
+do_query_send(RemoteQueryState *node)
 {
 	RemoteQuery		*step = (RemoteQuery *) node->ss.ps.plan;
 	TupleTableSlot		*scanslot = node->ss.ss_ScanTupleSlot;
@@ -3098,6 +3255,22 @@ do_query(RemoteQueryState *node)
 		pgxc_node_report_error(node);
 	}
 
+	/*
+	 * Let the first Datanode plan a read and the others run its plan, rather
+	 * than have each of them plan the same statement.
+	 */
+	if (node->rqs_shipped_plan)
+	{
+		pfree(node->rqs_shipped_plan);
+		node->rqs_shipped_plan = NULL;
+	}
+	node->rqs_shipped_planlen = 0;
+	node->rqs_plan_shipped = 0;
+	node->rqs_plan_node = InvalidOid;
+	if (primaryconnection == NULL &&
+		pgxc_plan_shippable(node, regular_conn_count))
+		node->rqs_plan_node = connections[0]->nodeoid;
+
 	for (i = 0; i < regular_conn_count; i++)
 	{
 		if (pgxc_node_begin(1, &connections[i], gxid, need_tran_block,
@@ -3106,6 +3279,12 @@ do_query(RemoteQueryState *node)
 					(errcode(ERRCODE_INTERNAL_ERROR),
 					 errmsg("Could not begin transaction on Datanodes.")));
 
+		if (i == 0 && OidIsValid(node->rqs_plan_node) &&
+			pgxc_node_send_plan_request(connections[i]) != 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("Failed to send command to Datanodes")));
+
 		if (!pgxc_start_command_on_connection(connections[i], node, snapshot))
 		{
 			pfree(connections);
@@ -3116,6 +3295,9 @@ do_query(RemoteQueryState *node)
 					 errmsg("Failed to send command to Datanodes")));
 		}
 		connections[i]->combiner = node;
+
+		if (i == 0 && OidIsValid(node->rqs_plan_node))
+			pgxc_wait_shipped_plan(node, connections[i]);
 	}
 
 	if (step->cursor)
@@ -3125,6 +3307,33 @@ do_query(RemoteQueryState *node)
 		memcpy(node->cursor_connections, connections, regular_conn_count * sizeof(PGXCNodeHandle *));
 	}
 
+	/*
+	 * Keep the connections where BufferConnection can find them, should
+	 * another query need one before do_query_receive is called.
+	 */
+	node->connections = connections;
+	node->conn_count = regular_conn_count;
+	node->current_conn = 0;
+	node->query_pending = true;
+}
+
+/*
+ * do_query_receive
+ * Read the responses to a query sent by do_query_send, until the first data
+ * row arrives or all the nodes have completed the command.
+ */
+static void
+do_query_receive(RemoteQueryState *node)
+{
+	TupleTableSlot		*scanslot = node->ss.ss_ScanTupleSlot;
+	PGXCNodeHandle		**connections = node->connections;
+	int			regular_conn_count = node->conn_count;
+
+	Assert(node->query_pending);
+	node->query_pending = false;
+	node->connections = NULL;
+	node->conn_count = 0;
+
 	/*
 	 * Stop if all commands are completed or we got a data row and
 	 * initialized state node for subsequent invocations
@@ -3136,8 +3345,6 @@ do_query(RemoteQueryState *node)
 		if (pgxc_node_receive(regular_conn_count, connections, NULL))
 		{
 			pfree(connections);
-			if (primaryconnection)
-				pfree(primaryconnection);
 			if (node->cursor_connections)
 				pfree(node->cursor_connections);
 
@@ -3212,6 +3419,357 @@ do_query(RemoteQueryState *node)
 	}
 }
 
+/*
+ * remote_query_send
+ * Send the query down to the nodes, if that has not been done yet.
+ */
+static void
+remote_query_send(RemoteQueryState *node)
+{
+	if (!node->query_Done)
+	{
+		/* Fire BEFORE STATEMENT triggers just before the query execution */
+		pgxc_rq_fire_bstriggers(node);
+		do_query_send(node);
+		node->query_Done = true;
+	}
+}
+
+/*
+ * remote_query_start
+ * Make sure the query has been sent down and its first response read.
+ */
+static void
+remote_query_start(RemoteQueryState *node)
+{
+	remote_query_send(node);
+	if (node->query_pending)
+		do_query_receive(node);
+}
+
+/*
+ * remote_query_start_nodes
+ * If the Datanodes a remote query will run on can be known before it runs,
+ * and it is a plain read that may be sent down ahead of time, add their
+ * indexes to *nodes and return true.
+ */
+static bool
+remote_query_start_nodes(RemoteQueryState *node, Bitmapset **nodes)
+{
+	RemoteQuery *step = (RemoteQuery *) node->ss.ps.plan;
+	ExecNodes  *exec_nodes = step->exec_nodes;
+	ListCell   *lc;
+	int			i;
+
+	if (node->ss.ps.chgParam != NULL ||
+		step->exec_type != EXEC_ON_DATANODES ||
+		exec_nodes == NULL ||
+		exec_nodes->accesstype != RELATION_ACCESS_READ ||
+		exec_nodes->en_expr != NULL ||
+		OidIsValid(exec_nodes->en_relid) ||
+		exec_nodes->primarynodelist != NIL ||
+		step->has_row_marks ||
+		step->cursor != NULL ||
+		OidIsValid(node->rqs_bloom_hashfunc))
+		return false;
+
+	/* An empty list means all the Datanodes, as in get_exec_connections */
+	if (exec_nodes->nodeList == NIL)
+	{
+		for (i = 0; i < NumDataNodes; i++)
+			*nodes = bms_add_member(*nodes, i);
+	}
+	else
+	{
+		foreach(lc, exec_nodes->nodeList)
+			*nodes = bms_add_member(*nodes, lfirst_int(lc));
+	}
+
+	return true;
+}
+
+/*
+ * State of remote queries read in the order their rows arrive, see
+ * ExecStartRemoteQueries
+ */
+struct RemoteQueriesState
+{
+	int			count;			/* number of queries */
+	PlanState **queries;		/* the RemoteQueryStates, in plan order */
+	Bitmapset **nodes;			/* Datanodes of each query */
+	char	   *status;			/* RQS_xxx status of each query */
+	Bitmapset  *busy_nodes;		/* Datanodes of the running queries */
+	int			current;		/* query the last row was read from */
+};
+
+#define RQS_WAITING		'w'		/* not sent down yet */
+#define RQS_RUNNING		'r'		/* sent down, rows being read */
+#define RQS_DONE		'd'		/* all rows read */
+
+/*
+ * remote_queries_send
+ * Send down the queries waiting for Datanodes that no running query uses.
+ */
+static void
+remote_queries_send(RemoteQueriesState *state)
+{
+	int			i;
+
+	for (i = 0; i < state->count; i++)
+	{
+		if (state->status[i] != RQS_WAITING ||
+			bms_overlap(state->nodes[i], state->busy_nodes))
+			continue;
+
+		remote_query_send((RemoteQueryState *) state->queries[i]);
+		state->status[i] = RQS_RUNNING;
+		state->busy_nodes = bms_add_members(state->busy_nodes,
+											state->nodes[i]);
+	}
+}
+
+/*
+ * remote_query_ready
+ * Can the next row of a remote query that has been sent down, or the end of
+ * its rows, be read without waiting for a Datanode?
+ */
+static bool
+remote_query_ready(RemoteQueryState *node)
+{
+	PGXCNodeHandle *conn;
+	int			i;
+
+	/* Rows already received */
+	if (node->currentRow.msg != NULL || node->rowBuffer != NIL)
+		return true;
+	if (node->tuplestorestate != NULL &&
+		!tuplestore_ateof(node->tuplestorestate))
+		return true;
+
+	/* Nothing more to receive */
+	if (node->conn_count == 0)
+		return true;
+
+	/* Until the first response is read, it may come from any connection */
+	if (node->query_pending)
+	{
+		for (i = 0; i < node->conn_count; i++)
+		{
+			conn = node->connections[i];
+			if (conn->state != DN_CONNECTION_STATE_QUERY ||
+				HAS_MESSAGE_BUFFERED(conn))
+				return true;
+		}
+		return false;
+	}
+
+	/* Afterwards FetchTuple reads from the current connection */
+	conn = node->connections[node->current_conn];
+	return conn->state != DN_CONNECTION_STATE_QUERY ||
+		conn->combiner != node ||
+		HAS_MESSAGE_BUFFERED(conn);
+}
+
+/*
+ * remote_queries_wait
+ * Wait until input arrives for one of the running queries, none of which
+ * is ready to be read.
+ */
+static void
+remote_queries_wait(RemoteQueriesState *state)
+{
+	PGXCNodeHandle **connections;
+	int			conn_count = 0;
+	int			max_count = 0;
+	int			i;
+	int			j;
+
+	for (i = 0; i < state->count; i++)
+	{
+		if (state->status[i] == RQS_RUNNING)
+			max_count += ((RemoteQueryState *) state->queries[i])->conn_count;
+	}
+	if (max_count == 0)
+		return;
+
+	connections = (PGXCNodeHandle **)
+		palloc(max_count * sizeof(PGXCNodeHandle *));
+	for (i = 0; i < state->count; i++)
+	{
+		RemoteQueryState *node = (RemoteQueryState *) state->queries[i];
+
+		if (state->status[i] != RQS_RUNNING)
+			continue;
+
+		if (node->query_pending)
+		{
+			for (j = 0; j < node->conn_count; j++)
+				connections[conn_count++] = node->connections[j];
+		}
+		else if (node->conn_count > 0)
+			connections[conn_count++] = node->connections[node->current_conn];
+	}
+
+	if (pgxc_node_receive(conn_count, connections, NULL))
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("Failed to read response from Datanodes")));
+	pfree(connections);
+}
+
+/*
+ * ExecStartRemoteQueries
+ * Send down ahead of time the remote queries among the given plans, which
+ * are going to be read as under an Append.
+ *
+ * A remote query that has been sent down runs on its Datanodes while the
+ * other plans are being read, so the latencies of the queries overlap
+ * instead of adding up.  However, a connection can carry only one query at
+ * a time, so a query is sent down only while none of its Datanodes is busy
+ * with another.
+ *
+ * If all the plans are remote queries whose Datanodes are known beforehand,
+ * and the caller does not need their rows in plan order (any_order), the
+ * queries sharing Datanodes with a running one are sent down as soon as it
+ * is done, and the returned state lets ExecRemoteQueriesNext read the rows
+ * of whichever query has some ready.
+ *
+ * Otherwise the plans are read one after another, and NULL is returned.
+ * A query is then sent down only if none of its Datanodes is used by a plan
+ * before it: running it on a connection still busy with an earlier query
+ * would mean reading the rest of the earlier one's results into memory
+ * first (see BufferConnection).  We stop at the first plan whose Datanodes
+ * cannot be known beforehand.
+ */
+RemoteQueriesState *
+ExecStartRemoteQueries(PlanState **plans, int nplans, bool any_order)
+{
+	MemoryContext oldcontext;
+	RemoteQueriesState *state;
+	Bitmapset **nodes;
+	Bitmapset  *used_nodes = NULL;
+	int			count;
+	int			i;
+
+	if (nplans == 0)
+		return NULL;
+
+	oldcontext = MemoryContextSwitchTo(plans[0]->state->es_query_cxt);
+
+	nodes = (Bitmapset **) palloc0(nplans * sizeof(Bitmapset *));
+	for (count = 0; count < nplans; count++)
+	{
+		if (!IsA(plans[count], RemoteQueryState) ||
+			!remote_query_start_nodes((RemoteQueryState *) plans[count],
+									  &nodes[count]))
+			break;
+	}
+
+	if (!any_order || count < nplans || nplans < 2)
+	{
+		for (i = 0; i < count; i++)
+		{
+			if (!bms_overlap(nodes[i], used_nodes))
+				remote_query_send((RemoteQueryState *) plans[i]);
+
+			used_nodes = bms_join(used_nodes, nodes[i]);
+		}
+
+		bms_free(used_nodes);
+		pfree(nodes);
+		MemoryContextSwitchTo(oldcontext);
+		return NULL;
+	}
+
+	state = (RemoteQueriesState *) palloc(sizeof(RemoteQueriesState));
+	state->count = nplans;
+	state->queries = plans;
+	state->nodes = nodes;
+	state->status = (char *) palloc(nplans * sizeof(char));
+	memset(state->status, RQS_WAITING, nplans * sizeof(char));
+	state->busy_nodes = NULL;
+	state->current = nplans - 1;
+
+	remote_queries_send(state);
+
+	MemoryContextSwitchTo(oldcontext);
+	return state;
+}
+
+/*
+ * ExecRemoteQueriesNext
+ * Return the next row of the remote queries started by
+ * ExecStartRemoteQueries, from whichever query has one ready, or NULL once
+ * all their rows have been read.
+ *
+ * The running queries are visited in turn, so that no Datanode waits long
+ * for its rows to be read.  Only when none of them has anything to read do
+ * we wait, for all their connections at once.
+ */
+TupleTableSlot *
+ExecRemoteQueriesNext(RemoteQueriesState *state)
+{
+	for (;;)
+	{
+		TupleTableSlot *slot;
+		bool		running = false;
+		int			which = -1;
+		int			i;
+
+		for (i = 1; i <= state->count; i++)
+		{
+			int			j = (state->current + i) % state->count;
+
+			if (state->status[j] != RQS_RUNNING)
+				continue;
+			running = true;
+			if (remote_query_ready((RemoteQueryState *) state->queries[j]))
+			{
+				which = j;
+				break;
+			}
+		}
+
+		if (!running)
+			return NULL;
+
+		if (which < 0)
+		{
+			remote_queries_wait(state);
+			continue;
+		}
+
+		state->current = which;
+		slot = ExecProcNode(state->queries[which]);
+		if (!TupIsNull(slot))
+			return slot;
+
+		/* The query is done, its Datanodes may take the queries waiting */
+		state->status[which] = RQS_DONE;
+		state->busy_nodes = bms_del_members(state->busy_nodes,
+											state->nodes[which]);
+		remote_queries_send(state);
+	}
+}
+
+/*
+ * ExecEndRemoteQueries
+ * Release the state returned by ExecStartRemoteQueries.  The queries
+ * themselves are left to the caller.
+ */
+void
+ExecEndRemoteQueries(RemoteQueriesState *state)
+{
+	int			i;
+
+	for (i = 0; i < state->count; i++)
+		bms_free(state->nodes[i]);
+	bms_free(state->busy_nodes);
+	pfree(state->nodes);
+	pfree(state->status);
+	pfree(state);
+}
+
 /*
  * ExecRemoteQuery
  * Wrapper around the main RemoteQueryNext() function. This
@@ -3266,13 +3824,7 @@ RemoteQueryNext(ScanState *scan_node)
 	 */
 	node->rqs_processed = 0;
 
-	if (!node->query_Done)
-	{
-		/* Fire BEFORE STATEMENT triggers just before the query execution */
-		pgxc_rq_fire_bstriggers(node);
-		do_query(node);
-		node->query_Done = true;
-	}
+	remote_query_start(node);
 
 	if (node->update_cursor)
 	{
@@ -3402,6 +3954,128 @@ RemoteQueryNext(ScanState *scan_node)
 	return scanslot;
 }
 
+/*
+ * cancel_remote_query
+ *
+ * If the executor is done with a remote query before the Datanodes have
+ * sent all its rows, as with a LIMIT that could not be shipped, the rows
+ * still coming would have to be read and thrown away, and the Datanodes
+ * would go on producing them until the end.  Instead, cancel the query on
+ * the Datanodes through the pooler and read only what they sent up to then.
+ *
+ * That is only safe for a read-only query running outside a transaction
+ * block on the Datanode: the cancel then aborts nothing but the query
+ * itself.  Connections that do not qualify are left to the caller to drain.
+ */
+static void
+cancel_remote_query(RemoteQueryState *node)
+{
+	RemoteQuery *step = (RemoteQuery *) node->ss.ps.plan;
+	PGXCNodeHandle *cancelled[node->conn_count];
+	int			dn_cancel[node->conn_count];
+	int			count = 0;
+	bool		need_delay = false;
+	int			i;
+
+	if (step->exec_type != EXEC_ON_DATANODES ||
+		step->exec_nodes == NULL ||
+		step->exec_nodes->accesstype != RELATION_ACCESS_READ ||
+		step->has_row_marks ||
+		node->cursor != NULL)
+		return;
+
+	for (i = 0; i < node->conn_count; i++)
+	{
+		PGXCNodeHandle *conn = node->connections[i];
+
+		if (conn == NULL ||
+			conn->state != DN_CONNECTION_STATE_QUERY ||
+			conn->combiner != node ||
+			conn->transaction_status != 'I')
+			continue;
+
+		cancelled[count] = conn;
+		dn_cancel[count] = PGXCNodeGetNodeId(conn->nodeoid, PGXC_NODE_DATANODE);
+		count++;
+	}
+
+	if (count == 0)
+		return;
+
+	PoolManagerCancelQuery(count, dn_cancel, 0, NULL);
+
+	/*
+	 * Read up to ReadyForQuery from each connection, so that it can be used
+	 * again.  The Datanode should answer with a "query canceled" error, which
+	 * is expected and so not reported.  If the query completed before the
+	 * cancel got there, the cancel may still be pending; wait a moment, as
+	 * cancel_query does, so that it cannot hit the next query instead.
+	 */
+	for (i = 0; i < count; i++)
+	{
+		PGXCNodeHandle *conn = cancelled[i];
+		char	   *saveErrorMessage = node->errorMessage;
+		char		saveErrorCode[5];
+		char	   *code;
+
+		memcpy(saveErrorCode, node->errorCode, 5);
+		node->errorMessage = NULL;
+
+		while (conn->state == DN_CONNECTION_STATE_QUERY)
+		{
+			int			res;
+
+			/* throw away message */
+			if (node->currentRow.msg)
+			{
+				pfree(node->currentRow.msg);
+				node->currentRow.msg = NULL;
+			}
+
+			res = handle_response(conn, node);
+			if (res == RESPONSE_EOF)
+			{
+				struct timeval timeout;
+				timeout.tv_sec = END_QUERY_TIMEOUT;
+				timeout.tv_usec = 0;
+
+				if (pgxc_node_receive(1, &conn, &timeout))
+					ereport(ERROR,
+							(errcode(ERRCODE_INTERNAL_ERROR),
+							 errmsg("Failed to read response from Datanodes when ending query")));
+			}
+		}
+
+		code = node->errorCode;
+		if (node->errorMessage &&
+			MAKE_SQLSTATE(code[0], code[1], code[2], code[3], code[4]) ==
+			ERRCODE_QUERY_CANCELED)
+		{
+			pfree(node->errorMessage);
+			node->errorMessage = NULL;
+			if (conn->error)
+			{
+				pfree(conn->error);
+				conn->error = NULL;
+			}
+		}
+		else
+			need_delay = true;
+
+		/* Put back any error seen before */
+		if (node->errorMessage == NULL)
+		{
+			node->errorMessage = saveErrorMessage;
+			memcpy(node->errorCode, saveErrorCode, 5);
+		}
+		else if (saveErrorMessage)
+			pfree(saveErrorMessage);
+	}
+
+	if (need_delay && pgxcnode_cancel_delay > 0)
+		pg_usleep(pgxcnode_cancel_delay * 1000);
+}
+
 /*
  * End the remote query
  */
@@ -3418,6 +4092,9 @@ ExecEndRemoteQuery(RemoteQueryState *node)
 	}
 	list_free_deep(node->rowBuffer);
 
+	/* Stop the Datanodes from sending rows nobody will read */
+	cancel_remote_query(node);
+
 	node->current_conn = 0;
 	while (node->conn_count > 0)
 	{
@@ -3522,6 +4199,18 @@ ExecEndRemoteQuery(RemoteQueryState *node)
 		node->paramval_len = 0;
 	}
 
+	if (node->rqs_bloom_statement)
+	{
+		pfree(node->rqs_bloom_statement);
+		node->rqs_bloom_statement = NULL;
+	}
+
+	if (node->rqs_shipped_plan)
+	{
+		pfree(node->rqs_shipped_plan);
+		node->rqs_shipped_plan = NULL;
+	}
+
 	/* Free the param types if they are newly allocated */
 	if (node->rqs_param_types &&
 	    node->rqs_param_types != ((RemoteQuery*)node->ss.ps.plan)->rq_param_types)
@@ -3761,6 +4450,165 @@ ExecRemoteQueryReScan(RemoteQueryState *node, ExprContext *exprCtxt)
 }
 
 
+/*
+ * ExecRemoteQueryInitBloomFilter
+ *
+ * Called by a parent Hash Join at initialization, to announce that it will
+ * supply a Bloom filter over the hash values of the join keys on its inner
+ * side.  attno is the column of the remote result holding the outer join
+ * key, and hashfunc is the hash function the join applies to it.
+ *
+ * Returns false if the filter cannot be applied to this remote query, in
+ * which case the caller should not bother building it.
+ */
+bool
+ExecRemoteQueryInitBloomFilter(RemoteQueryState *node, AttrNumber attno,
+							   Oid hashfunc)
+{
+	RemoteQuery *step = (RemoteQuery *) node->ss.ps.plan;
+	TupleDesc	scandesc = node->ss.ss_ScanTupleSlot->tts_tupleDescriptor;
+	char	   *sql = step->sql_statement;
+	int			len;
+
+	/*
+	 * Only plain reads on Datanodes are eligible.  The filter is added by
+	 * wrapping the statement and passing one more parameter, which rules out
+	 * statements prepared or declared on the remote side, and those using
+	 * internal parameters.
+	 */
+	if (step->exec_type != EXEC_ON_DATANODES ||
+		step->exec_nodes == NULL ||
+		step->exec_nodes->accesstype != RELATION_ACCESS_READ ||
+		step->statement || step->cursor || node->cursor ||
+		step->has_row_marks || step->rq_params_internal ||
+		step->base_tlist == NIL || sql == NULL)
+		return false;
+
+	if (attno <= 0 || attno > scandesc->natts)
+		return false;
+
+	/* A statement terminator would end up inside the subquery */
+	len = strlen(sql);
+	while (len > 0 && isspace((unsigned char) sql[len - 1]))
+		len--;
+	if (len == 0 || sql[len - 1] == ';')
+		return false;
+
+	node->rqs_bloom_attno = attno;
+	node->rqs_bloom_hashfunc = hashfunc;
+	return true;
+}
+
+/*
+ * ExecRemoteQuerySetBloomFilter
+ *
+ * Apply a Bloom filter, promised by ExecRemoteQueryInitBloomFilter, to the
+ * remote query.  The statement becomes
+ *
+ *	SELECT * FROM (<statement>) AS __pgxc_bloom (c1, ..., cN)
+ *		WHERE pg_catalog.pgxc_bloom_contains($n, hashfunc(cN))
+ *
+ * with the filter passed as the extra parameter $n, so that the Datanodes
+ * only send back the rows whose key may be found in the filter.  Only the
+ * columns up to the key are renamed, which does not change the result.
+ *
+ * This has no effect once the query has been sent.
+ */
+void
+ExecRemoteQuerySetBloomFilter(RemoteQueryState *node, bytea *filter)
+{
+	RemoteQuery *step = (RemoteQuery *) node->ss.ps.plan;
+	Oid			hashfunc = node->rqs_bloom_hashfunc;
+	MemoryContext oldcontext;
+	StringInfoData buf;
+	Oid		   *argtypes;
+	int			nargs;
+	int			nparams;
+	Oid		   *param_types;
+	char	   *pstring;
+	int			len;
+	uint16		n16;
+	uint32		n32;
+	int			i;
+
+	if (node->query_Done || !OidIsValid(hashfunc))
+		return;
+
+	oldcontext = MemoryContextSwitchTo(node->ss.ps.state->es_query_cxt);
+
+	nparams = node->rqs_num_params + 1;
+
+	/* Wrap the statement */
+	initStringInfo(&buf);
+	appendStringInfo(&buf, "SELECT * FROM (%s) AS __pgxc_bloom (",
+					 step->sql_statement);
+	for (i = 1; i <= node->rqs_bloom_attno; i++)
+		appendStringInfo(&buf, "%sc%d", (i > 1) ? ", " : "", i);
+	appendStringInfo(&buf, ") WHERE pg_catalog.pgxc_bloom_contains($%d, %s(c%d",
+					 nparams,
+					 quote_qualified_identifier(get_namespace_name(get_func_namespace(hashfunc)),
+												get_func_name(hashfunc)),
+					 node->rqs_bloom_attno);
+	/* Hash functions of polymorphic types cannot be given a cast */
+	get_func_signature(hashfunc, &argtypes, &nargs);
+	if (nargs == 1 && get_typtype(argtypes[0]) != TYPTYPE_PSEUDO)
+		appendStringInfo(&buf, "::%s", format_type_be_qualified(argtypes[0]));
+	appendStringInfoString(&buf, "))");
+	node->rqs_bloom_statement = buf.data;
+
+	/* Append the filter to the parameter values, in DataRow format */
+	initStringInfo(&buf);
+	n16 = htons(nparams);
+	appendBinaryStringInfo(&buf, (char *) &n16, 2);
+	if (node->paramval_data)
+	{
+		appendBinaryStringInfo(&buf, node->paramval_data + 2,
+							   node->paramval_len - 2);
+		pfree(node->paramval_data);
+	}
+	pstring = DatumGetCString(DirectFunctionCall1(byteaout,
+												  PointerGetDatum(filter)));
+	len = strlen(pstring);
+	n32 = htonl(len);
+	appendBinaryStringInfo(&buf, (char *) &n32, 4);
+	appendBinaryStringInfo(&buf, pstring, len);
+	pfree(pstring);
+	node->paramval_data = buf.data;
+	node->paramval_len = buf.len;
+
+	param_types = (Oid *) palloc(sizeof(Oid) * nparams);
+	if (node->rqs_num_params > 0)
+	{
+		memcpy(param_types, node->rqs_param_types,
+			   sizeof(Oid) * node->rqs_num_params);
+		if (node->rqs_param_types != step->rq_param_types)
+			pfree(node->rqs_param_types);
+	}
+	param_types[nparams - 1] = BYTEAOID;
+	node->rqs_param_types = param_types;
+	node->rqs_num_params = nparams;
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * pgxc_bloom_contains
+ *
+ * SQL-callable test of a hash value against a Bloom filter built by
+ * lib/bloomfilter.c.  This is what evaluates the filter added by
+ * ExecRemoteQuerySetBloomFilter on the Datanodes; it returns false only
+ * for values that are certainly not in the set.
+ */
+Datum
+pgxc_bloom_contains(PG_FUNCTION_ARGS)
+{
+	bytea	   *filter = PG_GETARG_BYTEA_PP(0);
+	uint32		hash = (uint32) PG_GETARG_INT32(1);
+
+	PG_RETURN_BOOL(!bloom_lacks_hash(filter, hash));
+}
+
+
 /*
  * Execute utility statement on multiple Datanodes
  * It does approximately the same as
@@ -0,0 +1,157 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodecompress.c
+ *
+ *	  Stream compression of the traffic between PGXC nodes
+ *
+ * The Coordinator side of a connection is in pgxcnode.c, the side of the
+ * node it is connected to in libpq/pqcomm.c.  This file only knows how to
+ * turn bytes into frames and back; see pgxc/nodecompress.h for the format.
+ *
+ * Portions Copyright (c) 1996-2009, PostgreSQL Global Development Group
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ * IDENTIFICATION
+ *    $$
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <arpa/inet.h>
+
+#include "pgxc/nodecompress.h"
+#include "utils/memutils.h"
+#include "utils/pg_lzcompress.h"
+
+/*
+ * Unlike the strategies meant for TOAST, try on any input worth a frame
+ * header, and do not insist on a compression rate: whatever is saved is
+ * bandwidth.  Give up early on data that does not compress at all, though.
+ */
+static const PGLZ_Strategy node_compress_strategy_data = {
+	32,							/* min_input_size */
+	NODE_COMPRESS_CHUNK,		/* max_input_size */
+	0,							/* min_comp_rate */
+	1024,						/* first_success_by */
+	128,						/* match_size_good */
+	10							/* match_size_drop */
+};
+
+/*
+ * pglz works on aligned buffers starting with a PGLZ_Header, which frames
+ * on the wire are not, so chunks are compressed and decompressed through
+ * this one.
+ */
+static PGLZ_Header *node_compress_scratch = NULL;
+
+static PGLZ_Header *
+get_scratch(void)
+{
+	if (node_compress_scratch == NULL)
+		node_compress_scratch = (PGLZ_Header *)
+			MemoryContextAlloc(TopMemoryContext,
+							   PGLZ_MAX_OUTPUT(NODE_COMPRESS_CHUNK));
+	return node_compress_scratch;
+}
+
+/*
+ * node_compress
+ *
+ * Append to out the frames carrying the len bytes at data.
+ */
+void
+node_compress(StringInfo out, const char *data, int len)
+{
+	PGLZ_Header *scratch = get_scratch();
+
+	while (len > 0)
+	{
+		int			chunk = Min(len, NODE_COMPRESS_CHUNK);
+		const char *payload = data;
+		int			paylen = chunk;
+		uint32		n32;
+
+		if (pglz_compress(data, chunk, scratch, &node_compress_strategy_data))
+		{
+			payload = (const char *) scratch + sizeof(PGLZ_Header);
+			paylen = VARSIZE(scratch) - sizeof(PGLZ_Header);
+		}
+
+		enlargeStringInfo(out, NODE_COMPRESS_HDRSZ + paylen);
+		n32 = htonl((uint32) paylen);
+		appendBinaryStringInfo(out, (char *) &n32, 4);
+		n32 = htonl((uint32) chunk);
+		appendBinaryStringInfo(out, (char *) &n32, 4);
+		appendBinaryStringInfo(out, payload, paylen);
+
+		data += chunk;
+		len -= chunk;
+	}
+}
+
+/*
+ * node_frame_rawlen
+ *
+ * Look at the frame starting at buf, of which avail bytes have been
+ * received.  Returns the number of bytes it stands for, or 0 if it has not
+ * been received in full yet, in which case more should be read; *framelen
+ * is set to the length of the frame on the wire.
+ *
+ * Returns -1 if the frame header does not make sense.
+ */
+int
+node_frame_rawlen(const char *buf, int avail, int *framelen)
+{
+	uint32		paylen;
+	uint32		rawlen;
+
+	if (avail < NODE_COMPRESS_HDRSZ)
+		return 0;
+
+	memcpy(&paylen, buf, 4);
+	paylen = ntohl(paylen);
+	memcpy(&rawlen, buf + 4, 4);
+	rawlen = ntohl(rawlen);
+
+	if (rawlen == 0 || rawlen > NODE_COMPRESS_CHUNK || paylen > rawlen)
+		return -1;
+
+	*framelen = NODE_COMPRESS_HDRSZ + paylen;
+	if (avail < *framelen)
+		return 0;
+
+	return (int) rawlen;
+}
+
+/*
+ * node_decompress
+ *
+ * Decompress a complete frame, found valid by node_frame_rawlen, into dest,
+ * which must have room for the bytes it stands for.
+ */
+void
+node_decompress(const char *frame, char *dest)
+{
+	uint32		paylen;
+	uint32		rawlen;
+
+	memcpy(&paylen, frame, 4);
+	paylen = ntohl(paylen);
+	memcpy(&rawlen, frame + 4, 4);
+	rawlen = ntohl(rawlen);
+
+	if (paylen == rawlen)
+		memcpy(dest, frame + NODE_COMPRESS_HDRSZ, rawlen);
+	else
+	{
+		PGLZ_Header *scratch = get_scratch();
+
+		SET_VARSIZE_COMPRESSED(scratch, sizeof(PGLZ_Header) + paylen);
+		scratch->rawsize = rawlen;
+		memcpy((char *) scratch + sizeof(PGLZ_Header),
+			   frame + NODE_COMPRESS_HDRSZ, paylen);
+		pglz_decompress(scratch, dest);
+	}
+}
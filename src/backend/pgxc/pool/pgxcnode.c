@@ -17,6 +17,12 @@
  */
 
 #include "postgres.h"
+#ifdef HAVE_POLL_H
+#include <poll.h>
+#endif
+#ifdef HAVE_SYS_POLL_H
+#include <sys/poll.h>
+#endif
 #include <sys/select.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -30,13 +36,16 @@
 #include "access/xact.h"
 #include "catalog/pg_type.h"
 #include "commands/prepare.h"
+#include "funcapi.h"
 #include "gtm/gtm_c.h"
+#include "miscadmin.h"
 #include "nodes/nodes.h"
 #include "pgxc/pgxcnode.h"
 #include "pgxc/execRemote.h"
 #include "catalog/pgxc_node.h"
 #include "catalog/pg_collation.h"
 #include "pgxc/locator.h"
+#include "pgxc/nodecompress.h"
 #include "pgxc/nodemgr.h"
 #include "pgxc/pgxc.h"
 #include "pgxc/poolmgr.h"
@@ -79,9 +88,27 @@ int 		NumCoords;
 /* Cancel Delay Duration -> set by GUC */
 int			pgxcnode_cancel_delay = 10;
 
+/* Nodes to compress the traffic with -> set by GUC */
+char	   *pgxcnode_compression = NULL;
+
+/* Read-only transactions may use Datanode standbys -> set by GUC */
+bool		pgxcnode_standby_reads = false;
+
+/* Are the Datanode handles of the transaction taken from standbys? */
+static bool dn_handles_standby = false;
+
 static void pgxc_node_init(PGXCNodeHandle *handle, int sock);
 static void pgxc_node_free(PGXCNodeHandle *handle);
 static void pgxc_node_all_free(void);
+static int	pgxc_node_read_compressed(PGXCNodeHandle *conn, bool close_if_error);
+static int	pgxc_node_recv(PGXCNodeHandle *conn, char *buf, size_t len,
+			   bool close_if_error);
+static int	send_some_compressed(PGXCNodeHandle *handle, int len);
+static int	send_raw(PGXCNodeHandle *handle, const char *ptr, int len);
+static bool node_compression_wanted(Oid nodeoid);
+static int	pgxc_node_send_compression(PGXCNodeHandle *handle, bool on);
+static void pgxc_node_set_compression(PGXCNodeHandle **handles, int count);
+static bool pgxc_node_standby_allowed(void);
 
 static int	get_int(PGXCNodeHandle * conn, size_t len, int *out);
 static int	get_char(PGXCNodeHandle * conn, char *out);
@@ -110,6 +137,14 @@ init_pgxc_handle(PGXCNodeHandle *pgxc_handle)
 	pgxc_handle->inEnd = 0;
 	pgxc_handle->inCursor = 0;
 	pgxc_handle->outEnd = 0;
+	pgxc_handle->compress = false;
+	memset(&pgxc_handle->compressOut, 0, sizeof(StringInfoData));
+	memset(&pgxc_handle->compressIn, 0, sizeof(StringInfoData));
+	pgxc_handle->rawBytesSent = 0;
+	pgxc_handle->wireBytesSent = 0;
+	pgxc_handle->rawBytesReceived = 0;
+	pgxc_handle->wireBytesReceived = 0;
+	pgxc_handle->standby = false;
 
 	if (pgxc_handle->outBuffer == NULL || pgxc_handle->inBuffer == NULL)
 	{
@@ -300,6 +335,17 @@ PGXCNodeConnected(NODE_CONNECTION *conn)
 static void
 pgxc_node_free(PGXCNodeHandle *handle)
 {
+	/*
+	 * The pooler hands out connections with compression off and talks to
+	 * the nodes through libpq, so give the connection back the same way.
+	 */
+	if (handle->compress && handle->sock != NO_SOCKET)
+	{
+		if (pgxc_node_send_compression(handle, false) == 0)
+			pgxc_node_flush(handle);
+		handle->compress = false;
+	}
+
 	close(handle->sock);
 	handle->sock = NO_SOCKET;
 }
@@ -364,12 +410,23 @@ pgxc_node_init(PGXCNodeHandle *handle, int sock)
 	handle->inStart = 0;
 	handle->inEnd = 0;
 	handle->inCursor = 0;
+	handle->compress = false;
+	if (handle->compressOut.data)
+	{
+		resetStringInfo(&handle->compressOut);
+		resetStringInfo(&handle->compressIn);
+	}
 }
 
 
 /*
  * Wait while at least one of specified connections has data available and read
  * the data into the buffer
+ *
+ * Where poll() is available, it is used rather than select(): its cost
+ * depends only on the number of connections waited on, not on the highest
+ * descriptor number, and it has no FD_SETSIZE limit on descriptor numbers,
+ * which a backend with many open files can easily exceed.
  */
 bool
 pgxc_node_receive(const int conn_count,
@@ -379,11 +436,20 @@ pgxc_node_receive(const int conn_count,
 #define NO_ERROR_OCCURED	false
 	int			i,
 				res_select,
-				nfds = 0;
+				nwait = 0;
+#ifdef HAVE_POLL
+	struct pollfd pfds[conn_count];
+	PGXCNodeHandle *wait_conns[conn_count];
+	int			timeout_ms;
+#else
+	int			nfds = 0;
 	fd_set			readfds;
+#endif
 	bool			is_msg_buffered;
 
+#ifndef HAVE_POLL
 	FD_ZERO(&readfds);
+#endif
 
 	is_msg_buffered = false;
 	for (i = 0; i < conn_count; i++)
@@ -405,8 +471,16 @@ pgxc_node_receive(const int conn_count,
 		/* prepare select params */
 		if (connections[i]->sock > 0)
 		{
+#ifdef HAVE_POLL
+			pfds[nwait].fd = connections[i]->sock;
+			pfds[nwait].events = POLLIN;
+			pfds[nwait].revents = 0;
+			wait_conns[nwait] = connections[i];
+#else
 			FD_SET(connections[i]->sock, &readfds);
-			nfds = connections[i]->sock;
+			nfds = Max(nfds, connections[i]->sock);
+#endif
+			nwait++;
 		}
 		else
 		{
@@ -418,26 +492,45 @@ pgxc_node_receive(const int conn_count,
 	/*
 	 * Return if we do not have connections to receive input
 	 */
-	if (nfds == 0)
+	if (nwait == 0)
 	{
 		if (is_msg_buffered)
 			return NO_ERROR_OCCURED;
 		return ERROR_OCCURED;
 	}
 
+#ifdef HAVE_POLL
+	if (timeout)
+		timeout_ms = timeout->tv_sec * 1000 + timeout->tv_usec / 1000;
+	else
+		timeout_ms = -1;
+#endif
+
 retry:
+#ifdef HAVE_POLL
+	res_select = poll(pfds, nwait, timeout_ms);
+#else
 	res_select = select(nfds + 1, &readfds, NULL, NULL, timeout);
+#endif
 	if (res_select < 0)
 	{
 		/* error - retry if EINTR or EAGAIN */
 		if (errno == EINTR || errno == EAGAIN)
 			goto retry;
 
+#ifdef HAVE_POLL
+		if (errno == EBADF)
+		{
+			elog(WARNING, "poll() bad file descriptor set");
+		}
+		elog(WARNING, "poll() error: %d", errno);
+#else
 		if (errno == EBADF)
 		{
 			elog(WARNING, "select() bad file descriptor set");
 		}
 		elog(WARNING, "select() error: %d", errno);
+#endif
 		if (errno)
 			return ERROR_OCCURED;
 		return NO_ERROR_OCCURED;
@@ -451,11 +544,20 @@ retry:
 	}
 
 	/* read data */
+#ifdef HAVE_POLL
+	for (i = 0; i < nwait; i++)
+	{
+		PGXCNodeHandle *conn = wait_conns[i];
+
+		/* Errors and hangups are found out by trying to read, too */
+		if (pfds[i].revents != 0)
+#else
 	for (i = 0; i < conn_count; i++)
 	{
 		PGXCNodeHandle *conn = connections[i];
 
-		if (FD_ISSET(conn->sock, &readfds))
+		if (conn->sock > 0 && FD_ISSET(conn->sock, &readfds))
+#endif
 		{
 			int	read_status = pgxc_node_read_data(conn, true);
 
@@ -527,6 +629,9 @@ pgxc_node_read_data(PGXCNodeHandle *conn, bool close_if_error)
 		conn->inStart = conn->inCursor = conn->inEnd = 0;
 	}
 
+	if (conn->compress)
+		return pgxc_node_read_compressed(conn, close_if_error);
+
 	/*
 	 * If the buffer is fairly full, enlarge it. We need to be able to enlarge
 	 * the buffer in case a single message exceeds the initial buffer size. We
@@ -552,8 +657,118 @@ pgxc_node_read_data(PGXCNodeHandle *conn, bool close_if_error)
 	}
 
 retry:
-	nread = recv(conn->sock, conn->inBuffer + conn->inEnd,
-				 conn->inSize - conn->inEnd, 0);
+	nread = pgxc_node_recv(conn, conn->inBuffer + conn->inEnd,
+						   conn->inSize - conn->inEnd, close_if_error);
+	if (nread == 0)
+		return someread;
+	if (nread < 0)
+		return EOF;
+
+	conn->inEnd += nread;
+
+	/*
+	 * Hack to deal with the fact that some kernels will only give us back
+	 * 1 packet per recv() call, even if we asked for more and there is
+	 * more available.	If it looks like we are reading a long message,
+	 * loop back to recv() again immediately, until we run out of data or
+	 * buffer space.  Without this, the block-and-restart behavior of
+	 * libpq's higher levels leads to O(N^2) performance on long messages.
+	 *
+	 * Since we left-justified the data above, conn->inEnd gives the
+	 * amount of data already read in the current message.	We consider
+	 * the message "long" once we have acquired 32k ...
+	 */
+	if (conn->inEnd > 32768 &&
+		(conn->inSize - conn->inEnd) >= 8192)
+	{
+		someread = 1;
+		goto retry;
+	}
+	return 1;
+}
+
+/*
+ * pgxc_node_read_compressed
+ *
+ * pgxc_node_read_data for a connection with compression on: read frames,
+ * and decompress those received in full into the input buffer.
+ */
+static int
+pgxc_node_read_compressed(PGXCNodeHandle *conn, bool close_if_error)
+{
+	StringInfo	in = &conn->compressIn;
+	int			decoded = 0;
+	int			nread;
+
+	/* Make room for at least a frame header and a bit */
+	enlargeStringInfo(in, 8192);
+
+	nread = pgxc_node_recv(conn, in->data + in->len,
+						   in->maxlen - in->len - 1, close_if_error);
+	if (nread == 0)
+		return 0;
+	if (nread < 0)
+		return EOF;
+
+	in->len += nread;
+	conn->wireBytesReceived += nread;
+
+	for (;;)
+	{
+		int			framelen;
+		int			rawlen;
+
+		rawlen = node_frame_rawlen(in->data + in->cursor, in->len - in->cursor,
+								   &framelen);
+		if (rawlen == 0)
+			break;
+		if (rawlen < 0)
+		{
+			if (close_if_error)
+				add_error_message(conn, "invalid compressed data from node");
+			conn->state = DN_CONNECTION_STATE_ERROR_FATAL;
+			return EOF;
+		}
+
+		if (ensure_in_buffer_capacity(conn->inEnd + rawlen, conn) != 0)
+		{
+			if (close_if_error)
+				add_error_message(conn, "can not allocate buffer");
+			return -1;
+		}
+		node_decompress(in->data + in->cursor, conn->inBuffer + conn->inEnd);
+		conn->inEnd += rawlen;
+		conn->rawBytesReceived += rawlen;
+		in->cursor += framelen;
+		decoded = 1;
+	}
+
+	/* Keep the incomplete frame, if any, at the start of the buffer */
+	if (in->cursor > 0)
+	{
+		in->len -= in->cursor;
+		if (in->len > 0)
+			memmove(in->data, in->data + in->cursor, in->len);
+		in->cursor = 0;
+	}
+
+	return decoded;
+}
+
+/*
+ * pgxc_node_recv
+ *
+ * Receive what has arrived on the connection, up to len bytes.  Returns the
+ * number of bytes read, 0 if there was nothing to read, or EOF if the
+ * connection is lost or failed.
+ */
+static int
+pgxc_node_recv(PGXCNodeHandle *conn, char *buf, size_t len, bool close_if_error)
+{
+	int			nread;
+
+retry:
+	nread = recv(conn->sock, buf, len, 0);
 
 	if (nread < 0)
 	{
@@ -564,11 +779,11 @@ retry:
 		/* Some systems return EAGAIN/EWOULDBLOCK for no data */
 #ifdef EAGAIN
 		if (errno == EAGAIN)
-			return someread;
+			return 0;
 #endif
 #if defined(EWOULDBLOCK) && (!defined(EAGAIN) || (EWOULDBLOCK != EAGAIN))
 		if (errno == EWOULDBLOCK)
-			return someread;
+			return 0;
 #endif
 		/* We might get ECONNRESET here if using TCP and backend died */
 #ifdef ECONNRESET
@@ -589,38 +804,12 @@ retry:
 				closesocket(conn->sock);
 				conn->sock = NO_SOCKET;
 			}
-			return -1;
+			return EOF;
 		}
 #endif
 		if (close_if_error)
 			add_error_message(conn, "could not receive data from server");
-		return -1;
-
-	}
-
-	if (nread > 0)
-	{
-		conn->inEnd += nread;
-
-		/*
-		 * Hack to deal with the fact that some kernels will only give us back
-		 * 1 packet per recv() call, even if we asked for more and there is
-		 * more available.	If it looks like we are reading a long message,
-		 * loop back to recv() again immediately, until we run out of data or
-		 * buffer space.  Without this, the block-and-restart behavior of
-		 * libpq's higher levels leads to O(N^2) performance on long messages.
-		 *
-		 * Since we left-justified the data above, conn->inEnd gives the
-		 * amount of data already read in the current message.	We consider
-		 * the message "long" once we have acquired 32k ...
-		 */
-		if (conn->inEnd > 32768 &&
-			(conn->inSize - conn->inEnd) >= 8192)
-		{
-			someread = 1;
-			goto retry;
-		}
-		return 1;
+		return EOF;
 	}
 
 	if (nread == 0)
@@ -630,10 +819,7 @@ retry:
 		return EOF;
 	}
 
-	if (someread)
-		return 1;				/* got a zero read after successful tries */
-
-	return 0;
+	return nread;
 }
 
 
@@ -785,6 +971,7 @@ release_handles(void)
 
 	datanode_count = 0;
 	coord_count = 0;
+	dn_handles_standby = false;
 }
 
 /*
@@ -1037,9 +1224,78 @@ ensure_out_buffer_capacity(size_t bytes_needed, PGXCNodeHandle *handle)
 int
 send_some(PGXCNodeHandle *handle, int len)
 {
-	char	   *ptr = handle->outBuffer;
-	int			remaining = handle->outEnd;
-	int			result = 0;
+	int			sent;
+
+	if (handle->compress)
+		return send_some_compressed(handle, len);
+
+	sent = send_raw(handle, handle->outBuffer, len);
+	if (sent < 0)
+	{
+		handle->outEnd = 0;
+		return -1;
+	}
+
+	/* shift the remaining contents of the buffer */
+	handle->outEnd -= sent;
+	if (handle->outEnd > 0 && sent > 0)
+		memmove(handle->outBuffer, handle->outBuffer + sent, handle->outEnd);
+
+	/*
+	 * If we did not send it all
+	 * return 1 to indicate that data is still pending.
+	 */
+	return (sent < len) ? 1 : 0;
+}
+
+/*
+ * send_some_compressed
+ *
+ * send_some for a connection with compression on.  The data is compressed
+ * only once the frames made earlier have all gone out, so that, as for a
+ * plain connection, outEnd keeps telling how much the node is behind.
+ */
+static int
+send_some_compressed(PGXCNodeHandle *handle, int len)
+{
+	StringInfo	out = &handle->compressOut;
+	int			sent;
+
+	if (out->cursor == out->len && len > 0)
+	{
+		resetStringInfo(out);
+		node_compress(out, handle->outBuffer, len);
+		handle->rawBytesSent += len;
+		handle->wireBytesSent += out->len;
+
+		handle->outEnd -= len;
+		if (handle->outEnd > 0)
+			memmove(handle->outBuffer, handle->outBuffer + len, handle->outEnd);
+	}
+
+	sent = send_raw(handle, out->data + out->cursor, out->len - out->cursor);
+	if (sent < 0)
+	{
+		resetStringInfo(out);
+		handle->outEnd = 0;
+		return -1;
+	}
+	out->cursor += sent;
+
+	return (out->cursor < out->len) ? 1 : 0;
+}
+
+/*
+ * send_raw
+ *
+ * Write len bytes at ptr to the socket of the connection, as far as it can
+ * be done without blocking.  Returns the number of bytes sent, or -1 on
+ * failure.
+ */
+static int
+send_raw(PGXCNodeHandle *handle, const char *ptr, int len)
+{
+	int			total = 0;
 
 	/* while there's still data to send */
 	while (len > 0)
@@ -1093,40 +1349,24 @@ send_some(PGXCNodeHandle *handle, int len)
 					 * pqReadData finds no more data can be read.  But abandon
 					 * attempt to send data.
 					 */
-					handle->outEnd = 0;
 					return -1;
 
 				default:
 					add_error_message(handle, "could not send data to server");
 					/* We don't assume it's a fatal error... */
-					handle->outEnd = 0;
 					return -1;
 			}
-		}
-		else
-		{
-			ptr += sent;
-			len -= sent;
-			remaining -= sent;
-		}
 
-		if (len > 0)
-		{
-			/*
-			 * We did not send it all
-			 * return 1 to indicate that data is still pending.
-			 */
-			result = 1;
+			/* The socket is full, the rest will have to wait */
 			break;
 		}
-	}
 
-	/* shift the remaining contents of the buffer */
-	if ((remaining > 0) && (handle->outBuffer != ptr))
-		memmove(handle->outBuffer, ptr, remaining);
-	handle->outEnd = remaining;
+		ptr += sent;
+		len -= sent;
+		total += sent;
+	}
 
-	return result;
+	return total;
 }
 
 /*
@@ -1518,7 +1758,8 @@ pgxc_node_send_query_extended(PGXCNodeHandle *handle, const char *query,
 int
 pgxc_node_flush(PGXCNodeHandle *handle)
 {
-	while (handle->outEnd)
+	while (handle->outEnd ||
+		   handle->compressOut.cursor < handle->compressOut.len)
 	{
 		if (send_some(handle, handle->outEnd) < 0)
 		{
@@ -1592,6 +1833,75 @@ pgxc_node_send_query(PGXCNodeHandle * handle, const char *query)
 }
 
 
+/*
+ * Ask the PGXC node to send back the plan of the next query it receives,
+ * see pgxc/planship.h.
+ */
+int
+pgxc_node_send_plan_request(PGXCNodeHandle *handle)
+{
+	int			msglen = 4;
+
+	/* Invalid connection state, return error */
+	if (handle->state != DN_CONNECTION_STATE_IDLE)
+		return EOF;
+
+	/* msgType + msgLen */
+	if (ensure_out_buffer_capacity(handle->outEnd + 1 + msglen, handle) != 0)
+	{
+		add_error_message(handle, "out of memory");
+		return EOF;
+	}
+
+	handle->outBuffer[handle->outEnd++] = 'j';
+	msglen = htonl(msglen);
+	memcpy(handle->outBuffer + handle->outEnd, &msglen, 4);
+	handle->outEnd += 4;
+
+	return 0;
+}
+
+/*
+ * Send down a plan another node has made for the specified statement, to be
+ * run in place of planning the statement.  The plan is passed as received
+ * from that node.
+ */
+int
+pgxc_node_send_plan(PGXCNodeHandle *handle, const char *query,
+					const char *plan, int planlen)
+{
+	int			strLen;
+	int			msgLen;
+
+	/* Invalid connection state, return error */
+	if (handle->state != DN_CONNECTION_STATE_IDLE)
+		return EOF;
+
+	strLen = strlen(query) + 1;
+	/* size + strlen + plan */
+	msgLen = 4 + strLen + planlen;
+
+	/* msgType + msgLen */
+	if (ensure_out_buffer_capacity(handle->outEnd + 1 + msgLen, handle) != 0)
+	{
+		add_error_message(handle, "out of memory");
+		return EOF;
+	}
+
+	handle->outBuffer[handle->outEnd++] = 'y';
+	msgLen = htonl(msgLen);
+	memcpy(handle->outBuffer + handle->outEnd, &msgLen, 4);
+	handle->outEnd += 4;
+	memcpy(handle->outBuffer + handle->outEnd, query, strLen);
+	handle->outEnd += strLen;
+	memcpy(handle->outBuffer + handle->outEnd, plan, planlen);
+	handle->outEnd += planlen;
+
+	handle->state = DN_CONNECTION_STATE_QUERY;
+
+	return pgxc_node_flush(handle);
+}
+
 /*
  * Send the GXID down to the PGXC node
  */
@@ -1761,6 +2071,163 @@ pgxc_node_send_timestamp(PGXCNodeHandle *handle, TimestampTz timestamp)
 }
 
 
+/*
+ * Send the request to turn compression on or off down to the PGXC node
+ */
+static int
+pgxc_node_send_compression(PGXCNodeHandle *handle, bool on)
+{
+	int			msglen = 5;
+
+	/* msgType + msgLen */
+	if (ensure_out_buffer_capacity(handle->outEnd + 1 + msglen, handle) != 0)
+	{
+		add_error_message(handle, "out of memory");
+		return EOF;
+	}
+
+	handle->outBuffer[handle->outEnd++] = 'z';
+	msglen = htonl(msglen);
+	memcpy(handle->outBuffer + handle->outEnd, &msglen, 4);
+	handle->outEnd += 4;
+	handle->outBuffer[handle->outEnd++] = on ? 1 : 0;
+
+	return 0;
+}
+
+/*
+ * Is the traffic with the given node to be compressed, according to
+ * pgxcnode_compression?
+ */
+static bool
+node_compression_wanted(Oid nodeoid)
+{
+	char	   *rawstring;
+	List	   *elemlist;
+	ListCell   *lc;
+	char	   *nodename;
+	bool		result = false;
+
+	if (pgxcnode_compression == NULL || pgxcnode_compression[0] == '\0')
+		return false;
+
+	/* The syntax has been checked when the parameter was set */
+	rawstring = pstrdup(pgxcnode_compression);
+	if (!SplitIdentifierString(rawstring, ',', &elemlist))
+		elemlist = NIL;
+
+	nodename = get_pgxc_nodename(nodeoid);
+	foreach(lc, elemlist)
+	{
+		char	   *name = (char *) lfirst(lc);
+
+		if (strcmp(name, "*") == 0 || strcmp(name, nodename) == 0)
+		{
+			result = true;
+			break;
+		}
+	}
+
+	list_free(elemlist);
+	pfree(rawstring);
+	return result;
+}
+
+/*
+ * pgxc_node_set_compression
+ *
+ * Ask the nodes behind the given connections, just obtained from the
+ * pooler, to compress the traffic if pgxcnode_compression says so.
+ *
+ * The node answers whether it agrees.  Nothing else is sent until it has,
+ * and a node sends nothing after its answer until it gets a command, so
+ * both sides switch at the same point of the stream.  The requests are
+ * all sent before waiting, so that this costs a single round trip.
+ * Compression is turned off again in pgxc_node_free; that needs no answer,
+ * as the node reads the request before whatever comes next.
+ */
+static void
+pgxc_node_set_compression(PGXCNodeHandle **handles, int count)
+{
+	PGXCNodeHandle **waiting;
+	int			nwaiting = 0;
+	int			i;
+
+	if (count == 0 || pgxcnode_compression == NULL ||
+		pgxcnode_compression[0] == '\0')
+		return;
+
+	waiting = (PGXCNodeHandle **) palloc(count * sizeof(PGXCNodeHandle *));
+
+	for (i = 0; i < count; i++)
+	{
+		PGXCNodeHandle *handle = handles[i];
+
+		if (!node_compression_wanted(handle->nodeoid))
+			continue;
+
+		if (pgxc_node_send_compression(handle, true) != 0 ||
+			pgxc_node_flush(handle) != 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("Failed to send compression request to node %s",
+							get_pgxc_nodename(handle->nodeoid))));
+
+		/* An answer is expected, see pgxc_node_receive */
+		handle->state = DN_CONNECTION_STATE_QUERY;
+		waiting[nwaiting++] = handle;
+	}
+
+	while (nwaiting > 0)
+	{
+		if (pgxc_node_receive(nwaiting, waiting, NULL))
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("Failed to read response from nodes")));
+
+		i = 0;
+		while (i < nwaiting)
+		{
+			PGXCNodeHandle *handle = waiting[i];
+			char	   *msg;
+			int			len;
+			char		msgtype;
+
+			msgtype = get_message(handle, &len, &msg);
+			if (msgtype == '\0')
+			{
+				/* Not there yet */
+				i++;
+				continue;
+			}
+
+			if (msgtype != 'z' || len != 1)
+				ereport(ERROR,
+						(errcode(ERRCODE_INTERNAL_ERROR),
+						 errmsg("Unexpected response from node %s to compression request",
+								get_pgxc_nodename(handle->nodeoid))));
+
+			if (msg[0])
+			{
+				if (handle->compressOut.data == NULL)
+				{
+					MemoryContext oldcontext;
+
+					oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+					initStringInfo(&handle->compressOut);
+					initStringInfo(&handle->compressIn);
+					MemoryContextSwitchTo(oldcontext);
+				}
+				handle->compress = true;
+			}
+			handle->state = DN_CONNECTION_STATE_IDLE;
+			waiting[i] = waiting[--nwaiting];
+		}
+	}
+
+	pfree(waiting);
+}
+
 /*
  * Add another message to the list of errors to be returned back to the client
  * at the convenient time
@@ -1952,7 +2419,19 @@ get_handles(List *datanodelist, List *coordlist, bool is_coord_only_query)
 	if (dn_allocate || co_allocate)
 	{
 		int	j = 0;
-		int	*fds = PoolManagerGetConnections(dn_allocate, co_allocate);
+		int	*fds;
+		PGXCNodeHandle **new_handles;
+		int	nnew = 0;
+
+		/*
+		 * All the Datanode connections of a transaction come from the same
+		 * side, so standbys are only chosen when it takes its first ones.
+		 */
+		if (dn_allocate && datanode_count == 0)
+			dn_handles_standby = pgxc_node_standby_allowed();
+
+		fds = PoolManagerGetConnections(dn_allocate, co_allocate,
+										dn_handles_standby);
 
 		if (!fds)
 		{
@@ -1972,6 +2451,9 @@ get_handles(List *datanodelist, List *coordlist, bool is_coord_only_query)
 					(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
 					 errmsg("Failed to get pooled connections")));
 		}
+		new_handles = (PGXCNodeHandle **)
+			palloc((list_length(dn_allocate) + list_length(co_allocate)) *
+				   sizeof(PGXCNodeHandle *));
 		/* Initialisation for Datanodes */
 		if (dn_allocate)
 		{
@@ -1989,8 +2471,10 @@ get_handles(List *datanodelist, List *coordlist, bool is_coord_only_query)
 
 				node_handle = &dn_handles[node];
 				pgxc_node_init(node_handle, fdsock);
+				node_handle->standby = dn_handles_standby;
 				dn_handles[node] = *node_handle;
 				datanode_count++;
+				new_handles[nnew++] = node_handle;
 			}
 		}
 		/* Initialisation for Coordinators */
@@ -2012,11 +2496,16 @@ get_handles(List *datanodelist, List *coordlist, bool is_coord_only_query)
 				pgxc_node_init(node_handle, fdsock);
 				co_handles[node] = *node_handle;
 				coord_count++;
+				new_handles[nnew++] = node_handle;
 			}
 		}
 
 		pfree(fds);
 
+		/* Compress the traffic on the new connections where asked to */
+		pgxc_node_set_compression(new_handles, nnew);
+		pfree(new_handles);
+
 		if (co_allocate)
 			list_free(co_allocate);
 		if (dn_allocate)
@@ -2026,6 +2515,28 @@ get_handles(List *datanodelist, List *coordlist, bool is_coord_only_query)
 	return result;
 }
 
+/*
+ * pgxc_node_standby_allowed
+ *
+ * Can the current transaction read from Datanode hot standbys?  It must be
+ * read only, and not serializable as a standby cannot run that.  A standby
+ * only sees data once it has replayed the commits of the snapshot it is sent,
+ * see GetPGXCSnapshotData.  Connections the session keeps beyond the
+ * transaction, for prepared statements active on the nodes or persistent
+ * connections, have to be usable by its next transactions, so they come from
+ * the Datanodes.  The pooler also gives Datanode connections to sessions
+ * using temporary objects, and wherever no standby is defined.
+ */
+static bool
+pgxc_node_standby_allowed(void)
+{
+	return pgxcnode_standby_reads &&
+		XactReadOnly &&
+		!IsolationIsSerializable() &&
+		!PersistentConnections &&
+		!HaveActiveDatanodeStatements();
+}
+
 /* Free PGXCNodeAllHandles structure */
 void
 pfree_pgxc_all_handles(PGXCNodeAllHandles *pgxc_handles)
@@ -2119,6 +2630,81 @@ pgxc_node_str(PG_FUNCTION_ARGS)
 	PG_RETURN_NAME(PGXCNodeName);
 }
 
+/*
+ * pgxc_node_compression_stats
+ *
+ * Report, for each node this session has a handle for, whether the traffic
+ * with it is being compressed, and how many bytes compression has been
+ * applied to, before and after, in each direction.
+ */
+Datum
+pgxc_node_compression_stats(PG_FUNCTION_ARGS)
+{
+#define PG_NODE_COMPRESSION_STATS_COLS	6
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	int			i;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	for (i = 0; i < NumDataNodes + NumCoords; i++)
+	{
+		PGXCNodeHandle *handle;
+		Datum		values[PG_NODE_COMPRESSION_STATS_COLS];
+		bool		nulls[PG_NODE_COMPRESSION_STATS_COLS];
+		NameData	nodename;
+
+		if (i < NumDataNodes)
+			handle = dn_handles ? &dn_handles[i] : NULL;
+		else
+			handle = co_handles ? &co_handles[i - NumDataNodes] : NULL;
+		if (handle == NULL)
+			continue;
+
+		MemSet(nulls, 0, sizeof(nulls));
+		namestrcpy(&nodename, get_pgxc_nodename(handle->nodeoid));
+		values[0] = NameGetDatum(&nodename);
+		values[1] = BoolGetDatum(handle->compress);
+		values[2] = Int64GetDatum((int64) handle->rawBytesSent);
+		values[3] = Int64GetDatum((int64) handle->wireBytesSent);
+		values[4] = Int64GetDatum((int64) handle->rawBytesReceived);
+		values[5] = Int64GetDatum((int64) handle->wireBytesReceived);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
 /*
  * PGXCNodeGetNodeIdFromName
  *		Return node position in handles array
@@ -0,0 +1,717 @@
+/*-------------------------------------------------------------------------
+ *
+ * planship.c
+ *
+ *	  Shipping plans made by one Datanode to the others
+ *
+ * A statement the Coordinator sends to many Datanodes is parsed, analyzed,
+ * rewritten and planned by each of them, which for complex queries can cost
+ * more than running them.  Instead, the first Datanode may be asked to send
+ * back its plan, and the others get that plan to run directly; see
+ * pgxc/planship.h for the messages involved.
+ *
+ * Each node has its own catalogs, so the Oids of user objects differ from
+ * one node to another.  Relations are therefore passed along by name and
+ * looked up again by the receiving node, and any plan referring to another
+ * user object is not shipped at all.
+ *
+ * Portions Copyright (c) 1996-2009, PostgreSQL Global Development Group
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ * IDENTIFICATION
+ *    $$
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/transam.h"
+#include "catalog/namespace.h"
+#include "catalog/pg_type.h"
+#include "libpq/libpq.h"
+#include "libpq/pqformat.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/planmain.h"
+#include "pgxc/planship.h"
+#include "storage/lock.h"
+#include "utils/lsyscache.h"
+
+/* GUC parameter */
+bool		enable_plan_shipping = false;
+
+typedef struct
+{
+	bool		fixup;			/* remapping a received plan, not checking one */
+	bool		portable;		/* cleared when checking finds a problem */
+	List	   *relids;			/* relation Oids the plan refers to */
+	List	   *newrelids;		/* corresponding local Oids, when remapping */
+} PlanShipContext;
+
+static void ship_plan(Plan *plan, PlanShipContext *cxt);
+static void ship_plan_list(List *plans, PlanShipContext *cxt);
+static void ship_expr(Node *node, PlanShipContext *cxt);
+static bool ship_check_walker(Node *node, PlanShipContext *cxt);
+static bool ship_fixup_walker(Node *node, PlanShipContext *cxt);
+static void ship_oid(Oid oid, PlanShipContext *cxt);
+static void ship_oid_array(Oid *oids, int count, PlanShipContext *cxt);
+static void ship_oid_list(List *oids, PlanShipContext *cxt);
+static Oid	ship_relid(Oid relid, PlanShipContext *cxt);
+static Oid	ship_local_relid(Oid relid, PlanShipContext *cxt);
+
+/*
+ * pgxc_plan_send
+ *
+ * Send the Coordinator the plan made for the statement it asked for, or
+ * only the time spent planning if the plan cannot be run by another node.
+ * stmt may be NULL if the statement is not one plan.
+ */
+void
+pgxc_plan_send(PlannedStmt *stmt, double planning_time)
+{
+	StringInfoData buf;
+	PlanShipContext cxt;
+	ListCell   *lc;
+
+	memset(&cxt, 0, sizeof(cxt));
+	cxt.portable = (stmt != NULL &&
+					stmt->commandType == CMD_SELECT &&
+					stmt->utilityStmt == NULL &&
+					!stmt->hasModifyingCTE &&
+					stmt->resultRelations == NIL &&
+					stmt->rowMarks == NIL);
+
+	if (cxt.portable)
+	{
+		foreach(lc, stmt->rtable)
+		{
+			RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc);
+
+			/* A view may be checked against its owner's rights */
+			ship_oid(rte->checkAsUser, &cxt);
+			if (rte->rtekind == RTE_RELATION)
+			{
+				/* Temporary relations have no name other nodes know */
+				if (isAnyTempNamespace(get_rel_namespace(rte->relid)))
+					cxt.portable = false;
+				ship_relid(rte->relid, &cxt);
+			}
+		}
+		if (cxt.portable)
+			ship_plan(stmt->planTree, &cxt);
+		if (cxt.portable)
+			ship_plan_list(stmt->subplans, &cxt);
+	}
+
+	pq_beginmessage(&buf, 'Y');
+	pq_sendfloat8(&buf, planning_time);
+	if (cxt.portable)
+	{
+		pq_sendstring(&buf, nodeToString(stmt));
+		pq_sendint(&buf, list_length(cxt.relids), 4);
+		foreach(lc, cxt.relids)
+		{
+			Oid			relid = lfirst_oid(lc);
+
+			pq_sendint(&buf, relid, 4);
+			pq_sendstring(&buf, get_namespace_name(get_rel_namespace(relid)));
+			pq_sendstring(&buf, get_rel_name(relid));
+			pq_sendint(&buf, get_relnatts(relid), 4);
+		}
+	}
+	pq_endmessage(&buf);
+
+	/* The Coordinator is waiting for it to send the other nodes anything */
+	pq_flush();
+}
+
+/*
+ * pgxc_plan_receive
+ *
+ * Read a plan shipped by another node from msg, and make it refer to the
+ * local relations.  Returns NULL if they do not match the ones the plan
+ * was made for, in which case the statement must be planned locally.
+ *
+ * Must be called in a transaction; the relations are locked as they would
+ * have been by parse analysis.
+ */
+PlannedStmt *
+pgxc_plan_receive(StringInfo msg)
+{
+	const char *planstr;
+	PlannedStmt *stmt;
+	PlanShipContext cxt;
+	int			nrels;
+	int			i;
+	ListCell   *lc;
+
+	memset(&cxt, 0, sizeof(cxt));
+	cxt.fixup = true;
+	cxt.portable = true;
+
+	planstr = pq_getmsgstring(msg);
+	nrels = pq_getmsgint(msg, 4);
+	for (i = 0; i < nrels; i++)
+	{
+		Oid			relid = (Oid) pq_getmsgint(msg, 4);
+		const char *nspname = pq_getmsgstring(msg);
+		const char *relname = pq_getmsgstring(msg);
+		int			natts = pq_getmsgint(msg, 4);
+		Oid			newrelid;
+
+		newrelid = RangeVarGetRelid(makeRangeVar(pstrdup(nspname),
+												 pstrdup(relname), -1),
+									AccessShareLock, true);
+		if (!OidIsValid(newrelid) || get_relnatts(newrelid) != natts)
+			cxt.portable = false;
+
+		cxt.relids = lappend_oid(cxt.relids, relid);
+		cxt.newrelids = lappend_oid(cxt.newrelids, newrelid);
+	}
+	pq_getmsgend(msg);
+
+	if (!cxt.portable)
+	{
+		elog(DEBUG1, "relations of shipped plan do not match, planning locally");
+		return NULL;
+	}
+
+	stmt = (PlannedStmt *) stringToNode((char *) planstr);
+	if (!IsA(stmt, PlannedStmt))
+		elog(ERROR, "shipped plan is not a PlannedStmt");
+
+	foreach(lc, stmt->rtable)
+	{
+		RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc);
+
+		if (rte->rtekind != RTE_RELATION)
+			continue;
+		rte->relid = ship_relid(rte->relid, &cxt);
+		if (get_rel_relkind(rte->relid) != rte->relkind)
+		{
+			elog(DEBUG1, "relations of shipped plan do not match, planning locally");
+			return NULL;
+		}
+	}
+	ship_plan(stmt->planTree, &cxt);
+	ship_plan_list(stmt->subplans, &cxt);
+
+	/* Those are for invalidating cached plans, which this one is not */
+	stmt->relationOids = NIL;
+	stmt->invalItems = NIL;
+
+	return stmt;
+}
+
+/*
+ * ship_plan
+ *
+ * Check that a plan tree can be shipped, or remap the one received,
+ * depending on cxt->fixup.  Only the plan nodes read by readfuncs.c may be
+ * shipped.
+ */
+static void
+ship_plan(Plan *plan, PlanShipContext *cxt)
+{
+	if (plan == NULL || !cxt->portable)
+		return;
+
+	ship_expr((Node *) plan->targetlist, cxt);
+	ship_expr((Node *) plan->qual, cxt);
+	ship_expr((Node *) plan->initPlan, cxt);
+
+	switch (nodeTag(plan))
+	{
+		case T_Result:
+			ship_expr(((Result *) plan)->resconstantqual, cxt);
+			break;
+		case T_Append:
+			ship_plan_list(((Append *) plan)->appendplans, cxt);
+			break;
+		case T_MergeAppend:
+			{
+				MergeAppend *mplan = (MergeAppend *) plan;
+
+				ship_plan_list(mplan->mergeplans, cxt);
+				ship_oid_array(mplan->sortOperators, mplan->numCols, cxt);
+				ship_oid_array(mplan->collations, mplan->numCols, cxt);
+			}
+			break;
+		case T_BitmapAnd:
+			ship_plan_list(((BitmapAnd *) plan)->bitmapplans, cxt);
+			break;
+		case T_BitmapOr:
+			ship_plan_list(((BitmapOr *) plan)->bitmapplans, cxt);
+			break;
+		case T_SeqScan:
+		case T_CteScan:
+		case T_Material:
+			break;
+		case T_IndexScan:
+			{
+				IndexScan  *iplan = (IndexScan *) plan;
+
+				iplan->indexid = ship_relid(iplan->indexid, cxt);
+				ship_expr((Node *) iplan->indexqual, cxt);
+				ship_expr((Node *) iplan->indexqualorig, cxt);
+				ship_expr((Node *) iplan->indexorderby, cxt);
+				ship_expr((Node *) iplan->indexorderbyorig, cxt);
+			}
+			break;
+		case T_IndexOnlyScan:
+			{
+				IndexOnlyScan *iplan = (IndexOnlyScan *) plan;
+
+				iplan->indexid = ship_relid(iplan->indexid, cxt);
+				ship_expr((Node *) iplan->indexqual, cxt);
+				ship_expr((Node *) iplan->indexorderby, cxt);
+				ship_expr((Node *) iplan->indextlist, cxt);
+			}
+			break;
+		case T_BitmapIndexScan:
+			{
+				BitmapIndexScan *iplan = (BitmapIndexScan *) plan;
+
+				iplan->indexid = ship_relid(iplan->indexid, cxt);
+				ship_expr((Node *) iplan->indexqual, cxt);
+				ship_expr((Node *) iplan->indexqualorig, cxt);
+			}
+			break;
+		case T_BitmapHeapScan:
+			ship_expr((Node *) ((BitmapHeapScan *) plan)->bitmapqualorig, cxt);
+			break;
+		case T_TidScan:
+			ship_expr((Node *) ((TidScan *) plan)->tidquals, cxt);
+			break;
+		case T_SubqueryScan:
+			ship_plan(((SubqueryScan *) plan)->subplan, cxt);
+			break;
+		case T_FunctionScan:
+			{
+				FunctionScan *fplan = (FunctionScan *) plan;
+
+				ship_expr(fplan->funcexpr, cxt);
+				ship_oid_list(fplan->funccoltypes, cxt);
+				ship_oid_list(fplan->funccolcollations, cxt);
+			}
+			break;
+		case T_ValuesScan:
+			ship_expr((Node *) ((ValuesScan *) plan)->values_lists, cxt);
+			break;
+		case T_NestLoop:
+			{
+				NestLoop   *nlplan = (NestLoop *) plan;
+				ListCell   *lc;
+
+				ship_expr((Node *) nlplan->join.joinqual, cxt);
+				foreach(lc, nlplan->nestParams)
+				{
+					NestLoopParam *nlp = (NestLoopParam *) lfirst(lc);
+
+					ship_expr((Node *) nlp->paramval, cxt);
+				}
+			}
+			break;
+		case T_MergeJoin:
+			{
+				MergeJoin  *mjplan = (MergeJoin *) plan;
+				int			numCols = list_length(mjplan->mergeclauses);
+
+				ship_expr((Node *) mjplan->join.joinqual, cxt);
+				ship_expr((Node *) mjplan->mergeclauses, cxt);
+				ship_oid_array(mjplan->mergeFamilies, numCols, cxt);
+				ship_oid_array(mjplan->mergeCollations, numCols, cxt);
+			}
+			break;
+		case T_HashJoin:
+			{
+				HashJoin   *hjplan = (HashJoin *) plan;
+
+				ship_expr((Node *) hjplan->join.joinqual, cxt);
+				ship_expr((Node *) hjplan->hashclauses, cxt);
+			}
+			break;
+		case T_Agg:
+			ship_oid_array(((Agg *) plan)->grpOperators,
+						   ((Agg *) plan)->numCols, cxt);
+			break;
+		case T_WindowAgg:
+			{
+				WindowAgg  *wplan = (WindowAgg *) plan;
+
+				ship_oid_array(wplan->partOperators, wplan->partNumCols, cxt);
+				ship_oid_array(wplan->ordOperators, wplan->ordNumCols, cxt);
+				ship_expr(wplan->startOffset, cxt);
+				ship_expr(wplan->endOffset, cxt);
+			}
+			break;
+		case T_Group:
+			ship_oid_array(((Group *) plan)->grpOperators,
+						   ((Group *) plan)->numCols, cxt);
+			break;
+		case T_Sort:
+			{
+				Sort	   *splan = (Sort *) plan;
+
+				ship_oid_array(splan->sortOperators, splan->numCols, cxt);
+				ship_oid_array(splan->collations, splan->numCols, cxt);
+			}
+			break;
+		case T_Unique:
+			ship_oid_array(((Unique *) plan)->uniqOperators,
+						   ((Unique *) plan)->numCols, cxt);
+			break;
+		case T_Hash:
+			{
+				Hash	   *hplan = (Hash *) plan;
+
+				if (OidIsValid(hplan->skewTable))
+					hplan->skewTable = ship_relid(hplan->skewTable, cxt);
+				ship_oid(hplan->skewColType, cxt);
+			}
+			break;
+		case T_SetOp:
+			ship_oid_array(((SetOp *) plan)->dupOperators,
+						   ((SetOp *) plan)->numCols, cxt);
+			break;
+		case T_Limit:
+			ship_expr(((Limit *) plan)->limitOffset, cxt);
+			ship_expr(((Limit *) plan)->limitCount, cxt);
+			break;
+		case T_Gather:
+			break;
+		default:
+			if (cxt->fixup)
+				elog(ERROR, "unrecognized node type in shipped plan: %d",
+					 (int) nodeTag(plan));
+			cxt->portable = false;
+			return;
+	}
+
+	ship_plan(plan->lefttree, cxt);
+	ship_plan(plan->righttree, cxt);
+}
+
+static void
+ship_plan_list(List *plans, PlanShipContext *cxt)
+{
+	ListCell   *lc;
+
+	foreach(lc, plans)
+		ship_plan((Plan *) lfirst(lc), cxt);
+}
+
+/*
+ * ship_expr
+ *
+ * Check or remap an expression tree of a plan.  Received expressions also
+ * need their operator functions looked up, as readfuncs.c leaves them out.
+ */
+static void
+ship_expr(Node *node, PlanShipContext *cxt)
+{
+	if (node == NULL || !cxt->portable)
+		return;
+
+	if (cxt->fixup)
+	{
+		fix_opfuncids(node);
+		(void) ship_fixup_walker(node, cxt);
+	}
+	else
+		(void) ship_check_walker(node, cxt);
+}
+
+/*
+ * ship_check_walker
+ *
+ * Clear cxt->portable if the expression refers to an object which is not
+ * built in, or contains a node whose Oids are not known to be checked here.
+ */
+static bool
+ship_check_walker(Node *node, PlanShipContext *cxt)
+{
+	if (node == NULL)
+		return false;
+
+	switch (nodeTag(node))
+	{
+		case T_Var:
+			ship_oid(((Var *) node)->vartype, cxt);
+			ship_oid(((Var *) node)->varcollid, cxt);
+			break;
+		case T_Const:
+			{
+				Const	   *c = (Const *) node;
+
+				/* The value of these is an Oid of its own */
+				switch (c->consttype)
+				{
+					case REGPROCOID:
+					case REGPROCEDUREOID:
+					case REGOPEROID:
+					case REGOPERATOROID:
+					case REGCLASSOID:
+					case REGTYPEOID:
+					case REGCONFIGOID:
+					case REGDICTIONARYOID:
+						cxt->portable = false;
+						break;
+				}
+				ship_oid(c->consttype, cxt);
+				ship_oid(c->constcollid, cxt);
+			}
+			break;
+		case T_Param:
+			ship_oid(((Param *) node)->paramtype, cxt);
+			ship_oid(((Param *) node)->paramcollid, cxt);
+			break;
+		case T_Aggref:
+			{
+				Aggref	   *agg = (Aggref *) node;
+
+				ship_oid(agg->aggfnoid, cxt);
+				ship_oid(agg->aggtype, cxt);
+				ship_oid(agg->aggtrantype, cxt);
+				ship_oid(agg->aggcollid, cxt);
+				ship_oid(agg->inputcollid, cxt);
+			}
+			break;
+		case T_WindowFunc:
+			{
+				WindowFunc *wfunc = (WindowFunc *) node;
+
+				ship_oid(wfunc->winfnoid, cxt);
+				ship_oid(wfunc->wintype, cxt);
+				ship_oid(wfunc->wincollid, cxt);
+				ship_oid(wfunc->inputcollid, cxt);
+			}
+			break;
+		case T_ArrayRef:
+			{
+				ArrayRef   *aref = (ArrayRef *) node;
+
+				ship_oid(aref->refarraytype, cxt);
+				ship_oid(aref->refelemtype, cxt);
+				ship_oid(aref->refcollid, cxt);
+			}
+			break;
+		case T_FuncExpr:
+			{
+				FuncExpr   *func = (FuncExpr *) node;
+
+				ship_oid(func->funcid, cxt);
+				ship_oid(func->funcresulttype, cxt);
+				ship_oid(func->funccollid, cxt);
+				ship_oid(func->inputcollid, cxt);
+			}
+			break;
+		case T_OpExpr:
+		case T_DistinctExpr:
+		case T_NullIfExpr:
+			{
+				OpExpr	   *op = (OpExpr *) node;
+
+				ship_oid(op->opno, cxt);
+				ship_oid(op->opfuncid, cxt);
+				ship_oid(op->opresulttype, cxt);
+				ship_oid(op->opcollid, cxt);
+				ship_oid(op->inputcollid, cxt);
+			}
+			break;
+		case T_ScalarArrayOpExpr:
+			{
+				ScalarArrayOpExpr *op = (ScalarArrayOpExpr *) node;
+
+				ship_oid(op->opno, cxt);
+				ship_oid(op->opfuncid, cxt);
+				ship_oid(op->inputcollid, cxt);
+			}
+			break;
+		case T_SubPlan:
+			ship_oid(((SubPlan *) node)->firstColType, cxt);
+			ship_oid(((SubPlan *) node)->firstColCollation, cxt);
+			break;
+		case T_FieldSelect:
+			ship_oid(((FieldSelect *) node)->resulttype, cxt);
+			ship_oid(((FieldSelect *) node)->resultcollid, cxt);
+			break;
+		case T_FieldStore:
+			ship_oid(((FieldStore *) node)->resulttype, cxt);
+			break;
+		case T_RelabelType:
+			ship_oid(((RelabelType *) node)->resulttype, cxt);
+			ship_oid(((RelabelType *) node)->resultcollid, cxt);
+			break;
+		case T_CoerceViaIO:
+			ship_oid(((CoerceViaIO *) node)->resulttype, cxt);
+			ship_oid(((CoerceViaIO *) node)->resultcollid, cxt);
+			break;
+		case T_ArrayCoerceExpr:
+			ship_oid(((ArrayCoerceExpr *) node)->elemfuncid, cxt);
+			ship_oid(((ArrayCoerceExpr *) node)->resulttype, cxt);
+			ship_oid(((ArrayCoerceExpr *) node)->resultcollid, cxt);
+			break;
+		case T_ConvertRowtypeExpr:
+			ship_oid(((ConvertRowtypeExpr *) node)->resulttype, cxt);
+			break;
+		case T_CollateExpr:
+			ship_oid(((CollateExpr *) node)->collOid, cxt);
+			break;
+		case T_CaseExpr:
+			ship_oid(((CaseExpr *) node)->casetype, cxt);
+			ship_oid(((CaseExpr *) node)->casecollid, cxt);
+			break;
+		case T_CaseTestExpr:
+			ship_oid(((CaseTestExpr *) node)->typeId, cxt);
+			ship_oid(((CaseTestExpr *) node)->collation, cxt);
+			break;
+		case T_ArrayExpr:
+			ship_oid(((ArrayExpr *) node)->array_typeid, cxt);
+			ship_oid(((ArrayExpr *) node)->array_collid, cxt);
+			ship_oid(((ArrayExpr *) node)->element_typeid, cxt);
+			break;
+		case T_RowExpr:
+			ship_oid(((RowExpr *) node)->row_typeid, cxt);
+			break;
+		case T_RowCompareExpr:
+			ship_oid_list(((RowCompareExpr *) node)->opnos, cxt);
+			ship_oid_list(((RowCompareExpr *) node)->opfamilies, cxt);
+			ship_oid_list(((RowCompareExpr *) node)->inputcollids, cxt);
+			break;
+		case T_CoalesceExpr:
+			ship_oid(((CoalesceExpr *) node)->coalescetype, cxt);
+			ship_oid(((CoalesceExpr *) node)->coalescecollid, cxt);
+			break;
+		case T_MinMaxExpr:
+			ship_oid(((MinMaxExpr *) node)->minmaxtype, cxt);
+			ship_oid(((MinMaxExpr *) node)->minmaxcollid, cxt);
+			ship_oid(((MinMaxExpr *) node)->inputcollid, cxt);
+			break;
+		case T_XmlExpr:
+			ship_oid(((XmlExpr *) node)->type, cxt);
+			break;
+		case T_CoerceToDomain:
+			ship_oid(((CoerceToDomain *) node)->resulttype, cxt);
+			ship_oid(((CoerceToDomain *) node)->resultcollid, cxt);
+			break;
+		case T_CoerceToDomainValue:
+			ship_oid(((CoerceToDomainValue *) node)->typeId, cxt);
+			ship_oid(((CoerceToDomainValue *) node)->collation, cxt);
+			break;
+		case T_List:
+		case T_TargetEntry:
+		case T_BoolExpr:
+		case T_CaseWhen:
+		case T_NullTest:
+		case T_BooleanTest:
+		case T_AlternativeSubPlan:
+			break;
+		default:
+			cxt->portable = false;
+			break;
+	}
+
+	if (!cxt->portable)
+		return true;
+
+	return expression_tree_walker(node, ship_check_walker, (void *) cxt);
+}
+
+/*
+ * ship_fixup_walker
+ *
+ * Remap the relation Oids found in a received expression tree.
+ */
+static bool
+ship_fixup_walker(Node *node, PlanShipContext *cxt)
+{
+	if (node == NULL)
+		return false;
+
+	if (IsA(node, TargetEntry))
+	{
+		TargetEntry *tle = (TargetEntry *) node;
+
+		/* Only used to describe the result, forget it if unknown */
+		if (OidIsValid(tle->resorigtbl))
+			tle->resorigtbl = ship_local_relid(tle->resorigtbl, cxt);
+	}
+
+	return expression_tree_walker(node, ship_fixup_walker, (void *) cxt);
+}
+
+/*
+ * ship_oid
+ *
+ * Check that an Oid, other than that of a relation, is the same on all
+ * nodes.  Nothing to do when remapping.
+ */
+static void
+ship_oid(Oid oid, PlanShipContext *cxt)
+{
+	if (!cxt->fixup && oid >= FirstNormalObjectId)
+		cxt->portable = false;
+}
+
+static void
+ship_oid_array(Oid *oids, int count, PlanShipContext *cxt)
+{
+	int			i;
+
+	for (i = 0; i < count; i++)
+		ship_oid(oids[i], cxt);
+}
+
+static void
+ship_oid_list(List *oids, PlanShipContext *cxt)
+{
+	ListCell   *lc;
+
+	foreach(lc, oids)
+		ship_oid(lfirst_oid(lc), cxt);
+}
+
+/*
+ * ship_relid
+ *
+ * When checking a plan, note that it refers to the given relation.  When
+ * remapping one, return the local Oid of the relation.
+ */
+static Oid
+ship_relid(Oid relid, PlanShipContext *cxt)
+{
+	Oid			newrelid;
+
+	if (!cxt->fixup)
+	{
+		cxt->relids = list_append_unique_oid(cxt->relids, relid);
+		return relid;
+	}
+
+	newrelid = ship_local_relid(relid, cxt);
+	if (!OidIsValid(newrelid))
+		elog(ERROR, "relation %u of shipped plan is unknown", relid);
+	return newrelid;
+}
+
+/*
+ * ship_local_relid
+ *
+ * Return the local Oid of a relation of a received plan, or InvalidOid if
+ * it was not passed along with the plan.
+ */
+static Oid
+ship_local_relid(Oid relid, PlanShipContext *cxt)
+{
+	ListCell   *lc1;
+	ListCell   *lc2;
+
+	forboth(lc1, cxt->relids, lc2, cxt->newrelids)
+	{
+		if (lfirst_oid(lc1) == relid)
+			return lfirst_oid(lc2);
+	}
+	return InvalidOid;
+}
@@ -123,7 +123,8 @@ static int	destroy_database_pool(const char *database, const char *user_name);
 static void reload_database_pools(PoolAgent *agent);
 static DatabasePool *find_database_pool(const char *database, const char *user_name, const char *pgoptions);
 static DatabasePool *remove_database_pool(const char *database, const char *user_name);
-static int *agent_acquire_connections(PoolAgent *agent, List *datanodelist, List *coordlist);
+static int *agent_acquire_connections(PoolAgent *agent, List *datanodelist,
+						  List *coordlist, bool standby);
 static int send_local_commands(PoolAgent *agent, List *datanodelist, List *coordlist);
 static int cancel_query_on_connections(PoolAgent *agent, List *datanodelist, List *coordlist);
 static PGXCNodePoolSlot *acquire_connection(DatabasePool *dbPool, Oid node);
@@ -133,6 +134,7 @@ static void release_connection(DatabasePool *dbPool, PGXCNodePoolSlot *slot,
 							   Oid node, bool force_destroy);
 static void destroy_slot(PGXCNodePoolSlot *slot);
 static PGXCNodePool *grow_pool(DatabasePool *dbPool, Oid node);
+static void grow_pools(DatabasePool *dbPool, Oid *nodes, int nnodes);
 static void destroy_node_pool(PGXCNodePool *node_pool);
 static void PoolerLoop(void);
 static int clean_connection(List *node_discard,
@@ -429,6 +431,7 @@ agent_create(int new_fd)
 	agent->dn_conn_oids = NULL;
 	agent->coord_conn_oids = NULL;
 	agent->dn_connections = NULL;
+	agent->dn_slot_oids = NULL;
 	agent->coord_connections = NULL;
 	agent->session_params = NULL;
 	agent->local_params = NULL;
@@ -738,6 +741,8 @@ agent_init(PoolAgent *agent, const char *database, const char *user_name,
 			palloc0(agent->num_coord_connections * sizeof(PGXCNodePoolSlot *));
 	agent->dn_connections = (PGXCNodePoolSlot **)
 			palloc0(agent->num_dn_connections * sizeof(PGXCNodePoolSlot *));
+	agent->dn_slot_oids = (Oid *)
+			palloc0(agent->num_dn_connections * sizeof(Oid));
 	/* find database */
 	agent->pool = find_database_pool(database, user_name, pgoptions);
 
@@ -820,13 +825,13 @@ PoolManagerDisconnect(void)
  * Get pooled connections
  */
 int *
-PoolManagerGetConnections(List *datanodelist, List *coordlist)
+PoolManagerGetConnections(List *datanodelist, List *coordlist, bool standby)
 {
 	int			i;
 	ListCell   *nodelist_item;
 	int		   *fds;
 	int			totlen = list_length(datanodelist) + list_length(coordlist);
-	int			nodes[totlen + 2];
+	int			nodes[totlen + 3];
 
 	Assert(poolHandle);
 
@@ -854,8 +859,10 @@ PoolManagerGetConnections(List *datanodelist, List *coordlist)
 			nodes[i++] = htonl(lfirst_int(nodelist_item));
 		}
 	}
+	/* And finally where to take Datanode connections from */
+	nodes[i++] = htonl(standby ? 1 : 0);
 
-	pool_putmessage(&poolHandle->port, 'g', (char *) nodes, sizeof(int) * (totlen + 2));
+	pool_putmessage(&poolHandle->port, 'g', (char *) nodes, sizeof(int) * (totlen + 3));
 	pool_flush(&poolHandle->port);
 
 	/* Receive response */
@@ -1049,6 +1056,7 @@ agent_handle_input(PoolAgent * agent, StringInfo s)
 		PoolCommandType	command_type;
 		int			datanodecount;
 		int			coordcount;
+		bool		standby;
 		List	   *nodelist = NIL;
 		List	   *datanodelist = NIL;
 		List	   *coordlist = NIL;
@@ -1178,10 +1186,11 @@ agent_handle_input(PoolAgent * agent, StringInfo s)
 				 * - List of Coordinators = NumPoolCoords * 4bytes (max)
 				 * - Number of Datanodes sent = 4bytes
 				 * - Number of Coordinators sent = 4bytes
+				 * - Datanode standby flag = 4bytes
 				 * It is better to send in a same message the list of Co and Dn at the same
 				 * time, this permits to reduce interactions between postmaster and pooler
 				 */
-				pool_getmessage(&agent->port, s, 4 * agent->num_dn_connections + 4 * agent->num_coord_connections + 12);
+				pool_getmessage(&agent->port, s, 4 * agent->num_dn_connections + 4 * agent->num_coord_connections + 16);
 				datanodecount = pq_getmsgint(s, 4);
 				for (i = 0; i < datanodecount; i++)
 					datanodelist = lappend_int(datanodelist, pq_getmsgint(s, 4));
@@ -1189,13 +1198,15 @@ agent_handle_input(PoolAgent * agent, StringInfo s)
 				/* It is possible that no Coordinators are involved in the transaction */
 				for (i = 0; i < coordcount; i++)
 					coordlist = lappend_int(coordlist, pq_getmsgint(s, 4));
+				standby = (pq_getmsgint(s, 4) != 0);
 				pq_getmsgend(s);
 
 				/*
 				 * In case of error agent_acquire_connections will log
 				 * the error and return NULL
 				 */
-				fds = agent_acquire_connections(agent, datanodelist, coordlist);
+				fds = agent_acquire_connections(agent, datanodelist, coordlist,
+												standby);
 				list_free(datanodelist);
 				list_free(coordlist);
 
@@ -1417,12 +1428,16 @@ agent_set_command(PoolAgent *agent, const char *set_command, PoolCommandType com
  * acquire connection
  */
 static int *
-agent_acquire_connections(PoolAgent *agent, List *datanodelist, List *coordlist)
+agent_acquire_connections(PoolAgent *agent, List *datanodelist,
+						  List *coordlist, bool standby)
 {
 	int			i;
 	int		   *result;
 	ListCell   *nodelist_item;
 	MemoryContext oldcontext;
+	Oid		   *grow_oids;
+	int			ngrow;
+	Oid		   *dn_oids;
 
 	Assert(agent);
 
@@ -1453,6 +1468,78 @@ agent_acquire_connections(PoolAgent *agent, List *datanodelist, List *coordlist)
 	 */
 	oldcontext = MemoryContextSwitchTo(agent->pool->mcxt);
 
+	/*
+	 * Choose the node each Datanode connection is taken from: a hot standby
+	 * of the Datanode if asked for and one is defined, else the Datanode.
+	 * Temporary objects only exist on the Datanodes themselves.  The agent
+	 * pid spreads sessions over the standbys of a Datanode.  A connection
+	 * kept from an earlier transaction that comes from the other node is
+	 * given up; it may carry session parameters, so it is only put back to
+	 * pool if the session has none.
+	 */
+	dn_oids = (Oid *) palloc(agent->num_dn_connections * sizeof(Oid));
+	foreach(nodelist_item, datanodelist)
+	{
+		int			node = lfirst_int(nodelist_item);
+		Oid			nodeoid = InvalidOid;
+
+		if (standby && !agent->is_temp)
+			nodeoid = PgxcNodeGetStandby(agent->dn_conn_oids[node], agent->pid);
+		if (!OidIsValid(nodeoid))
+			nodeoid = agent->dn_conn_oids[node];
+		dn_oids[node] = nodeoid;
+
+		if (agent->dn_connections[node] != NULL &&
+			agent->dn_slot_oids[node] != nodeoid)
+		{
+			release_connection(agent->pool, agent->dn_connections[node],
+							   agent->dn_slot_oids[node],
+							   agent->session_params != NULL);
+			agent->dn_connections[node] = NULL;
+		}
+	}
+
+	/*
+	 * Find the node pools that have no free connection to give, and grow
+	 * them all together, so that the new connections are opened in parallel
+	 * rather than one by one in acquire_connection.
+	 */
+	grow_oids = (Oid *) palloc((list_length(datanodelist) + list_length(coordlist)) * sizeof(Oid));
+	ngrow = 0;
+	foreach(nodelist_item, datanodelist)
+	{
+		int			node = lfirst_int(nodelist_item);
+
+		if (agent->dn_connections[node] == NULL)
+		{
+			PGXCNodePool *nodePool;
+
+			nodePool = (PGXCNodePool *) hash_search(agent->pool->nodePools,
+													&dn_oids[node],
+													HASH_FIND, NULL);
+			if (nodePool == NULL || nodePool->freeSize == 0)
+				grow_oids[ngrow++] = dn_oids[node];
+		}
+	}
+	foreach(nodelist_item, coordlist)
+	{
+		int			node = lfirst_int(nodelist_item);
+
+		if (agent->coord_connections[node] == NULL)
+		{
+			PGXCNodePool *nodePool;
+
+			nodePool = (PGXCNodePool *) hash_search(agent->pool->nodePools,
+													&agent->coord_conn_oids[node],
+													HASH_FIND, NULL);
+			if (nodePool == NULL || nodePool->freeSize == 0)
+				grow_oids[ngrow++] = agent->coord_conn_oids[node];
+		}
+	}
+	if (ngrow > 0)
+		grow_pools(agent->pool, grow_oids, ngrow);
+	pfree(grow_oids);
+
 	/* Initialize result */
 	i = 0;
 	/* Save in array fds of Datanodes first */
@@ -1464,18 +1551,27 @@ agent_acquire_connections(PoolAgent *agent, List *datanodelist, List *coordlist)
 		if (agent->dn_connections[node] == NULL)
 		{
 			PGXCNodePoolSlot *slot = acquire_connection(agent->pool,
-														agent->dn_conn_oids[node]);
+														dn_oids[node]);
+
+			/* A standby out of reach is no reason to fail, use the Datanode */
+			if (slot == NULL && dn_oids[node] != agent->dn_conn_oids[node])
+			{
+				dn_oids[node] = agent->dn_conn_oids[node];
+				slot = acquire_connection(agent->pool, dn_oids[node]);
+			}
 
 			/* Handle failure */
 			if (slot == NULL)
 			{
 				pfree(result);
+				pfree(dn_oids);
 				MemoryContextSwitchTo(oldcontext);
 				return NULL;
 			}
 
 			/* Store in the descriptor */
 			agent->dn_connections[node] = slot;
+			agent->dn_slot_oids[node] = dn_oids[node];
 
 			/*
 			 * Update newly-acquired slot with session parameters.
@@ -1489,6 +1585,8 @@ agent_acquire_connections(PoolAgent *agent, List *datanodelist, List *coordlist)
 		result[i++] = PQsocket((PGconn *) agent->dn_connections[node]->conn);
 	}
 
+	pfree(dn_oids);
+
 	/* Save then in the array fds for Coordinators */
 	foreach(nodelist_item, coordlist)
 	{
@@ -1764,7 +1862,7 @@ agent_release_connections(PoolAgent *agent, bool force_destroy)
 		 * If connection has temporary objects on it, destroy connection slot.
 		 */
 		if (slot)
-			release_connection(agent->pool, slot, agent->dn_conn_oids[i], force_destroy);
+			release_connection(agent->pool, slot, agent->dn_slot_oids[i], force_destroy);
 		agent->dn_connections[i] = NULL;
 	}
 	/* Then clean up for Coordinator connections */
@@ -1987,6 +2085,8 @@ reload_database_pools(PoolAgent *agent)
 			palloc0(agent->num_coord_connections * sizeof(PGXCNodePoolSlot *));
 	agent->dn_connections = (PGXCNodePoolSlot **)
 			palloc0(agent->num_dn_connections * sizeof(PGXCNodePoolSlot *));
+	agent->dn_slot_oids = (Oid *)
+			palloc0(agent->num_dn_connections * sizeof(Oid));
 
 	/*
 	 * Scan the list and destroy any altered pool. They will be recreated
@@ -2203,74 +2303,200 @@ release_connection(DatabasePool *dbPool, PGXCNodePoolSlot *slot,
 static PGXCNodePool *
 grow_pool(DatabasePool *dbPool, Oid node)
 {
-	PGXCNodePool   *nodePool;
-	bool			found;
+	grow_pools(dbPool, &node, 1);
 
-	Assert(dbPool);
+	return (PGXCNodePool *) hash_search(dbPool->nodePools, &node,
+										HASH_FIND, NULL);
+}
 
-	nodePool = (PGXCNodePool *) hash_search(dbPool->nodePools, &node,
-											HASH_ENTER, &found);
 
-	if (!found)
+/*
+ * Increase the size of the pools of several nodes at once
+ *
+ * Each pool is brought up to MinPoolSize, and given one more connection if
+ * it has none free, as long as it stays within MaxPoolSize.  All the new
+ * connections are established concurrently, using libpq's non-blocking
+ * connection functions.  The pooler serves all the sessions of this
+ * Coordinator one after the other, so during a connection storm the time
+ * it spends waiting for nodes to accept connections is time every waiting
+ * session pays; opening the connections a session needs in parallel makes
+ * that the time of the slowest connection rather than the sum of them all.
+ */
+static void
+grow_pools(DatabasePool *dbPool, Oid *nodes, int nnodes)
+{
+	PGXCNodePool **pending_pools;
+	PGconn	  **pending_conns;
+	PostgresPollingStatusType *pending_status;
+	struct pollfd *pfds;
+	int			npending = 0;
+	int			maxpending = 0;
+	int			nactive;
+	int			i;
+
+	Assert(dbPool);
+
+	/* Count the connections to make, creating node pools as needed */
+	for (i = 0; i < nnodes; i++)
 	{
-		nodePool->connstr = build_node_conn_str(node, dbPool);
-		if (!nodePool->connstr)
+		PGXCNodePool   *nodePool;
+		bool			found;
+
+		nodePool = (PGXCNodePool *) hash_search(dbPool->nodePools, &nodes[i],
+												HASH_ENTER, &found);
+
+		if (!found)
 		{
-			ereport(ERROR,
-					(errcode(ERRCODE_INTERNAL_ERROR),
-					 errmsg("could not build connection string for node %u", node)));
+			nodePool->connstr = build_node_conn_str(nodes[i], dbPool);
+			if (!nodePool->connstr)
+			{
+				ereport(ERROR,
+						(errcode(ERRCODE_INTERNAL_ERROR),
+						 errmsg("could not build connection string for node %u", nodes[i])));
+			}
+
+			nodePool->slot = (PGXCNodePoolSlot **) palloc0(MaxPoolSize * sizeof(PGXCNodePoolSlot *));
+			if (!nodePool->slot)
+			{
+				ereport(ERROR,
+						(errcode(ERRCODE_OUT_OF_MEMORY),
+						 errmsg("out of memory")));
+			}
+			nodePool->freeSize = 0;
+			nodePool->size = 0;
 		}
 
-		nodePool->slot = (PGXCNodePoolSlot **) palloc0(MaxPoolSize * sizeof(PGXCNodePoolSlot *));
-		if (!nodePool->slot)
+		if (nodePool->size < MinPoolSize)
+			maxpending += MinPoolSize - nodePool->size;
+		else if (nodePool->freeSize == 0 && nodePool->size < MaxPoolSize)
+			maxpending++;
+	}
+
+	if (maxpending == 0)
+		return;
+
+	pending_pools = (PGXCNodePool **) palloc(maxpending * sizeof(PGXCNodePool *));
+	pending_conns = (PGconn **) palloc(maxpending * sizeof(PGconn *));
+	pending_status = (PostgresPollingStatusType *)
+		palloc(maxpending * sizeof(PostgresPollingStatusType));
+	pfds = (struct pollfd *) palloc(maxpending * sizeof(struct pollfd));
+
+	/* Start all the connections */
+	for (i = 0; i < nnodes; i++)
+	{
+		PGXCNodePool   *nodePool;
+		int				size;
+
+		nodePool = (PGXCNodePool *) hash_search(dbPool->nodePools, &nodes[i],
+												HASH_FIND, NULL);
+		size = nodePool->size;
+
+		while (size < MinPoolSize ||
+			   (nodePool->freeSize == 0 && size == nodePool->size &&
+				size < MaxPoolSize))
 		{
-			ereport(ERROR,
-					(errcode(ERRCODE_OUT_OF_MEMORY),
-					 errmsg("out of memory")));
+			PGconn	   *conn = PQconnectStart(nodePool->connstr);
+
+			size++;
+			if (conn == NULL || PQstatus(conn) == CONNECTION_BAD)
+			{
+				if (conn)
+					PQfinish(conn);
+				ereport(LOG,
+						(errcode(ERRCODE_CONNECTION_FAILURE),
+						 errmsg("failed to connect to Datanode")));
+				break;
+			}
+
+			pending_pools[npending] = nodePool;
+			pending_conns[npending] = conn;
+			/* As documented for PQconnectPoll, start as if it said WRITING */
+			pending_status[npending] = PGRES_POLLING_WRITING;
+			npending++;
 		}
-		nodePool->freeSize = 0;
-		nodePool->size = 0;
 	}
 
-	while (nodePool->size < MinPoolSize || (nodePool->freeSize == 0 && nodePool->size < MaxPoolSize))
+	/* Drive them all until each one has succeeded or failed */
+	nactive = npending;
+	while (nactive > 0)
 	{
-		PGXCNodePoolSlot *slot;
+		int			nfds = 0;
+		int			retval;
 
-		/* Allocate new slot */
-		slot = (PGXCNodePoolSlot *) palloc(sizeof(PGXCNodePoolSlot));
-		if (slot == NULL)
+		for (i = 0; i < npending; i++)
 		{
-			ereport(ERROR,
-					(errcode(ERRCODE_OUT_OF_MEMORY),
-					 errmsg("out of memory")));
-		}
+			if (pending_conns[i] == NULL ||
+				pending_status[i] == PGRES_POLLING_OK ||
+				pending_status[i] == PGRES_POLLING_FAILED)
+				continue;
 
-		/* If connection fails, be sure that slot is destroyed cleanly */
-		slot->xc_cancelConn = NULL;
+			pfds[nfds].fd = PQsocket(pending_conns[i]);
+			pfds[nfds].events =
+				(pending_status[i] == PGRES_POLLING_READING) ? POLLIN : POLLOUT;
+			pfds[nfds].revents = 0;
+			nfds++;
+		}
 
-		/* Establish connection */
-		slot->conn = PGXCNodeConnect(nodePool->connstr);
-		if (!PGXCNodeConnected(slot->conn))
+		retval = poll(pfds, nfds, -1);
+		if (retval < 0)
 		{
-			destroy_slot(slot);
-			ereport(LOG,
-					(errcode(ERRCODE_CONNECTION_FAILURE),
-					 errmsg("failed to connect to Datanode")));
-			break;
+			if (errno == EINTR)
+				continue;
+			elog(FATAL, "poll returned with error %d", retval);
 		}
 
-		slot->xc_cancelConn = (NODE_CANCEL *) PQgetCancel((PGconn *)slot->conn);
+		nfds = 0;
+		for (i = 0; i < npending; i++)
+		{
+			PGXCNodePool *nodePool = pending_pools[i];
+			PGXCNodePoolSlot *slot;
+
+			if (pending_conns[i] == NULL ||
+				pending_status[i] == PGRES_POLLING_OK ||
+				pending_status[i] == PGRES_POLLING_FAILED)
+				continue;
 
-		/* Insert at the end of the pool */
-		nodePool->slot[(nodePool->freeSize)++] = slot;
+			if (pfds[nfds++].revents == 0)
+				continue;
+
+			pending_status[i] = PQconnectPoll(pending_conns[i]);
 
-		/* Increase count of pool size */
-		(nodePool->size)++;
-		elog(DEBUG1, "Pooler: increased pool size to %d for pool %s",
-			 nodePool->size,
-			 nodePool->connstr);
+			if (pending_status[i] == PGRES_POLLING_FAILED)
+			{
+				PQfinish(pending_conns[i]);
+				pending_conns[i] = NULL;
+				nactive--;
+				ereport(LOG,
+						(errcode(ERRCODE_CONNECTION_FAILURE),
+						 errmsg("failed to connect to Datanode")));
+				continue;
+			}
+
+			if (pending_status[i] != PGRES_POLLING_OK)
+				continue;
+
+			nactive--;
+
+			/* Allocate new slot */
+			slot = (PGXCNodePoolSlot *) palloc(sizeof(PGXCNodePoolSlot));
+			slot->conn = (NODE_CONNECTION *) pending_conns[i];
+			slot->xc_cancelConn = (NODE_CANCEL *) PQgetCancel(pending_conns[i]);
+
+			/* Insert at the end of the pool */
+			nodePool->slot[(nodePool->freeSize)++] = slot;
+
+			/* Increase count of pool size */
+			(nodePool->size)++;
+			elog(DEBUG1, "Pooler: increased pool size to %d for pool %s",
+				 nodePool->size,
+				 nodePool->connstr);
+		}
 	}
-	return nodePool;
+
+	pfree(pending_pools);
+	pfree(pending_conns);
+	pfree(pending_status);
+	pfree(pfds);
 }
 
 
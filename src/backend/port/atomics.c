@@ -0,0 +1,23 @@
+/*-------------------------------------------------------------------------
+ *
+ * atomics.c
+ *	   Non-inline definitions of the atomic operations.
+ *
+ * If the compiler doesn't support inline functions, the functions in
+ * port/atomics.h are compiled here instead.  See STATIC_IF_INLINE in c.h.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/port/atomics.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+/* See port/atomics.h */
+#define ATOMICS_INCLUDE_DEFINITIONS
+
+#include "port/atomics.h"
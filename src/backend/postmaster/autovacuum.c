@@ -119,6 +119,9 @@ int			autovacuum_freeze_max_age;
 
 int			autovacuum_vac_cost_delay;
 int			autovacuum_vac_cost_limit;
+#ifdef PGXC
+int			autovacuum_parallel_vacuum_workers = -1;
+#endif
 
 int			Log_autovacuum_min_duration = -1;
 
@@ -110,6 +110,20 @@ static struct
 static StringInfoData reply_message;
 static StringInfoData incoming_message;
 
+#ifdef PGXC
+/*
+ * Replies requested from the primary and not received yet, oldest first.
+ * Each holds the last end-of-WAL request of backends made before it was
+ * sent, see GetPrimaryWalEnd: the primary answers in order, so its answer
+ * satisfies that request.  walEndRequestSent is the last request sent.
+ */
+#define MAX_WALEND_REQUESTS 8
+static uint64 walEndRequests[MAX_WALEND_REQUESTS];
+static int	walEndRequestFirst = 0;
+static int	walEndRequestCount = 0;
+static uint64 walEndRequestSent = 0;
+#endif
+
 /*
  * About SIGTERM handling:
  *
@@ -141,6 +155,10 @@ static void XLogWalRcvFlush(bool dying);
 static void XLogWalRcvSendReply(bool force, bool requestReply);
 static void XLogWalRcvSendHSFeedback(bool immed);
 static void ProcessWalSndrMessage(XLogRecPtr walEnd, TimestampTz sendTime);
+#ifdef PGXC
+static void XLogWalRcvRequestWalEnd(void);
+static void ProcessWalEndAnswer(XLogRecPtr walEnd);
+#endif
 
 /* Signal handlers */
 static void WalRcvSigHupHandler(SIGNAL_ARGS);
@@ -380,6 +398,14 @@ WalReceiverMain(void)
 			last_recv_timestamp = GetCurrentTimestamp();
 			ping_sent = false;
 
+#ifdef PGXC
+			/* Requests sent on a previous connection are not answered */
+			walEndRequestFirst = walEndRequestCount = 0;
+			SpinLockAcquire(&walrcv->mutex);
+			walEndRequestSent = walrcv->walEndAnswered;
+			SpinLockRelease(&walrcv->mutex);
+#endif
+
 			/* Loop until end-of-streaming or error */
 			while (!endofwal)
 			{
@@ -412,6 +438,11 @@ WalReceiverMain(void)
 					XLogWalRcvSendHSFeedback(true);
 				}
 
+#ifdef PGXC
+				/* Ask the primary for its end of WAL if backends need it */
+				XLogWalRcvRequestWalEnd();
+#endif
+
 				/* Wait a while for data to arrive */
 				len = walrcv_receive(NAPTIME_PER_CYCLE, &buf);
 				if (len != 0)
@@ -848,6 +879,11 @@ XLogWalRcvProcessMsg(unsigned char type, char *buf, Size len)
 				/* If the primary requested a reply, send one immediately */
 				if (replyRequested)
 					XLogWalRcvSendReply(true, false);
+#ifdef PGXC
+				/* Otherwise it is the reply to one we requested */
+				else
+					ProcessWalEndAnswer(walEnd);
+#endif
 				break;
 			}
 		default:
@@ -1060,6 +1096,30 @@ XLogWalRcvSendReply(bool force, bool requestReply)
 		return;
 	sendTime = now;
 
+#ifdef PGXC
+	/* Remember which end-of-WAL request the reply answers */
+	if (requestReply)
+	{
+		if (walEndRequestCount < MAX_WALEND_REQUESTS)
+		{
+			/* use volatile pointer to prevent code rearrangement */
+			volatile WalRcvData *walrcv = WalRcv;
+
+			SpinLockAcquire(&walrcv->mutex);
+			walEndRequestSent = walrcv->walEndRequested;
+			SpinLockRelease(&walrcv->mutex);
+
+			walEndRequests[(walEndRequestFirst + walEndRequestCount++) %
+						   MAX_WALEND_REQUESTS] = walEndRequestSent;
+		}
+		else
+		{
+			/* Enough replies are on their way already */
+			requestReply = false;
+		}
+	}
+#endif
+
 	/* Construct a new message */
 	writePtr = LogstreamResult.Write;
 	flushPtr = LogstreamResult.Flush;
@@ -1165,6 +1225,52 @@ XLogWalRcvSendHSFeedback(bool immed)
 		master_has_standby_xmin = false;
 }
 
+#ifdef PGXC
+/*
+ * Send a request for the primary's end of WAL if a backend made one that
+ * has not been sent yet.
+ */
+static void
+XLogWalRcvRequestWalEnd(void)
+{
+	/* use volatile pointer to prevent code rearrangement */
+	volatile WalRcvData *walrcv = WalRcv;
+	uint64		requested;
+
+	SpinLockAcquire(&walrcv->mutex);
+	requested = walrcv->walEndRequested;
+	SpinLockRelease(&walrcv->mutex);
+
+	if (requested > walEndRequestSent)
+		XLogWalRcvSendReply(true, true);
+}
+
+/*
+ * The primary answered the oldest reply request still pending, with the end
+ * of WAL it had when it did.  Let the backends waiting for it know.
+ */
+static void
+ProcessWalEndAnswer(XLogRecPtr walEnd)
+{
+	/* use volatile pointer to prevent code rearrangement */
+	volatile WalRcvData *walrcv = WalRcv;
+	uint64		answered;
+
+	if (walEndRequestCount == 0)
+		return;
+
+	answered = walEndRequests[walEndRequestFirst];
+	walEndRequestFirst = (walEndRequestFirst + 1) % MAX_WALEND_REQUESTS;
+	walEndRequestCount--;
+
+	SpinLockAcquire(&walrcv->mutex);
+	walrcv->primaryWalEnd = walEnd;
+	if (walrcv->walEndAnswered < answered)
+		walrcv->walEndAnswered = answered;
+	SpinLockRelease(&walrcv->mutex);
+}
+#endif
+
 /*
  * Update shared memory status upon receiving a message from primary.
  *
@@ -24,6 +24,7 @@
 #include <signal.h>
 
 #include "access/xlog_internal.h"
+#include "miscadmin.h"
 #include "postmaster/startup.h"
 #include "replication/walreceiver.h"
 #include "storage/pmsignal.h"
@@ -367,3 +368,54 @@ GetReplicationTransferLatency(void)
 
 	return ms;
 }
+
+#ifdef PGXC
+/*
+ * Returns the end of WAL on the primary, as read there after this call was
+ * made, so that every transaction committed on the primary before now ends
+ * below it.  Returns InvalidXLogRecPtr if walreceiver is not streaming, or
+ * if the answer did not come within timeout milliseconds.
+ */
+XLogRecPtr
+GetPrimaryWalEnd(int timeout)
+{
+	/* use volatile pointer to prevent code rearrangement */
+	volatile WalRcvData *walrcv = WalRcv;
+	XLogRecPtr	result = InvalidXLogRecPtr;
+	uint64		request = 0;
+	pid_t		pid;
+	TimestampTz stop;
+
+	SpinLockAcquire(&walrcv->mutex);
+	pid = walrcv->pid;
+	if (walrcv->walRcvState == WALRCV_STREAMING)
+		request = ++walrcv->walEndRequested;
+	SpinLockRelease(&walrcv->mutex);
+
+	if (request == 0 || pid == 0)
+		return InvalidXLogRecPtr;
+
+	/* Wake up walreceiver, which sends the request to the primary */
+	kill(pid, SIGUSR1);
+
+	stop = TimestampTzPlusMilliseconds(GetCurrentTimestamp(), timeout);
+	for (;;)
+	{
+		bool		answered;
+
+		SpinLockAcquire(&walrcv->mutex);
+		answered = (walrcv->walEndAnswered >= request);
+		if (answered)
+			result = walrcv->primaryWalEnd;
+		SpinLockRelease(&walrcv->mutex);
+
+		if (answered || GetCurrentTimestamp() >= stop)
+			break;
+
+		CHECK_FOR_INTERRUPTS();
+		pg_usleep(1000L);
+	}
+
+	return result;
+}
+#endif
@@ -2033,12 +2033,28 @@ pg_stat_get_wal_senders(PG_FUNCTION_ARGS)
 static void
 WalSndKeepalive(bool requestReply)
 {
+	XLogRecPtr	walEnd = sentPtr;
+
 	elog(DEBUG2, "sending replication keepalive");
 
+#ifdef PGXC
+	/*
+	 * A reply requested by the standby reports the end of WAL here, flushed
+	 * so that it gets streamed.  The standby then knows that once it has
+	 * replayed that far, it has seen every transaction committed here before
+	 * it asked, see GetPrimaryWalEnd.  A standby has no such end to report.
+	 */
+	if (!requestReply && !am_cascading_walsender && !sendTimeLineIsHistoric)
+	{
+		walEnd = GetXLogInsertEndRecPtr();
+		XLogFlush(walEnd);
+	}
+#endif
+
 	/* construct the message... */
 	resetStringInfo(&output_message);
 	pq_sendbyte(&output_message, 'k');
-	pq_sendint64(&output_message, sentPtr);
+	pq_sendint64(&output_message, walEnd);
 	pq_sendint64(&output_message, GetCurrentIntegerTimestamp());
 	pq_sendbyte(&output_message, requestReply ? 1 : 0);
 
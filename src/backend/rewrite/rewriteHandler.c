@@ -3418,7 +3418,7 @@ QueryRewriteCTAS(Query *parsetree)
 /*
  * pgxc_find_unique_index finds either primary key or unique index
  * defined for the passed relation.
- * Returns the number of columns in the primary key or unique index
+ * Returns the number of key columns in the primary key or unique index
  * ZERO means no primary key or unique index is defined.
  * The column attributes of the primary key or unique index are returned
  * in the passed indexed_col_numbers.
@@ -3470,17 +3470,18 @@ pgxc_find_unique_index(Oid relid, int16 **indexed_col_numbers)
 
 	indexStruct = (Form_pg_index) GETSTRUCT(indexUnique);
 
-	*indexed_col_numbers = palloc0(indexStruct->indnatts * sizeof(int16));
+	*indexed_col_numbers = palloc0(indexStruct->indnkeyatts * sizeof(int16));
 
 	/*
 	 * Now get the list of PK attributes from the indkey definition (we
-	 * assume a primary key cannot have expressional elements)
+	 * assume a primary key cannot have expressional elements).  Only the
+	 * key columns identify a row; INCLUDE columns of a unique index don't.
 	 */
-	for (i = 0; i < indexStruct->indnatts; i++)
+	for (i = 0; i < indexStruct->indnkeyatts; i++)
 	{
 		(*indexed_col_numbers)[i] = indexStruct->indkey.values[i];
 	}
-	return indexStruct->indnatts;
+	return indexStruct->indnkeyatts;
 }
 
 /*
@@ -1219,6 +1219,48 @@ FilePrefetch(File file, off_t offset, int amount)
 #endif
 }
 
+/*
+ * FileWriteback --- ask the kernel to start writing back dirty data in the
+ * given range of the file.
+ *
+ * This is purely a hint; it doesn't wait for the data to reach storage and
+ * failures are only logged.  It is a no-op where sync_file_range() isn't
+ * available, or if fsync is off.
+ */
+void
+FileWriteback(File file, off_t offset, off_t nbytes)
+{
+#if defined(HAVE_SYNC_FILE_RANGE)
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileWriteback: %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) nbytes));
+
+	/*
+	 * Caution: do not call sync_file_range with nbytes == 0, since that
+	 * means "to the end of the file".
+	 */
+	if (nbytes <= 0 || !enableFsync)
+		return;
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return;
+
+	returnCode = sync_file_range(VfdCache[file].fd, offset, nbytes,
+								 SYNC_FILE_RANGE_WRITE);
+	if (returnCode < 0)
+		ereport(WARNING,
+				(errcode_for_file_access(),
+				 errmsg("could not flush dirty data: %m")));
+#else
+	Assert(FileIsValid(file));
+#endif
+}
+
 int
 FileRead(File file, char *buffer, int amount)
 {
@@ -21,6 +21,8 @@
 #include "access/subtrans.h"
 #include "access/twophase.h"
 #include "commands/async.h"
+#include "commands/vacuum.h"
+#include "executor/execParallel.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #ifdef PGXC
@@ -132,6 +134,8 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 		size = add_size(size, AsyncShmemSize());
 #ifdef PGXC
 		size = add_size(size, NodeTablesShmemSize());
+		size = add_size(size, ParallelShmemSize());
+		size = add_size(size, LazyVacuumShmemSize());
 #endif
 
 #ifdef EXEC_BACKEND
@@ -246,6 +250,8 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 
 #ifdef PGXC
 	NodeTablesShmemInit();
+	ParallelShmemInit();
+	LazyVacuumShmemInit();
 #endif
 
 
@@ -90,6 +90,8 @@
 #include "pgxc/nodemgr.h"
 /* PGXC_DATANODE */
 #include "postmaster/autovacuum.h"
+#include "replication/walreceiver.h"
+#include "utils/timestamp.h"
 #endif
 
 
@@ -205,6 +207,7 @@ void UnsetGlobalSnapshotData(void);
 static bool GetPGXCSnapshotData(Snapshot snapshot);
 static bool GetSnapshotDataDataNode(Snapshot snapshot);
 static bool GetSnapshotDataCoordinator(Snapshot snapshot);
+static void WaitForGlobalSnapshotReplay(void);
 static bool resizeXip(Snapshot snapshot, int newsize);
 static bool resizeSubxip(Snapshot snapshot, int newsize);
 static void cleanSnapshot(Snapshot snapshot);
@@ -215,6 +218,12 @@ static int gxmin = InvalidTransactionId;
 static int gxmax = InvalidTransactionId;
 static int gxcnt = 0;
 static int *gxip = NULL;
+
+/* Has this hot standby replayed the commits of the global snapshot? */
+static bool gsnapshot_replayed = false;
+
+/* GUC parameter, how long a standby may wait to use a global snapshot */
+int			standby_read_timeout = 5000;
 #endif
 
 /* Primitives for KnownAssignedXids array handling for standby */
@@ -2777,6 +2786,11 @@ DisplayXidCache(void)
 void
 SetGlobalSnapshotData(int xmin, int xmax, int xcnt, int *xip)
 {
+	/* A standby has to check a new snapshot again, see GetPGXCSnapshotData */
+	if (xmin != gxmin || xmax != gxmax || xcnt != gxcnt ||
+		(xcnt > 0 && memcmp(xip, gxip, xcnt * sizeof(int)) != 0))
+		gsnapshot_replayed = false;
+
 	snapshot_source = SNAPSHOT_COORDINATOR;
 	gxmin = xmin;
 	gxmax = xmax;
@@ -2800,6 +2814,7 @@ UnsetGlobalSnapshotData(void)
 	if (gxip)
 		free(gxip);
 	gxip = NULL;
+	gsnapshot_replayed = false;
 	elog (DEBUG1, "unset snapshot info");
 }
 
@@ -2813,9 +2828,21 @@ GetPGXCSnapshotData(Snapshot snapshot)
 	/*
 	 * If this node is in recovery phase,
 	 * snapshot has to be taken directly from WAL information.
+	 * The exception is a hot standby of a Datanode reading for a Coordinator:
+	 * it uses the global snapshot it is sent, once it has replayed all the
+	 * transactions that snapshot sees as committed.
 	 */
 	if (RecoveryInProgress())
+	{
+		if (IS_PGXC_DATANODE && IsConnFromCoord() &&
+			snapshot_source == SNAPSHOT_COORDINATOR &&
+			TransactionIdIsValid(gxmin))
+		{
+			WaitForGlobalSnapshotReplay();
+			return GetSnapshotDataDataNode(snapshot);
+		}
 		return false;
+	}
 
 	/*
 	 * The typical case is that the local Coordinator passes down the snapshot to the
@@ -2863,6 +2890,49 @@ GetPGXCSnapshotData(Snapshot snapshot)
 	return false;
 }
 
+/*
+ * Wait until this hot standby has replayed every transaction committed
+ * on its primary Datanode that the global snapshot sees.
+ *
+ * Those transactions committed on the primary before they were reported
+ * to GTM, hence before the snapshot was taken and sent here.  So their
+ * commit records end below the end of WAL on the primary as it is now,
+ * which walreceiver asks for.
+ */
+static void
+WaitForGlobalSnapshotReplay(void)
+{
+	XLogRecPtr	walEnd;
+	TimestampTz stop;
+
+	if (gsnapshot_replayed)
+		return;
+
+	stop = TimestampTzPlusMilliseconds(GetCurrentTimestamp(),
+									   standby_read_timeout);
+
+	walEnd = GetPrimaryWalEnd(standby_read_timeout);
+	if (XLogRecPtrIsInvalid(walEnd))
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not get the end of WAL of the primary Datanode"),
+				 errdetail("A standby needs it to read with a global snapshot.")));
+
+	while (GetXLogReplayRecPtr(NULL) < walEnd)
+	{
+		if (GetCurrentTimestamp() >= stop)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("standby has not replayed WAL up to %X/%X within standby_read_timeout",
+							(uint32) (walEnd >> 32), (uint32) walEnd)));
+
+		CHECK_FOR_INTERRUPTS();
+		pg_usleep(1000L);
+	}
+
+	gsnapshot_replayed = true;
+}
+
 /*
  * Get snapshot data for Datanode
  * This is usually passed down from the Coordinator
@@ -98,6 +98,8 @@
 #include "pgxc/pgxcnode.h"
 #include "commands/copy.h"
 /* PGXC_DATANODE */
+#include "pgxc/planship.h"
+#include "portability/instr_time.h"
 #include "access/transam.h"
 #endif
 extern int	optind;
@@ -187,6 +189,14 @@ static bool ignore_till_sync = false;
  */
 static CachedPlanSource *unnamed_stmt_psrc = NULL;
 
+#ifdef PGXC
+/*
+ * Set by a 'j' message: the Coordinator wants the plan of the next simple
+ * query sent back so that it can ship it to other Datanodes.
+ */
+static bool plan_requested = false;
+#endif
+
 /* assorted command-line switches */
 static const char *userDoption = NULL;	/* -D switch */
 
@@ -230,6 +240,9 @@ static bool IsTransactionStmtList(List *parseTrees);
 static void drop_unnamed_stmt(void);
 static void SigHupHandler(SIGNAL_ARGS);
 static void log_disconnections(int code, Datum arg);
+#ifdef PGXC
+static void exec_shipped_plan(const char *query_string, StringInfo plan_msg);
+#endif
 
 
 #ifdef PGXC /* PGXC_DATANODE */
@@ -494,6 +507,9 @@ SocketBackend(StringInfo inBuf)
 		case 's':				/* Snapshot */
 		case 't':				/* Timestamp */
 		case 'b':				/* Barrier */
+		case 'z':				/* Compression */
+		case 'j':				/* Plan request */
+		case 'y':				/* Shipped plan */
 			break;
 #endif
 
@@ -914,6 +930,14 @@ exec_simple_query(const char *query_string)
 	bool		was_logged = false;
 	bool		isTopLevel;
 	char		msec_str[32];
+#ifdef PGXC
+	bool		send_plan = plan_requested;
+	instr_time	plan_start;
+
+	plan_requested = false;
+	if (send_plan)
+		INSTR_TIME_SET_CURRENT(plan_start);
+#endif
 
 	/*
 	 * Report query to various monitoring facilities.
@@ -1075,6 +1099,27 @@ exec_simple_query(const char *query_string)
 		CHECK_FOR_INTERRUPTS();
 
 #ifdef PGXC
+		/*
+		 * Answer a plan request of the Coordinator before running anything.
+		 * Only a lone statement with a single plan can be shipped, but the
+		 * Coordinator waits for an answer in any case.
+		 */
+		if (send_plan)
+		{
+			PlannedStmt *shipped = NULL;
+			instr_time	plan_time;
+
+			if (list_length(parsetree_list) == 1 &&
+				list_length(plantree_list) == 1 &&
+				IsA(linitial(plantree_list), PlannedStmt))
+				shipped = (PlannedStmt *) linitial(plantree_list);
+
+			INSTR_TIME_SET_CURRENT(plan_time);
+			INSTR_TIME_SUBTRACT(plan_time, plan_start);
+			pgxc_plan_send(shipped, INSTR_TIME_GET_MILLISEC(plan_time));
+			send_plan = false;
+		}
+
 		/* PGXC_DATANODE */
 		/* Force getting Xid from GTM if not autovacuum, but a vacuum or CLUSTER */
 		/* Now in the cluster command, we take GXID using BeginTranGTM(), not
@@ -1240,6 +1285,144 @@ exec_simple_query(const char *query_string)
 	debug_query_string = NULL;
 }
 
+#ifdef PGXC
+/*
+ * exec_shipped_plan
+ *
+ * Execute a 'y' message: a SELECT together with the plan another Datanode
+ * made for it.  If the plan does not fit the relations found here, the
+ * statement is planned locally as if it came in a 'Q' message.
+ */
+static void
+exec_shipped_plan(const char *query_string, StringInfo plan_msg)
+{
+	CommandDest dest = whereToSendOutput;
+	MemoryContext oldcontext;
+	PlannedStmt *plan;
+	Portal		portal;
+	DestReceiver *receiver;
+	int16		format = 0;
+	char		completionTag[COMPLETION_TAG_BUFSIZE];
+	bool		save_log_statement_stats = log_statement_stats;
+	bool		was_logged = false;
+	char		msec_str[32];
+
+	debug_query_string = query_string;
+
+	pgstat_report_activity(STATE_RUNNING, query_string);
+
+	TRACE_POSTGRESQL_QUERY_START(query_string);
+
+	if (save_log_statement_stats)
+		ResetUsage();
+
+	start_xact_command();
+	drop_unnamed_stmt();
+
+	if (IS_PGXC_DATANODE || IsConnFromCoord())
+		SetForceXidFromGTM(false);
+
+	if (IsAbortedTransactionBlockState())
+		ereport(ERROR,
+				(errcode(ERRCODE_IN_FAILED_SQL_TRANSACTION),
+				 errmsg("current transaction is aborted, "
+						"commands ignored until end of transaction block"),
+				 errdetail_abort()));
+
+	/* If we got a cancel signal prior to this command, quit */
+	CHECK_FOR_INTERRUPTS();
+
+	/*
+	 * The plan and the lookups of the relations it uses must outlive the
+	 * portal, like the plans made by exec_simple_query.
+	 */
+	oldcontext = MemoryContextSwitchTo(MessageContext);
+	PushActiveSnapshot(GetTransactionSnapshot());
+	plan = pgxc_plan_receive(plan_msg);
+	PopActiveSnapshot();
+	MemoryContextSwitchTo(oldcontext);
+
+	if (plan == NULL)
+	{
+		exec_simple_query(query_string);
+		return;
+	}
+
+	/* A shipped plan is always a plain SELECT, logged only by "all" */
+	if (log_statement == LOGSTMT_ALL)
+	{
+		ereport(LOG,
+				(errmsg("statement: %s", query_string),
+				 errhidestmt(true)));
+		was_logged = true;
+	}
+
+	set_ps_display("SELECT", false);
+
+	BeginCommand("SELECT", dest);
+
+	oldcontext = MemoryContextSwitchTo(MessageContext);
+
+	portal = CreatePortal("", true, true);
+	/* Don't display the portal in pg_cursors */
+	portal->visible = false;
+
+	PortalDefineQuery(portal,
+					  NULL,
+					  query_string,
+					  "SELECT",
+					  list_make1(plan),
+					  NULL);
+
+	PortalStart(portal, NULL, 0, InvalidSnapshot);
+
+	PortalSetResultFormat(portal, 1, &format);
+
+	receiver = CreateDestReceiver(dest);
+	if (dest == DestRemote)
+		SetRemoteDestReceiverParams(receiver, portal);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	(void) PortalRun(portal,
+					 FETCH_ALL,
+					 true,
+					 receiver,
+					 receiver,
+					 completionTag);
+
+	(*receiver->rDestroy) (receiver);
+
+	PortalDrop(portal, false);
+
+	finish_xact_command();
+
+	EndCommand(completionTag, dest);
+
+	switch (check_log_duration(msec_str, was_logged))
+	{
+		case 1:
+			ereport(LOG,
+					(errmsg("duration: %s ms", msec_str),
+					 errhidestmt(true)));
+			break;
+		case 2:
+			ereport(LOG,
+					(errmsg("duration: %s ms  statement: %s",
+							msec_str, query_string),
+					 errhidestmt(true)));
+			break;
+	}
+
+	if (save_log_statement_stats)
+		ShowUsage("QUERY STATISTICS");
+
+	TRACE_POSTGRESQL_QUERY_DONE(query_string);
+
+	debug_query_string = NULL;
+}
+#endif
+
 /*
  * exec_parse_message
  *
@@ -4225,8 +4408,17 @@ PostgresMain(int argc, char *argv[],
 		 * (6) process the command.  But ignore it if we're skipping till
 		 * Sync.
 		 */
+#ifdef PGXC
+		/*
+		 * The Coordinator waits for the answer to a compression request,
+		 * and the stream switches right after it, so never skip one.
+		 */
+		if (ignore_till_sync && firstchar != EOF && firstchar != 'z')
+			continue;
+#else
 		if (ignore_till_sync && firstchar != EOF)
 			continue;
+#endif
 
 		switch (firstchar)
 		{
@@ -4576,6 +4768,54 @@ PostgresMain(int argc, char *argv[],
 					}
 				}
 				break;
+
+			case 'z':			/* compression */
+				{
+					bool		on;
+
+					on = (pq_getmsgbyte(&input_message) != 0);
+					pq_getmsgend(&input_message);
+
+					if (on)
+					{
+						StringInfoData buf;
+						bool		accept = IsConnFromCoord();
+
+						/*
+						 * Answer uncompressed, and switch right after: the
+						 * Coordinator does the same when it reads the answer.
+						 */
+						pq_beginmessage(&buf, 'z');
+						pq_sendbyte(&buf, accept ? 1 : 0);
+						pq_endmessage(&buf);
+						if (accept)
+							pq_set_compression(true);
+						else
+							pq_flush();
+					}
+					else
+						pq_set_compression(false);
+				}
+				break;
+
+			case 'j':			/* plan request */
+				pq_getmsgend(&input_message);
+				plan_requested = true;
+				break;
+
+			case 'y':			/* shipped plan */
+				{
+					const char *query_string;
+
+					/* Set statement_timestamp() */
+					SetCurrentStatementStartTimestamp();
+
+					query_string = pq_getmsgstring(&input_message);
+					exec_shipped_plan(query_string, &input_message);
+
+					send_ready_for_query = true;
+				}
+				break;
 #endif /* PGXC */
 
 			default:
@@ -86,6 +86,7 @@ CreateQueryDesc(PlannedStmt *plannedstmt,
 	qd->params = params;		/* parameter values passed into query */
 	qd->instrument_options = instrument_options;		/* instrumentation
 														 * wanted? */
+	qd->parallel_scan = NULL;	/* not part of a parallel scan */
 
 	/* null these fields until set by ExecutorStart */
 	qd->tupDesc = NULL;
@@ -117,6 +118,7 @@ CreateUtilityQueryDesc(Node *utilitystmt,
 	qd->dest = dest;			/* output dest */
 	qd->params = params;		/* parameter values passed into query */
 	qd->instrument_options = false;		/* uninteresting for utilities */
+	qd->parallel_scan = NULL;
 
 	/* null these fields until set by ExecutorStart */
 	qd->tupDesc = NULL;
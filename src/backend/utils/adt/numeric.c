@@ -28,6 +28,7 @@
 
 #include "access/hash.h"
 #include "catalog/pg_type.h"
+#include "lib/hyperloglog.h"
 #include "libpq/pqformat.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
@@ -35,6 +36,7 @@
 #include "utils/builtins.h"
 #include "utils/int8.h"
 #include "utils/numeric.h"
+#include "utils/sortsupport.h"
 
 /* ----------
  * Uncomment the following to enable compilation of dump_numeric()
@@ -264,6 +266,34 @@ typedef struct NumericVar
  * Some preinitialized constants
  * ----------
  */
+/* ----------
+ * Sort support.
+ *
+ * The abbreviated key of a numeric is a signed integer as wide as a Datum,
+ * built from its weight and leading digits (see numeric_abbrev_convert_var),
+ * and negated so that NaN, which sorts above everything else, can be the
+ * most negative value.  Abbreviated keys therefore compare backwards.
+ * ----------
+ */
+#if SIZEOF_DATUM == 8
+#define NumericAbbrevGetDatum(X)	((Datum) SET_8_BYTES(X))
+#define DatumGetNumericAbbrev(X)	((int64) GET_8_BYTES(X))
+#define NUMERIC_ABBREV_NAN		NumericAbbrevGetDatum(-INT64CONST(0x7FFFFFFFFFFFFFFF) - 1)
+#else
+#define NumericAbbrevGetDatum(X)	((Datum) SET_4_BYTES(X))
+#define DatumGetNumericAbbrev(X)	((int32) GET_4_BYTES(X))
+#define NUMERIC_ABBREV_NAN		NumericAbbrevGetDatum(INT_MIN)
+#endif
+
+typedef struct
+{
+	void	   *buf;			/* buffer for short varlenas */
+	int64		input_count;	/* number of non-null values seen */
+	bool		estimating;		/* still estimating cardinality? */
+	hyperLogLogState abbr_card; /* cardinality of abbreviated keys */
+} NumericSortSupport;
+
+
 static NumericDigit const_zero_data[1] = {0};
 static NumericVar const_zero =
 {0, 0, NUMERIC_POS, 0, NULL, const_zero_data};
@@ -392,6 +422,13 @@ static void int8_to_numericvar(int64 val, NumericVar *var);
 static double numeric_to_double_no_overflow(Numeric num);
 static double numericvar_to_double_no_overflow(NumericVar *var);
 
+static int	numeric_fast_cmp(Datum x, Datum y, SortSupport ssup);
+static int	numeric_cmp_abbrev(Datum x, Datum y, SortSupport ssup);
+static Datum numeric_abbrev_convert(Datum original_datum, SortSupport ssup);
+static Datum numeric_abbrev_convert_var(NumericVar *var,
+						   NumericSortSupport *nss);
+static bool numeric_abbrev_abort(int memtupcount, SortSupport ssup);
+
 static int	cmp_numerics(Numeric num1, Numeric num2);
 static int	cmp_var(NumericVar *var1, NumericVar *var2);
 static int cmp_var_common(const NumericDigit *var1digits, int var1ndigits,
@@ -1331,6 +1368,295 @@ numeric_cmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(result);
 }
 
+/*
+ * Sort support for numeric
+ */
+Datum
+numeric_sortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+
+	ssup->comparator = numeric_fast_cmp;
+
+	if (ssup->abbreviate)
+	{
+		NumericSortSupport *nss;
+		MemoryContext oldcontext = MemoryContextSwitchTo(ssup->ssup_cxt);
+
+		nss = palloc(sizeof(NumericSortSupport));
+
+		/* big enough for any short varlena, with a regular header */
+		nss->buf = palloc(VARATT_SHORT_MAX + VARHDRSZ + 1);
+
+		nss->input_count = 0;
+		nss->estimating = true;
+		initHyperLogLog(&nss->abbr_card, 10);
+
+		ssup->ssup_extra = nss;
+
+		ssup->abbrev_full_comparator = ssup->comparator;
+		ssup->comparator = numeric_cmp_abbrev;
+		ssup->abbrev_converter = numeric_abbrev_convert;
+		ssup->abbrev_abort = numeric_abbrev_abort;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	PG_RETURN_VOID();
+}
+
+static int
+numeric_fast_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	Numeric		nx = DatumGetNumeric(x);
+	Numeric		ny = DatumGetNumeric(y);
+	int			result;
+
+	result = cmp_numerics(nx, ny);
+
+	/* We can't afford to leak memory here. */
+	if ((Pointer) nx != DatumGetPointer(x))
+		pfree(nx);
+	if ((Pointer) ny != DatumGetPointer(y))
+		pfree(ny);
+
+	return result;
+}
+
+static int
+numeric_cmp_abbrev(Datum x, Datum y, SortSupport ssup)
+{
+	/* backwards on purpose: the abbreviated keys are negated */
+	if (DatumGetNumericAbbrev(x) < DatumGetNumericAbbrev(y))
+		return 1;
+	if (DatumGetNumericAbbrev(x) > DatumGetNumericAbbrev(y))
+		return -1;
+	return 0;
+}
+
+static Datum
+numeric_abbrev_convert(Datum original_datum, SortSupport ssup)
+{
+	NumericSortSupport *nss = ssup->ssup_extra;
+	void	   *original_varatt = PG_DETOAST_DATUM_PACKED(original_datum);
+	Numeric		value;
+	Datum		result;
+
+	nss->input_count += 1;
+
+	/*
+	 * The Numeric macros expect a regular varlena header; copy a packed
+	 * value into our buffer instead of detoasting it into a palloc'd one.
+	 */
+	if (VARATT_IS_SHORT(original_varatt))
+	{
+		void	   *buf = nss->buf;
+		Size		sz = VARSIZE_SHORT(original_varatt) - VARHDRSZ_SHORT;
+
+		Assert(sz <= VARATT_SHORT_MAX - VARHDRSZ_SHORT);
+
+		SET_VARSIZE(buf, VARHDRSZ + sz);
+		memcpy(VARDATA(buf), VARDATA_SHORT(original_varatt), sz);
+
+		value = (Numeric) buf;
+	}
+	else
+		value = (Numeric) original_varatt;
+
+	if (NUMERIC_IS_NAN(value))
+		result = NUMERIC_ABBREV_NAN;
+	else
+	{
+		NumericVar	var;
+
+		init_var_from_num(value, &var);
+
+		result = numeric_abbrev_convert_var(&var, nss);
+	}
+
+	/* only external or compressed values were copied */
+	if ((Pointer) original_varatt != DatumGetPointer(original_datum))
+		pfree(original_varatt);
+
+	return result;
+}
+
+/*
+ * Give up abbreviation when the abbreviated keys are mostly duplicates,
+ * e.g. for values that agree in their leading digits.
+ */
+static bool
+numeric_abbrev_abort(int memtupcount, SortSupport ssup)
+{
+	NumericSortSupport *nss = ssup->ssup_extra;
+	double		abbr_card;
+
+	if (memtupcount < 10000 || nss->input_count < 10000 || !nss->estimating)
+		return false;
+
+	abbr_card = estimateHyperLogLog(&nss->abbr_card);
+
+	/*
+	 * With more than 100k distinct keys abbreviation pays off whatever the
+	 * input size; stop estimating.
+	 */
+	if (abbr_card > 100000.0)
+	{
+		nss->estimating = false;
+		return false;
+	}
+
+	/*
+	 * Ask for at least one distinct key per 10000 values: around there,
+	 * cheaper comparisons start paying for building the keys.  The 0.5
+	 * fudge factor gives up early on data with a single key in the first
+	 * 10000.
+	 */
+	if (abbr_card < nss->input_count / 10000.0 + 0.5)
+		return true;
+
+	return false;
+}
+
+/*
+ * Build the abbreviated key of a non-NaN NumericVar.
+ *
+ * The 63-bit key (on 64-bit platforms) is
+ *
+ *		0 + 7-bit weight + 4 x 14-bit digits
+ *
+ * where the weight is in NBASE digits, in excess-44 representation (offset
+ * by 44, so that the smallest representable weight is all zero bits), and
+ * the first four digits follow, padded with zeroes.  Values below 10^-176
+ * become 0, like zero itself, and values above 10^332 become the largest
+ * key; at least 13 significant decimal digits are compared.
+ *
+ * The 31-bit key (on 32-bit platforms) is
+ *
+ *		0 + 7-bit weight + 24-bit value
+ *
+ * where the weight is in decimal digits, again in excess-44, and the value
+ * holds the 7 most significant decimal digits.  Values outside 10^-44 to
+ * 10^83 are rounded off as above.
+ *
+ * Either key is then negated for a positive value, see above.
+ */
+#if SIZEOF_DATUM == 8
+
+static Datum
+numeric_abbrev_convert_var(NumericVar *var, NumericSortSupport *nss)
+{
+	int			ndigits = var->ndigits;
+	int			weight = var->weight;
+	int64		result;
+
+	if (ndigits == 0 || weight < -44)
+		result = 0;
+	else if (weight > 83)
+		result = INT64CONST(0x7FFFFFFFFFFFFFFF);
+	else
+	{
+		result = ((int64) (weight + 44) << 56);
+
+		switch (ndigits)
+		{
+			default:
+				result |= ((int64) var->digits[3]);
+				/* FALL THRU */
+			case 3:
+				result |= ((int64) var->digits[2]) << 14;
+				/* FALL THRU */
+			case 2:
+				result |= ((int64) var->digits[1]) << 28;
+				/* FALL THRU */
+			case 1:
+				result |= ((int64) var->digits[0]) << 42;
+				break;
+		}
+	}
+
+	if (var->sign == NUMERIC_POS)
+		result = -result;
+
+	if (nss->estimating)
+	{
+		uint32		tmp = ((uint32) result
+						   ^ (uint32) ((uint64) result >> 32));
+
+		addHyperLogLog(&nss->abbr_card, DatumGetUInt32(hash_uint32(tmp)));
+	}
+
+	return NumericAbbrevGetDatum(result);
+}
+
+#else							/* SIZEOF_DATUM != 8 */
+
+static Datum
+numeric_abbrev_convert_var(NumericVar *var, NumericSortSupport *nss)
+{
+	int			ndigits = var->ndigits;
+	int			weight = var->weight;
+	int32		result;
+
+	if (ndigits == 0 || weight < -11)
+		result = 0;
+	else if (weight > 20)
+		result = INT_MAX;
+	else
+	{
+		NumericDigit nxt1 = (ndigits > 1) ? var->digits[1] : 0;
+
+		weight = (weight + 11) * 4;
+
+		result = var->digits[0];
+
+		/* pack in more digits, up to 7 in all */
+		if (result > 999)
+		{
+			/* already have 4 digits, add 3 more */
+			result = (result * 1000) + (nxt1 / 10);
+			weight += 3;
+		}
+		else if (result > 99)
+		{
+			/* already have 3 digits, add 4 more */
+			result = (result * 10000) + nxt1;
+			weight += 2;
+		}
+		else if (result > 9)
+		{
+			NumericDigit nxt2 = (ndigits > 2) ? var->digits[2] : 0;
+
+			/* already have 2 digits, add 5 more */
+			result = (result * 100000) + (nxt1 * 10) + (nxt2 / 1000);
+			weight += 1;
+		}
+		else
+		{
+			NumericDigit nxt2 = (ndigits > 2) ? var->digits[2] : 0;
+
+			/* already have 1 digit, add 6 more */
+			result = (result * 1000000) + (nxt1 * 100) + (nxt2 / 100);
+		}
+
+		result = result | (weight << 24);
+	}
+
+	if (var->sign == NUMERIC_POS)
+		result = -result;
+
+	if (nss->estimating)
+	{
+		uint32		tmp = (uint32) result;
+
+		addHyperLogLog(&nss->abbr_card, DatumGetUInt32(hash_uint32(tmp)));
+	}
+
+	return NumericAbbrevGetDatum(result);
+}
+
+#endif   /* SIZEOF_DATUM == 8 */
+
 
 Datum
 numeric_eq(PG_FUNCTION_ARGS)
@@ -983,7 +983,7 @@ pg_get_indexdef_string(Oid indexrelid)
 	return pg_get_indexdef_worker(indexrelid, 0, NULL, false, true, 0);
 }
 
-/* Internal version that just reports the column definitions */
+/* Internal version that just reports the key column definitions */
 char *
 pg_get_indexdef_columns(Oid indexrelid, bool pretty)
 {
@@ -1128,6 +1128,19 @@ pg_get_indexdef_worker(Oid indexrelid, int colno,
 		Oid			keycoltype;
 		Oid			keycolcollation;
 
+		/*
+		 * The remaining columns are INCLUDE columns, which attrsOnly leaves
+		 * out.
+		 */
+		if (keyno == idxrec->indnkeyatts)
+		{
+			if (attrsOnly)
+				break;
+			if (!colno)
+				appendStringInfoString(&buf, ") INCLUDE (");
+			sep = "";
+		}
+
 		if (!colno)
 			appendStringInfoString(&buf, sep);
 		sep = ", ";
@@ -1170,7 +1183,8 @@ pg_get_indexdef_worker(Oid indexrelid, int colno,
 			keycolcollation = exprCollation(indexkey);
 		}
 
-		if (!attrsOnly && (!colno || colno == keyno + 1))
+		if (!attrsOnly && keyno < idxrec->indnkeyatts &&
+			(!colno || colno == keyno + 1))
 		{
 			Oid			indcoll;
 
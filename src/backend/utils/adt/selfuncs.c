@@ -100,6 +100,7 @@
 #include <ctype.h>
 #include <math.h>
 
+#include "access/brin.h"
 #include "access/gin.h"
 #include "access/htup_details.h"
 #include "access/sysattr.h"
@@ -4409,7 +4410,7 @@ examine_variable(PlannerInfo *root, Node *node, int varRelid,
 						 * should match has_unique_index().
 						 */
 						if (index->unique &&
-							index->ncolumns == 1 &&
+							index->nkeycolumns == 1 &&
 							(index->indpred == NIL || index->predOK))
 							vardata->isunique = true;
 
@@ -6357,13 +6358,13 @@ btcostestimate(PG_FUNCTION_ARGS)
 	}
 
 	/*
-	 * If index is unique and we found an '=' clause for each column, we can
-	 * just assume numIndexTuples = 1 and skip the expensive
+	 * If index is unique and we found an '=' clause for each key column, we
+	 * can just assume numIndexTuples = 1 and skip the expensive
 	 * clauselist_selectivity calculations.  However, a ScalarArrayOp or
 	 * NullTest invalidates that theory, even though it sets eqQualHere.
 	 */
 	if (index->unique &&
-		indexcol == index->ncolumns - 1 &&
+		indexcol == index->nkeycolumns - 1 &&
 		eqQualHere &&
 		!found_saop &&
 		!found_is_null_op)
@@ -6527,7 +6528,7 @@ btcostestimate(PG_FUNCTION_ARGS)
 			if (index->reverse_sort[0])
 				varCorrelation = -varCorrelation;
 
-			if (index->ncolumns > 1)
+			if (index->nkeycolumns > 1)
 				costs.indexCorrelation = varCorrelation * 0.75;
 			else
 				costs.indexCorrelation = varCorrelation;
@@ -7320,3 +7321,134 @@ gincostestimate(PG_FUNCTION_ARGS)
 
 	PG_RETURN_VOID();
 }
+
+/*
+ * BRIN indexes are always read in full, and return whole block ranges
+ */
+Datum
+brincostestimate(PG_FUNCTION_ARGS)
+{
+	PlannerInfo *root = (PlannerInfo *) PG_GETARG_POINTER(0);
+	IndexPath  *path = (IndexPath *) PG_GETARG_POINTER(1);
+	double		loop_count = PG_GETARG_FLOAT8(2);
+	Cost	   *indexStartupCost = (Cost *) PG_GETARG_POINTER(3);
+	Cost	   *indexTotalCost = (Cost *) PG_GETARG_POINTER(4);
+	Selectivity *indexSelectivity = (Selectivity *) PG_GETARG_POINTER(5);
+	double	   *indexCorrelation = (double *) PG_GETARG_POINTER(6);
+	IndexOptInfo *index = path->indexinfo;
+	List	   *indexQuals = path->indexquals;
+	double		numPages = index->pages;
+	double		heapPages = index->rel->pages;
+	double		numRanges;
+	double		correlation = 0.0;
+	Selectivity selec;
+	Relation	indexRel;
+	BlockNumber pagesPerRange;
+	QualCost	index_qual_cost;
+	double		qual_arg_cost;
+	double		qual_op_cost;
+	double		spc_seq_page_cost;
+
+	indexRel = index_open(index->indexoid, AccessShareLock);
+	pagesPerRange = BrinGetPagesPerRange(indexRel);
+	index_close(indexRel, AccessShareLock);
+
+	numRanges = Max(ceil(heapPages / pagesPerRange), 1.0);
+
+	/*
+	 * The whole index is read sequentially before the first heap page is
+	 * returned.
+	 */
+	get_tablespace_page_costs(index->reltablespace,
+							  NULL,
+							  &spc_seq_page_cost);
+	*indexStartupCost = spc_seq_page_cost * numPages * loop_count;
+
+	/*
+	 * How many heap pages are returned depends on how well the ranges
+	 * separate the values, which we judge by the physical correlation of the
+	 * first column: with no correlation, every range will probably contain
+	 * some matching value.  Also, at least one whole range is returned
+	 * whenever anything matches.
+	 */
+	if (index->indexkeys[0] != 0)
+	{
+		RangeTblEntry *rte = planner_rt_fetch(index->rel->relid, root);
+		VariableStatData vardata;
+
+		MemSet(&vardata, 0, sizeof(vardata));
+		if (get_relation_stats_hook &&
+			(*get_relation_stats_hook) (root, rte, index->indexkeys[0],
+										&vardata))
+		{
+			if (HeapTupleIsValid(vardata.statsTuple) &&
+				!vardata.freefunc)
+				elog(ERROR, "no function provided to release variable stats with");
+		}
+		else
+		{
+			vardata.statsTuple = SearchSysCache3(STATRELATTINH,
+												 ObjectIdGetDatum(rte->relid),
+											Int16GetDatum(index->indexkeys[0]),
+												 BoolGetDatum(rte->inh));
+			vardata.freefunc = ReleaseSysCache;
+		}
+
+		if (HeapTupleIsValid(vardata.statsTuple))
+		{
+			Oid			sortop;
+			float4	   *numbers;
+			int			nnumbers;
+
+			sortop = get_opfamily_member(index->opfamily[0],
+										 index->opcintype[0],
+										 index->opcintype[0],
+										 BTLessStrategyNumber);
+			if (OidIsValid(sortop) &&
+				get_attstatsslot(vardata.statsTuple, InvalidOid, 0,
+								 STATISTIC_KIND_CORRELATION,
+								 sortop,
+								 NULL,
+								 NULL, NULL,
+								 &numbers, &nnumbers))
+			{
+				Assert(nnumbers == 1);
+				correlation = fabs(numbers[0]);
+				free_attstatsslot(InvalidOid, NULL, 0, numbers, nnumbers);
+			}
+		}
+
+		ReleaseVariableStats(vardata);
+	}
+
+	selec = clauselist_selectivity(root, indexQuals,
+								   index->rel->relid,
+								   JOIN_INNER,
+								   NULL);
+	selec += (1.0 - correlation) * (1.0 - selec);
+	if (selec > 0)
+		selec += 1.0 / numRanges;
+	CLAMP_PROBABILITY(selec);
+	*indexSelectivity = selec;
+
+	/* the bitmap is lossy, so the heap scan sees no useful ordering */
+	*indexCorrelation = 0.0;
+
+	/*
+	 * Add on index qual eval costs, much as in genericcostestimate; the
+	 * operators are applied once per range rather than per tuple.
+	 */
+	cost_qual_eval(&index_qual_cost, indexQuals, root);
+	qual_arg_cost = index_qual_cost.startup + index_qual_cost.per_tuple;
+	qual_op_cost = cpu_operator_cost * list_length(indexQuals);
+	qual_arg_cost -= qual_op_cost;
+	if (qual_arg_cost < 0)		/* just in case... */
+		qual_arg_cost = 0;
+
+	*indexStartupCost += qual_arg_cost;
+	*indexStartupCost += numRanges * loop_count *
+		(cpu_index_tuple_cost + qual_op_cost);
+	*indexTotalCost = *indexStartupCost;
+
+	PG_RETURN_VOID();
+}
@@ -14,8 +14,10 @@
 #include "postgres.h"
 
 #include "access/hash.h"
+#include "lib/hyperloglog.h"
 #include "libpq/pqformat.h"
 #include "utils/builtins.h"
+#include "utils/sortsupport.h"
 #include "utils/uuid.h"
 
 /* uuid size in bytes */
@@ -27,8 +29,19 @@ struct pg_uuid_t
 	unsigned char data[UUID_LEN];
 };
 
+/* working state of uuid sort support with abbreviated keys */
+typedef struct
+{
+	int64		input_count;	/* number of non-null values seen */
+	bool		estimating;		/* still estimating cardinality? */
+	hyperLogLogState abbr_card; /* cardinality of abbreviated keys */
+} uuid_sortsupport_state;
+
 static void string_to_uuid(const char *source, pg_uuid_t *uuid);
 static int	uuid_internal_cmp(const pg_uuid_t *arg1, const pg_uuid_t *arg2);
+static int	uuid_fast_cmp(Datum x, Datum y, SortSupport ssup);
+static Datum uuid_abbrev_convert(Datum original, SortSupport ssup);
+static bool uuid_abbrev_abort(int memtupcount, SortSupport ssup);
 
 Datum
 uuid_in(PG_FUNCTION_ARGS)
@@ -222,6 +235,109 @@ uuid_cmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(uuid_internal_cmp(arg1, arg2));
 }
 
+/*
+ * Sort support for uuid.  The abbreviated key is the first sizeof(Datum)
+ * bytes of the value, which tell apart nearly all random uuids.
+ */
+Datum
+uuid_sortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+
+	ssup->comparator = uuid_fast_cmp;
+
+	if (ssup->abbreviate)
+	{
+		uuid_sortsupport_state *uss;
+		MemoryContext oldcontext;
+
+		oldcontext = MemoryContextSwitchTo(ssup->ssup_cxt);
+
+		uss = palloc(sizeof(uuid_sortsupport_state));
+		uss->input_count = 0;
+		uss->estimating = true;
+		initHyperLogLog(&uss->abbr_card, 10);
+
+		ssup->ssup_extra = uss;
+
+		ssup->abbrev_full_comparator = uuid_fast_cmp;
+		ssup->comparator = AbbrevKeyUnsignedCmp;
+		ssup->abbrev_converter = uuid_abbrev_convert;
+		ssup->abbrev_abort = uuid_abbrev_abort;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	PG_RETURN_VOID();
+}
+
+static int
+uuid_fast_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	return uuid_internal_cmp(DatumGetUUIDP(x), DatumGetUUIDP(y));
+}
+
+static Datum
+uuid_abbrev_convert(Datum original, SortSupport ssup)
+{
+	uuid_sortsupport_state *uss = ssup->ssup_extra;
+	pg_uuid_t  *authoritative = DatumGetUUIDP(original);
+	Datum		res;
+
+	res = AbbrevKeyFromBytes((char *) authoritative->data, UUID_LEN);
+	uss->input_count += 1;
+
+	if (uss->estimating)
+	{
+		uint32		tmp;
+
+#if SIZEOF_DATUM == 8
+		tmp = (uint32) res ^ (uint32) ((uint64) res >> 32);
+#else
+		tmp = (uint32) res;
+#endif
+
+		addHyperLogLog(&uss->abbr_card, DatumGetUInt32(hash_uint32(tmp)));
+	}
+
+	return res;
+}
+
+/*
+ * Give up abbreviation when the abbreviated keys are mostly duplicates,
+ * which happens only with uuids generated in some non-random way.
+ */
+static bool
+uuid_abbrev_abort(int memtupcount, SortSupport ssup)
+{
+	uuid_sortsupport_state *uss = ssup->ssup_extra;
+	double		abbr_card;
+
+	if (memtupcount < 10000 || uss->input_count < 10000 || !uss->estimating)
+		return false;
+
+	abbr_card = estimateHyperLogLog(&uss->abbr_card);
+
+	/*
+	 * With more than 100k distinct keys abbreviation pays off whatever the
+	 * input size; stop estimating.
+	 */
+	if (abbr_card > 100000.0)
+	{
+		uss->estimating = false;
+		return false;
+	}
+
+	/*
+	 * Ask for at least one distinct key per 2000 values.  The 0.5 fudge
+	 * factor gives up early on data with a single key in the first 2000.
+	 */
+	if (abbr_card < uss->input_count / 2000.0 + 0.5)
+		return true;
+
+	return false;
+}
+
 /* hash index support */
 Datum
 uuid_hash(PG_FUNCTION_ARGS)
@@ -17,9 +17,11 @@
 #include <ctype.h>
 #include <limits.h>
 
+#include "access/hash.h"
 #include "access/tuptoaster.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_type.h"
+#include "lib/hyperloglog.h"
 #include "libpq/md5.h"
 #include "libpq/pqformat.h"
 #include "miscadmin.h"
@@ -28,7 +30,9 @@
 #include "utils/builtins.h"
 #include "utils/bytea.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/pg_locale.h"
+#include "utils/sortsupport.h"
 
 
 /* GUC variable */
@@ -50,6 +54,28 @@ typedef struct
 	int			skiptable[256]; /* skip distance for given mismatched char */
 } TextPositionState;
 
+/*
+ * Working state of text sort support.  The buffers hold NUL-terminated
+ * copies of the strings compared by strcoll().
+ */
+typedef struct
+{
+	char	   *buf1;
+	char	   *buf2;
+	int			buflen1;
+	int			buflen2;
+#ifdef HAVE_LOCALE_T
+	pg_locale_t locale;			/* locale of a non-default collation */
+#endif
+	hyperLogLogState abbr_card; /* cardinality of abbreviated keys */
+	hyperLogLogState full_card; /* cardinality of original strings */
+	double		prop_card;		/* required abbr_card / full_card */
+} TextSortSupport;
+
+#define TEXTBUFLEN		1024
+/* Only this many leading bytes of a string are hashed for full_card */
+#define TEXT_HASH_PREFIX	64
+
 #define DatumGetUnknownP(X)			((unknown *) PG_DETOAST_DATUM(X))
 #define DatumGetUnknownPCopy(X)		((unknown *) PG_DETOAST_DATUM_COPY(X))
 #define PG_GETARG_UNKNOWN_P(n)		DatumGetUnknownP(PG_GETARG_DATUM(n))
@@ -68,6 +94,13 @@ static void text_position_setup(text *t1, text *t2, TextPositionState *state);
 static int	text_position_next(int start_pos, TextPositionState *state);
 static void text_position_cleanup(TextPositionState *state);
 static int	text_cmp(text *arg1, text *arg2, Oid collid);
+static int	bttextfastcmp_c(Datum x, Datum y, SortSupport ssup);
+static int	bttextfastcmp_locale(Datum x, Datum y, SortSupport ssup);
+#ifdef WIN32
+static int	bttextfastcmp_varstr(Datum x, Datum y, SortSupport ssup);
+#endif
+static Datum bttext_abbrev_convert(Datum original, SortSupport ssup);
+static bool bttext_abbrev_abort(int memtupcount, SortSupport ssup);
 static bytea *bytea_catenate(bytea *t1, bytea *t2);
 static bytea *bytea_substring(Datum str,
 				int S,
@@ -1683,6 +1716,307 @@ bttextcmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(result);
 }
 
+/*
+ * Sort support for text.
+ *
+ * The comparators avoid the fmgr overhead and the per-call palloc of
+ * varstr_cmp().  Under the "C" collation, when the caller allows it, the
+ * leading bytes of each string are also packed into an abbreviated key, so
+ * that most comparisons made by a sort never look at the strings themselves.
+ *
+ * Other collations are not abbreviated.  Their keys would have to come from
+ * strxfrm(), and some C libraries have strxfrm() images that do not sort the
+ * way strcoll() does; a btree built with such keys would be out of order for
+ * the searches made with strcoll() afterwards.
+ */
+Datum
+bttextsortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+	Oid			collid = ssup->ssup_collation;
+	MemoryContext oldcontext;
+	TextSortSupport *tss;
+	bool		collate_c;
+
+	oldcontext = MemoryContextSwitchTo(ssup->ssup_cxt);
+
+	collate_c = lc_collate_is_c(collid);
+
+#ifdef WIN32
+
+	/*
+	 * Win32 compares UTF-8 strings through UTF-16 and wcscoll(), which
+	 * bttextfastcmp_locale() doesn't know about; stick to varstr_cmp().
+	 */
+	if (!collate_c && GetDatabaseEncoding() == PG_UTF8)
+	{
+		ssup->comparator = bttextfastcmp_varstr;
+		MemoryContextSwitchTo(oldcontext);
+		PG_RETURN_VOID();
+	}
+#endif
+
+	tss = palloc0(sizeof(TextSortSupport));
+
+	if (collate_c)
+		ssup->comparator = bttextfastcmp_c;
+	else
+	{
+		if (collid != DEFAULT_COLLATION_OID)
+		{
+			if (!OidIsValid(collid))
+				ereport(ERROR,
+						(errcode(ERRCODE_INDETERMINATE_COLLATION),
+						 errmsg("could not determine which collation to use for string comparison"),
+						 errhint("Use the COLLATE clause to set the collation explicitly.")));
+#ifdef HAVE_LOCALE_T
+			tss->locale = pg_newlocale_from_collation(collid);
+#endif
+		}
+
+		tss->buf1 = palloc(TEXTBUFLEN);
+		tss->buflen1 = TEXTBUFLEN;
+		tss->buf2 = palloc(TEXTBUFLEN);
+		tss->buflen2 = TEXTBUFLEN;
+		ssup->comparator = bttextfastcmp_locale;
+	}
+
+	if (ssup->abbreviate && collate_c)
+	{
+		initHyperLogLog(&tss->abbr_card, 10);
+		initHyperLogLog(&tss->full_card, 10);
+		tss->prop_card = 0.20;
+
+		ssup->abbrev_full_comparator = ssup->comparator;
+		ssup->comparator = AbbrevKeyUnsignedCmp;
+		ssup->abbrev_converter = bttext_abbrev_convert;
+		ssup->abbrev_abort = bttext_abbrev_abort;
+	}
+
+	ssup->ssup_extra = tss;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Make sure a TextSortSupport buffer can hold len bytes plus a terminator.
+ * Buffer contents are not preserved.
+ */
+static void
+bttext_grow_buffer(SortSupport ssup, char **buf, int *buflen, Size len)
+{
+	if (len < *buflen)
+		return;
+
+	pfree(*buf);
+	*buflen = Max(len + 1, Min((Size) *buflen * 2, MaxAllocSize));
+	*buf = MemoryContextAlloc(ssup->ssup_cxt, *buflen);
+}
+
+/*
+ * sortsupport comparator for text under the "C" collation
+ */
+static int
+bttextfastcmp_c(Datum x, Datum y, SortSupport ssup)
+{
+	text	   *arg1 = DatumGetTextPP(x);
+	text	   *arg2 = DatumGetTextPP(y);
+	int			len1,
+				len2;
+	int			result;
+
+	len1 = VARSIZE_ANY_EXHDR(arg1);
+	len2 = VARSIZE_ANY_EXHDR(arg2);
+
+	result = memcmp(VARDATA_ANY(arg1), VARDATA_ANY(arg2), Min(len1, len2));
+	if ((result == 0) && (len1 != len2))
+		result = (len1 < len2) ? -1 : 1;
+
+	/* We can't afford to leak memory here. */
+	if (PointerGetDatum(arg1) != x)
+		pfree(arg1);
+	if (PointerGetDatum(arg2) != y)
+		pfree(arg2);
+
+	return result;
+}
+
+/*
+ * sortsupport comparator for text under any other collation; same as
+ * varstr_cmp(), but with buffers kept across calls
+ */
+static int
+bttextfastcmp_locale(Datum x, Datum y, SortSupport ssup)
+{
+	text	   *arg1 = DatumGetTextPP(x);
+	text	   *arg2 = DatumGetTextPP(y);
+	TextSortSupport *tss = (TextSortSupport *) ssup->ssup_extra;
+	char	   *a1p,
+			   *a2p;
+	int			len1,
+				len2;
+	int			result;
+
+	a1p = VARDATA_ANY(arg1);
+	a2p = VARDATA_ANY(arg2);
+
+	len1 = VARSIZE_ANY_EXHDR(arg1);
+	len2 = VARSIZE_ANY_EXHDR(arg2);
+
+	/*
+	 * Identical strings are equal under any collation.  This is worth
+	 * checking since ties between abbreviated keys often come from
+	 * duplicates.
+	 */
+	if (len1 == len2 && memcmp(a1p, a2p, len1) == 0)
+	{
+		result = 0;
+		goto done;
+	}
+
+	bttext_grow_buffer(ssup, &tss->buf1, &tss->buflen1, len1);
+	bttext_grow_buffer(ssup, &tss->buf2, &tss->buflen2, len2);
+
+	memcpy(tss->buf1, a1p, len1);
+	tss->buf1[len1] = '\0';
+	memcpy(tss->buf2, a2p, len2);
+	tss->buf2[len2] = '\0';
+
+#ifdef HAVE_LOCALE_T
+	if (tss->locale)
+		result = strcoll_l(tss->buf1, tss->buf2, tss->locale);
+	else
+#endif
+		result = strcoll(tss->buf1, tss->buf2);
+
+	/* break strcoll() ties the way varstr_cmp() does */
+	if (result == 0)
+		result = strcmp(tss->buf1, tss->buf2);
+
+done:
+	/* We can't afford to leak memory here. */
+	if (PointerGetDatum(arg1) != x)
+		pfree(arg1);
+	if (PointerGetDatum(arg2) != y)
+		pfree(arg2);
+
+	return result;
+}
+
+#ifdef WIN32
+/*
+ * sortsupport comparator for text that just calls varstr_cmp()
+ */
+static int
+bttextfastcmp_varstr(Datum x, Datum y, SortSupport ssup)
+{
+	text	   *arg1 = DatumGetTextPP(x);
+	text	   *arg2 = DatumGetTextPP(y);
+	int			result;
+
+	result = text_cmp(arg1, arg2, ssup->ssup_collation);
+
+	/* We can't afford to leak memory here. */
+	if (PointerGetDatum(arg1) != x)
+		pfree(arg1);
+	if (PointerGetDatum(arg2) != y)
+		pfree(arg2);
+
+	return result;
+}
+#endif   /* WIN32 */
+
+/*
+ * Abbreviated key conversion for text under the "C" collation.
+ *
+ * The key is made of the first sizeof(Datum) bytes of the string.  Missing
+ * bytes are zeroes, so a shorter string sorts first, as it should.  Keys of
+ * strings that agree in those bytes compare equal, and are resolved by the
+ * full comparator.
+ */
+static Datum
+bttext_abbrev_convert(Datum original, SortSupport ssup)
+{
+	TextSortSupport *tss = (TextSortSupport *) ssup->ssup_extra;
+	text	   *authoritative = DatumGetTextPP(original);
+	char	   *authoritative_data = VARDATA_ANY(authoritative);
+	int			len = VARSIZE_ANY_EXHDR(authoritative);
+	Datum		res;
+	uint32		hash;
+
+	res = AbbrevKeyFromBytes(authoritative_data, len);
+
+	/*
+	 * Keep track of the number of distinct original strings and abbreviated
+	 * keys for bttext_abbrev_abort().  Only a prefix of long strings is
+	 * hashed, with the length mixed in, to keep this cheap.
+	 */
+	hash = DatumGetUInt32(hash_any((unsigned char *) authoritative_data,
+								   Min(len, TEXT_HASH_PREFIX)));
+	if (len > TEXT_HASH_PREFIX)
+		hash ^= DatumGetUInt32(hash_uint32((uint32) len));
+	addHyperLogLog(&tss->full_card, hash);
+
+#if SIZEOF_DATUM == 8
+	hash = DatumGetUInt32(hash_uint32((uint32) res ^ (uint32) (res >> 32)));
+#else
+	hash = DatumGetUInt32(hash_uint32((uint32) res));
+#endif
+	addHyperLogLog(&tss->abbr_card, hash);
+
+	/* We can't afford to leak memory here. */
+	if (PointerGetDatum(authoritative) != original)
+		pfree(authoritative);
+
+	return res;
+}
+
+/*
+ * Decide whether text abbreviation is worth going on with.
+ *
+ * Abbreviation pays off as long as the abbreviated keys tell apart a good
+ * share of the distinct strings; otherwise most comparisons end up looking
+ * at the strings anyway, after the cost of building the keys has been paid.
+ */
+static bool
+bttext_abbrev_abort(int memtupcount, SortSupport ssup)
+{
+	TextSortSupport *tss = (TextSortSupport *) ssup->ssup_extra;
+	double		abbrev_distinct,
+				key_distinct;
+
+	/* Have a little patience */
+	if (memtupcount < 100)
+		return false;
+
+	abbrev_distinct = estimateHyperLogLog(&tss->abbr_card);
+	key_distinct = estimateHyperLogLog(&tss->full_card);
+
+	/* NULLs are not counted; don't let an all-NULL start mislead us */
+	if (abbrev_distinct <= 1.0)
+		abbrev_distinct = 1.0;
+	if (key_distinct <= 1.0)
+		key_distinct = 1.0;
+
+	if (abbrev_distinct > key_distinct * tss->prop_card)
+	{
+		/*
+		 * Past 10000 tuples the n log n comparisons dominate the linear cost
+		 * of building the keys, so ask for a little less from then on.  The
+		 * decay is slower than the doubling of memtupcount between calls, so
+		 * a sudden drop in abbreviated cardinality is still noticed.
+		 */
+		if (memtupcount > 10000)
+			tss->prop_card *= 0.65;
+
+		return false;
+	}
+
+	return true;
+}
+
 
 Datum
 text_larger(PG_FUNCTION_ARGS)
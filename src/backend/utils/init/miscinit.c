@@ -31,6 +31,9 @@
 
 #include "access/htup_details.h"
 #include "catalog/pg_authid.h"
+#ifdef PGXC
+#include "executor/execParallel.h"
+#endif
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "postmaster/autovacuum.h"
@@ -1310,6 +1313,10 @@ process_shared_preload_libraries(void)
 	load_libraries(shared_preload_libraries_string,
 				   "shared_preload_libraries",
 				   false);
+#ifdef PGXC
+	/* parallel scan workers get registered just like those of libraries */
+	RegisterParallelWorkers();
+#endif
 	process_shared_preload_libraries_in_progress = false;
 }
 
@@ -27,11 +27,14 @@
 #include <syslog.h>
 #endif
 
+#include "access/clog.h"
 #include "access/gin.h"
 #ifdef PGXC
 #include "access/gtm.h"
 #include "pgxc/pgxc.h"
 #endif
+#include "access/slru.h"
+#include "access/subtrans.h"
 #include "access/transam.h"
 #include "access/twophase.h"
 #include "access/xact.h"
@@ -58,6 +61,7 @@
 #include "pgstat.h"
 #ifdef PGXC
 #include "commands/tablecmds.h"
+#include "executor/execParallel.h"
 #include "nodes/nodes.h"
 #include "optimizer/pgxcship.h"
 #include "pgxc/execRemote.h"
@@ -66,6 +70,7 @@
 #include "pgxc/poolmgr.h"
 #include "pgxc/nodemgr.h"
 #include "pgxc/pgxcnode.h"
+#include "pgxc/planship.h"
 #include "pgxc/xc_maintenance_mode.h"
 #include "pgxc/xc_gtm_commit_sync.h"
 #endif
@@ -82,6 +87,7 @@
 #include "storage/standby.h"
 #include "storage/fd.h"
 #include "storage/proc.h"
+#include "storage/procarray.h"
 #include "storage/predicate.h"
 #include "tcop/tcopprot.h"
 #include "tsearch/ts_cache.h"
@@ -190,6 +196,7 @@ static void assign_syslog_facility(int newval, void *extra);
 static void assign_syslog_ident(const char *newval, void *extra);
 static void assign_session_replication_role(int newval, void *extra);
 static bool check_temp_buffers(int *newval, void **extra, GucSource source);
+static bool check_slru_buffers(int *newval, void **extra, GucSource source);
 static bool check_phony_autocommit(bool *newval, void **extra, GucSource source);
 static bool check_debug_assertions(bool *newval, void **extra, GucSource source);
 static bool check_bonjour(bool *newval, void **extra, GucSource source);
@@ -198,6 +205,7 @@ static bool check_stage_log_stats(bool *newval, void **extra, GucSource source);
 static bool check_log_stats(bool *newval, void **extra, GucSource source);
 #ifdef PGXC
 static bool check_pgxc_maintenance_mode(bool *newval, void **extra, GucSource source);
+static bool check_pgxcnode_compression(char **newval, void **extra, GucSource source);
 #endif
 static bool check_canonical_path(char **newval, void **extra, GucSource source);
 static bool check_timezone_abbreviations(char **newval, void **extra, GucSource source);
@@ -848,6 +856,24 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_remotebloomfilter", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables pushing Bloom filters built by hash joins down to remote scans."),
+			NULL
+		},
+		&enable_remotebloomfilter,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_plan_shipping", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables running a plan made by one Datanode on the others."),
+			NULL
+		},
+		&enable_plan_shipping,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"gtm_backup_barrier", PGC_SUSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables coordinator to report barrier id to GTM for backup."),
@@ -1564,6 +1590,16 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"pgxcnode_standby_reads", PGC_USERSET, DATA_NODES,
+			gettext_noop("Sends read-only transactions to Datanode hot standbys."),
+			gettext_noop("Applies to the Datanodes having a standby declared "
+						 "with CREATE NODE ... STANDBY_OF.")
+		},
+		&pgxcnode_standby_reads,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"xc_maintenance_mode", PGC_SUSET, XC_HOUSEKEEPING_OPTIONS,
 		    gettext_noop("Turn on XC maintenance mode."),
@@ -1799,6 +1835,29 @@ static struct config_int ConfigureNamesInt[] =
 		check_temp_buffers, NULL, NULL
 	},
 
+	{
+		{"clog_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of buffers used for the commit log."),
+			gettext_noop("Must be a multiple of 16. "
+						 "0 sizes it from shared_buffers."),
+			GUC_UNIT_BLOCKS
+		},
+		&clog_buffers,
+		0, 0, 131072,
+		check_slru_buffers, NULL, NULL
+	},
+
+	{
+		{"subtrans_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of buffers used for the subtransaction log."),
+			gettext_noop("Must be a multiple of 16."),
+			GUC_UNIT_BLOCKS
+		},
+		&subtrans_buffers,
+		32, 16, 131072,
+		check_slru_buffers, NULL, NULL
+	},
+
 	{
 		{"port", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
 			gettext_noop("Sets the TCP port the server listens on."),
@@ -2159,6 +2218,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"checkpoint_flush_after", PGC_SIGHUP, WAL_CHECKPOINTS,
+			gettext_noop("Number of pages after which previously performed writes are flushed to disk."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&checkpoint_flush_after,
+		DEFAULT_CHECKPOINT_FLUSH_AFTER, 0, WRITEBACK_MAX_PENDING_FLUSHES,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_buffers", PGC_POSTMASTER, WAL_SETTINGS,
 			gettext_noop("Sets the number of disk-page buffers in shared memory for WAL."),
@@ -2639,6 +2709,79 @@ static struct config_int ConfigureNamesInt[] =
 		2000, 0, INT_MAX,
 		NULL, NULL, NULL
 	},
+	{
+		{"standby_read_timeout", PGC_USERSET, REPLICATION_STANDBY,
+			gettext_noop("Sets the maximum time a hot standby waits to catch up "
+						 "with a snapshot received from a Coordinator."),
+			NULL,
+			GUC_UNIT_MS
+		},
+		&standby_read_timeout,
+		5000, 1, INT_MAX,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"max_parallel_scan_workers", PGC_POSTMASTER, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Sets the number of parallel scan workers started on a Datanode."),
+			NULL
+		},
+		&max_parallel_scan_workers,
+		0, 0, 256,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"parallel_scan_degree", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the number of parallel scan workers a sequential scan may use."),
+			gettext_noop("Zero disables parallel scans.")
+		},
+		&parallel_scan_degree,
+		0, 0, 256,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"parallel_scan_min_size", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the minimum size of a relation scanned in parallel."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&parallel_scan_min_size,
+		1024, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"parallel_vacuum_workers", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Sets the number of parallel workers VACUUM may use to vacuum the indexes of a table."),
+			gettext_noop("Zero vacuums indexes one after the other.")
+		},
+		&parallel_vacuum_workers,
+		0, 0, 256,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"autovacuum_parallel_vacuum_workers", PGC_SIGHUP, AUTOVACUUM,
+			gettext_noop("Sets the number of parallel workers autovacuum may use to vacuum the indexes of a table."),
+			gettext_noop("-1 means use parallel_vacuum_workers.")
+		},
+		&autovacuum_parallel_vacuum_workers,
+		-1, -1, 256,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"parallel_vacuum_mem", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the shared memory reserved for the dead tuples of a parallel index vacuum."),
+			NULL,
+			GUC_UNIT_KB
+		},
+		&parallel_vacuum_mem,
+		16384, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
 #endif
 	/* End-of-list marker */
 	{
@@ -3326,6 +3469,18 @@ static struct config_string ConfigureNamesString[] =
 		"",
 		NULL, NULL, NULL
 	},
+
+	{
+		{"pgxcnode_compression", PGC_USERSET, DATA_NODES,
+			gettext_noop("Sets the nodes the traffic with is compressed."),
+			gettext_noop("A comma-separated list of node names, or * for all "
+						 "nodes. Applies to connections obtained afterwards."),
+			GUC_LIST_INPUT | GUC_LIST_QUOTE
+		},
+		&pgxcnode_compression,
+		"",
+		check_pgxcnode_compression, NULL, NULL
+	},
 #endif
 	{
 		{"ssl_ciphers", PGC_POSTMASTER, CONN_AUTH_SECURITY,
@@ -8743,6 +8898,19 @@ check_temp_buffers(int *newval, void **extra, GucSource source)
 	return true;
 }
 
+static bool
+check_slru_buffers(int *newval, void **extra, GucSource source)
+{
+	/* SLRU buffers are divided into banks, which must all be the same size */
+	if (*newval % SLRU_BANK_SIZE != 0)
+	{
+		GUC_check_errdetail("The value must be a multiple of %d.",
+							SLRU_BANK_SIZE);
+		return false;
+	}
+	return true;
+}
+
 static bool
 check_phony_autocommit(bool *newval, void **extra, GucSource source)
 {
@@ -8864,6 +9032,33 @@ check_pgxc_maintenance_mode(bool *newval, void **extra, GucSource source)
 			return false;
 	}
 }
+
+static bool
+check_pgxcnode_compression(char **newval, void **extra, GucSource source)
+{
+	char	   *rawstring;
+	List	   *elemlist;
+
+	/* Need a modifiable copy of string */
+	rawstring = pstrdup(*newval);
+
+	/*
+	 * Only the syntax is checked: nodes may be added later, and names that
+	 * match no node are simply never used.
+	 */
+	if (!SplitIdentifierString(rawstring, ',', &elemlist))
+	{
+		/* syntax error in list */
+		GUC_check_errdetail("List syntax is invalid.");
+		pfree(rawstring);
+		list_free(elemlist);
+		return false;
+	}
+
+	pfree(rawstring);
+	list_free(elemlist);
+	return true;
+}
 #endif
 
 static bool
@@ -253,6 +253,7 @@ static void AllocSetReset(MemoryContext context);
 static void AllocSetDelete(MemoryContext context);
 static Size AllocSetGetChunkSpace(MemoryContext context, void *pointer);
 static bool AllocSetIsEmpty(MemoryContext context);
+static Size AllocSetMemAllocated(MemoryContext context);
 static void AllocSetStats(MemoryContext context, int level);
 
 #ifdef MEMORY_CONTEXT_CHECKING
@@ -271,6 +272,7 @@ static MemoryContextMethods AllocSetMethods = {
 	AllocSetDelete,
 	AllocSetGetChunkSpace,
 	AllocSetIsEmpty,
+	AllocSetMemAllocated,
 	AllocSetStats
 #ifdef MEMORY_CONTEXT_CHECKING
 	,AllocSetCheck
@@ -1237,6 +1239,23 @@ AllocSetIsEmpty(MemoryContext context)
 	return false;
 }
 
+/*
+ * AllocSetMemAllocated
+ *		Returns the total size of the blocks obtained by an allocset,
+ *		whether or not the space in them is currently in use.
+ */
+static Size
+AllocSetMemAllocated(MemoryContext context)
+{
+	AllocSet	set = (AllocSet) context;
+	Size		totalspace = 0;
+	AllocBlock	block;
+
+	for (block = set->blocks; block != NULL; block = block->next)
+		totalspace += block->endptr - ((char *) block);
+	return totalspace;
+}
+
 /*
  * AllocSetStats
  *		Displays stats about memory consumption of an allocset.
@@ -18,8 +18,10 @@
 /* See sortsupport.h */
 #define SORTSUPPORT_INCLUDE_DEFINITIONS
 
+#include "access/nbtree.h"
 #include "fmgr.h"
 #include "utils/lsyscache.h"
+#include "utils/rel.h"
 #include "utils/sortsupport.h"
 
 
@@ -116,3 +118,83 @@ PrepareSortSupportFromOrderingOp(Oid orderingOp, SortSupport ssup)
 		PrepareSortSupportComparisonShim(sortFunction, ssup);
 	}
 }
+
+/*
+ * Fill in SortSupport given an index relation, attribute, and strategy.
+ *
+ * Caller must previously have zeroed the SortSupportData structure and then
+ * filled in ssup_cxt, ssup_attno, ssup_collation, ssup_nulls_first and
+ * abbreviate.  This will fill in ssup_reverse (based on the supplied
+ * strategy), as well as the comparator function pointer.
+ */
+void
+PrepareSortSupportFromIndexRel(Relation indexRel, int16 strategy,
+							   SortSupport ssup)
+{
+	Oid			opfamily = indexRel->rd_opfamily[ssup->ssup_attno - 1];
+	Oid			opcintype = indexRel->rd_opcintype[ssup->ssup_attno - 1];
+	Oid			sortFunction;
+
+	if (indexRel->rd_rel->relam != BTREE_AM_OID)
+		elog(ERROR, "unexpected non-btree AM: %u", indexRel->rd_rel->relam);
+	if (strategy != BTGreaterStrategyNumber &&
+		strategy != BTLessStrategyNumber)
+		elog(ERROR, "unexpected sort support strategy: %d", strategy);
+	ssup->ssup_reverse = (strategy == BTGreaterStrategyNumber);
+
+	sortFunction = get_opfamily_proc(opfamily, opcintype, opcintype,
+									 BTSORTSUPPORT_PROC);
+	if (OidIsValid(sortFunction))
+	{
+		/* The sort support function should provide a comparator */
+		OidFunctionCall1(sortFunction, PointerGetDatum(ssup));
+		Assert(ssup->comparator != NULL);
+		return;
+	}
+
+	sortFunction = get_opfamily_proc(opfamily, opcintype, opcintype,
+									 BTORDER_PROC);
+	if (!OidIsValid(sortFunction))
+		elog(ERROR, "missing support function %d(%u,%u) in opfamily %u",
+			 BTORDER_PROC, opcintype, opcintype, opfamily);
+
+	/* We'll use a shim to call the old-style btree comparator */
+	PrepareSortSupportComparisonShim(sortFunction, ssup);
+}
+
+/*
+ * Build an abbreviated key out of the first bytes of a binary string.
+ *
+ * The bytes are packed most significant first, and missing bytes are taken
+ * as zeroes, so that AbbrevKeyUnsignedCmp orders the keys as memcmp() would
+ * order their strings, with shorter strings first.
+ */
+Datum
+AbbrevKeyFromBytes(const char *data, Size len)
+{
+	Datum		res = 0;
+	Size		i;
+
+	for (i = 0; i < sizeof(Datum); i++)
+	{
+		res <<= BITS_PER_BYTE;
+		if (i < len)
+			res |= (unsigned char) data[i];
+	}
+
+	return res;
+}
+
+/*
+ * Comparator for abbreviated keys that are compared as unsigned integers.
+ */
+int
+AbbrevKeyUnsignedCmp(Datum x, Datum y, SortSupport ssup)
+{
+	if (x > y)
+		return 1;
+	else if (x == y)
+		return 0;
+	else
+		return -1;
+}
@@ -2150,8 +2150,11 @@ dumpNodes(PGconn *conn)
 					" || ' , HOST = ' || chr(39) || node_host || chr(39)"
 					" || ', PORT = ' || node_port || (case when nodeis_primary='t'"
 					" then ', PRIMARY' else ' ' end) || (case when nodeis_preferred"
-					" then ', PREFERRED' else ' ' end) || ');' "
-					" as node_query from pg_catalog.pgxc_node order by oid");
+					" then ', PREFERRED' else ' ' end) || (case when node_type='S'"
+					" then ', STANDBY_OF = ' || chr(39) || (select m.node_name"
+					" from pg_catalog.pgxc_node m where m.oid = n.node_standby_of)"
+					" || chr(39) else ' ' end) || ');' "
+					" as node_query from pg_catalog.pgxc_node n order by oid");
 
 	res = executeQuery(conn, query->data);
 
@@ -1197,7 +1197,7 @@ psql_completion(char *text, int start, int end)
 			 pg_strcasecmp(prev_wd, "(") == 0)
 	{
 		static const char *const list_INDEXOPTIONS[] =
-		{"fillfactor", "fastupdate", NULL};
+		{"fillfactor", "fastupdate", "deduplicate_items", NULL};
 
 		COMPLETE_WITH_LIST(list_INDEXOPTIONS);
 	}
@@ -0,0 +1,65 @@
+/*-------------------------------------------------------------------------
+ *
+ * brin.h
+ *	  Public header file for the BRIN (block range) index access method.
+ *
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ * src/include/access/brin.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef BRIN_H
+#define BRIN_H
+
+#include "access/xlog.h"
+#include "fmgr.h"
+#include "storage/block.h"
+#include "utils/relcache.h"
+
+
+/* BRIN opclass support function numbers */
+#define BRIN_ORDER_PROC				1	/* btree-style three-way comparison */
+#define BRINNProcs					1
+
+/* reloption parameters */
+#define BRIN_DEFAULT_PAGES_PER_RANGE	128
+#define BRIN_MIN_PAGES_PER_RANGE		1
+#define BRIN_MAX_PAGES_PER_RANGE		131072
+
+/*
+ * Storage type for BRIN's reloptions
+ */
+typedef struct BrinOptions
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	BlockNumber pagesPerRange;
+} BrinOptions;
+
+#define BrinGetPagesPerRange(relation) \
+	((relation)->rd_options ? \
+	 ((BrinOptions *) (relation)->rd_options)->pagesPerRange : \
+	 BRIN_DEFAULT_PAGES_PER_RANGE)
+
+
+/* brin.c */
+extern Datum brinbuild(PG_FUNCTION_ARGS);
+extern Datum brinbuildempty(PG_FUNCTION_ARGS);
+extern Datum brininsert(PG_FUNCTION_ARGS);
+extern Datum brinbeginscan(PG_FUNCTION_ARGS);
+extern Datum brinrescan(PG_FUNCTION_ARGS);
+extern Datum brinendscan(PG_FUNCTION_ARGS);
+extern Datum brinmarkpos(PG_FUNCTION_ARGS);
+extern Datum brinrestrpos(PG_FUNCTION_ARGS);
+extern Datum bringetbitmap(PG_FUNCTION_ARGS);
+extern Datum brinbulkdelete(PG_FUNCTION_ARGS);
+extern Datum brinvacuumcleanup(PG_FUNCTION_ARGS);
+extern Datum brinoptions(PG_FUNCTION_ARGS);
+
+/* brin_xlog.c */
+extern void brin_redo(XLogRecPtr lsn, XLogRecord *record);
+extern void brin_desc(StringInfo buf, uint8 xl_info, char *rec);
+
+#endif   /* BRIN_H */
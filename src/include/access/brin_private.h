@@ -0,0 +1,261 @@
+/*-------------------------------------------------------------------------
+ *
+ * brin_private.h
+ *	  Private declarations for the BRIN (block range) index access method.
+ *
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ * src/include/access/brin_private.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef BRIN_PRIVATE_H
+#define BRIN_PRIVATE_H
+
+#include "access/brin.h"
+#include "access/itup.h"
+#include "access/skey.h"
+#include "storage/bufpage.h"
+#include "storage/itemptr.h"
+#include "utils/rel.h"
+
+
+/*
+ * Page layout.  Every page carries a BrinSpecialSpace identifying its type.
+ * Block 0 is the metapage.  The metapage points to directory pages, which
+ * point to revmap pages, which hold one ItemPointer per block range pointing
+ * to the range's summary tuple on a regular page.  Directory and revmap
+ * pages are allocated on demand anywhere in the relation; once set, a link
+ * from a parent page never changes.  See src/backend/access/brin/README.
+ */
+#define BRIN_METAPAGE_BLKNO		0
+
+#define BRIN_PAGETYPE_META			0xF091
+#define BRIN_PAGETYPE_DIRECTORY		0xF092
+#define BRIN_PAGETYPE_REVMAP		0xF093
+#define BRIN_PAGETYPE_REGULAR		0xF094
+
+typedef struct BrinSpecialSpace
+{
+	uint16		flags;			/* currently unused */
+	uint16		type;			/* one of BRIN_PAGETYPE_* */
+} BrinSpecialSpace;
+
+#define BrinPageGetSpecial(page) \
+	((BrinSpecialSpace *) PageGetSpecialPointer(page))
+#define BrinPageType(page)		(BrinPageGetSpecial(page)->type)
+#define BRIN_IS_REGULAR_PAGE(page) \
+	(BrinPageType(page) == BRIN_PAGETYPE_REGULAR)
+
+/* space available for the contents of a metapage, directory or revmap page */
+#define BrinPageContentSize \
+	(BLCKSZ - MAXALIGN(SizeOfPageHeaderData) - \
+	 MAXALIGN(sizeof(BrinSpecialSpace)))
+
+typedef struct BrinMetaPageData
+{
+	uint32		brinMagic;
+	uint32		brinVersion;
+	BlockNumber pagesPerRange;
+	uint32		nDirectory;		/* directory[] slots in use (incl. holes) */
+	BlockNumber directory[1];	/* VARIABLE LENGTH ARRAY */
+} BrinMetaPageData;
+
+#define BRIN_META_MAGIC			0xA8109CFA
+#define BRIN_CURRENT_VERSION	1
+
+#define BrinPageGetMeta(page) \
+	((BrinMetaPageData *) PageGetContents(page))
+#define BrinPageGetDirectory(page) \
+	((BlockNumber *) PageGetContents(page))
+#define BrinPageGetRevmap(page) \
+	((ItemPointerData *) PageGetContents(page))
+
+#define BRIN_MAX_DIRECTORY_PAGES \
+	((BrinPageContentSize - offsetof(BrinMetaPageData, directory)) / \
+	 sizeof(BlockNumber))
+#define DIRECTORY_PAGE_MAXITEMS \
+	(BrinPageContentSize / sizeof(BlockNumber))
+#define REVMAP_PAGE_MAXITEMS \
+	(BrinPageContentSize / sizeof(ItemPointerData))
+
+/* Largest summary tuple that fits on an otherwise empty regular page */
+#define BrinMaxItemSize \
+	MAXALIGN_DOWN(BLCKSZ - \
+				  (MAXALIGN(SizeOfPageHeaderData + sizeof(ItemIdData)) + \
+				   MAXALIGN(sizeof(BrinSpecialSpace))))
+
+/*
+ * On-disk summary tuple.  bt_colflags holds BRIN_COL_* bits for each index
+ * column; the min and max values of all columns follow as an IndexTuple
+ * with 2 * natts attributes, starting at BrinTupleDataOffset.
+ */
+typedef struct BrinTuple
+{
+	BlockNumber bt_blkno;		/* first heap block of the range */
+	uint8		bt_info;		/* BRIN_PLACEHOLDER, or 0 */
+	uint8		bt_colflags[1];	/* VARIABLE LENGTH ARRAY */
+} BrinTuple;
+
+#define BRIN_PLACEHOLDER		0x01
+
+#define BRIN_COL_ALLNULLS		0x01
+#define BRIN_COL_HASNULLS		0x02
+
+#define BrinTupleDataOffset(natts) \
+	MAXALIGN(offsetof(BrinTuple, bt_colflags) + (natts))
+#define BrinTupleGetIndexTuple(tup, natts) \
+	((IndexTuple) ((char *) (tup) + BrinTupleDataOffset(natts)))
+#define BrinTupleIsPlaceholder(tup) \
+	(((tup)->bt_info & BRIN_PLACEHOLDER) != 0)
+
+/*
+ * In-memory (deformed) summary of one block range.  allnulls means that the
+ * range holds no non-null value of the column, in which case min and max are
+ * not set; hasnulls means that it holds at least one null.
+ */
+typedef struct BrinValues
+{
+	bool		allnulls;
+	bool		hasnulls;
+	Datum		min;
+	Datum		max;
+} BrinValues;
+
+typedef struct BrinMemTuple
+{
+	BlockNumber bt_blkno;
+	bool		bt_placeholder;
+	BrinValues	bt_columns[1];	/* VARIABLE LENGTH ARRAY */
+} BrinMemTuple;
+
+/*
+ * Working state for an index: its descriptor, the descriptor of the
+ * IndexTuple used to store the summaries, and the comparison procs.
+ */
+typedef struct BrinDesc
+{
+	Relation	bd_index;
+	TupleDesc	bd_tupdesc;
+	TupleDesc	bd_disktdesc;
+	FmgrInfo   *bd_cmp[INDEX_MAX_KEYS];
+} BrinDesc;
+
+/* brin_tuple.c */
+extern BrinDesc *brin_build_desc(Relation rel);
+extern BrinMemTuple *brin_new_memtuple(BrinDesc *bdesc, BlockNumber blkno);
+extern BrinTuple *brin_form_tuple(BrinDesc *bdesc, BrinMemTuple *dtup,
+				Size *size);
+extern BrinMemTuple *brin_deform_tuple(BrinDesc *bdesc, BrinTuple *tuple);
+extern bool brin_add_value(BrinDesc *bdesc, BrinMemTuple *dtup, int keyno,
+			   Datum value, bool isnull);
+extern void brin_union_tuples(BrinDesc *bdesc, BrinMemTuple *a,
+				  BrinMemTuple *b);
+extern bool brin_consistent(BrinDesc *bdesc, BrinMemTuple *dtup,
+				ScanKey key);
+
+/* brin_revmap.c */
+typedef struct BrinRevmap BrinRevmap;
+
+extern void brin_page_init(Page page, uint16 type);
+extern void brin_metapage_init(Page page, BlockNumber pagesPerRange);
+extern void brinSetMapLink(Page parent, uint32 slot, BlockNumber newblk);
+extern BrinRevmap *brinRevmapInitialize(Relation idxrel,
+					 BlockNumber *pagesPerRange);
+extern void brinRevmapTerminate(BrinRevmap *revmap);
+extern Buffer brinLockRevmapPageForUpdate(BrinRevmap *revmap,
+							BlockNumber heapBlk, bool extend);
+extern void brinGetRevmapEntry(Buffer rmbuf, BlockNumber pagesPerRange,
+				   BlockNumber heapBlk, ItemPointer tid);
+extern void brinSetRevmapEntry(Buffer rmbuf, BlockNumber pagesPerRange,
+				   BlockNumber heapBlk, ItemPointer tid);
+extern BrinTuple *brinGetTupleForHeapBlock(BrinRevmap *revmap,
+						 BlockNumber heapBlk, Size *size);
+extern BrinTuple *brinGetTupleForUpdate(BrinRevmap *revmap, Buffer rmbuf,
+					  BlockNumber heapBlk, Size *size);
+
+/* brin_pageops.c */
+extern void brin_doinsert(Relation idxrel, BlockNumber pagesPerRange,
+			  Buffer rmbuf, BlockNumber heapBlk,
+			  BrinTuple *tup, Size itemsz);
+extern void brin_doupdate(Relation idxrel, BlockNumber pagesPerRange,
+			  Buffer rmbuf, BlockNumber heapBlk,
+			  BrinTuple *tup, Size itemsz);
+
+
+/*
+ * XLOG records for BRIN operations
+ */
+#define XLOG_BRIN_CREATE_INDEX		0x00
+#define XLOG_BRIN_INSERT			0x10
+#define XLOG_BRIN_UPDATE			0x20
+#define XLOG_BRIN_SAMEPAGE_UPDATE	0x30
+#define XLOG_BRIN_NEW_MAP_PAGE		0x40
+
+#define XLOG_BRIN_OPMASK			0x70
+/*
+ * When we insert the first item on a new page, we restore the entire page in
+ * redo.
+ */
+#define XLOG_BRIN_INIT_PAGE			0x80
+
+typedef struct xl_brin_createidx
+{
+	RelFileNode node;
+	BlockNumber pagesPerRange;
+} xl_brin_createidx;
+
+/*
+ * This is what we need to know about a BRIN tuple insert.  The revmap page
+ * is backup block 0 and the data page is backup block 1 (unless the data page
+ * is initialized by this record); the tuple itself follows.
+ */
+typedef struct xl_brin_insert
+{
+	RelFileNode node;
+	BlockNumber heapBlk;
+	BlockNumber pagesPerRange;
+	BlockNumber revmapBlk;
+	ItemPointerData tid;		/* location of the new tuple */
+} xl_brin_insert;
+
+#define SizeOfBrinInsert	(offsetof(xl_brin_insert, tid) + sizeof(ItemPointerData))
+
+/*
+ * A cross-page update: the new tuple goes to new.tid, and the old one at
+ * oldtid is removed.  Backup blocks are the revmap page (0), the old page
+ * (1) and the new page (2, unless initialized by this record).
+ */
+typedef struct xl_brin_update
+{
+	xl_brin_insert new;
+	ItemPointerData oldtid;
+} xl_brin_update;
+
+#define SizeOfBrinUpdate	(offsetof(xl_brin_update, oldtid) + sizeof(ItemPointerData))
+
+/* An update that replaces a tuple in place; backup block 0 is the page */
+typedef struct xl_brin_samepage_update
+{
+	RelFileNode node;
+	ItemPointerData tid;
+} xl_brin_samepage_update;
+
+#define SizeOfBrinSamepageUpdate	(offsetof(xl_brin_samepage_update, tid) + sizeof(ItemPointerData))
+
+/*
+ * A new directory or revmap page, linked from slot "slot" of its parent (the
+ * metapage or a directory page), which is backup block 0.
+ */
+typedef struct xl_brin_new_map_page
+{
+	RelFileNode node;
+	BlockNumber parentBlk;
+	uint32		slot;
+	BlockNumber newBlk;
+	uint16		pageType;
+} xl_brin_new_map_page;
+
+#endif   /* BRIN_PRIVATE_H */
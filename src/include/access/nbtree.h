@@ -119,6 +119,70 @@ typedef struct BTMetaPageData
 				   MAXALIGN(SizeOfPageHeaderData + 3*sizeof(ItemIdData)) - \
 				   MAXALIGN(sizeof(BTPageOpaqueData))) / 3)
 
+/*
+ * Posting list tuples.
+ *
+ * In a non-unique index, a leaf page may hold a run of tuples whose keys are
+ * equal as a single "posting list" tuple: the key, stored once, followed by
+ * an array of the heap TIDs of all the tuples in ascending TID order.  Such
+ * a tuple is flagged by BT_IS_POSTING in t_info, and its t_tid holds the
+ * byte offset of the TID array from the start of the tuple in the block
+ * number field and the number of TIDs in the offset number field.  A posting
+ * list always has at least two TIDs.  High keys and tuples on internal pages
+ * are never posting list tuples.
+ *
+ * Posting lists are limited to half the maximum item size, so that a page
+ * can always be split.  MaxTIDsPerBTreePage is an upper bound on the number
+ * of heap TIDs that a leaf page can hold, counting every TID in a posting
+ * list.
+ */
+#define BT_IS_POSTING	INDEX_AM_RESERVED_BIT
+
+#define BTMaxPostingSize \
+	MAXALIGN_DOWN((BLCKSZ - \
+				   MAXALIGN(SizeOfPageHeaderData + 3*sizeof(ItemIdData)) - \
+				   MAXALIGN(sizeof(BTPageOpaqueData))) / 6)
+
+#define MaxTIDsPerBTreePage \
+	((int) ((BLCKSZ - SizeOfPageHeaderData - sizeof(BTPageOpaqueData)) / \
+			sizeof(ItemPointerData)))
+
+#define BTreeTupleIsPosting(itup) \
+	(((itup)->t_info & BT_IS_POSTING) != 0)
+#define BTreeTupleGetNPosting(itup) \
+	((int) ItemPointerGetOffsetNumber(&(itup)->t_tid))
+#define BTreeTupleGetPostingOffset(itup) \
+	((Size) ItemPointerGetBlockNumber(&(itup)->t_tid))
+#define BTreeTupleGetPosting(itup) \
+	((ItemPointer) ((char *) (itup) + BTreeTupleGetPostingOffset(itup)))
+
+/* number of heap TIDs in any leaf tuple, and the n'th of them */
+#define BTreeTupleGetNHeapTIDs(itup) \
+	(BTreeTupleIsPosting(itup) ? BTreeTupleGetNPosting(itup) : 1)
+#define BTreeTupleGetHeapTID(itup, n) \
+	(BTreeTupleIsPosting(itup) ? BTreeTupleGetPosting(itup) + (n) : \
+	 &(itup)->t_tid)
+
+/*
+ * Leaf tuples used as high keys and downlinks are cut down to their key
+ * columns by _bt_pivot_copy.  This tells whether a leaf tuple has anything
+ * to cut.
+ */
+#define BTreeTupleNeedsPivotCopy(rel, itup) \
+	(BTreeTupleIsPosting(itup) || \
+	 IndexRelationGetNumberOfKeyAttributes(rel) < \
+	 IndexRelationGetNumberOfAttributes(rel))
+
+/*
+ * Deduplication into posting lists is done for non-unique indexes only, and
+ * can be disabled with the deduplicate_items storage parameter.
+ */
+#define BTGetDeduplicateItems(relation) \
+	((relation)->rd_options ? \
+	 ((StdRdOptions *) (relation)->rd_options)->deduplicate_items : true)
+#define BTDeduplicationEnabled(relation) \
+	(!(relation)->rd_index->indisunique && BTGetDeduplicateItems(relation))
+
 /*
  * The leaf-page fillfactor defaults to 90% but is user-adjustable.
  * For pages above the leaf level, we use a fixed 70% fillfactor.
@@ -291,10 +355,11 @@ typedef struct xl_btree_split
 	 * than BlockNumber for alignment reasons: SizeOfBtreeSplit is only 16-bit
 	 * aligned.)
 	 *
-	 * If level > 0, an IndexTuple representing the HIKEY of the left page
-	 * follows.  We don't need this on leaf pages, because it's the same as
-	 * the leftmost key in the new right page.	Also, it's suppressed if
-	 * XLogInsert chooses to store the left page's whole page image.
+	 * Next is an IndexTuple representing the HIKEY of the left page.  On
+	 * leaf pages it is a cut-down copy of the leftmost key in the new right
+	 * page (see _bt_pivot_copy), which redo has no relation to make.  It's
+	 * suppressed if XLogInsert chooses to store the left page's whole page
+	 * image.
 	 *
 	 * In the _L variants, next are OffsetNumber newitemoff and the new item.
 	 * (In the _R variants, the new item is one of the right page's tuples.)
@@ -357,17 +422,24 @@ typedef struct xl_btree_reuse_page
  *
  * Note that the *last* WAL record in any vacuum of an index is allowed to
  * have a zero length array of offsets. Earlier records must have at least one.
+ *
+ * A posting list tuple that loses only some of its heap TIDs is not deleted
+ * but replaced, at the same offset, by a copy holding the remaining TIDs.
  */
 typedef struct xl_btree_vacuum
 {
 	RelFileNode node;
 	BlockNumber block;
 	BlockNumber lastBlockVacuumed;
+	uint16		ndeleted;		/* number of tuples removed */
+	uint16		nupdated;		/* number of posting lists shrunk */
 
-	/* TARGET OFFSET NUMBERS FOLLOW */
+	/* DELETED TARGET OFFSET NUMBERS FOLLOW */
+	/* UPDATED TARGET OFFSET NUMBERS FOLLOW */
+	/* REPLACEMENT TUPLES FOLLOW, one per updated offset */
 } xl_btree_vacuum;
 
-#define SizeOfBtreeVacuum	(offsetof(xl_btree_vacuum, lastBlockVacuumed) + sizeof(BlockNumber))
+#define SizeOfBtreeVacuum	(offsetof(xl_btree_vacuum, nupdated) + sizeof(uint16))
 
 /*
  * This is what we need to know about deletion of a btree page.  The target
@@ -523,7 +595,7 @@ typedef struct BTScanPosData
 	int			lastItem;		/* last valid index in items[] */
 	int			itemIndex;		/* current index in items[] */
 
-	BTScanPosItem items[MaxIndexTuplesPerPage]; /* MUST BE LAST */
+	BTScanPosItem items[MaxTIDsPerBTreePage];	/* MUST BE LAST */
 } BTScanPosData;
 
 typedef BTScanPosData *BTScanPos;
@@ -620,6 +692,28 @@ extern Buffer _bt_getstackbuf(Relation rel, BTStack stack, int access);
 extern void _bt_insert_parent(Relation rel, Buffer buf, Buffer rbuf,
 				  BTStack stack, bool is_root, bool is_only);
 
+/*
+ * prototypes for functions in nbtdedup.c
+ */
+typedef struct BTDedupStateData
+{
+	IndexTuple	base;			/* first tuple of the pending run */
+	Size		basekeysize;	/* size of base, not counting posting list */
+	int			nitems;			/* number of tuples in the run */
+	int			nhtids;			/* number of heap TIDs in htids */
+	bool		sorted;			/* are htids in ascending order? */
+	ItemPointer htids;			/* workspace of BTMaxPostingSize bytes */
+} BTDedupStateData;
+
+typedef BTDedupStateData *BTDedupState;
+
+extern void _bt_dedup_start_run(BTDedupState state, IndexTuple base);
+extern bool _bt_dedup_add_tuple(BTDedupState state, IndexTuple itup);
+extern IndexTuple _bt_dedup_finish_run(BTDedupState state);
+extern bool _bt_dedup_one_page(Relation rel, Buffer buf);
+extern IndexTuple _bt_form_posting(IndexTuple base, ItemPointer htids,
+				 int nhtids);
+
 /*
  * prototypes for functions in nbtpage.c
  */
@@ -638,7 +732,8 @@ extern void _bt_delitems_delete(Relation rel, Buffer buf,
 					OffsetNumber *itemnos, int nitems, Relation heapRel);
 extern void _bt_delitems_vacuum(Relation rel, Buffer buf,
 					OffsetNumber *itemnos, int nitems,
-					BlockNumber lastBlockVacuumed);
+					OffsetNumber *updatednos, IndexTuple *updated,
+					int nupdated, BlockNumber lastBlockVacuumed);
 extern int	_bt_pagedel(Relation rel, Buffer buf, BTStack stack);
 
 /*
@@ -664,6 +759,7 @@ extern ScanKey _bt_mkscankey(Relation rel, IndexTuple itup);
 extern ScanKey _bt_mkscankey_nodata(Relation rel);
 extern void _bt_freeskey(ScanKey skey);
 extern void _bt_freestack(BTStack stack);
+extern IndexTuple _bt_pivot_copy(Relation rel, IndexTuple itup);
 extern void _bt_preprocess_array_keys(IndexScanDesc scan);
 extern void _bt_start_array_keys(IndexScanDesc scan, ScanDirection dir);
 extern bool _bt_advance_array_keys(IndexScanDesc scan, ScanDirection dir);
@@ -19,7 +19,23 @@
 #include "access/htup_details.h"
 #include "access/itup.h"
 #include "access/tupdesc.h"
+#include "storage/spin.h"
 
+/*
+ * Shared state of a heap scan whose blocks are divided among several
+ * backends.  It lives in shared memory; each participant attaches its own
+ * HeapScanDesc to it with heap_beginscan_parallel, and blocks are handed out
+ * one at a time by heap_parallelscan_nextpage, so that a participant which
+ * gets held up just ends up scanning fewer of them.
+ */
+typedef struct ParallelHeapScanDescData
+{
+	Oid			phs_relid;		/* OID of relation to scan */
+	BlockNumber phs_nblocks;	/* # blocks in relation at start of scan */
+	slock_t		phs_mutex;		/* mutual exclusion for the fields below */
+	BlockNumber phs_cblock;		/* next block to hand out */
+	bool		phs_aborted;	/* stop handing out blocks */
+}	ParallelHeapScanDescData;
 
 typedef struct HeapScanDescData
 {
@@ -38,6 +54,7 @@ typedef struct HeapScanDescData
 	BlockNumber rs_startblock;	/* block # to start at */
 	BufferAccessStrategy rs_strategy;	/* access strategy for reads */
 	bool		rs_syncscan;	/* report location to syncscan logic? */
+	ParallelHeapScanDesc rs_parallel;	/* shared state, if parallel scan */
 
 	/* scan current state */
 	bool		rs_inited;		/* false = scan not init'd yet */
@@ -36,6 +36,15 @@
  */
 #define SLRU_PAGES_PER_SEGMENT	32
 
+/*
+ * The buffer slots of an SLRU are divided into banks of SLRU_BANK_SIZE
+ * slots each, and a page can only ever be held in the bank selected by
+ * pageno % num_banks.  Looking up a page therefore scans a single bank
+ * rather than the whole buffer pool, which lets the pool be made large.
+ * Sizes of SLRUs that are configurable are required to be a multiple of this.
+ */
+#define SLRU_BANK_SIZE			16
+
 /*
  * Page status codes.  Note that these do not include the "dirty" bit.
  * page_dirty can be TRUE only in the VALID or WRITE_IN_PROGRESS states;
@@ -60,6 +69,18 @@ typedef struct SlruSharedData
 	/* Number of buffers managed by this SLRU structure */
 	int			num_slots;
 
+	/*
+	 * Slots are divided into num_banks banks of bank_size slots; the last
+	 * bank also takes any slots left over.  bank_locks[] holds the lock
+	 * protecting each bank.  For an SLRU that is not partitioned they are all
+	 * ControlLock, otherwise bank_locks[0] is ControlLock and the others are
+	 * separate locks, so that backends working on pages in different banks
+	 * do not contend with each other.
+	 */
+	int			num_banks;
+	int			bank_size;
+	LWLockId   *bank_locks;
+
 	/*
 	 * Arrays holding info for each buffer slot.  Page number is undefined
 	 * when status is EMPTY, as is page_lru_count.
@@ -83,20 +104,22 @@ typedef struct SlruSharedData
 	int			lsn_groups_per_page;
 
 	/*----------
-	 * We mark a page "most recently used" by setting
-	 *		page_lru_count[slotno] = ++cur_lru_count;
-	 * The oldest page is therefore the one with the highest value of
-	 *		cur_lru_count - page_lru_count[slotno]
+	 * Each bank has its own LRU counter.  We mark a page "most recently used"
+	 * by setting
+	 *		page_lru_count[slotno] = ++bank_cur_lru_count[bankno];
+	 * The oldest page in a bank is therefore the one with the highest value of
+	 *		bank_cur_lru_count[bankno] - page_lru_count[slotno]
 	 * The counts will eventually wrap around, but this calculation still
 	 * works as long as no page's age exceeds INT_MAX counts.
 	 *----------
 	 */
-	int			cur_lru_count;
+	int		   *bank_cur_lru_count;
 
 	/*
 	 * latest_page_number is the page number of the current end of the log;
 	 * this is not critical data, since we use it only to avoid swapping out
-	 * the latest page.
+	 * the latest page.  It is set under the lock of the bank holding that
+	 * page, so other banks may read a slightly stale value.
 	 */
 	int			latest_page_number;
 } SlruSharedData;
@@ -134,9 +157,18 @@ typedef struct SlruCtlData
 typedef SlruCtlData *SlruCtl;
 
 
+/*
+ * Lock protecting the bank that holds (or would hold) the given page.  This
+ * is the lock callers must hold around SimpleLruReadPage, SimpleLruZeroPage
+ * and SimpleLruWritePage, and release after SimpleLruReadPage_ReadOnly.
+ */
+#define SimpleLruGetBankLock(ctl, pageno) \
+	((ctl)->shared->bank_locks[(pageno) % (ctl)->shared->num_banks])
+
 extern Size SimpleLruShmemSize(int nslots, int nlsns);
+extern int	SimpleLruNumLWLocks(int nslots, bool partitioned);
 extern void SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
-			  LWLockId ctllock, const char *subdir);
+			  LWLockId ctllock, const char *subdir, bool partitioned);
 extern int	SimpleLruZeroPage(SlruCtl ctl, int pageno);
 extern int SimpleLruReadPage(SlruCtl ctl, int pageno, bool write_ok,
 				  TransactionId xid);
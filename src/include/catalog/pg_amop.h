@@ -781,4 +781,139 @@ DATA(insert (	3474   3831 3831 8 s	3892 4000 0 ));
 DATA(insert (	3474   3831 2283 16 s	3889 4000 0 ));
 DATA(insert (	3474   3831 3831 18 s	3882 4000 0 ));
 
+/*
+ * BRIN int2_minmax_ops
+ */
+DATA(insert (	4054   21 21 1 s	95 3580 0 ));
+DATA(insert (	4054   21 21 2 s	522 3580 0 ));
+DATA(insert (	4054   21 21 3 s	94 3580 0 ));
+DATA(insert (	4054   21 21 4 s	524 3580 0 ));
+DATA(insert (	4054   21 21 5 s	520 3580 0 ));
+
+/*
+ * BRIN int4_minmax_ops
+ */
+DATA(insert (	4055   23 23 1 s	97 3580 0 ));
+DATA(insert (	4055   23 23 2 s	523 3580 0 ));
+DATA(insert (	4055   23 23 3 s	96 3580 0 ));
+DATA(insert (	4055   23 23 4 s	525 3580 0 ));
+DATA(insert (	4055   23 23 5 s	521 3580 0 ));
+
+/*
+ * BRIN int8_minmax_ops
+ */
+DATA(insert (	4056   20 20 1 s	412 3580 0 ));
+DATA(insert (	4056   20 20 2 s	414 3580 0 ));
+DATA(insert (	4056   20 20 3 s	410 3580 0 ));
+DATA(insert (	4056   20 20 4 s	415 3580 0 ));
+DATA(insert (	4056   20 20 5 s	413 3580 0 ));
+
+/*
+ * BRIN float4_minmax_ops
+ */
+DATA(insert (	4057   700 700 1 s	622 3580 0 ));
+DATA(insert (	4057   700 700 2 s	624 3580 0 ));
+DATA(insert (	4057   700 700 3 s	620 3580 0 ));
+DATA(insert (	4057   700 700 4 s	625 3580 0 ));
+DATA(insert (	4057   700 700 5 s	623 3580 0 ));
+
+/*
+ * BRIN float8_minmax_ops
+ */
+DATA(insert (	4058   701 701 1 s	672 3580 0 ));
+DATA(insert (	4058   701 701 2 s	673 3580 0 ));
+DATA(insert (	4058   701 701 3 s	670 3580 0 ));
+DATA(insert (	4058   701 701 4 s	675 3580 0 ));
+DATA(insert (	4058   701 701 5 s	674 3580 0 ));
+
+/*
+ * BRIN numeric_minmax_ops
+ */
+DATA(insert (	4059   1700 1700 1 s	1754 3580 0 ));
+DATA(insert (	4059   1700 1700 2 s	1755 3580 0 ));
+DATA(insert (	4059   1700 1700 3 s	1752 3580 0 ));
+DATA(insert (	4059   1700 1700 4 s	1757 3580 0 ));
+DATA(insert (	4059   1700 1700 5 s	1756 3580 0 ));
+
+/*
+ * BRIN text_minmax_ops
+ */
+DATA(insert (	4060   25 25 1 s	664 3580 0 ));
+DATA(insert (	4060   25 25 2 s	665 3580 0 ));
+DATA(insert (	4060   25 25 3 s	98 3580 0 ));
+DATA(insert (	4060   25 25 4 s	667 3580 0 ));
+DATA(insert (	4060   25 25 5 s	666 3580 0 ));
+
+/*
+ * BRIN bpchar_minmax_ops
+ */
+DATA(insert (	4061   1042 1042 1 s	1058 3580 0 ));
+DATA(insert (	4061   1042 1042 2 s	1059 3580 0 ));
+DATA(insert (	4061   1042 1042 3 s	1054 3580 0 ));
+DATA(insert (	4061   1042 1042 4 s	1061 3580 0 ));
+DATA(insert (	4061   1042 1042 5 s	1060 3580 0 ));
+
+/*
+ * BRIN oid_minmax_ops
+ */
+DATA(insert (	4062   26 26 1 s	609 3580 0 ));
+DATA(insert (	4062   26 26 2 s	611 3580 0 ));
+DATA(insert (	4062   26 26 3 s	607 3580 0 ));
+DATA(insert (	4062   26 26 4 s	612 3580 0 ));
+DATA(insert (	4062   26 26 5 s	610 3580 0 ));
+
+/*
+ * BRIN date_minmax_ops
+ */
+DATA(insert (	4063   1082 1082 1 s	1095 3580 0 ));
+DATA(insert (	4063   1082 1082 2 s	1096 3580 0 ));
+DATA(insert (	4063   1082 1082 3 s	1093 3580 0 ));
+DATA(insert (	4063   1082 1082 4 s	1098 3580 0 ));
+DATA(insert (	4063   1082 1082 5 s	1097 3580 0 ));
+
+/*
+ * BRIN timestamp_minmax_ops
+ */
+DATA(insert (	4064   1114 1114 1 s	2062 3580 0 ));
+DATA(insert (	4064   1114 1114 2 s	2063 3580 0 ));
+DATA(insert (	4064   1114 1114 3 s	2060 3580 0 ));
+DATA(insert (	4064   1114 1114 4 s	2065 3580 0 ));
+DATA(insert (	4064   1114 1114 5 s	2064 3580 0 ));
+
+/*
+ * BRIN timestamptz_minmax_ops
+ */
+DATA(insert (	4065   1184 1184 1 s	1322 3580 0 ));
+DATA(insert (	4065   1184 1184 2 s	1323 3580 0 ));
+DATA(insert (	4065   1184 1184 3 s	1320 3580 0 ));
+DATA(insert (	4065   1184 1184 4 s	1325 3580 0 ));
+DATA(insert (	4065   1184 1184 5 s	1324 3580 0 ));
+
+/*
+ * BRIN time_minmax_ops
+ */
+DATA(insert (	4066   1083 1083 1 s	1110 3580 0 ));
+DATA(insert (	4066   1083 1083 2 s	1111 3580 0 ));
+DATA(insert (	4066   1083 1083 3 s	1108 3580 0 ));
+DATA(insert (	4066   1083 1083 4 s	1113 3580 0 ));
+DATA(insert (	4066   1083 1083 5 s	1112 3580 0 ));
+
+/*
+ * BRIN interval_minmax_ops
+ */
+DATA(insert (	4067   1186 1186 1 s	1332 3580 0 ));
+DATA(insert (	4067   1186 1186 2 s	1333 3580 0 ));
+DATA(insert (	4067   1186 1186 3 s	1330 3580 0 ));
+DATA(insert (	4067   1186 1186 4 s	1335 3580 0 ));
+DATA(insert (	4067   1186 1186 5 s	1334 3580 0 ));
+
+/*
+ * BRIN uuid_minmax_ops
+ */
+DATA(insert (	4068   2950 2950 1 s	2974 3580 0 ));
+DATA(insert (	4068   2950 2950 2 s	2976 3580 0 ));
+DATA(insert (	4068   2950 2950 3 s	2972 3580 0 ));
+DATA(insert (	4068   2950 2950 4 s	2977 3580 0 ));
+DATA(insert (	4068   2950 2950 5 s	2975 3580 0 ));
+
 #endif   /* PG_AMOP_H */
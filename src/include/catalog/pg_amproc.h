@@ -118,11 +118,13 @@ DATA(insert (	1984   829 829 1 836 ));
 DATA(insert (	1986   19 19 1 359 ));
 DATA(insert (	1986   19 19 2 3135 ));
 DATA(insert (	1988   1700 1700 1 1769 ));
+DATA(insert (	1988   1700 1700 2 3283 ));
 DATA(insert (	1989   26 26 1 356 ));
 DATA(insert (	1989   26 26 2 3134 ));
 DATA(insert (	1991   30 30 1 404 ));
 DATA(insert (	2994   2249 2249 1 2987 ));
 DATA(insert (	1994   25 25 1 360 ));
+DATA(insert (	1994   25 25 2 3255 ));
 DATA(insert (	1996   1083 1083 1 1107 ));
 DATA(insert (	2000   1266 1266 1 1358 ));
 DATA(insert (	2002   1562 1562 1 1672 ));
@@ -133,6 +135,7 @@ DATA(insert (	2233   703 703 1  380 ));
 DATA(insert (	2234   704 704 1  381 ));
 DATA(insert (	2789   27 27 1 2794 ));
 DATA(insert (	2968   2950 2950 1 2960 ));
+DATA(insert (	2968   2950 2950 2 3300 ));
 DATA(insert (	3522   3500 3500 1 3514 ));
 
 
@@ -379,4 +382,21 @@ DATA(insert (	3474   3831 3831 3 3471 ));
 DATA(insert (	3474   3831 3831 4 3472 ));
 DATA(insert (	3474   3831 3831 5 3473 ));
 
+/* BRIN minmax */
+DATA(insert (	4054   21 21 1 350 ));
+DATA(insert (	4055   23 23 1 351 ));
+DATA(insert (	4056   20 20 1 842 ));
+DATA(insert (	4057   700 700 1 354 ));
+DATA(insert (	4058   701 701 1 355 ));
+DATA(insert (	4059   1700 1700 1 1769 ));
+DATA(insert (	4060   25 25 1 360 ));
+DATA(insert (	4061   1042 1042 1 1078 ));
+DATA(insert (	4062   26 26 1 356 ));
+DATA(insert (	4063   1082 1082 1 1092 ));
+DATA(insert (	4064   1114 1114 1 2045 ));
+DATA(insert (	4065   1184 1184 1 1314 ));
+DATA(insert (	4066   1083 1083 1 1107 ));
+DATA(insert (	4067   1186 1186 1 1315 ));
+DATA(insert (	4068   2950 2950 1 2960 ));
+
 #endif   /* PG_AMPROC_H */
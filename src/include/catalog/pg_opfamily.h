@@ -148,4 +148,20 @@ DATA(insert OID = 4016 (	4000	kd_point_ops	PGNSP PGUID ));
 DATA(insert OID = 4017 (	4000	text_ops		PGNSP PGUID ));
 #define TEXT_SPGIST_FAM_OID 4017
 
+DATA(insert OID = 4054 (	3580	int2_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 4055 (	3580	int4_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 4056 (	3580	int8_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 4057 (	3580	float4_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 4058 (	3580	float8_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 4059 (	3580	numeric_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 4060 (	3580	text_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 4061 (	3580	bpchar_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 4062 (	3580	oid_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 4063 (	3580	date_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 4064 (	3580	timestamp_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 4065 (	3580	timestamptz_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 4066 (	3580	time_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 4067 (	3580	interval_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 4068 (	3580	uuid_minmax_ops		PGNSP PGUID ));
+
 #endif   /* PG_OPFAMILY_H */
@@ -57,11 +57,16 @@ CATALOG(pgxc_node,9015) BKI_SHARED_RELATION
 	 * Node identifier to be used at places where a fixed length node identification is required
 	 */
 	int32		node_id;
+
+	/*
+	 * Datanode this node is a hot standby of, InvalidOid for other nodes
+	 */
+	Oid			node_standby_of;
 } FormData_pgxc_node;
 
 typedef FormData_pgxc_node *Form_pgxc_node;
 
-#define Natts_pgxc_node				7
+#define Natts_pgxc_node				8
 
 #define Anum_pgxc_node_name			1
 #define Anum_pgxc_node_type			2
@@ -70,10 +75,12 @@ typedef FormData_pgxc_node *Form_pgxc_node;
 #define Anum_pgxc_node_is_primary	5
 #define Anum_pgxc_node_is_preferred	6
 #define Anum_pgxc_node_id		7
+#define Anum_pgxc_node_standby_of	8
 
 /* Possible types of nodes */
 #define PGXC_NODE_COORDINATOR		'C'
 #define PGXC_NODE_DATANODE			'D'
+#define PGXC_NODE_DATANODE_STANDBY	'S'
 #define PGXC_NODE_NONE				'N'
 
 #endif   /* PGXC_NODE_H */
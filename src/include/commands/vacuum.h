@@ -136,6 +136,10 @@ extern PGDLLIMPORT int default_statistics_target;		/* PGDLLIMPORT for
 														 * PostGIS */
 extern int	vacuum_freeze_min_age;
 extern int	vacuum_freeze_table_age;
+#ifdef PGXC
+extern int	parallel_vacuum_workers;
+extern int	parallel_vacuum_mem;
+#endif
 
 
 /* in commands/vacuum.c */
@@ -167,6 +171,11 @@ extern void vacuum_delay_point(void);
 /* in commands/vacuumlazy.c */
 extern void lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 				BufferAccessStrategy bstrategy);
+#ifdef PGXC
+extern Size LazyVacuumShmemSize(void);
+extern void LazyVacuumShmemInit(void);
+extern void lazy_vacuum_indexes_worker(void);
+#endif
 
 /* in commands/analyze.c */
 extern void analyze_rel(Oid relid, VacuumStmt *vacstmt,
@@ -0,0 +1,49 @@
+/*-------------------------------------------------------------------------
+ *
+ * execParallel.h
+ *	  Background workers running copies of a plan for a Gather node,
+ *	  or vacuuming indexes for a VACUUM
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ * src/include/executor/execParallel.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef EXECPARALLEL_H
+#define EXECPARALLEL_H
+
+#include "access/htup.h"
+#include "nodes/execnodes.h"
+#include "tcop/dest.h"
+
+typedef struct ParallelGroup ParallelGroup;
+
+/* kinds of job a parallel scan worker can be given */
+typedef enum ParallelJobKind
+{
+	PJOB_PLAN,					/* run the subplan of a Gather node */
+	PJOB_INDEX_VACUUM			/* vacuum indexes, see vacuumlazy.c */
+} ParallelJobKind;
+
+/* GUC variable */
+extern int	max_parallel_scan_workers;
+
+extern Size ParallelShmemSize(void);
+extern void ParallelShmemInit(void);
+extern void RegisterParallelWorkers(void);
+
+extern ParallelGroup *ExecParallelBegin(Gather *node, EState *estate,
+				  int eflags);
+extern ParallelGroup *ExecParallelBeginJob(ParallelJobKind kind, int nwanted);
+extern ParallelHeapScanDesc ExecParallelScanDesc(ParallelGroup *group);
+extern int	ExecParallelNumWorkers(ParallelGroup *group);
+extern MinimalTuple ExecParallelReadTuple(ParallelGroup *group, bool *done);
+extern void ExecParallelWait(ParallelGroup *group);
+extern void ExecParallelWaitAll(ParallelGroup *group);
+extern void ExecParallelFinish(ParallelGroup *group);
+
+extern DestReceiver *CreateTupleQueueDestReceiver(void);
+
+#endif   /* EXECPARALLEL_H */
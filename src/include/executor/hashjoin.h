@@ -157,6 +157,15 @@ typedef struct HashJoinTableData
 
 	MemoryContext hashCxt;		/* context for whole-hash-join storage */
 	MemoryContext batchCxt;		/* context for this-batch-only storage */
+
+#ifdef PGXC
+	/*
+	 * If not NULL, a Bloom filter (see lib/bloomfilter.h) to which the hash
+	 * value of every inner tuple is added, for pushdown to a remote outer
+	 * scan.  Allocated in hashCxt.
+	 */
+	bytea	   *bloomfilter;
+#endif
 }	HashJoinTableData;
 
 #endif   /* HASHJOIN_H */
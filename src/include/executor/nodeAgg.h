@@ -16,6 +16,14 @@
 
 #include "nodes/execnodes.h"
 
+/*
+ * A hashed aggregation that runs out of memory splits the tuples of the
+ * groups that did not fit into this many batches, by this many bits of
+ * their hash value.
+ */
+#define HASHAGG_PARTITION_BITS	4
+#define HASHAGG_PARTITIONS		(1 << HASHAGG_PARTITION_BITS)
+
 extern AggState *ExecInitAgg(Agg *node, EState *estate, int eflags);
 extern TupleTableSlot *ExecAgg(AggState *node);
 extern void ExecEndAgg(AggState *node);
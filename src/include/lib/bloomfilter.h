@@ -0,0 +1,32 @@
+/*
+ * bloomfilter.h
+ *
+ * A Bloom filter over 32-bit hash values, stored as a bytea
+ *
+ * Portions Copyright (c) 2012-2013, PostgreSQL Global Development Group
+ *
+ * src/include/lib/bloomfilter.h
+ */
+
+#ifndef BLOOMFILTER_H
+#define BLOOMFILTER_H
+
+/*
+ * The filter is a plain bytea, so that it can be passed around as a Datum
+ * and shipped to other nodes without any conversion.  Its payload is laid
+ * out byte by byte (and so is independent of the machine's endianness):
+ *
+ *		byte 0		log2 of the number of bits in the bitset
+ *		byte 1		number of probes made for each element
+ *		byte 2..	the bitset
+ *
+ * Elements are added and tested by their hash value; callers must use the
+ * same hash function on both sides.
+ */
+#define BLOOM_HEADER_SIZE	2
+
+extern bytea *bloom_create(double total_elems, Size max_bytes);
+extern void bloom_add_hash(bytea *filter, uint32 hash);
+extern bool bloom_lacks_hash(bytea *filter, uint32 hash);
+
+#endif   /* BLOOMFILTER_H */
@@ -0,0 +1,32 @@
+/*
+ * hyperloglog.h
+ *
+ * A simple HyperLogLog cardinality estimator implementation
+ *
+ * Portions Copyright (c) 2012-2013, PostgreSQL Global Development Group
+ *
+ * src/include/lib/hyperloglog.h
+ */
+
+#ifndef HYPERLOGLOG_H
+#define HYPERLOGLOG_H
+
+/*
+ * HyperLogLog is an approximate technique for computing the number of
+ * distinct entries in a set.  Elements are added by their 32-bit hash
+ * value; the estimator keeps, in each of 2^registerWidth registers, the
+ * longest run of leading zero bits seen among the hashes routed to it.
+ */
+typedef struct hyperLogLogState
+{
+	uint8		registerWidth;	/* log2 of the number of registers */
+	Size		nRegisters;		/* number of registers */
+	double		alphaMM;		/* bias correction constant times m^2 */
+	uint8	   *hashesArr;		/* the registers */
+} hyperLogLogState;
+
+extern void initHyperLogLog(hyperLogLogState *cState, uint8 bwidth);
+extern void addHyperLogLog(hyperLogLogState *cState, uint32 hash);
+extern double estimateHyperLogLog(hyperLogLogState *cState);
+
+#endif   /* HYPERLOGLOG_H */
@@ -66,6 +66,9 @@ extern int	pq_putmessage(char msgtype, const char *s, size_t len);
 extern void pq_putmessage_noblock(char msgtype, const char *s, size_t len);
 extern void pq_startcopyout(void);
 extern void pq_endcopyout(bool errorAbort);
+#ifdef PGXC
+extern void pq_set_compression(bool on);
+#endif
 
 /*
  * prototypes for functions in be-secure.c
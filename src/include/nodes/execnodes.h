@@ -31,7 +31,9 @@
  *		entries for a particular index.  Used for both index_build and
  *		retail creation of index entries.
  *
- *		NumIndexAttrs		number of columns in this index
+ *		NumIndexAttrs		total number of columns in this index
+ *		NumIndexKeyAttrs	number of key columns in index; the rest, if
+ *							any, are INCLUDE columns
  *		KeyAttrNumbers		underlying-rel attribute numbers used as keys
  *							(zeroes indicate expressions)
  *		Expressions			expr trees for expression entries, or NIL if none
@@ -54,6 +56,7 @@ typedef struct IndexInfo
 {
 	NodeTag		type;
 	int			ii_NumIndexAttrs;
+	int			ii_NumIndexKeyAttrs;
 	AttrNumber	ii_KeyAttrNumbers[INDEX_MAX_KEYS];
 	List	   *ii_Expressions; /* list of Expr */
 	List	   *ii_ExpressionsState;	/* list of ExprState */
@@ -418,6 +421,13 @@ typedef struct EState
 	HeapTuple  *es_epqTuple;	/* array of EPQ substitute tuples */
 	bool	   *es_epqTupleSet; /* true if EPQ tuple is provided */
 	bool	   *es_epqScanDone; /* true if EPQ tuple has been fetched */
+
+	/*
+	 * Shared state of a parallel heap scan: a SeqScan node initialized while
+	 * this is set, and scanning the relation it describes, takes part in
+	 * that scan rather than reading the whole relation itself.
+	 */
+	ParallelHeapScanDesc es_parallel_scan;
 } EState;
 
 
@@ -550,10 +560,15 @@ typedef HASH_SEQ_STATUS TupleHashIterator;
  *
  * To save on dispatch overhead, each ExprState node contains a function
  * pointer to the routine to execute to evaluate the node.
+ *
+ * The top node of an expression may additionally carry a flattened version
+ * of the whole tree below it (see ExecCompileExpr in execQual.c), in which
+ * case evalfunc runs that instead of recursing through the tree.
  * ----------------
  */
 
 typedef struct ExprState ExprState;
+typedef struct ExprProgram ExprProgram;
 
 typedef Datum (*ExprStateEvalFunc) (ExprState *expression,
 												ExprContext *econtext,
@@ -565,6 +580,7 @@ struct ExprState
 	NodeTag		type;
 	Expr	   *expr;			/* associated Expr node */
 	ExprStateEvalFunc evalfunc; /* routine to run to execute node */
+	ExprProgram *program;		/* flattened expression, or NULL */
 };
 
 /* ----------------
@@ -1114,6 +1130,11 @@ typedef struct AppendState
 	PlanState **appendplans;	/* array of PlanStates for my inputs */
 	int			as_nplans;
 	int			as_whichplan;
+#ifdef PGXC
+	bool		as_remote_started;	/* remote subplans sent down yet? */
+	bool		as_remote_any_order;	/* may they be read in any order? */
+	struct RemoteQueriesState *as_remote;	/* if so, their state */
+#endif
 } AppendState;
 
 /* ----------------
@@ -1603,6 +1624,8 @@ typedef struct MergeJoinState
  *		hj_JoinState			current state of ExecHashJoin state machine
  *		hj_MatchedOuter			true if found a join match for current outer
  *		hj_OuterNotEmpty		true if outer relation known not empty
+ *		hj_BloomPushdown		true if a Bloom filter over the inner hash
+ *								keys is handed to the outer RemoteQuery
  * ----------------
  */
 
@@ -1630,6 +1653,9 @@ typedef struct HashJoinState
 	int			hj_JoinState;
 	bool		hj_MatchedOuter;
 	bool		hj_OuterNotEmpty;
+#ifdef PGXC
+	bool		hj_BloomPushdown;
+#endif
 } HashJoinState;
 
 
@@ -1718,6 +1744,16 @@ typedef struct AggState
 	List	   *hash_needed;	/* list of columns needed in hash table */
 	bool		table_filled;	/* hash table filled yet? */
 	TupleHashIterator hashiter; /* for iterating through hash table */
+	/* these fields are used when AGG_HASHED spills to disk: */
+	Size		hash_mem_limit;	/* memory allowed for the hash table */
+	long		hash_ngroups_current;	/* number of groups in hash table */
+	long		hash_ngroups_check;		/* recheck memory at this many groups */
+	bool		hash_spill_mode;	/* spilling tuples of new groups? */
+	bool		hash_ever_spilled;	/* has any pass spilled? */
+	int			hash_pass_depth;	/* partitioning depth of current pass */
+	struct HashAggSpillData *hash_spill;	/* batch files being written */
+	List	   *hash_batches;	/* spilled batches not yet aggregated */
+	TupleTableSlot *hash_spill_slot;	/* slot for reading spilled tuples */
 #ifdef PGXC
 	bool		skip_trans;		/* skip the transition step for aggregates */
 #endif /* PGXC */
@@ -1896,4 +1932,22 @@ typedef struct LimitState
 	TupleTableSlot *subSlot;	/* tuple last obtained from subplan */
 } LimitState;
 
+/* ----------------
+ *	 GatherState information
+ *
+ *		group is the set of workers running copies of the subplan; the
+ *		subplan is also run locally, and tuples coming from the workers are
+ *		returned in funnel_slot.
+ * ----------------
+ */
+typedef struct GatherState
+{
+	PlanState	ps;				/* its first field is NodeTag */
+	struct ParallelGroup *group;	/* workers, and the scan they share */
+	int			nworkers_launched;	/* number of workers group got */
+	bool		local_done;		/* local copy of the subplan is exhausted */
+	bool		workers_done;	/* every worker has finished */
+	TupleTableSlot *funnel_slot;	/* holds tuples read from workers */
+} GatherState;
+
 #endif   /* EXECNODES_H */
@@ -762,6 +762,22 @@ typedef struct Limit
 	Node	   *limitCount;		/* COUNT parameter, or NULL if none */
 } Limit;
 
+/* ----------------
+ *		gather node
+ *
+ * The subplan is run by num_workers background workers as well as by the
+ * backend running the Gather itself, and the rows all of them produce are
+ * returned in no particular order.  One SeqScan in the subplan divides the
+ * pages of its relation among the participants (see heapam.c); the rest of
+ * the subplan must be safe to run separately in each of them.
+ * ----------------
+ */
+typedef struct Gather
+{
+	Plan		plan;
+	int			num_workers;	/* number of workers to ask for */
+} Gather;
+
 
 /*
  * RowMarkType -
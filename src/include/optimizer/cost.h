@@ -67,6 +67,7 @@ extern bool enable_remotejoin;
 extern bool enable_remotegroup;
 extern bool enable_remotesort;
 extern bool enable_remotelimit;
+extern bool enable_remotebloomfilter;
 #endif
 extern int	constraint_exclusion;
 
@@ -113,6 +114,8 @@ extern void cost_agg(Path *path, PlannerInfo *root,
 		 int numGroupCols, double numGroups,
 		 Cost input_startup_cost, Cost input_total_cost,
 		 double input_tuples);
+extern Cost cost_hashagg_spill(double input_tuples, int input_width,
+				   double numGroups, double hashentrysize);
 extern void cost_windowagg(Path *path, PlannerInfo *root,
 			   List *windowFuncs, int numPartCols, int numOrderCols,
 			   Cost input_startup_cost, Cost input_total_cost,
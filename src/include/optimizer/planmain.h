@@ -152,6 +152,15 @@ extern List *pgxc_build_relation_tlist(RelOptInfo *rel);
 extern void pgxc_copy_path_costsize(Plan *dest, Path *src);
 extern Plan *pgxc_create_gating_plan(PlannerInfo *root, Plan *plan, List *quals);
 extern Node *pgxc_replace_nestloop_params(PlannerInfo *root, Node *expr);
+
+/*
+ * prototypes for plan/planparallel.c
+ */
+extern int	parallel_scan_degree;
+extern int	parallel_scan_min_size;
+
+extern Plan *parallelize_plan_tree(PlannerGlobal *glob, Query *parse,
+					  int cursorOptions, Plan *top_plan);
 #endif
 
 #endif   /* PLANMAIN_H */
@@ -103,6 +103,14 @@
  */
 #define ALIGNOF_BUFFER	32
 
+/*
+ * Assumed cache line size. This doesn't affect correctness, but can be
+ * used for low-level optimizations. Currently, this is only used to pad
+ * some data structures in shared memory, to avoid bouncing a cache line
+ * between processes, so only performance-critical places need to care.
+ */
+#define CACHE_LINE_SIZE		128
+
 /*
  * Disable UNIX sockets for certain operating systems.
  */
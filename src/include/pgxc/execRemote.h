@@ -97,6 +97,7 @@ typedef struct RemoteQueryState
 	char	   *errorMessage;			/* error message to send back to client */
 	char	   *errorDetail;			/* error detail to send back to client */
 	bool		query_Done;				/* query has been sent down to Datanodes */
+	bool		query_pending;			/* sent down, first response not read yet */
 	RemoteDataRowData currentRow;		/* next data ro to be wrapped into a tuple */
 	/* TODO use a tuplestore as a rowbuffer */
 	List 	   *rowBuffer;				/* buffer where rows are stored when connection
@@ -129,8 +130,22 @@ typedef struct RemoteQueryState
 	Tuplestorestate *tuplestorestate;
 	CommandId	rqs_cmd_id;			/* Cmd id to use in some special cases */
 	uint32		rqs_processed;			/* Number of rows processed (only for DMLs) */
+	/* Bloom filter pushdown, see ExecRemoteQueryInitBloomFilter */
+	AttrNumber	rqs_bloom_attno;		/* column the filter applies to */
+	Oid			rqs_bloom_hashfunc;		/* hash function to apply to it */
+	char	   *rqs_bloom_statement;	/* statement with the filter added */
+	/* Plan shipping, see pgxc_wait_shipped_plan */
+	Oid			rqs_plan_node;			/* node asked for its plan, if any */
+	char	   *rqs_shipped_plan;		/* plan it sent back, if portable */
+	int			rqs_shipped_planlen;
+	int			rqs_plan_shipped;		/* number of nodes it was sent to */
+	double		rqs_remote_plan_time;	/* ms spent planning by that node */
+	double		rqs_plan_wait_time;		/* ms spent waiting for its answer */
 }	RemoteQueryState;
 
+/* Remote queries read in the order their rows arrive, see execRemote.c */
+typedef struct RemoteQueriesState RemoteQueriesState;
+
 typedef void (*xact_callback) (bool isCommit, void *args);
 
 /* Multinode Executor */
@@ -156,6 +171,10 @@ extern int DataNodeCopyInBinaryForAll(char *msg_buf, int len, PGXCNodeHandle** c
 extern int ExecCountSlotsRemoteQuery(RemoteQuery *node);
 extern RemoteQueryState *ExecInitRemoteQuery(RemoteQuery *node, EState *estate, int eflags);
 extern TupleTableSlot* ExecRemoteQuery(RemoteQueryState *step);
+extern RemoteQueriesState *ExecStartRemoteQueries(PlanState **plans, int nplans,
+												  bool any_order);
+extern TupleTableSlot *ExecRemoteQueriesNext(RemoteQueriesState *state);
+extern void ExecEndRemoteQueries(RemoteQueriesState *state);
 extern void ExecEndRemoteQuery(RemoteQueryState *step);
 extern void ExecRemoteUtility(RemoteQuery *node);
 
@@ -166,6 +185,10 @@ extern bool FetchTuple(RemoteQueryState *combiner, TupleTableSlot *slot);
 extern void BufferConnection(PGXCNodeHandle *conn);
 
 extern void ExecRemoteQueryReScan(RemoteQueryState *node, ExprContext *exprCtxt);
+extern bool ExecRemoteQueryInitBloomFilter(RemoteQueryState *node,
+							   AttrNumber attno, Oid hashfunc);
+extern void ExecRemoteQuerySetBloomFilter(RemoteQueryState *node,
+							  bytea *filter);
 
 extern void SetDataRowForExtParams(ParamListInfo params, RemoteQueryState *rq_state);
 
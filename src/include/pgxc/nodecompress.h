@@ -0,0 +1,42 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodecompress.h
+ *
+ *		Stream compression of the traffic between PGXC nodes
+ *
+ * Portions Copyright (c) 1996-2011, PostgreSQL Global Development Group
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ * src/include/pgxc/nodecompress.h
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef NODECOMPRESS_H
+#define NODECOMPRESS_H
+
+#include "lib/stringinfo.h"
+
+/*
+ * Once compression has been negotiated on a connection (see the 'z'
+ * message), everything sent over it in either direction is a sequence of
+ * frames, each made of
+ *
+ *		int32	length of the payload
+ *		int32	number of bytes the payload stands for
+ *		payload
+ *
+ * in network byte order.  The payload is the output of pglz_compress, or
+ * the bytes themselves if they did not compress, in which case both lengths
+ * are equal.  Whatever is in the send buffer when it is flushed goes into
+ * frames, regardless of message boundaries, split in chunks of at most
+ * NODE_COMPRESS_CHUNK bytes.
+ */
+#define NODE_COMPRESS_HDRSZ		8
+#define NODE_COMPRESS_CHUNK		(64 * 1024)
+
+extern void node_compress(StringInfo out, const char *data, int len);
+extern int	node_frame_rawlen(const char *buf, int avail, int *framelen);
+extern void node_decompress(const char *frame, char *dest);
+
+#endif   /* NODECOMPRESS_H */
@@ -34,6 +34,7 @@ typedef struct
 	int			nodeport;
 	bool		nodeisprimary;
 	bool 		nodeispreferred;
+	Oid			nodestandbyof;	/* Datanode replicated by a standby */
 } NodeDefinition;
 
 extern void NodeTablesShmemInit(void);
@@ -44,6 +45,7 @@ extern void PgxcNodeGetOids(Oid **coOids, Oid **dnOids,
 							int *num_coords, int *num_dns,
 							bool update_preferred);
 extern NodeDefinition *PgxcNodeGetDefinition(Oid node);
+extern Oid	PgxcNodeGetStandby(Oid node, uint32 hint);
 extern void PgxcNodeAlter(AlterNodeStmt *stmt);
 extern void PgxcNodeCreate(CreateNodeStmt *stmt);
 extern void PgxcNodeRemove(DropNodeStmt *stmt);
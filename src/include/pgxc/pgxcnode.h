@@ -20,6 +20,7 @@
 #include "utils/timestamp.h"
 #include "nodes/pg_list.h"
 #include "utils/snapshot.h"
+#include "lib/stringinfo.h"
 #include <unistd.h>
 
 #define NO_SOCKET -1
@@ -99,6 +100,22 @@ struct pgxc_node_handle
 	size_t		inEnd;
 	size_t		inCursor;
 
+	/*
+	 * Stream compression, see pgxc_node_set_compression.  When it is on,
+	 * the buffers above hold plain protocol data as usual, and the frames
+	 * exchanged over the socket go through these.
+	 */
+	bool		compress;
+	StringInfoData compressOut;	/* frames not sent yet, from cursor on */
+	StringInfoData compressIn;	/* frames not decompressed yet */
+	uint64		rawBytesSent;		/* counters, before and after */
+	uint64		wireBytesSent;		/* compression */
+	uint64		rawBytesReceived;
+	uint64		wireBytesReceived;
+
+	/* Connected to a hot standby of the Datanode, see get_handles */
+	bool		standby;
+
 	/*
 	 * Have a variable to enable/disable response checking and
 	 * if enable then read the result of response checking
@@ -155,6 +172,9 @@ extern int	ensure_in_buffer_capacity(size_t bytes_needed, PGXCNodeHandle * handl
 extern int	ensure_out_buffer_capacity(size_t bytes_needed, PGXCNodeHandle * handle);
 
 extern int	pgxc_node_send_query(PGXCNodeHandle * handle, const char *query);
+extern int	pgxc_node_send_plan_request(PGXCNodeHandle *handle);
+extern int	pgxc_node_send_plan(PGXCNodeHandle *handle, const char *query,
+					const char *plan, int planlen);
 extern int	pgxc_node_send_describe(PGXCNodeHandle * handle, bool is_statement,
 						const char *name);
 extern int	pgxc_node_send_execute(PGXCNodeHandle * handle, const char *portal, int fetch);
@@ -197,4 +217,10 @@ extern Datum pgxc_execute_on_nodes(int numnodes, Oid *nodelist, char *query);
 /* New GUC to store delay value of cancel delay dulation in millisecond */
 extern int pgxcnode_cancel_delay;
 
+/* Nodes to compress the traffic with, see pgxc_node_set_compression */
+extern char *pgxcnode_compression;
+
+/* Send read-only transactions to Datanode hot standbys, see get_handles */
+extern bool pgxcnode_standby_reads;
+
 #endif /* PGXCNODE_H */
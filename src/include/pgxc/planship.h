@@ -0,0 +1,54 @@
+/*-------------------------------------------------------------------------
+ *
+ * planship.h
+ *
+ *		Shipping plans made by one Datanode to the others
+ *
+ * Portions Copyright (c) 1996-2011, PostgreSQL Global Development Group
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ * src/include/pgxc/planship.h
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef PLANSHIP_H
+#define PLANSHIP_H
+
+#include "lib/stringinfo.h"
+#include "nodes/plannodes.h"
+
+/*
+ * When a read-only statement goes to several Datanodes, the Coordinator may
+ * send it to the first one preceded by a 'j' message.  That Datanode then
+ * answers with a 'Y' message before running the statement:
+ *
+ *		float8	milliseconds spent parsing and planning the statement
+ *		plan	if the plan can be run by other Datanodes, nothing otherwise
+ *
+ * and the Coordinator sends the others a 'y' message instead of 'Q':
+ *
+ *		string	the statement
+ *		plan	as received
+ *
+ * where a plan is
+ *
+ *		string	nodeToString() of the PlannedStmt
+ *		int32	number of relations the plan refers to by Oid
+ *		for each of them
+ *			int32	Oid on the node which made the plan
+ *			string	schema name
+ *			string	relation name
+ *			int32	number of attributes
+ *
+ * Other Oids in a shipped plan are those of built-in objects, which are the
+ * same on every node.  A Datanode on which the relations do not match falls
+ * back to planning the statement itself.
+ */
+
+extern bool enable_plan_shipping;
+
+extern void pgxc_plan_send(PlannedStmt *stmt, double planning_time);
+extern PlannedStmt *pgxc_plan_receive(StringInfo msg);
+
+#endif   /* PLANSHIP_H */
@@ -106,6 +106,9 @@ typedef struct
 	Oid		   	   *dn_conn_oids;		/* one for each Datanode */
 	Oid		   	   *coord_conn_oids;	/* one for each Coordinator */
 	PGXCNodePoolSlot **dn_connections; /* one for each Datanode */
+	Oid			   *dn_slot_oids;		/* node each Datanode connection
+										 * comes from, the Datanode or one of
+										 * its standbys */
 	PGXCNodePoolSlot **coord_connections; /* one for each Coordinator */
 	char		   *session_params;
 	char		   *local_params;
@@ -181,8 +184,12 @@ extern void PoolManagerReconnect(void);
  */
 extern int PoolManagerSetCommand(PoolCommandType command_type, const char *set_command);
 
-/* Get pooled connections */
-extern int *PoolManagerGetConnections(List *datanodelist, List *coordlist);
+/*
+ * Get pooled connections, to hot standbys of the Datanodes rather than to
+ * the Datanodes themselves where possible if standby is true
+ */
+extern int *PoolManagerGetConnections(List *datanodelist, List *coordlist,
+						  bool standby);
 
 /* Clean pool connections */
 extern void PoolManagerCleanConnection(List *datanodelist, List *coordlist, char *dbname, char *username);
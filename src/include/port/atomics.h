@@ -0,0 +1,266 @@
+/*-------------------------------------------------------------------------
+ *
+ * atomics.h
+ *	  Atomic operations.
+ *
+ * Hardware and compiler dependent functions for manipulating memory
+ * atomically and dealing with cache coherency.  Used to implement locking
+ * facilities and lockless algorithms/data structures.
+ *
+ * All of the read-modify-write operations provided here (compare-exchange,
+ * exchange and the fetch-and-op family) act as full memory barriers.
+ * pg_atomic_read_u32 and pg_atomic_write_u32 only guarantee that the value
+ * is read or written in one piece; they do not imply any barrier semantics.
+ *
+ * With a compiler providing the GCC __sync builtins (HAVE_GCC_INT_ATOMICS)
+ * the operations map directly onto those.  Otherwise, each atomic variable
+ * carries its own spinlock, which is used to emulate the operations.  That
+ * is much slower, but it keeps the code using these facilities simple and
+ * portable.  Note that with the fallback, atomic variables must live in
+ * shared memory (or be otherwise accessible to S_LOCK), and must be
+ * initialized with pg_atomic_init_u32 before use, as usual.
+ *
+ * Use higher level functionality (lwlocks, spinlocks, heavyweight locks)
+ * whenever possible.  Writing correct code using these facilities is hard.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/port/atomics.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef ATOMICS_H
+#define ATOMICS_H
+
+#include <limits.h>
+
+#ifndef HAVE_GCC_INT_ATOMICS
+#include "storage/s_lock.h"
+#endif
+
+typedef struct pg_atomic_uint32
+{
+#ifndef HAVE_GCC_INT_ATOMICS
+	slock_t		sema;			/* protects value, see file header */
+#endif
+	volatile uint32 value;
+} pg_atomic_uint32;
+
+
+/*
+ * The functions are defined in this header so that they can be inlined;
+ * see STATIC_IF_INLINE in c.h.
+ */
+#ifndef PG_USE_INLINE
+extern void pg_atomic_init_u32(volatile pg_atomic_uint32 *ptr, uint32 val);
+extern uint32 pg_atomic_read_u32(volatile pg_atomic_uint32 *ptr);
+extern void pg_atomic_write_u32(volatile pg_atomic_uint32 *ptr, uint32 val);
+extern uint32 pg_atomic_exchange_u32(volatile pg_atomic_uint32 *ptr,
+					   uint32 newval);
+extern bool pg_atomic_compare_exchange_u32(volatile pg_atomic_uint32 *ptr,
+							   uint32 *expected, uint32 newval);
+extern uint32 pg_atomic_fetch_add_u32(volatile pg_atomic_uint32 *ptr,
+						int32 add_);
+extern uint32 pg_atomic_fetch_sub_u32(volatile pg_atomic_uint32 *ptr,
+						int32 sub_);
+extern uint32 pg_atomic_fetch_and_u32(volatile pg_atomic_uint32 *ptr,
+						uint32 and_);
+extern uint32 pg_atomic_fetch_or_u32(volatile pg_atomic_uint32 *ptr,
+					   uint32 or_);
+extern uint32 pg_atomic_add_fetch_u32(volatile pg_atomic_uint32 *ptr,
+						int32 add_);
+extern uint32 pg_atomic_sub_fetch_u32(volatile pg_atomic_uint32 *ptr,
+						int32 sub_);
+#endif   /* !PG_USE_INLINE */
+
+#if defined(PG_USE_INLINE) || defined(ATOMICS_INCLUDE_DEFINITIONS)
+
+/*
+ * pg_atomic_init_u32 - initialize atomic variable
+ *
+ * Has to be done before any concurrent usage.
+ */
+STATIC_IF_INLINE void
+pg_atomic_init_u32(volatile pg_atomic_uint32 *ptr, uint32 val)
+{
+#ifndef HAVE_GCC_INT_ATOMICS
+	S_INIT_LOCK(&ptr->sema);
+#endif
+	ptr->value = val;
+}
+
+/*
+ * pg_atomic_read_u32 - unlocked read from atomic variable
+ *
+ * No barrier semantics; the value read may be stale by the time it is
+ * used.
+ */
+STATIC_IF_INLINE uint32
+pg_atomic_read_u32(volatile pg_atomic_uint32 *ptr)
+{
+	return ptr->value;
+}
+
+/*
+ * pg_atomic_write_u32 - unlocked write to atomic variable
+ *
+ * No barrier semantics.  Concurrent read-modify-write operations on the
+ * same variable may overwrite the stored value.
+ */
+STATIC_IF_INLINE void
+pg_atomic_write_u32(volatile pg_atomic_uint32 *ptr, uint32 val)
+{
+	ptr->value = val;
+}
+
+/*
+ * pg_atomic_compare_exchange_u32 - CAS operation
+ *
+ * Atomically compare the current value of ptr with *expected and store
+ * newval iff they are equal.  Returns true if values have been exchanged;
+ * otherwise the current value is returned in *expected.
+ */
+STATIC_IF_INLINE bool
+pg_atomic_compare_exchange_u32(volatile pg_atomic_uint32 *ptr,
+							   uint32 *expected, uint32 newval)
+{
+#ifdef HAVE_GCC_INT_ATOMICS
+	uint32		current;
+
+	current = __sync_val_compare_and_swap(&ptr->value, *expected, newval);
+	if (current == *expected)
+		return true;
+	*expected = current;
+	return false;
+#else
+	bool		ret;
+
+	S_LOCK(&ptr->sema);
+	ret = (ptr->value == *expected);
+	if (ret)
+		ptr->value = newval;
+	else
+		*expected = ptr->value;
+	S_UNLOCK(&ptr->sema);
+	return ret;
+#endif
+}
+
+/*
+ * pg_atomic_exchange_u32 - exchange newval with current value
+ *
+ * Returns the old value of ptr.
+ */
+STATIC_IF_INLINE uint32
+pg_atomic_exchange_u32(volatile pg_atomic_uint32 *ptr, uint32 newval)
+{
+	uint32		old;
+
+	old = pg_atomic_read_u32(ptr);
+	while (!pg_atomic_compare_exchange_u32(ptr, &old, newval))
+		 /* skip */ ;
+	return old;
+}
+
+/*
+ * pg_atomic_fetch_add_u32 - atomically add to variable
+ *
+ * Returns the value of ptr before the arithmetic operation.
+ */
+STATIC_IF_INLINE uint32
+pg_atomic_fetch_add_u32(volatile pg_atomic_uint32 *ptr, int32 add_)
+{
+#ifdef HAVE_GCC_INT_ATOMICS
+	return __sync_fetch_and_add(&ptr->value, add_);
+#else
+	uint32		old;
+
+	S_LOCK(&ptr->sema);
+	old = ptr->value;
+	ptr->value = old + add_;
+	S_UNLOCK(&ptr->sema);
+	return old;
+#endif
+}
+
+/*
+ * pg_atomic_fetch_sub_u32 - atomically subtract from variable
+ *
+ * Returns the value of ptr before the arithmetic operation.  Note that
+ * sub_ may not be INT_MIN due to platform limitations.
+ */
+STATIC_IF_INLINE uint32
+pg_atomic_fetch_sub_u32(volatile pg_atomic_uint32 *ptr, int32 sub_)
+{
+	Assert(sub_ != INT_MIN);
+	return pg_atomic_fetch_add_u32(ptr, -sub_);
+}
+
+/*
+ * pg_atomic_fetch_and_u32 - atomically bit-and and_ with variable
+ *
+ * Returns the value of ptr before the operation.
+ */
+STATIC_IF_INLINE uint32
+pg_atomic_fetch_and_u32(volatile pg_atomic_uint32 *ptr, uint32 and_)
+{
+#ifdef HAVE_GCC_INT_ATOMICS
+	return __sync_fetch_and_and(&ptr->value, and_);
+#else
+	uint32		old;
+
+	old = pg_atomic_read_u32(ptr);
+	while (!pg_atomic_compare_exchange_u32(ptr, &old, old & and_))
+		 /* skip */ ;
+	return old;
+#endif
+}
+
+/*
+ * pg_atomic_fetch_or_u32 - atomically bit-or or_ with variable
+ *
+ * Returns the value of ptr before the operation.
+ */
+STATIC_IF_INLINE uint32
+pg_atomic_fetch_or_u32(volatile pg_atomic_uint32 *ptr, uint32 or_)
+{
+#ifdef HAVE_GCC_INT_ATOMICS
+	return __sync_fetch_and_or(&ptr->value, or_);
+#else
+	uint32		old;
+
+	old = pg_atomic_read_u32(ptr);
+	while (!pg_atomic_compare_exchange_u32(ptr, &old, old | or_))
+		 /* skip */ ;
+	return old;
+#endif
+}
+
+/*
+ * pg_atomic_add_fetch_u32 - atomically add to variable
+ *
+ * Returns the value of ptr after the arithmetic operation.
+ */
+STATIC_IF_INLINE uint32
+pg_atomic_add_fetch_u32(volatile pg_atomic_uint32 *ptr, int32 add_)
+{
+	return pg_atomic_fetch_add_u32(ptr, add_) + add_;
+}
+
+/*
+ * pg_atomic_sub_fetch_u32 - atomically subtract from variable
+ *
+ * Returns the value of ptr after the arithmetic operation.  Note that sub_
+ * may not be INT_MIN due to platform limitations.
+ */
+STATIC_IF_INLINE uint32
+pg_atomic_sub_fetch_u32(volatile pg_atomic_uint32 *ptr, int32 sub_)
+{
+	Assert(sub_ != INT_MIN);
+	return pg_atomic_fetch_add_u32(ptr, -sub_) - sub_;
+}
+
+#endif   /* PG_USE_INLINE || ATOMICS_INCLUDE_DEFINITIONS */
+
+#endif   /* ATOMICS_H */
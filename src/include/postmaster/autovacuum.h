@@ -32,6 +32,9 @@ extern double autovacuum_anl_scale;
 extern int	autovacuum_freeze_max_age;
 extern int	autovacuum_vac_cost_delay;
 extern int	autovacuum_vac_cost_limit;
+#ifdef PGXC
+extern int	autovacuum_parallel_vacuum_workers;
+#endif
 
 /* autovacuum launcher PID, only valid when worker is shutting down */
 extern int	AutovacuumLauncherPid;
@@ -98,6 +98,19 @@ typedef struct
 	XLogRecPtr	latestWalEnd;
 	TimestampTz latestWalEndTime;
 
+#ifdef PGXC
+	/*
+	 * End of WAL on the primary, for backends that must see everything
+	 * committed there up to now, see GetPrimaryWalEnd.  A backend bumps
+	 * walEndRequested and wakes up walreceiver, which asks the primary.
+	 * Once walEndAnswered has caught up with the request, primaryWalEnd was
+	 * read on the primary after the request was made.
+	 */
+	uint64		walEndRequested;
+	uint64		walEndAnswered;
+	XLogRecPtr	primaryWalEnd;
+#endif
+
 	/*
 	 * connection string; is used for walreceiver to connect with the primary.
 	 */
@@ -153,5 +166,8 @@ extern void RequestXLogStreaming(TimeLineID tli, XLogRecPtr recptr, const char *
 extern XLogRecPtr GetWalRcvWriteRecPtr(XLogRecPtr *latestChunkStart, TimeLineID *receiveTLI);
 extern int	GetReplicationApplyDelay(void);
 extern int	GetReplicationTransferLatency(void);
+#ifdef PGXC
+extern XLogRecPtr GetPrimaryWalEnd(int timeout);
+#endif
 
 #endif   /* _WALRECEIVER_H */
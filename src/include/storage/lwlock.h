@@ -31,6 +31,15 @@
 #define LOG2_NUM_PREDICATELOCK_PARTITIONS  4
 #define NUM_PREDICATELOCK_PARTITIONS  (1 << LOG2_NUM_PREDICATELOCK_PARTITIONS)
 
+/*
+ * Number of WAL insertion locks.  Each concurrent WAL insertion needs one
+ * of these; reserving space in WAL is done under a spinlock, so more locks
+ * only allow more backends to copy their records into the WAL buffers in
+ * parallel.  Waiting for in-progress insertions to finish has to scan all
+ * of them, so this shouldn't be made too large either.
+ */
+#define NUM_XLOGINSERT_LOCKS  8
+
 /*
  * We have a number of predefined LWLocks, plus a bunch of LWLocks that are
  * dynamically assigned (e.g., for shared buffers).  The LWLock structures
@@ -46,14 +55,14 @@
  */
 typedef enum LWLockId
 {
-	BufFreelistLock,
+	UnusedLock0,				/* formerly BufFreelistLock */
 	ShmemIndexLock,
 	OidGenLock,
 	XidGenLock,
 	ProcArrayLock,
 	SInvalReadLock,
 	SInvalWriteLock,
-	WALInsertLock,
+	WALBufMappingLock,
 	WALWriteLock,
 	ControlFileLock,
 	CheckpointLock,
@@ -87,9 +96,10 @@ typedef enum LWLockId
 	FirstBufMappingLock,
 	FirstLockMgrLock = FirstBufMappingLock + NUM_BUFFER_PARTITIONS,
 	FirstPredicateLockMgrLock = FirstLockMgrLock + NUM_LOCK_PARTITIONS,
+	FirstWALInsertLock = FirstPredicateLockMgrLock + NUM_PREDICATELOCK_PARTITIONS,
 
 	/* must be last except for MaxDynamicLWLock: */
-	NumFixedLWLocks = FirstPredicateLockMgrLock + NUM_PREDICATELOCK_PARTITIONS,
+	NumFixedLWLocks = FirstWALInsertLock + NUM_XLOGINSERT_LOCKS,
 
 	MaxDynamicLWLock = 1000000000
 } LWLockId;
@@ -113,6 +123,10 @@ extern LWLockId LWLockAssign(void);
 extern void LWLockAcquire(LWLockId lockid, LWLockMode mode);
 extern bool LWLockConditionalAcquire(LWLockId lockid, LWLockMode mode);
 extern bool LWLockAcquireOrWait(LWLockId lockid, LWLockMode mode);
+extern bool LWLockAcquireWithVar(LWLockId lockid, uint64 *valptr, uint64 val);
+extern bool LWLockWaitForVar(LWLockId lockid, uint64 *valptr, uint64 oldval,
+				 uint64 *newval);
+extern void LWLockUpdateVar(LWLockId lockid, uint64 *valptr, uint64 value);
 extern void LWLockRelease(LWLockId lockid);
 extern void LWLockReleaseAll(void);
 extern bool LWLockHeldByMe(LWLockId lockid);
@@ -32,6 +32,8 @@ extern void ProcArrayInitRecovery(TransactionId initializedUptoXID);
 extern void SetGlobalSnapshotData(int xmin, int xmax, int xcnt, int *xip);
 extern void UnsetGlobalSnapshotData(void);
 extern void ReloadConnInfoOnBackends(void);
+
+extern int	standby_read_timeout;
 #endif /* PGXC */
 
 extern void ProcArrayApplyRecoveryInfo(RunningTransactions running);
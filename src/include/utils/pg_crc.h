@@ -57,6 +57,49 @@ do { \
 extern CRCDLLIMPORT const uint32 pg_crc32_table[];
 
 
+/*
+ * CRC-32C (Castagnoli) support.  This is a "reflected" CRC, computed by
+ * pg_comp_crc32c(), which uses the SSE 4.2 crc32 instruction when the CPU
+ * supports it and a slicing-by-8 table lookup otherwise.  See
+ * src/port/pg_crc32c.c.  This is what WAL records, two-phase state files
+ * and the control file are checksummed with.
+ */
+typedef uint32 pg_crc32c;
+
+/* Initialize a CRC-32C accumulator */
+#define INIT_CRC32C(crc) ((crc) = 0xFFFFFFFF)
+
+/* Accumulate some (more) bytes into a CRC-32C */
+#define COMP_CRC32C(crc, data, len) \
+	((crc) = pg_comp_crc32c((crc), (data), (len)))
+
+/* Finish a CRC-32C calculation */
+#define FIN_CRC32C(crc) ((crc) ^= 0xFFFFFFFF)
+
+/* Check for equality of two CRC-32Cs */
+#define EQ_CRC32C(c1,c2)  ((c1) == (c2))
+
+/*
+ * The SSE 4.2 implementation relies on GCC's target attribute to use the
+ * crc32 instruction without compiling everything with -msse4.2, so it is
+ * only available with GCC 4.9 or later on x86.  Whether the CPU actually
+ * supports the instruction is checked at runtime.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+	(__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define USE_SSE42_CRC32C_WITH_RUNTIME_CHECK
+#endif
+
+extern pg_crc32c pg_comp_crc32c_sb8(pg_crc32c crc, const void *data, size_t len);
+
+#ifdef USE_SSE42_CRC32C_WITH_RUNTIME_CHECK
+extern pg_crc32c pg_comp_crc32c_sse42(pg_crc32c crc, const void *data, size_t len);
+extern CRCDLLIMPORT pg_crc32c (*pg_comp_crc32c) (pg_crc32c crc, const void *data, size_t len);
+#else
+#define pg_comp_crc32c(crc, data, len) pg_comp_crc32c_sb8(crc, data, len)
+#endif
+
+
 #ifdef PROVIDE_64BIT_CRC
 
 /*
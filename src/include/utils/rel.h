@@ -215,6 +215,8 @@ typedef struct StdRdOptions
 	int			fillfactor;		/* page fill factor in percent (0..100) */
 	AutoVacOpts autovacuum;		/* autovacuum-related options */
 	bool		security_barrier;		/* for views */
+	bool		deduplicate_items;		/* for btree indexes */
+	int			parallel_vacuum_workers;	/* -1 for the default */
 } StdRdOptions;
 
 #define HEAP_MIN_FILLFACTOR			10
@@ -289,6 +291,21 @@ typedef struct StdRdOptions
  */
 #define RelationGetNumberOfAttributes(relation) ((relation)->rd_rel->relnatts)
 
+/*
+ * IndexRelationGetNumberOfAttributes
+ *		Returns the total number of attributes in an index relation.
+ */
+#define IndexRelationGetNumberOfAttributes(relation) \
+	((relation)->rd_index->indnatts)
+
+/*
+ * IndexRelationGetNumberOfKeyAttributes
+ *		Returns the number of key attributes in an index relation, that is
+ *		the ones that are not INCLUDE columns.
+ */
+#define IndexRelationGetNumberOfKeyAttributes(relation) \
+	((relation)->rd_index->indnkeyatts)
+
 /*
  * RelationGetDescr
  *		Returns tuple descriptor for a relation.
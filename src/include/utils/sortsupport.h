@@ -48,6 +48,7 @@
 #define SORTSUPPORT_H
 
 #include "access/attnum.h"
+#include "utils/relcache.h"
 
 typedef struct SortSupportData *SortSupport;
 
@@ -96,8 +97,41 @@ typedef struct SortSupportData
 	int			(*comparator) (Datum x, Datum y, SortSupport ssup);
 
 	/*
-	 * Additional sort-acceleration functions might be added here later.
+	 * "Abbreviated key" infrastructure follows.
+	 *
+	 * An abbreviated key is a pass-by-value Datum built from the original
+	 * value, such that comparing two abbreviated keys with the comparator
+	 * gives the same answer as comparing the originals, except that it may
+	 * report two unequal originals as equal.  Ties have to be broken with
+	 * abbrev_full_comparator on the original values.  The sort support
+	 * function may use abbreviated keys only when the caller set "abbreviate"
+	 * before calling it; it then sets "comparator" to the cheap comparator
+	 * of abbreviated keys, and the three function pointers below.  Only
+	 * tuplesort.c uses abbreviated keys at present, and only for the leading
+	 * sort key.
 	 */
+	bool		abbreviate;		/* may use abbreviated keys? */
+
+	/*
+	 * Converter from the original value to its abbreviated key.  It is
+	 * never passed a NULL.
+	 */
+	Datum		(*abbrev_converter) (Datum original, SortSupport ssup);
+
+	/*
+	 * Called now and then while keys are being abbreviated, with the number
+	 * of tuples seen so far.  Returning true means abbreviation is not
+	 * paying off (e.g. too many keys share an abbreviation), and the caller
+	 * should go back to comparing original values with
+	 * abbrev_full_comparator.
+	 */
+	bool		(*abbrev_abort) (int memtupcount, SortSupport ssup);
+
+	/*
+	 * Comparator of the original values, used to break ties between equal
+	 * abbreviated keys and after abbreviation is abandoned.
+	 */
+	int			(*abbrev_full_comparator) (Datum x, Datum y, SortSupport ssup);
 } SortSupportData;
 
 
@@ -109,6 +143,9 @@ typedef struct SortSupportData
 extern int ApplySortComparator(Datum datum1, bool isNull1,
 					Datum datum2, bool isNull2,
 					SortSupport ssup);
+extern int ApplySortAbbrevFullComparator(Datum datum1, bool isNull1,
+							  Datum datum2, bool isNull2,
+							  SortSupport ssup);
 #endif   /* !PG_USE_INLINE */
 #if defined(PG_USE_INLINE) || defined(SORTSUPPORT_INCLUDE_DEFINITIONS)
 /*
@@ -147,10 +184,51 @@ ApplySortComparator(Datum datum1, bool isNull1,
 
 	return compare;
 }
+
+/*
+ * Same as ApplySortComparator, but compares the original values of a key
+ * whose comparator works on abbreviated keys.
+ */
+STATIC_IF_INLINE int
+ApplySortAbbrevFullComparator(Datum datum1, bool isNull1,
+							  Datum datum2, bool isNull2,
+							  SortSupport ssup)
+{
+	int			compare;
+
+	if (isNull1)
+	{
+		if (isNull2)
+			compare = 0;		/* NULL "=" NULL */
+		else if (ssup->ssup_nulls_first)
+			compare = -1;		/* NULL "<" NOT_NULL */
+		else
+			compare = 1;		/* NULL ">" NOT_NULL */
+	}
+	else if (isNull2)
+	{
+		if (ssup->ssup_nulls_first)
+			compare = 1;		/* NOT_NULL ">" NULL */
+		else
+			compare = -1;		/* NOT_NULL "<" NULL */
+	}
+	else
+	{
+		compare = (*ssup->abbrev_full_comparator) (datum1, datum2, ssup);
+		if (ssup->ssup_reverse)
+			compare = -compare;
+	}
+
+	return compare;
+}
 #endif   /*-- PG_USE_INLINE || SORTSUPPORT_INCLUDE_DEFINITIONS */
 
 /* Other functions in utils/sort/sortsupport.c */
 extern void PrepareSortSupportComparisonShim(Oid cmpFunc, SortSupport ssup);
 extern void PrepareSortSupportFromOrderingOp(Oid orderingOp, SortSupport ssup);
+extern void PrepareSortSupportFromIndexRel(Relation indexRel, int16 strategy,
+							   SortSupport ssup);
+extern Datum AbbrevKeyFromBytes(const char *data, Size len);
+extern int	AbbrevKeyUnsignedCmp(Datum x, Datum y, SortSupport ssup);
 
 #endif   /* SORTSUPPORT_H */
@@ -0,0 +1,180 @@
+/*-------------------------------------------------------------------------
+ *
+ * crc32c_bench.c
+ *		Verify and benchmark the CRC-32C implementations.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/test/crc32c/crc32c_bench.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres_fe.h"
+
+#include <sys/time.h>
+
+#include "utils/pg_crc.h"
+
+typedef pg_crc32c (*crc32c_func) (pg_crc32c crc, const void *data, size_t len);
+
+/* record sizes to measure; roughly the range of typical WAL records */
+static const size_t record_sizes[] = {8, 16, 32, 64, 128, 256, 512, 1024, 8192};
+
+#define MAX_RECORD_SIZE 8192
+
+static double
+elapsed_secs(struct timeval * start, struct timeval * stop)
+{
+	return (stop->tv_sec - start->tv_sec) +
+		(stop->tv_usec - start->tv_usec) / 1000000.0;
+}
+
+/*
+ * Compute CRC-32C of each length with the given implementation, starting at
+ * every alignment, and compare against the slicing-by-8 one.
+ */
+static bool
+check_impl(const char *name, crc32c_func func, const unsigned char *buf)
+{
+	size_t		len;
+	size_t		off;
+
+	for (len = 0; len < 64; len++)
+	{
+		for (off = 0; off < 8; off++)
+		{
+			pg_crc32c	expected;
+			pg_crc32c	actual;
+
+			INIT_CRC32C(expected);
+			expected = pg_comp_crc32c_sb8(expected, buf + off, len);
+			FIN_CRC32C(expected);
+
+			INIT_CRC32C(actual);
+			actual = func(actual, buf + off, len);
+			FIN_CRC32C(actual);
+
+			if (!EQ_CRC32C(expected, actual))
+			{
+				fprintf(stderr, "%s: mismatch for length %lu at offset %lu: %08X != %08X\n",
+						name, (unsigned long) len, (unsigned long) off,
+						actual, expected);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static void
+bench_crc32c(const char *name, crc32c_func func, const unsigned char *buf,
+			 size_t len, long total_bytes)
+{
+	long		loops = total_bytes / len;
+	long		i;
+	pg_crc32c	crc = 0;
+	struct timeval start,
+				stop;
+	double		secs;
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < loops; i++)
+	{
+		pg_crc32c	c;
+
+		INIT_CRC32C(c);
+		c = func(c, buf, len);
+		FIN_CRC32C(c);
+		crc += c;
+	}
+	gettimeofday(&stop, NULL);
+
+	secs = elapsed_secs(&start, &stop);
+	printf("%-8s %6lu bytes: %10.1f MB/s (%08X)\n", name, (unsigned long) len,
+		   secs > 0 ? (loops * (double) len) / (secs * 1024 * 1024) : 0.0, crc);
+}
+
+static void
+bench_crc32(const unsigned char *buf, size_t len, long total_bytes)
+{
+	long		loops = total_bytes / len;
+	long		i;
+	pg_crc32	crc = 0;
+	struct timeval start,
+				stop;
+	double		secs;
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < loops; i++)
+	{
+		pg_crc32	c;
+
+		INIT_CRC32(c);
+		COMP_CRC32(c, buf, len);
+		FIN_CRC32(c);
+		crc += c;
+	}
+	gettimeofday(&stop, NULL);
+
+	secs = elapsed_secs(&start, &stop);
+	printf("%-8s %6lu bytes: %10.1f MB/s (%08X)\n", "crc32", (unsigned long) len,
+		   secs > 0 ? (loops * (double) len) / (secs * 1024 * 1024) : 0.0, crc);
+}
+
+int
+main(int argc, char *argv[])
+{
+	unsigned char buf[MAX_RECORD_SIZE + 8];
+	long		total_bytes = 256L * 1024 * 1024;
+	pg_crc32c	crc;
+	int			i;
+
+	if (argc > 1)
+		total_bytes = atol(argv[1]) * 1024L * 1024L;
+	if (total_bytes <= 0)
+	{
+		fprintf(stderr, "usage: %s [megabytes]\n", argv[0]);
+		return 1;
+	}
+
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = (unsigned char) (i * 7 + 3);
+
+	/* The standard CRC-32C check value */
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc, "123456789", 9);
+	FIN_CRC32C(crc);
+	if (crc != 0xE3069283)
+	{
+		fprintf(stderr, "CRC-32C of \"123456789\" is %08X, expected E3069283\n", crc);
+		return 1;
+	}
+
+#ifdef USE_SSE42_CRC32C_WITH_RUNTIME_CHECK
+	if (pg_comp_crc32c == pg_comp_crc32c_sse42 &&
+		!check_impl("sse42", pg_comp_crc32c_sse42, buf))
+		return 1;
+	printf("using %s implementation\n",
+		   pg_comp_crc32c == pg_comp_crc32c_sse42 ? "SSE 4.2" : "slicing-by-8");
+#else
+	printf("using slicing-by-8 implementation\n");
+#endif
+	if (!check_impl("sb8", pg_comp_crc32c_sb8, buf))
+		return 1;
+
+	for (i = 0; i < lengthof(record_sizes); i++)
+	{
+		size_t		len = record_sizes[i];
+
+		bench_crc32(buf, len, total_bytes);
+		bench_crc32c("sb8", pg_comp_crc32c_sb8, buf, len, total_bytes);
+#ifdef USE_SSE42_CRC32C_WITH_RUNTIME_CHECK
+		if (pg_comp_crc32c == pg_comp_crc32c_sse42)
+			bench_crc32c("sse42", pg_comp_crc32c_sse42, buf, len, total_bytes);
+#endif
+	}
+
+	return 0;
+}
@@ -0,0 +1,78 @@
+#!/bin/sh
+#-------------------------------------------------------------------------
+#
+# qualbench.sh
+#		Time the evaluation of WHERE clauses over a sequential scan.
+#
+# Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+#
+# src/test/qualbench/qualbench.sh
+#
+#-------------------------------------------------------------------------
+
+DBNAME=${1:-postgres}
+ROWS=${ROWS:-1000000}
+LOOPS=${LOOPS:-20}
+
+PSQL="psql -X -q -v ON_ERROR_STOP=1 -d $DBNAME"
+SCRIPT=`mktemp ${TMPDIR:-/tmp}/qualbench.XXXXXX` || exit 1
+trap 'rm -f $SCRIPT' 0
+
+nrows=`$PSQL -A -t -c "SELECT count(*) FROM qualbench_data" 2>/dev/null`
+if [ "$nrows" != "$ROWS" ]; then
+	echo "creating qualbench_data with $ROWS rows"
+	$PSQL <<SQL || exit 1
+DROP TABLE IF EXISTS qualbench_data;
+CREATE TABLE qualbench_data (a int4, b int4, c int4, d int4, e int8, t text)
+	DISTRIBUTE BY REPLICATION;
+INSERT INTO qualbench_data
+	SELECT g, g % 1000, g % 100, g % 10, g * 1000000::int8, 'row ' || g % 1000
+	FROM generate_series(1, $ROWS) g;
+VACUUM ANALYZE qualbench_data;
+SQL
+fi
+
+# Print the average latency of a query, in milliseconds.  Any further
+# arguments are passed to pgbench.
+run_query()
+{
+	query=$1
+	shift
+	echo "$query" > $SCRIPT
+	out=`pgbench -n -t $LOOPS "$@" -f $SCRIPT $DBNAME 2>&1`
+	lat=`echo "$out" | sed -n 's/^latency average[^0-9]*\([0-9.]*\).*/\1/p'`
+	if [ -z "$lat" ]; then
+		# older pgbench only prints tps; derive the latency from it
+		lat=`echo "$out" | sed -n 's/^tps = \([0-9.]*\) (excluding.*/\1/p' |
+			awk '{ if ($1 > 0) printf "%.3f", 1000 / $1 }'`
+	fi
+	echo "$lat"
+}
+
+# Time a qual, and print its cost per row above the baseline
+measure()
+{
+	name=$1
+	qual=$2
+	shift 2
+	lat=`run_query "SELECT count(*) FROM qualbench_data WHERE $qual;" "$@"`
+	echo "$name $lat $base $ROWS" |
+		awk '{ printf "%-14s %12s %12.1f\n", $1, $2, ($2 - $3) * 1000000 / $4 }'
+}
+
+# the first run also loads the table into shared buffers
+run_query "SELECT count(*) FROM qualbench_data;" > /dev/null
+base=`run_query "SELECT count(*) FROM qualbench_data;"`
+
+printf "%-14s %12s %12s\n" qual "latency ms" "ns per row"
+printf "%-14s %12s\n" none "$base"
+measure var_const "a > 0"
+measure and2 "a > 0 AND b >= 0"
+measure and4 "a > 0 AND b >= 0 AND c >= 0 AND d >= 0"
+measure or3 "a < 0 OR b < 0 OR c >= 0"
+measure not "NOT (a < 0)"
+measure int8 "e > 0"
+measure text "t <> 'none'"
+measure distinct "d IS DISTINCT FROM 10"
+# with -M prepared, :v is sent as a parameter
+measure param ":v < a" -M prepared -D v=0
@@ -862,6 +862,11 @@ set_node_config_file(PGXCNodeTypeNum node)
 		fputs(buf, pg_conf);
 	}
 
+	/* Start parallel scan workers on Datanodes for the parallel scan tests */
+	if (node == PGXC_DATANODE_1 ||
+		node == PGXC_DATANODE_2)
+		fputs("max_parallel_scan_workers = 2\n", pg_conf);
+
 	if (temp_config != NULL)
 	{
 		FILE	   *extra_conf;
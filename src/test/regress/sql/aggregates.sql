@@ -447,3 +447,24 @@ select string_agg(v, NULL order by v) from bytea_test_table;
 select string_agg(v, decode('ee', 'hex') order by v) from bytea_test_table;
 
 drop table bytea_test_table;
+
+-- hashed aggregation spilling groups to disk, in batches that are split
+-- again when they still don't fit
+set work_mem = '64kB';
+set enable_sort = off;
+explain (costs off, nodes off)
+select count(*), sum(k), sum(c), sum(s)
+  from (select g % 100000 as k, count(*) as c, sum(g) as s
+        from generate_series(1, 200000) g group by 1) x;
+select count(*), sum(k), sum(c), sum(s)
+  from (select g % 100000 as k, count(*) as c, sum(g) as s
+        from generate_series(1, 200000) g group by 1) x;
+select count(*)
+  from (select g % 100000 as k, count(*) as c, sum(g) as s
+        from generate_series(1, 200000) g group by 1) x
+  where c <> 2 or (k > 0 and s <> 2 * k + 100000);
+select count(*), sum(length(k))
+  from (select (g % 50000)::text as k, count(*)
+        from generate_series(1, 100000) g group by 1) x;
+reset enable_sort;
+reset work_mem;
@@ -0,0 +1,67 @@
+--
+-- BRIN
+--
+CREATE TABLE brintest (id int, ts timestamp, txt text, n numeric);
+INSERT INTO brintest
+  SELECT i, '2015-01-01'::timestamp + i * interval '1 minute', md5(i::text), i / 10.0
+  FROM generate_series(1, 5000) i;
+INSERT INTO brintest (id) VALUES (NULL), (NULL);
+
+CREATE INDEX brinidx ON brintest USING brin (id, ts, txt, n) WITH (pages_per_range = 0);
+CREATE INDEX brinidx ON brintest USING brin (id, ts, txt, n) WITH (pages_per_range = 2);
+
+SET enable_seqscan = off;
+SET enable_indexscan = off;
+
+-- the plan is made on the Datanodes, so it is looked at on one of them
+CREATE FUNCTION brin_explain(query text) RETURNS SETOF text LANGUAGE plpgsql AS $$
+DECLARE
+	ln text;
+BEGIN
+	FOR ln IN EXECUTE 'EXPLAIN (COSTS OFF) ' || query LOOP
+		RETURN NEXT ln;
+	END LOOP;
+END;
+$$;
+CREATE FUNCTION brin_explain_on_datanode(query text) RETURNS SETOF text LANGUAGE plpgsql AS $$
+DECLARE
+	nodename name;
+	ln text;
+BEGIN
+	SELECT node_name INTO nodename FROM pgxc_node
+		WHERE node_type = 'D' ORDER BY node_name LIMIT 1;
+	FOR ln IN EXECUTE 'EXECUTE DIRECT ON (' || nodename || ') ' ||
+		quote_literal('SELECT brin_explain(' || quote_literal(query) || ')') LOOP
+		RETURN NEXT ln;
+	END LOOP;
+END;
+$$;
+SELECT brin_explain_on_datanode('SELECT count(*) FROM brintest WHERE id < 100');
+
+SELECT count(*) FROM brintest WHERE id < 100;
+SELECT count(*) FROM brintest WHERE id = 2500;
+SELECT count(*) FROM brintest WHERE ts >= '2015-01-02' AND ts < '2015-01-03';
+SELECT count(*) FROM brintest WHERE txt = md5('42');
+SELECT count(*) FROM brintest WHERE n BETWEEN 10 AND 20;
+SELECT count(*) FROM brintest WHERE ts IS NULL;
+SELECT count(*) FROM brintest WHERE ts IS NOT NULL;
+
+-- rows going to ranges not summarized yet are found, before and after VACUUM
+INSERT INTO brintest
+  SELECT i, '2015-01-01'::timestamp + i * interval '1 minute', md5(i::text), i / 10.0
+  FROM generate_series(5001, 6000) i;
+SELECT count(*) FROM brintest WHERE id > 5500;
+VACUUM brintest;
+SELECT count(*) FROM brintest WHERE id > 5500;
+
+-- summaries of existing ranges are widened by new values
+UPDATE brintest SET n = 100000 WHERE id = 10;
+SELECT count(*) FROM brintest WHERE n > 1000;
+SELECT id FROM brintest WHERE n > 1000 ORDER BY id;
+
+RESET enable_seqscan;
+RESET enable_indexscan;
+DROP FUNCTION brin_explain_on_datanode(text);
+DROP FUNCTION brin_explain(text);
+
+DROP TABLE brintest;
@@ -64,3 +64,55 @@ select proname from pg_proc where proname like E'RI\\_FKey%del' order by 1;
 set enable_indexscan to false;
 set enable_bitmapscan to true;
 select proname from pg_proc where proname like E'RI\\_FKey%del' order by 1;
+
+--
+-- Test deduplication of equal keys into posting lists
+--
+reset enable_seqscan;
+reset enable_indexscan;
+reset enable_bitmapscan;
+create table dedup_test (a int, b text);
+insert into dedup_test select i % 10, 'x' from generate_series(1, 10000) i;
+create index dedup_test_a on dedup_test (a);
+create index dedup_test_a_plain on dedup_test (a) with (deduplicate_items = off);
+select pg_relation_size('dedup_test_a') < pg_relation_size('dedup_test_a_plain') as smaller;
+
+-- insertions into posting lists, scans and vacuum
+insert into dedup_test select i % 10, 'y' from generate_series(1, 5000) i;
+drop index dedup_test_a_plain;
+set enable_seqscan to false;
+set enable_bitmapscan to false;
+select count(*) from dedup_test where a = 3;
+select a, count(*) from dedup_test where a < 3 group by a order by a;
+delete from dedup_test where b = 'y' and a < 5;
+delete from dedup_test where a = 7;
+vacuum dedup_test;
+select a, count(*) from dedup_test group by a order by a;
+reset enable_seqscan;
+reset enable_bitmapscan;
+drop table dedup_test;
+
+--
+-- Test non-key INCLUDE columns
+--
+create table include_test (a int, b int, c text);
+create unique index include_test_a on include_test (a) include (b, c);
+select pg_get_indexdef('include_test_a'::regclass);
+select indnatts, indnkeyatts from pg_index where indexrelid = 'include_test_a'::regclass;
+insert into include_test select i, i * 2, 'row ' || i from generate_series(1, 2000) i;
+-- uniqueness only looks at the key column
+insert into include_test values (1, 3, 'dup');
+set enable_seqscan to false;
+set enable_bitmapscan to false;
+select a, b, c from include_test where a between 100 and 103 order by a;
+update include_test set b = b + 1 where a % 2 = 0;
+vacuum include_test;
+select count(*), sum(b) from include_test where a > 1000;
+reset enable_seqscan;
+reset enable_bitmapscan;
+-- things included columns don't support
+create index on include_test (a) include ((b + 1));
+create index on include_test (a) include (c text_pattern_ops);
+create index on include_test (a) include (b desc);
+create index on include_test using hash (a) include (b);
+drop table include_test;
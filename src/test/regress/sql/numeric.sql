@@ -828,3 +828,7 @@ select 12345678901234567890 % 123;
 select 12345678901234567890 / 123;
 select div(12345678901234567890, 123);
 select div(12345678901234567890, 123) * 123 + 12345678901234567890 % 123;
+
+-- sorting, including values whose leading digits are equal and values out
+-- of the range of abbreviated keys
+select t from (values ('nan', 'NaN'::numeric), ('-1e100', -1e100), ('-0.5', -0.5), ('zero', 0), ('1e-200', 1e-200), ('1.0000000000001', 1.0000000000001), ('1.00000000000002', 1.00000000000002), ('1e400', 1e400)) v(t, x) order by x;
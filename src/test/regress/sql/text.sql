@@ -116,3 +116,7 @@ select format('>>%-s<<', 'Hello');
 select format('>>%10L<<', NULL);
 select format('>>%2$*1$L<<', NULL, 'Hello');
 select format('>>%2$*1$L<<', 0, 'Hello');
+
+-- sorting strings that only differ past their first 8 bytes
+select x from (values ('abcdefghij2'), ('abcdefghij1'), ('abcdefgh!'), ('abcdefgh'), ('abc'), (''), (null)) v(x) order by x collate "C";
+select x from (values ('abcdefghij2'), ('abcdefghij1'), ('abcdefgh!'), ('abcdefgh'), ('abc'), (''), (null)) v(x) order by x collate "C" desc;
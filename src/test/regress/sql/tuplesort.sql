@@ -0,0 +1,22 @@
+--
+-- External sorts
+--
+set work_mem = '64kB';
+
+-- A datum sort of a pass-by-value type charges nothing but the memtuples
+-- array to work_mem, so one of these input sizes fills it exactly and the
+-- input ends right after the first run has been written out.
+select n from generate_series(1000, 3000) n
+where array_length((select array_agg(i order by i desc)
+                    from generate_series(1, n) i), 1) is distinct from n;
+
+-- several runs, checking the merged output is complete and in order
+select count(*), count(distinct x) from
+  (select (i * 7919) % 20011 as x from generate_series(1, 20011) i
+   order by 1 offset 0) s;
+select count(*) from
+  (select x, lag(x) over (order by x) as prev from
+     (select (i * 7919) % 20011 as x from generate_series(1, 20011) i) s) s
+where prev >= x;
+
+reset work_mem;
@@ -55,3 +55,21 @@ VACUUM FULL vactst;
 
 DROP TABLE vaccluster;
 DROP TABLE vactst;
+
+-- indexes vacuumed by parallel workers, where the Datanodes have any
+CREATE TABLE vacparallel (i INT, j INT) WITH (parallel_vacuum_workers = 2);
+CREATE INDEX vacparallel_i ON vacparallel (i);
+CREATE INDEX vacparallel_j ON vacparallel (j);
+CREATE INDEX vacparallel_ij ON vacparallel (i, j);
+INSERT INTO vacparallel SELECT g, g % 100 FROM generate_series(1, 10000) g;
+DELETE FROM vacparallel WHERE i % 3 = 0;
+VACUUM vacparallel;
+SET parallel_vacuum_workers = 1;
+ALTER TABLE vacparallel RESET (parallel_vacuum_workers);
+DELETE FROM vacparallel WHERE j < 50;
+VACUUM vacparallel;
+RESET parallel_vacuum_workers;
+SELECT count(*) FROM vacparallel WHERE i > 5000;
+SELECT count(*) FROM vacparallel WHERE j = 60;
+ALTER TABLE vacparallel SET (parallel_vacuum_workers = 300);
+DROP TABLE vacparallel;
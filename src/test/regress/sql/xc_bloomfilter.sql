@@ -0,0 +1,44 @@
+--
+-- XC_BLOOMFILTER
+--
+
+-- Bloom filters sent by Coordinator hash joins to the remote scans of their
+-- outer side.  Whether a filter is used depends on the plan, so only check
+-- that the results do not change.
+SET enable_fast_query_shipping TO false;
+SET enable_remotejoin TO false;
+SET enable_nestloop TO false;
+SET enable_mergejoin TO false;
+
+CREATE TABLE xc_bloom_outer (a int, b text) DISTRIBUTE BY ROUNDROBIN;
+CREATE TABLE xc_bloom_inner (a int, c int) DISTRIBUTE BY ROUNDROBIN;
+INSERT INTO xc_bloom_outer SELECT i, 'v' || i FROM generate_series(1, 1000) i;
+INSERT INTO xc_bloom_outer VALUES (NULL, 'null');
+INSERT INTO xc_bloom_inner SELECT i * 10, i FROM generate_series(1, 20) i;
+INSERT INTO xc_bloom_inner VALUES (NULL, 0);
+ANALYZE xc_bloom_outer;
+ANALYZE xc_bloom_inner;
+
+SET enable_remotebloomfilter TO on;
+SELECT count(*), sum(o.a), sum(i.c) FROM xc_bloom_outer o JOIN xc_bloom_inner i ON o.a = i.a;
+SELECT count(*) FROM xc_bloom_outer o WHERE o.a IN (SELECT a FROM xc_bloom_inner);
+SELECT count(*), count(o.a) FROM xc_bloom_outer o RIGHT JOIN xc_bloom_inner i ON o.a = i.a;
+-- NULL join keys match nothing
+SELECT count(*) FROM xc_bloom_outer o JOIN xc_bloom_inner i ON o.a = i.a WHERE o.a IS NULL;
+SELECT count(*) FROM xc_bloom_outer o JOIN xc_bloom_inner i ON o.a = i.a WHERE i.a IS NULL;
+-- empty inner side
+SELECT count(*) FROM xc_bloom_outer o JOIN xc_bloom_inner i ON o.a = i.a WHERE i.c > 100;
+SELECT count(*) FROM xc_bloom_outer o WHERE o.a IN (SELECT a FROM xc_bloom_inner WHERE c < 0);
+-- the same without filters
+SET enable_remotebloomfilter TO off;
+SELECT count(*), sum(o.a), sum(i.c) FROM xc_bloom_outer o JOIN xc_bloom_inner i ON o.a = i.a;
+SELECT count(*) FROM xc_bloom_outer o WHERE o.a IN (SELECT a FROM xc_bloom_inner);
+SELECT count(*), count(o.a) FROM xc_bloom_outer o RIGHT JOIN xc_bloom_inner i ON o.a = i.a;
+
+RESET enable_remotebloomfilter;
+RESET enable_mergejoin;
+RESET enable_nestloop;
+RESET enable_remotejoin;
+RESET enable_fast_query_shipping;
+DROP TABLE xc_bloom_outer;
+DROP TABLE xc_bloom_inner;
@@ -0,0 +1,45 @@
+--
+-- XC_COMPRESSION
+--
+
+-- Compression of the traffic between the Coordinator and the Datanodes
+CREATE TABLE xc_compress (a int, b text) DISTRIBUTE BY HASH (a);
+INSERT INTO xc_compress SELECT i, repeat('pgxc', 50) || i
+	FROM generate_series(1, 2000) i;
+
+-- the rows are all sent to the Coordinator by string_agg
+SET pgxcnode_compression = '*';
+BEGIN;
+SELECT md5(string_agg(b, ',' ORDER BY a)) FROM xc_compress;
+SELECT bool_and(s.compressed) AS compressed,
+	bool_and(s.bytes_received < s.raw_bytes_received) AS smaller
+	FROM pgxc_node_compression_stats() s JOIN pgxc_node n USING (node_name)
+	WHERE n.node_type = 'D';
+COMMIT;
+
+-- the connections go back to the pool uncompressed and can be used as usual
+RESET pgxcnode_compression;
+BEGIN;
+SELECT md5(string_agg(b, ',' ORDER BY a)) FROM xc_compress;
+SELECT bool_or(s.compressed) AS compressed
+	FROM pgxc_node_compression_stats() s JOIN pgxc_node n USING (node_name)
+	WHERE n.node_type = 'D';
+COMMIT;
+
+-- or compressed again
+SET pgxcnode_compression = '*';
+BEGIN;
+SELECT md5(string_agg(b, ',' ORDER BY a)) FROM xc_compress;
+SELECT bool_and(s.compressed) AS compressed
+	FROM pgxc_node_compression_stats() s JOIN pgxc_node n USING (node_name)
+	WHERE n.node_type = 'D';
+COMMIT;
+SELECT count(*), sum(a) FROM xc_compress WHERE a % 100 = 0;
+
+-- node names that match no node are accepted, a bad list is not
+SET pgxcnode_compression = 'no_such_node';
+SELECT count(*) FROM xc_compress;
+SET pgxcnode_compression = 'a,,b';
+
+RESET pgxcnode_compression;
+DROP TABLE xc_compress;
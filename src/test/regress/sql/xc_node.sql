@@ -39,3 +39,16 @@ ALTER NODE dummy_node WITH (PREFERRED);
 ALTER NODE dummy_node WITH (PRIMARY);
 ALTER NODE dummy_node WITH (TYPE = 'datanode');
 DROP NODE dummy_node;
+-- Hot standbys of Datanodes
+CREATE NODE dummy_node_datanode WITH (TYPE = 'datanode', PORT = 5689);
+CREATE NODE dummy_node_standby WITH (TYPE = 'datanode', PORT = 5690, STANDBY_OF = 'dummy_node_datanode');
+SELECT s.node_name, s.node_type, s.node_port, d.node_name AS standby_of
+FROM pgxc_node s JOIN pgxc_node d ON (s.node_standby_of = d.oid)
+WHERE s.node_name = 'dummy_node_standby';
+CREATE NODE dummy_node WITH (TYPE = 'coordinator', STANDBY_OF = 'dummy_node_datanode'); -- fail
+CREATE NODE dummy_node WITH (TYPE = 'datanode', STANDBY_OF = 'dummy_node_standby'); -- fail
+ALTER NODE dummy_node_standby WITH (PREFERRED); -- fail
+ALTER NODE dummy_node_datanode WITH (STANDBY_OF = 'dummy_node_datanode'); -- fail
+DROP NODE dummy_node_datanode; -- fail
+DROP NODE dummy_node_standby;
+DROP NODE dummy_node_datanode;
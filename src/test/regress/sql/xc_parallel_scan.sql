@@ -0,0 +1,33 @@
+--
+-- XC_PARALLEL_SCAN
+--
+
+-- Sequential scans and aggregations split across the parallel scan workers
+-- of each Datanode.  The results must not depend on how the pages of the
+-- table were shared out.
+CREATE TABLE xc_pscan (a int, b int, c text) DISTRIBUTE BY HASH (b);
+INSERT INTO xc_pscan SELECT i, i % 100, repeat('x', 50)
+	FROM generate_series(1, 20000) i;
+ANALYZE xc_pscan;
+SET parallel_scan_degree = 2;
+SET parallel_scan_min_size = 10;
+
+-- plain scan
+SELECT a, b FROM xc_pscan WHERE a % 2000 = 0 ORDER BY a;
+SELECT count(*), sum(a), max(a) FROM xc_pscan;
+
+-- hashed grouping, the HAVING clause applied after combining the workers
+SET enable_sort = off;
+SELECT b, count(*), sum(a) FROM xc_pscan
+	GROUP BY b HAVING sum(a) > 2008000 AND min(a) > 0 ORDER BY b;
+RESET enable_sort;
+
+-- an error in a worker is raised as it is in the backend
+\set VERBOSITY terse
+SELECT count(*) FROM xc_pscan WHERE 100 / (a % 5000) > 0;
+\set VERBOSITY default
+SELECT count(*), sum(a), max(a) FROM xc_pscan;
+
+RESET parallel_scan_degree;
+RESET parallel_scan_min_size;
+DROP TABLE xc_pscan;
@@ -0,0 +1,90 @@
+--
+-- XC_PLANSHIP
+--
+
+-- Plans made by one Datanode and shipped to the others with
+-- enable_plan_shipping.  Each query runs on several Datanodes, first with
+-- every Datanode planning it, then with plans shipped; the results must
+-- be the same.  The queries cover the plan and expression nodes a shipped
+-- plan may contain, which the receiving nodes read back with stringToNode.
+CREATE TABLE xc_ps_t1 (id int, grp int, val numeric, name text, arr int[])
+	DISTRIBUTE BY HASH (id);
+CREATE TABLE xc_ps_t2 (id int, t1_id int, note varchar(20))
+	DISTRIBUTE BY HASH (t1_id);
+CREATE INDEX xc_ps_t1_grp ON xc_ps_t1 (grp);
+INSERT INTO xc_ps_t1
+	SELECT i, i % 10, i * 1.5, 'n' || i, ARRAY[i, i % 7]
+	FROM generate_series(1, 200) i;
+INSERT INTO xc_ps_t2
+	SELECT i, i % 200 + 1, 'x' || i % 3
+	FROM generate_series(1, 300) i;
+ANALYZE xc_ps_t1;
+ANALYZE xc_ps_t2;
+
+-- scan with a filter
+\set q1 'select id, val from xc_ps_t1 where grp = 3 and val > 100 order by id'
+SET enable_plan_shipping TO off;
+:q1;
+SET enable_plan_shipping TO on;
+:q1;
+
+-- grouping, with array subscripts
+\set q2 'select grp, count(*), sum(val), min(name), max(arr[2]) from xc_ps_t1 group by grp order by grp'
+SET enable_plan_shipping TO off;
+:q2;
+SET enable_plan_shipping TO on;
+:q2;
+
+-- join on the distribution keys
+\set q3 'select count(*), sum(t1.val), count(distinct t2.note) from xc_ps_t1 t1 join xc_ps_t2 t2 on t1.id = t2.t1_id where t1.grp < 5'
+SET enable_plan_shipping TO off;
+:q3;
+SET enable_plan_shipping TO on;
+:q3;
+
+-- index scan
+\set q4 'select id, name from xc_ps_t1 where grp = 7 and id < 50 order by id'
+SET enable_seqscan TO off;
+SET enable_plan_shipping TO off;
+:q4;
+SET enable_plan_shipping TO on;
+:q4;
+RESET enable_seqscan;
+
+-- window function
+\set q5 'select grp, id from (select grp, id, row_number() over (partition by grp order by id desc) as rn from xc_ps_t1) s where rn = 1 order by grp'
+SET enable_plan_shipping TO off;
+:q5;
+SET enable_plan_shipping TO on;
+:q5;
+
+-- CASE, NULLIF, ANY and boolean expressions
+\set q6 'select sum(case when id % 2 = 0 then val else 0 end), count(nullif(grp, 0)), count(case when id = any (array[5, 15, 25]) then 1 end), bool_and(id in (1, 2, 3) or id > 3 and not name is null) from xc_ps_t1'
+SET enable_plan_shipping TO off;
+:q6;
+SET enable_plan_shipping TO on;
+:q6;
+
+-- DISTINCT
+\set q7 'select distinct grp from xc_ps_t1 where id between 10 and 15 order by grp'
+SET enable_plan_shipping TO off;
+:q7;
+SET enable_plan_shipping TO on;
+:q7;
+
+-- correlated EXISTS
+\set q8 'select count(*) from xc_ps_t1 t1 where exists (select 1 from xc_ps_t2 t2 where t2.t1_id = t1.id and t2.id > 250)'
+SET enable_plan_shipping TO off;
+:q8;
+SET enable_plan_shipping TO on;
+:q8;
+
+-- grouping with HAVING
+\set q9 'select count(*) from (select t1_id, count(*) from xc_ps_t2 group by t1_id having count(*) > 1) s'
+SET enable_plan_shipping TO off;
+:q9;
+SET enable_plan_shipping TO on;
+:q9;
+
+RESET enable_plan_shipping;
+DROP TABLE xc_ps_t1, xc_ps_t2;
@@ -246,6 +246,42 @@ insert into xcrem_employee select * from xcrem_temptable;
 :SEL;
 
 
+-- Append over remote subplans on different Datanodes, which are sent down
+-- together, rescanned for each outer row
+select create_table_nodes('xcrem_app1 (a int)', '{1}'::int[], 'replication', NULL);
+select create_table_nodes('xcrem_app2 (a int)', '{2}'::int[], 'replication', NULL);
+INSERT INTO xcrem_app1 SELECT generate_series(1, 10);
+INSERT INTO xcrem_app2 SELECT generate_series(11, 15);
+SELECT x, (SELECT sum(CASE WHEN a <= x * 5 THEN 1 ELSE 0 END)
+           FROM (SELECT a FROM xcrem_app1 UNION ALL SELECT a FROM xcrem_app2) u) AS c
+  FROM generate_series(1, 3) x ORDER BY x;
+SET enable_material TO false;
+SELECT x, count(*)
+  FROM generate_series(1, 3) x
+  JOIN (SELECT a FROM xcrem_app1 UNION ALL SELECT a FROM xcrem_app2) u ON u.a <= x * 5
+  GROUP BY x ORDER BY x;
+RESET enable_material;
+-- Append over remote subplans sharing Datanodes, whose rows are read in
+-- the order they arrive
+select create_table_nodes('xcrem_app3 (a int)', '{1, 2}'::int[], 'hash(a)', NULL);
+INSERT INTO xcrem_app3 SELECT generate_series(16, 30);
+SELECT count(*), sum(a), min(a), max(a)
+  FROM (SELECT a FROM xcrem_app1 UNION ALL SELECT a FROM xcrem_app3
+        UNION ALL SELECT a FROM xcrem_app2 UNION ALL SELECT a + 100 FROM xcrem_app1) u;
+SELECT count(*)
+  FROM (SELECT a FROM xcrem_app1 UNION ALL SELECT a FROM xcrem_app3
+        UNION ALL SELECT a FROM xcrem_app2 LIMIT 7) u;
+SELECT count(*) FROM xcrem_app3;
+SET enable_material TO false;
+SELECT x, count(*)
+  FROM generate_series(1, 3) x
+  JOIN (SELECT a FROM xcrem_app1 UNION ALL SELECT a FROM xcrem_app3
+        UNION ALL SELECT a FROM xcrem_app2) u ON u.a <= x * 10
+  GROUP BY x ORDER BY x;
+RESET enable_material;
+DROP TABLE xcrem_app1, xcrem_app2, xcrem_app3;
+
+
 -- Clean up
 DROP TABLE rel_rep, rel_hash, rel_rr;
 DROP FUNCTION func_stable (int);
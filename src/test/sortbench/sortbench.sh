@@ -0,0 +1,55 @@
+#!/bin/sh
+#-------------------------------------------------------------------------
+#
+# sortbench.sh
+#		Time external sorts over a range of work_mem settings.
+#
+# Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+#
+# src/test/sortbench/sortbench.sh
+#
+#-------------------------------------------------------------------------
+
+DBNAME=${1:-postgres}
+ROWS=${ROWS:-2000000}
+WORK_MEMS=${WORK_MEMS:-"1MB 4MB 16MB 64MB 256MB"}
+LOOPS=${LOOPS:-5}
+
+PSQL="psql -X -q -v ON_ERROR_STOP=1 -d $DBNAME"
+SCRIPT=`mktemp ${TMPDIR:-/tmp}/sortbench.XXXXXX` || exit 1
+trap 'rm -f $SCRIPT' 0
+
+nrows=`$PSQL -A -t -c "SELECT count(*) FROM sortbench_data" 2>/dev/null`
+if [ "$nrows" != "$ROWS" ]; then
+	echo "creating sortbench_data with $ROWS rows"
+	$PSQL <<SQL || exit 1
+DROP TABLE IF EXISTS sortbench_data;
+CREATE TABLE sortbench_data (i int4, t text, n numeric)
+	DISTRIBUTE BY REPLICATION;
+INSERT INTO sortbench_data
+	SELECT r, md5(r::text), r / 7.0
+	FROM (SELECT (random() * 1000000000)::int4 AS r
+		  FROM generate_series(1, $ROWS)) s;
+VACUUM ANALYZE sortbench_data;
+SQL
+fi
+
+printf "%-10s %-8s %12s\n" work_mem key "latency ms"
+for wm in $WORK_MEMS; do
+	for col in i t n; do
+		# SET is sent on to the Datanode; OFFSET keeps the sort from being
+		# flattened away or bounded
+		cat > $SCRIPT <<SQL
+SET work_mem = '$wm';
+SELECT count(*) FROM (SELECT $col FROM sortbench_data ORDER BY $col OFFSET 0) s;
+SQL
+		out=`pgbench -n -t $LOOPS -f $SCRIPT $DBNAME 2>&1`
+		lat=`echo "$out" | sed -n 's/^latency average[^0-9]*\([0-9.]*\).*/\1/p'`
+		if [ -z "$lat" ]; then
+			# older pgbench only prints tps; derive the latency from it
+			lat=`echo "$out" | sed -n 's/^tps = \([0-9.]*\) (excluding.*/\1/p' |
+				awk '{ if ($1 > 0) printf "%.1f", 1000 / $1 }'`
+		fi
+		printf "%-10s %-8s %12s\n" $wm $col "$lat"
+	done
+done
@@ -0,0 +1,62 @@
+#!/bin/sh
+#-------------------------------------------------------------------------
+#
+# walbench.sh
+#		Time concurrent INSERTs over a range of client counts.
+#
+# Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+#
+# src/test/walbench/walbench.sh
+#
+#-------------------------------------------------------------------------
+
+DBNAME=${1:-postgres}
+CLIENTS=${CLIENTS:-"1 2 4 8 16 32"}
+DURATION=${DURATION:-30}
+INSERTS=${INSERTS:-10}
+
+PSQL="psql -X -q -v ON_ERROR_STOP=1 -d $DBNAME"
+SCRIPT=`mktemp ${TMPDIR:-/tmp}/walbench.XXXXXX` || exit 1
+trap 'rm -f $SCRIPT' 0
+
+maxclients=`echo $CLIENTS | tr ' ' '\n' | sort -n | tail -1`
+
+# One table per client, walbench_0 to walbench_<maxclients - 1>
+run_tables()
+{
+	i=0
+	while [ $i -lt $maxclients ]; do
+		echo "$1" | sed "s/%/$i/g"
+		i=`expr $i + 1`
+	done | $PSQL || exit 1
+}
+
+run_tables "DROP TABLE IF EXISTS walbench_%;
+CREATE TABLE walbench_% (a int4, b int4, t text) DISTRIBUTE BY HASH (a);"
+
+# pgbench replaces :client_id with the number of the client, 0 to N - 1
+echo "BEGIN;" > $SCRIPT
+i=0
+while [ $i -lt $INSERTS ]; do
+	echo "INSERT INTO walbench_:client_id VALUES ($i, :client_id, repeat('x', 100));" >> $SCRIPT
+	i=`expr $i + 1`
+done
+echo "COMMIT;" >> $SCRIPT
+
+printf "%8s %12s %12s %8s\n" clients tps "rows/s" speedup
+first=
+for c in $CLIENTS; do
+	run_tables "TRUNCATE walbench_%;"
+	$PSQL -c "CHECKPOINT;"
+	out=`pgbench -n -c $c -j $c -T $DURATION -f $SCRIPT $DBNAME 2>&1`
+	tps=`echo "$out" | sed -n 's/^tps = \([0-9.]*\) (excluding.*/\1/p'`
+	if [ -z "$tps" ]; then
+		echo "$out" >&2
+		exit 1
+	fi
+	[ -z "$first" ] && first=$tps
+	echo "$c $tps $INSERTS $first" |
+		awk '{ printf "%8d %12.1f %12.0f %8.2f\n", $1, $2, $2 * $3, $2 / $4 }'
+done
+
+run_tables "DROP TABLE walbench_%;"